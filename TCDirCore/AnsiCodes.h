@@ -43,6 +43,7 @@ namespace AnsiCodes
     constexpr const wchar_t * CURSOR_TO_COLUMN_FORMAT = CSI L"{}G";           // Move cursor to 1-based column N (use with format)
     constexpr const wchar_t * ERASE_LINE              = L"\r" CSI L"2K";      // Move to column 0 and erase entire line
     constexpr const wchar_t * ERASE_ENTIRE_LINE       = CSI L"2K";            // Erase entire line, leaving the cursor in place
+    constexpr const wchar_t * CLEAR_SCREEN            = CSI L"H" CSI L"2J" CSI L"3J";  // Cursor home, erase the screen and the scrollback
 
     //
     // SGR color shortcuts for TUI widgets
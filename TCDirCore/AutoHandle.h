@@ -111,4 +111,11 @@ using AutoInternetHandle = CAutoHandleT<HANDLE, INVALID_HANDLE_VALUE, InternetCl
 //  RegCreateKeyEx.
 //
 
-using CAutoRegKey = CAutoHandleT<HKEY, nullptr, RegCloseKey>;
\ No newline at end of file
+using CAutoRegKey = CAutoHandleT<HKEY, nullptr, RegCloseKey>;
+
+//
+//  A MapViewOfFile view, also invalid as nullptr.  The wrapper converts to
+//  the view's base address.
+//
+
+using CAutoMappedView = CAutoHandleT<LPVOID, nullptr, UnmapViewOfFile>;
\ No newline at end of file
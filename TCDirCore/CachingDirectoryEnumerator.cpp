@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "CachingDirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCachingDirectoryEnumerator::CCachingDirectoryEnumerator
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CCachingDirectoryEnumerator::CCachingDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pInner, shared_ptr<CListingCache> pCache, bool fRefresh) :
+    m_pInner   (move (pInner)),
+    m_pCache   (move (pCache)),
+    m_fRefresh (fRefresh)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCachingDirectoryEnumerator::Enumerate
+//
+//  The stamp is read before the directory, so a change made while it is
+//  being read leaves a record whose stamp is already out of date: the next
+//  run reads the directory again rather than trusting a stale listing.
+//
+//  Only a read that ran to the end and succeeded is stored.  A miss always
+//  reads the 8.3 names, whether or not this caller needs them, so that the
+//  record can serve any later listing of the directory.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCachingDirectoryEnumerator::Enumerate (
+    const filesystem::path & dirPath,
+    const filesystem::path & fileSpec,
+    bool                     fNeedShortNames,
+    const BatchCallback    & onBatch) const
+{
+    HRESULT                 hr        = S_OK;
+    ULONGLONG               ullStamp  = 0;
+    bool                    fComplete = true;
+    vector<WIN32_FIND_DATA> vEntries;
+
+
+
+    if (fileSpec != L"*" || FAILED (m_pInner->GetDirectoryStamp (dirPath, ullStamp)))
+    {
+        return m_pInner->Enumerate (dirPath, fileSpec, fNeedShortNames, onBatch);
+    }
+
+    if (!m_fRefresh && m_pCache->Lookup (dirPath, ullStamp, vEntries))
+    {
+        span<const WIN32_FIND_DATA> entries (vEntries);
+
+        for (size_t i = 0; i < entries.size(); i += s_kcEntriesPerBatch)
+        {
+            if (!onBatch (entries.subspan (i, (std::min) (s_kcEntriesPerBatch, entries.size() - i))))
+            {
+                break;
+            }
+        }
+
+        return S_OK;
+    }
+
+    hr = m_pInner->Enumerate (dirPath, fileSpec, true, [&] (span<const WIN32_FIND_DATA> batch)
+    {
+        vEntries.insert (vEntries.end(), batch.begin(), batch.end());
+
+        fComplete = onBatch (batch);
+        return fComplete;
+    });
+
+    if (hr == S_OK && fComplete)
+    {
+        m_pCache->Store (dirPath, ullStamp, vEntries);
+    }
+
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCachingDirectoryEnumerator::GetDirectoryId
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCachingDirectoryEnumerator::GetDirectoryId (
+    const filesystem::path & dirPath,
+    SDirectoryId           & id) const
+{
+    return m_pInner->GetDirectoryId (dirPath, id);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCachingDirectoryEnumerator::GetDirectoryStamp
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCachingDirectoryEnumerator::GetDirectoryStamp (
+    const filesystem::path & dirPath,
+    ULONGLONG              & ullStamp) const
+{
+    return m_pInner->GetDirectoryStamp (dirPath, ullStamp);
+}
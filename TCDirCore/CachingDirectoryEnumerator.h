@@ -0,0 +1,51 @@
+#pragma once
+
+#include "IDirectoryEnumerator.h"
+#include "ListingCache.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCachingDirectoryEnumerator
+//
+//  --Cache: wraps another enumerator and serves whole-directory reads from
+//  a CListingCache when the directory's stamp matches the cached one,
+//  storing every read it does pass through.  Reads with a narrower spec
+//  always go to the wrapped enumerator.  Records keep the 8.3 names, so a
+//  record serves reads that need them (masked listings) as well as those
+//  that do not.  With fRefresh every directory is read again and its
+//  record replaced.
+//
+//  Shared by all the enumeration workers, like any IDirectoryEnumerator;
+//  the cache does its own locking.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CCachingDirectoryEnumerator : public IDirectoryEnumerator
+{
+public:
+    CCachingDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pInner, shared_ptr<CListingCache> pCache, bool fRefresh);
+
+    HRESULT Enumerate (const filesystem::path & dirPath,
+                       const filesystem::path & fileSpec,
+                       bool                     fNeedShortNames,
+                       const BatchCallback    & onBatch) const override;
+
+    HRESULT GetDirectoryId (const filesystem::path & dirPath,
+                            SDirectoryId           & id) const override;
+
+    HRESULT GetDirectoryStamp (const filesystem::path & dirPath,
+                               ULONGLONG              & ullStamp) const override;
+
+    static constexpr size_t s_kcEntriesPerBatch = 64;
+
+
+
+private:
+    shared_ptr<IDirectoryEnumerator> m_pInner;
+    shared_ptr<CListingCache>        m_pCache;
+    bool                             m_fRefresh;
+};
@@ -0,0 +1,276 @@
+#include "pch.h"
+#include "CaseFolding.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCaseFolding::Upcase
+//
+//  Writes the upcased form of text to pszUpcased and returns its length, or
+//  0 if text does not fit in cchUpcased characters or cannot be mapped.
+//  The output is not null-terminated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+size_t CCaseFolding::Upcase (wstring_view text, wchar_t * pszUpcased, size_t cchUpcased)
+{
+    size_t cchResult = 0;
+
+
+
+    if (text.empty() || text.size() > cchUpcased)
+    {
+        cchResult = 0;
+    }
+    else if (TryUpcaseAscii (text, pszUpcased))
+    {
+        cchResult = text.size();
+    }
+    else
+    {
+        cchResult = LCMapStringEx (LOCALE_NAME_INVARIANT,
+                                   LCMAP_UPPERCASE,
+                                   text.data(),
+                                   static_cast<int> (text.size()),
+                                   pszUpcased,
+                                   static_cast<int> (cchUpcased),
+                                   nullptr,
+                                   nullptr,
+                                   0);
+    }
+
+    return cchResult;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCaseFolding::TryUpcaseAscii
+//
+//  Folds a-z to A-Z and returns true if every character is ASCII.  Returns
+//  false as soon as a non-ASCII character is seen; the contents of
+//  pszUpcased are then unspecified.  pszUpcased must hold text.size()
+//  characters.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CCaseFolding::TryUpcaseAscii (wstring_view text, wchar_t * pszUpcased)
+{
+    static constexpr size_t s_kcchVector = 8;
+
+    const wchar_t * pch = text.data();
+    size_t          cch = text.size();
+    size_t          i   = 0;
+
+
+
+#if defined(_M_X64) || defined(_M_IX86)
+    const __m128i kNonAsciiMask = _mm_set1_epi16 (static_cast<short> (0xFF80));
+    const __m128i kBeforeLowerA = _mm_set1_epi16 (L'a' - 1);
+    const __m128i kAfterLowerZ  = _mm_set1_epi16 (L'z' + 1);
+    const __m128i kCaseBit      = _mm_set1_epi16 (0x20);
+
+    for (; i + s_kcchVector <= cch; i += s_kcchVector)
+    {
+        __m128i chars = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (pch + i));
+
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_and_si128 (chars, kNonAsciiMask), _mm_setzero_si128())) != 0xFFFF)
+        {
+            return false;
+        }
+
+        // ASCII lanes are non-negative, so the signed compares are safe
+        __m128i isLower = _mm_and_si128 (_mm_cmpgt_epi16 (chars, kBeforeLowerA),
+                                         _mm_cmplt_epi16 (chars, kAfterLowerZ));
+
+        chars = _mm_sub_epi16 (chars, _mm_and_si128 (isLower, kCaseBit));
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (pszUpcased + i), chars);
+    }
+#elif defined(_M_ARM64)
+    const uint16x8_t kLowerA  = vdupq_n_u16 (L'a');
+    const uint16x8_t kLowerZ  = vdupq_n_u16 (L'z');
+    const uint16x8_t kCaseBit = vdupq_n_u16 (0x20);
+
+    for (; i + s_kcchVector <= cch; i += s_kcchVector)
+    {
+        uint16x8_t chars = vld1q_u16 (reinterpret_cast<const uint16_t *> (pch + i));
+
+        if (vmaxvq_u16 (chars) > 0x7F)
+        {
+            return false;
+        }
+
+        uint16x8_t isLower = vandq_u16 (vcgeq_u16 (chars, kLowerA), vcleq_u16 (chars, kLowerZ));
+
+        chars = vsubq_u16 (chars, vandq_u16 (isLower, kCaseBit));
+        vst1q_u16 (reinterpret_cast<uint16_t *> (pszUpcased + i), chars);
+    }
+#endif
+
+    //
+    // Scalar tail (and the whole string on other architectures)
+    //
+
+    for (; i < cch; ++i)
+    {
+        wchar_t ch = pch[i];
+
+        if (ch > 0x7F)
+        {
+            return false;
+        }
+
+        pszUpcased[i] = (ch >= L'a' && ch <= L'z') ? static_cast<wchar_t> (ch - 0x20) : ch;
+    }
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCaseFolding::CompareOrdinalIgnoreCase
+//
+//  Returns <0, 0, or >0 as lhs sorts before, with, or after rhs when both
+//  are upcased unit by unit.  Runs of ASCII are folded and compared eight
+//  units at a time; the first block that is not pure ASCII, or that holds
+//  a difference, is finished by the table loop.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int CCaseFolding::CompareOrdinalIgnoreCase (wstring_view lhs, wstring_view rhs)
+{
+    static constexpr size_t s_kcchVector = 8;
+
+    const array<wchar_t, 0x10000> & upcase = GetUpcaseTable();
+    size_t                          cch    = (std::min) (lhs.size(), rhs.size());
+    size_t                          i      = 0;
+
+
+
+#if defined(_M_X64) || defined(_M_IX86)
+    const __m128i kNonAsciiMask = _mm_set1_epi16 (static_cast<short> (0xFF80));
+    const __m128i kBeforeLowerA = _mm_set1_epi16 (L'a' - 1);
+    const __m128i kAfterLowerZ  = _mm_set1_epi16 (L'z' + 1);
+    const __m128i kCaseBit      = _mm_set1_epi16 (0x20);
+
+    for (; i + s_kcchVector <= cch; i += s_kcchVector)
+    {
+        __m128i lhsChars = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (lhs.data() + i));
+        __m128i rhsChars = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (rhs.data() + i));
+
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_and_si128 (_mm_or_si128 (lhsChars, rhsChars), kNonAsciiMask), _mm_setzero_si128())) != 0xFFFF)
+        {
+            break;
+        }
+
+        lhsChars = _mm_sub_epi16 (lhsChars, _mm_and_si128 (_mm_and_si128 (_mm_cmpgt_epi16 (lhsChars, kBeforeLowerA), _mm_cmplt_epi16 (lhsChars, kAfterLowerZ)), kCaseBit));
+        rhsChars = _mm_sub_epi16 (rhsChars, _mm_and_si128 (_mm_and_si128 (_mm_cmpgt_epi16 (rhsChars, kBeforeLowerA), _mm_cmplt_epi16 (rhsChars, kAfterLowerZ)), kCaseBit));
+
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (lhsChars, rhsChars)) != 0xFFFF)
+        {
+            break;
+        }
+    }
+#elif defined(_M_ARM64)
+    const uint16x8_t kLowerA  = vdupq_n_u16 (L'a');
+    const uint16x8_t kLowerZ  = vdupq_n_u16 (L'z');
+    const uint16x8_t kCaseBit = vdupq_n_u16 (0x20);
+
+    for (; i + s_kcchVector <= cch; i += s_kcchVector)
+    {
+        uint16x8_t lhsChars = vld1q_u16 (reinterpret_cast<const uint16_t *> (lhs.data() + i));
+        uint16x8_t rhsChars = vld1q_u16 (reinterpret_cast<const uint16_t *> (rhs.data() + i));
+
+        if (vmaxvq_u16 (vorrq_u16 (lhsChars, rhsChars)) > 0x7F)
+        {
+            break;
+        }
+
+        lhsChars = vsubq_u16 (lhsChars, vandq_u16 (vandq_u16 (vcgeq_u16 (lhsChars, kLowerA), vcleq_u16 (lhsChars, kLowerZ)), kCaseBit));
+        rhsChars = vsubq_u16 (rhsChars, vandq_u16 (vandq_u16 (vcgeq_u16 (rhsChars, kLowerA), vcleq_u16 (rhsChars, kLowerZ)), kCaseBit));
+
+        if (vminvq_u16 (vceqq_u16 (lhsChars, rhsChars)) == 0)
+        {
+            break;
+        }
+    }
+#endif
+
+    //
+    // Table loop: the rest of the string, or the block the vector loop
+    // stopped at
+    //
+
+    for (; i < cch; ++i)
+    {
+        wchar_t chLhs = upcase[lhs[i]];
+        wchar_t chRhs = upcase[rhs[i]];
+
+        if (chLhs != chRhs)
+        {
+            return (chLhs < chRhs) ? -1 : 1;
+        }
+    }
+
+    return (lhs.size() < rhs.size()) ? -1 : (lhs.size() > rhs.size()) ? 1 : 0;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCaseFolding::GetUpcaseTable
+//
+//  Maps every UTF-16 unit to its invariant simple uppercase, like the
+//  $UpCase table NTFS compares names with.  Surrogates map to themselves;
+//  a range the mapping cannot convert one-for-one is left unchanged.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const array<wchar_t, 0x10000> & CCaseFolding::GetUpcaseTable (void)
+{
+    static const unique_ptr<array<wchar_t, 0x10000>> s_pTable = []
+    {
+        static constexpr pair<size_t, size_t> s_krgRanges[] = { { 0x0001, 0xD800 }, { 0xE000, 0x10000 } };
+
+        auto            pTable = make_unique<array<wchar_t, 0x10000>>();
+        vector<wchar_t> vMapped;
+
+
+
+        for (size_t ch = 0; ch < pTable->size(); ++ch)
+        {
+            (*pTable)[ch] = static_cast<wchar_t> (ch);
+        }
+
+        for (const auto & [chFirst, chEnd] : s_krgRanges)
+        {
+            int cch = static_cast<int> (chEnd - chFirst);
+
+            vMapped.resize (cch);
+
+            if (LCMapStringEx (LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, pTable->data() + chFirst, cch, vMapped.data(), cch, nullptr, nullptr, 0) == cch)
+            {
+                copy (vMapped.begin(), vMapped.end(), pTable->begin() + chFirst);
+            }
+        }
+
+        return pTable;
+    }();
+
+
+
+    return *s_pTable;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCaseFolding
+//
+//  Upcases file names the way the file system compares them.  Pure-ASCII
+//  names (the overwhelming majority) are folded eight UTF-16 units at a
+//  time with SSE2 on x64 or NEON on ARM64; anything else goes through the
+//  invariant locale's simple uppercase mapping.
+//
+//  CompareOrdinalIgnoreCase orders names the way NTFS does: each UTF-16
+//  unit is upcased through a 64K-entry table (the same mapping, built
+//  once) and the results compare as unsigned integers.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CCaseFolding
+{
+public:
+    static size_t  Upcase                   (wstring_view text, wchar_t * pszUpcased, size_t cchUpcased);
+    static bool    TryUpcaseAscii           (wstring_view text, wchar_t * pszUpcased);
+    static wchar_t UpcaseChar               (wchar_t ch) { return GetUpcaseTable()[ch]; }
+    static int     CompareOrdinalIgnoreCase (wstring_view lhs, wstring_view rhs);
+
+private:
+    static const array<wchar_t, 0x10000> & GetUpcaseTable (void);
+};
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "ChangeCoalescer.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CChangeCoalescer::CChangeCoalescer
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CChangeCoalescer::CChangeCoalescer (IChangeNotifier & notifier, chrono::milliseconds quietPeriod, chrono::milliseconds maxDelay) :
+    m_notifier    (notifier),
+    m_quietPeriod (quietPeriod),
+    m_maxDelay    (maxDelay)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CChangeCoalescer::Wait
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CChangeCoalescer::Wait (SChangeSet & changes)
+{
+    HRESULT                          hr = S_OK;
+    chrono::steady_clock::time_point deadline;
+
+
+
+    do
+    {
+        hr = m_notifier.WaitForChanges (INFINITE, changes);
+        CHR (hr);
+    }
+    while (changes.IsEmpty());
+
+    deadline = chrono::steady_clock::now() + m_maxDelay;
+
+    for (;;)
+    {
+        auto remaining = chrono::duration_cast<chrono::milliseconds> (deadline - chrono::steady_clock::now());
+
+        BAIL_OUT_IF (remaining <= chrono::milliseconds::zero(), S_OK);
+
+        hr = m_notifier.WaitForChanges (static_cast<DWORD> ((min) (remaining, m_quietPeriod).count()), changes);
+        CHR (hr);
+
+        BAIL_OUT_IF (hr == S_FALSE, S_OK);
+    }
+
+
+
+Error:
+    return hr;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "IChangeNotifier.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CChangeCoalescer
+//
+//  --Watch: turns a burst of change notifications into one set of changed
+//  directories.  Wait blocks until something changes, then keeps adding to
+//  the set until nothing has changed for the quiet period, or until the
+//  maximum delay since the first change has passed, so a build writing
+//  thousands of files redraws the listing every couple of seconds at most
+//  rather than once per file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CChangeCoalescer
+{
+public:
+    static constexpr chrono::milliseconds s_kDefaultQuietPeriod { 250 };
+    static constexpr chrono::milliseconds s_kDefaultMaxDelay    { 2000 };
+
+    CChangeCoalescer (IChangeNotifier    & notifier,
+                      chrono::milliseconds quietPeriod = s_kDefaultQuietPeriod,
+                      chrono::milliseconds maxDelay    = s_kDefaultMaxDelay);
+
+    HRESULT Wait (SChangeSet & changes);
+
+
+
+private:
+    IChangeNotifier    & m_notifier;
+    chrono::milliseconds m_quietPeriod;
+    chrono::milliseconds m_maxDelay;
+};
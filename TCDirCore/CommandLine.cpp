@@ -2,6 +2,7 @@
 #include "CommandLine.h"
 
 #include "Config.h"
+#include "MaskGrouper.h"
 
 
 
@@ -87,6 +88,8 @@ void CCommandLine::ApplyConfigDefaults (const CConfig & config)
 
     if (config.m_eSizeFormat.has_value() &&
         m_eSizeFormat == ESizeFormat::Default)                  m_eSizeFormat    = config.m_eSizeFormat.value();
+
+    if (config.m_cThreads.has_value())                         m_cThreads       = config.m_cThreads.value();
 }
 
 
@@ -103,6 +106,14 @@ void CCommandLine::ApplyConfigDefaults (const CConfig & config)
 
 HRESULT CCommandLine::Parse (int cArg, WCHAR ** ppszArg)
 {
+    // Indexed by ETimeField
+    static constexpr FILETIME WIN32_FIND_DATA::* s_krgpftTimeFields[] =
+    {
+        &WIN32_FIND_DATA::ftLastWriteTime,
+        &WIN32_FIND_DATA::ftCreationTime,
+        &WIN32_FIND_DATA::ftLastAccessTime,
+    };
+
     HRESULT hr = S_OK; 
 
 
@@ -143,6 +154,13 @@ HRESULT CCommandLine::Parse (int cArg, WCHAR ** ppszArg)
         ++ppszArg;       
     }
 
+    //
+    // Compile the entry filters now that the /T: field they compare dates
+    // against is known (it may follow them)
+    //
+
+    m_entryFilter.Compile (s_krgpftTimeFields[static_cast<size_t> (m_timeField)]);
+
     //
     // Post-parse validation: check switch conflicts
     //
@@ -150,6 +168,12 @@ HRESULT CCommandLine::Parse (int cArg, WCHAR ** ppszArg)
     hr = ValidateSwitchCombinations();
     CHR (hr);
 
+    // A snapshot or a diff always covers the whole tree
+    if (!m_strSnapshotFile.empty() || !m_strDiffBase.empty())
+    {
+        m_fRecurse = true;
+    }
+
 
 
 Error:
@@ -161,7 +185,7 @@ Error:
 
     if (m_eSizeFormat == ESizeFormat::Default)
     {
-        m_eSizeFormat = m_fTree ? ESizeFormat::Auto : ESizeFormat::Bytes;
+        m_eSizeFormat = (m_fTree || m_fUsage) ? ESizeFormat::Auto : ESizeFormat::Bytes;
     }
 
     return hr;
@@ -297,6 +321,15 @@ HRESULT CCommandLine::ValidateSwitchCombinations (void)
     hr = ValidateNerdFontCombinations();
     CHR (hr);
 
+    hr = ValidateSnapshotCombinations();
+    CHR (hr);
+
+    hr = ValidateWatchCombinations();
+    CHR (hr);
+
+    hr = ValidateGlobCombinations();
+    CHR (hr);
+
 Error:
     return hr;
 }
@@ -311,6 +344,8 @@ Error:
 //
 //  Tree mode is incompatible with several listing switches, and the
 //  --Depth / --TreeIndent options require tree mode (and have ranges).
+//  --Usage draws a tree of directories too: it takes --Depth and
+//  --TreeIndent, and conflicts with the per-file listing switches.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -343,10 +378,19 @@ HRESULT CCommandLine::ValidateTreeCombinations (void)
         { &CCommandLine::m_fShowOwner,    L"--Tree and --Owner cannot be used together." },
     };
 
+    static constexpr SBoolConflict s_krgUsageConflicts[] =
+    {
+        { &CCommandLine::m_fTree,         L"--Usage and --Tree cannot be used together." },
+        { &CCommandLine::m_fWideListing,  L"--Usage and -W (wide) cannot be used together." },
+        { &CCommandLine::m_fBareListing,  L"--Usage and -B (bare) cannot be used together." },
+        { &CCommandLine::m_fShowOwner,    L"--Usage and --Owner cannot be used together." },
+        { &CCommandLine::m_fShowStreams,  L"--Usage and --Streams cannot be used together." },
+    };
+
     static constexpr SIntRequirement s_krgTreeRequirements[] =
     {
-        { &CCommandLine::m_cMaxDepth,    0, L"--Depth requires --Tree.",       false, 0, 0, nullptr },
-        { &CCommandLine::m_cTreeIndent,  4, L"--TreeIndent requires --Tree.",  true,  1, 8, L"--TreeIndent must be between 1 and 8." },
+        { &CCommandLine::m_cMaxDepth,    0, L"--Depth requires --Tree or --Usage.",       false, 0, 0, nullptr },
+        { &CCommandLine::m_cTreeIndent,  4, L"--TreeIndent requires --Tree or --Usage.",  true,  1, 8, L"--TreeIndent must be between 1 and 8." },
     };
 
 
@@ -360,13 +404,27 @@ HRESULT CCommandLine::ValidateTreeCombinations (void)
 
         CBRFEx (m_eSizeFormat != ESizeFormat::Bytes, E_INVALIDARG,
                 m_strValidationError = L"--Tree and --Size=Bytes cannot be used together.");
+
+        CBRFEx (m_cTop == 0, E_INVALIDARG,
+                m_strValidationError = L"--Tree and --Top cannot be used together.");
+    }
+
+    if (m_fUsage)
+    {
+        for (const SBoolConflict & conflict : s_krgUsageConflicts)
+        {
+            CBRFEx (!(this->*(conflict.pfSwitch)), E_INVALIDARG, m_strValidationError = conflict.pszError);
+        }
+
+        CBRFEx (m_cTop == 0, E_INVALIDARG,
+                m_strValidationError = L"--Usage and --Top cannot be used together.");
     }
 
     for (const SIntRequirement & req : s_krgTreeRequirements)
     {
         int iValue = this->*(req.piValue);
 
-        CBRFEx (m_fTree || iValue == req.iDefaultValue, E_INVALIDARG,
+        CBRFEx (m_fTree || m_fUsage || iValue == req.iDefaultValue, E_INVALIDARG,
                 m_strValidationError = req.pszRequiresTreeError);
 
         CBRFEx (!req.fHasRange || (iValue >= req.iMinValue && iValue <= req.iMaxValue), E_INVALIDARG,
@@ -407,6 +465,7 @@ HRESULT CCommandLine::ValidateAliasCombinations (void)
         &CCommandLine::m_fWideListing,
         &CCommandLine::m_fBareListing,
         &CCommandLine::m_fTree,
+        &CCommandLine::m_fUsage,
         &CCommandLine::m_fShowOwner,
         &CCommandLine::m_fShowStreams,
         &CCommandLine::m_fEnv,
@@ -443,6 +502,137 @@ Error:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCommandLine::ValidateSnapshotCombinations
+//
+//  --Snapshot and --Diff each take one target (a directory, or for --Diff a
+//  second snapshot) and list it through the normal or wide displayer, so
+//  they conflict with each other and with the other whole-listing modes.
+//  Bare output has no section headers to tell added from removed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCommandLine::ValidateSnapshotCombinations (void)
+{
+    HRESULT hr = S_OK;
+
+    static constexpr bool CCommandLine::* s_krgSnapshotConflictSwitches[] =
+    {
+        &CCommandLine::m_fBareListing,
+        &CCommandLine::m_fTree,
+        &CCommandLine::m_fUsage,
+        &CCommandLine::m_fBenchmark,
+    };
+
+
+
+    BAIL_OUT_IF (m_strSnapshotFile.empty() && m_strDiffBase.empty(), S_OK);
+
+    CBRFEx (m_strSnapshotFile.empty() || m_strDiffBase.empty(), E_INVALIDARG,
+            m_strValidationError = L"--Snapshot and --Diff cannot be used together.");
+
+    CBRFEx (!AnyMemberFlagSet (s_krgSnapshotConflictSwitches) && m_cTop == 0, E_INVALIDARG,
+            m_strValidationError = L"--Snapshot and --Diff cannot be combined with -B, --Tree, --Usage, --Top, or --Benchmark.");
+
+    CBRFEx (m_listMask.size() <= 1, E_INVALIDARG,
+            m_strValidationError = L"--Snapshot and --Diff take a single directory (or, for --Diff, a second snapshot).");
+
+    CBRFEx (m_entryFilter.IsEmpty(), E_INVALIDARG,
+            m_strValidationError = L"--Snapshot and --Diff cover every entry and cannot be combined with --Size>N, --Size<N, --Newer, --Older, or --Regex.");
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCommandLine::ValidateWatchCombinations
+//
+//  --Watch redraws a normal, wide, or bare listing.  The tree and --Usage
+//  views, --Top, and the modes that do not list at all are not redrawn,
+//  and --Cache would serve a directory changed in place from its stale
+//  listing.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCommandLine::ValidateWatchCombinations (void)
+{
+    HRESULT hr = S_OK;
+
+    static constexpr bool CCommandLine::* s_krgWatchConflictSwitches[] =
+    {
+        &CCommandLine::m_fTree,
+        &CCommandLine::m_fUsage,
+        &CCommandLine::m_fBenchmark,
+    };
+
+
+
+    BAIL_OUT_IF (!m_fWatch, S_OK);
+
+    CBRFEx (!AnyMemberFlagSet (s_krgWatchConflictSwitches)          &&
+            m_cTop == 0                                             &&
+            m_eCacheMode == ECacheMode::Off                         &&
+            m_strSnapshotFile.empty() && m_strDiffBase.empty(), E_INVALIDARG,
+            m_strValidationError = L"--Watch cannot be combined with --Tree, --Usage, --Top, --Cache, --Snapshot, --Diff, or --Benchmark.");
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CCommandLine::ValidateGlobCombinations
+//
+//  A recursive mask ("**\*.cpp", "src\*\test_*") is matched by the
+//  recursive listing, which prunes the directories it cannot reach.  The
+//  tree and --Usage views show every directory, and --Watch, --Snapshot,
+//  and --Diff take a single directory rather than a mask.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CCommandLine::ValidateGlobCombinations (void)
+{
+    HRESULT hr = S_OK;
+
+    static constexpr bool CCommandLine::* s_krgGlobConflictSwitches[] =
+    {
+        &CCommandLine::m_fTree,
+        &CCommandLine::m_fUsage,
+        &CCommandLine::m_fWatch,
+    };
+
+
+
+    BAIL_OUT_IF (ranges::none_of (m_listMask, CMaskGrouper::IsRecursiveGlob), S_OK);
+
+    CBRFEx (!AnyMemberFlagSet (s_krgGlobConflictSwitches) &&
+            m_strSnapshotFile.empty() && m_strDiffBase.empty(), E_INVALIDARG,
+            m_strValidationError = L"Recursive masks (** or a wildcard in a directory) cannot be combined with --Tree, --Usage, --Watch, --Snapshot, or --Diff.");
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CCommandLine::ValidateNerdFontCombinations
@@ -463,6 +653,7 @@ HRESULT CCommandLine::ValidateNerdFontCombinations (void)
         &CCommandLine::m_fWideListing,
         &CCommandLine::m_fBareListing,
         &CCommandLine::m_fTree,
+        &CCommandLine::m_fUsage,
         &CCommandLine::m_fShowOwner,
         &CCommandLine::m_fShowStreams,
         &CCommandLine::m_fEnv,
@@ -618,6 +809,9 @@ HRESULT CCommandLine::HandleLongSwitch (LPCWSTR pszArg, int & cArg, WCHAR ** & p
         {  L"get-aliases",          &CCommandLine::m_fGetAliases         },
         {  L"remove-aliases",       &CCommandLine::m_fRemoveAliases      },
         {  L"whatif",               &CCommandLine::m_fWhatIf             },
+        {  L"benchmark",            &CCommandLine::m_fBenchmark          },
+        {  L"usage",                &CCommandLine::m_fUsage              },
+        {  L"watch",                &CCommandLine::m_fWatch              },
         {  L"install-nerdfonts",    &CCommandLine::m_fInstallNerdFonts   },
         {  L"install-nerd-fonts",   &CCommandLine::m_fInstallNerdFonts   },
         {  L"uninstall-nerdfonts",  &CCommandLine::m_fUninstallNerdFonts },
@@ -627,6 +821,8 @@ HRESULT CCommandLine::HandleLongSwitch (LPCWSTR pszArg, int & cArg, WCHAR ** & p
 #endif
     };
 
+    static constexpr LPCWSTR s_kpszSizeBoundError = L"--Size bounds are a number of bytes, optionally followed by K, M, G, or T (e.g. >100M or <1.5K).";
+
     HRESULT hr = E_INVALIDARG;
 
     //
@@ -702,7 +898,24 @@ HRESULT CCommandLine::HandleLongSwitch (LPCWSTR pszArg, int & cArg, WCHAR ** & p
     }
 
     //
-    //  Parameterized switches: --Depth=N, --TreeIndent=N
+    //  Size bounds: --Size>N and --Size<N.  The shell takes '>' and '<' for
+    //  redirection, so these must be quoted; --Size=+N and --Size=-N (below)
+    //  need not be.
+    //
+
+    if (hr != S_OK && strSwitch.size() > 4 && _wcsnicmp (strSwitch.c_str(), L"size", 4) == 0 &&
+        (strSwitch[4] == L'>' || strSwitch[4] == L'<'))
+    {
+        hr = m_entryFilter.AddSizeBound (wstring_view (strSwitch).substr (5), strSwitch[4] == L'>');
+        CHRF (hr, m_strValidationError = s_kpszSizeBoundError);
+    }
+
+    //
+    //  Parameterized switches: --Depth=N, --TreeIndent=N, --ReadAhead=N,
+    //  --Threads=N|Auto, --Size=Auto|Bytes|+N|-N, --Follow=Never|Once|Always,
+    //  --Sort=Ordinal|Locale, --Top=N, --Cache=Off|Read|Refresh,
+    //  --Snapshot=<file>, --Diff=<file>, --Newer=<date>, --Older=<date>,
+    //  --Regex=<pattern>
     //  Support both '=' separator and space separator
     //
 
@@ -765,6 +978,44 @@ HRESULT CCommandLine::HandleLongSwitch (LPCWSTR pszArg, int & cArg, WCHAR ** & p
             m_cTreeIndent = n;
             hr = S_OK;
         }
+        else if (_wcsicmp (switchName.c_str(), L"readahead") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            int n = _wtoi (switchValue.c_str());
+
+            if (n < 0)
+            {
+                m_strValidationError = L"--ReadAhead must be zero or a positive integer.";
+                CHR (E_INVALIDARG);
+            }
+
+            m_cReadAhead = n;
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"threads") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            if (_wcsicmp (switchValue.c_str(), L"auto") == 0)
+            {
+                m_cThreads = s_kcThreadsAuto;
+            }
+            else
+            {
+                int n = _wtoi (switchValue.c_str());
+
+                if (n < 1 || n > s_kcMaxThreads)
+                {
+                    m_strValidationError = format (L"--Threads must be Auto or between 1 and {}.", s_kcMaxThreads);
+                    CHR (E_INVALIDARG);
+                }
+
+                m_cThreads = n;
+            }
+
+            hr = S_OK;
+        }
         else if (_wcsicmp (switchName.c_str(), L"size") == 0)
         {
             CBREx (fHasValue, E_INVALIDARG);
@@ -777,9 +1028,125 @@ HRESULT CCommandLine::HandleLongSwitch (LPCWSTR pszArg, int & cArg, WCHAR ** & p
             {
                 m_eSizeFormat = ESizeFormat::Bytes;
             }
+            else if (!switchValue.empty() && (switchValue[0] == L'+' || switchValue[0] == L'-'))
+            {
+                hr = m_entryFilter.AddSizeBound (wstring_view (switchValue).substr (1), switchValue[0] == L'+');
+                CHRF (hr, m_strValidationError = s_kpszSizeBoundError);
+            }
+            else
+            {
+                m_strValidationError = L"--Size must be Auto, Bytes, or a bound such as >100M or <1K.";
+                CHR (E_INVALIDARG);
+            }
+
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"follow") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            if (_wcsicmp (switchValue.c_str(), L"never") == 0)
+            {
+                m_eFollowLinks = EFollowLinks::Never;
+            }
+            else if (_wcsicmp (switchValue.c_str(), L"once") == 0)
+            {
+                m_eFollowLinks = EFollowLinks::Once;
+            }
+            else if (_wcsicmp (switchValue.c_str(), L"always") == 0)
+            {
+                m_eFollowLinks = EFollowLinks::Always;
+            }
+            else
+            {
+                m_strValidationError = L"--Follow must be Never, Once, or Always.";
+                CHR (E_INVALIDARG);
+            }
+
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"sort") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            if (_wcsicmp (switchValue.c_str(), L"ordinal") == 0)
+            {
+                m_eNameCompare = ENameCompare::Ordinal;
+            }
+            else if (_wcsicmp (switchValue.c_str(), L"locale") == 0)
+            {
+                m_eNameCompare = ENameCompare::Locale;
+            }
+            else
+            {
+                m_strValidationError = L"--Sort must be Ordinal or Locale.";
+                CHR (E_INVALIDARG);
+            }
+
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"top") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            int n = _wtoi (switchValue.c_str());
+
+            if (n < 1)
+            {
+                m_strValidationError = L"--Top must be a positive integer.";
+                CHR (E_INVALIDARG);
+            }
+
+            m_cTop = n;
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"snapshot") == 0)
+        {
+            CBREx (fHasValue && !switchValue.empty(), E_INVALIDARG);
+
+            m_strSnapshotFile = switchValue;
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"diff") == 0)
+        {
+            CBREx (fHasValue && !switchValue.empty(), E_INVALIDARG);
+
+            m_strDiffBase = switchValue;
+            hr = S_OK;
+        }
+        else if (_wcsicmp (switchName.c_str(), L"newer") == 0 || _wcsicmp (switchName.c_str(), L"older") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            hr = m_entryFilter.AddTimeBound (switchValue, _wcsicmp (switchName.c_str(), L"newer") == 0);
+            CHRF (hr, m_strValidationError = L"--Newer and --Older take a date: yyyy-mm-dd, optionally followed by Thh:mm or Thh:mm:ss.");
+        }
+        else if (_wcsicmp (switchName.c_str(), L"regex") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            hr = m_entryFilter.AddNamePattern (switchValue);
+            CHRF (hr, m_strValidationError = L"--Regex must be a valid regular expression.");
+        }
+        else if (_wcsicmp (switchName.c_str(), L"cache") == 0)
+        {
+            CBREx (fHasValue, E_INVALIDARG);
+
+            if (_wcsicmp (switchValue.c_str(), L"off") == 0)
+            {
+                m_eCacheMode = ECacheMode::Off;
+            }
+            else if (_wcsicmp (switchValue.c_str(), L"read") == 0)
+            {
+                m_eCacheMode = ECacheMode::Read;
+            }
+            else if (_wcsicmp (switchValue.c_str(), L"refresh") == 0)
+            {
+                m_eCacheMode = ECacheMode::Refresh;
+            }
             else
             {
-                m_strValidationError = L"--Size must be Auto or Bytes.";
+                m_strValidationError = L"--Cache must be Off, Read, or Refresh.";
                 CHR (E_INVALIDARG);
             }
 
@@ -819,6 +1186,20 @@ bool CCommandLine::IsRecognizedLongSwitch (const wstring & strSwitch)
         L"depth",
         L"treeindent",
         L"size",
+        L"readahead",
+        L"threads",
+        L"benchmark",
+        L"usage",
+        L"follow",
+        L"sort",
+        L"top",
+        L"cache",
+        L"snapshot",
+        L"diff",
+        L"watch",
+        L"newer",
+        L"older",
+        L"regex",
         L"set-aliases",
         L"get-aliases",
         L"remove-aliases",
@@ -867,7 +1248,8 @@ HRESULT CCommandLine::OrderByHandler (LPCWSTR pszArg)
         { L'n', ESortOrder::SO_NAME      },
         { L'e', ESortOrder::SO_EXTENSION },
         { L's', ESortOrder::SO_SIZE      },
-        { L'd', ESortOrder::SO_DATE      }
+        { L'd', ESortOrder::SO_DATE      },
+        { L'v', ESortOrder::SO_NATURAL   }
     };
 
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "EntryFilter.h"
 #include "SizeFormat.h"
 
 
@@ -20,6 +21,7 @@ public:
         SO_EXTENSION,       // E  By extension (alphabetic)
         SO_SIZE,            // S  By size (smallest first)
         SO_DATE,            // D  By date/time (oldest first)
+        SO_NATURAL,         // V  By name, with digit runs compared as numbers
 
         __SO_COUNT          // Count of sort orders in this enum
     };
@@ -37,6 +39,30 @@ public:
         TF_ACCESS       // A - ftLastAccessTime
     };
 
+    enum class EFollowLinks
+    {
+        Default,        // Never in tree mode, Always with /S
+        Never,          // List directory links but never descend into them
+        Once,           // Descend through at most one link on any path
+        Always          // Descend through every link, pruning cycles
+    };
+
+    enum class ENameCompare
+    {
+        Ordinal,        // Upcase each UTF-16 unit and compare the values, as NTFS does
+        Locale          // lstrcmpiW in the user's locale
+    };
+
+    enum class ECacheMode
+    {
+        Off,            // Read every directory
+        Read,           // Serve unchanged directories from the listing cache, store the rest
+        Refresh         // Read every directory and replace its cached listing
+    };
+
+    static constexpr int s_kcThreadsAuto = -1;     // --Threads=Auto: adaptive worker count
+    static constexpr int s_kcMaxThreads  = 256;    // Upper bound for --Threads=N
+
 
 
     //
@@ -86,6 +112,18 @@ public:
     int                m_cMaxDepth                                         = 0;        // --Depth=N (0 = unlimited)
     int                m_cTreeIndent                                       = 4;        // --TreeIndent=N (1-8)
     ESizeFormat        m_eSizeFormat                                       = ESizeFormat::Default;  // --Size=Auto|Bytes
+    int                m_cReadAhead                                        = 100000;   // --ReadAhead=N: entries enumerated ahead of the display (0 = unlimited)
+    int                m_cThreads                                          = 0;        // --Threads=N|Auto: enumeration workers (0 = one per CPU, s_kcThreadsAuto = adaptive)
+    bool               m_fBenchmark                                        = false;    // --Benchmark switch (throughput across thread counts)
+    EFollowLinks       m_eFollowLinks                                      = EFollowLinks::Default;  // --Follow=Never|Once|Always
+    ENameCompare       m_eNameCompare                                      = ENameCompare::Ordinal;  // --Sort=Ordinal|Locale: how names and extensions compare
+    bool               m_fUsage                                            = false;    // --Usage switch (recursive size of each directory, as a tree)
+    int                m_cTop                                              = 0;        // --Top=N: only the first N files of the listing in /O order (0 = off)
+    ECacheMode         m_eCacheMode                                        = ECacheMode::Off;  // --Cache=Off|Read|Refresh
+    wstring            m_strSnapshotFile;                                               // --Snapshot=<file>: write the recursive listing to a snapshot file
+    wstring            m_strDiffBase;                                                   // --Diff=<old>: snapshot to compare the target (a directory or a second snapshot) against
+    bool               m_fWatch                                            = false;    // --Watch switch (keep the listing on screen, re-reading directories as they change)
+    CEntryFilter       m_entryFilter;                                                   // --Size>N, --Size<N, --Newer, --Older, --Regex (compiled after parsing)
     wstring            m_strValidationError;                                            // Validation error message (empty if no error)
     bool               m_fSetAliases                                       = false;    // --set-aliases switch
     bool               m_fGetAliases                                       = false;    // --get-aliases switch
@@ -124,6 +162,9 @@ protected:
     HRESULT ValidateTreeCombinations      (void);
     HRESULT ValidateAliasCombinations     (void);
     HRESULT ValidateNerdFontCombinations  (void);
+    HRESULT ValidateSnapshotCombinations  (void);
+    HRESULT ValidateWatchCombinations     (void);
+    HRESULT ValidateGlobCombinations      (void);
 
     //
     // Returns true if any of the bool member flags in the array is set on this.
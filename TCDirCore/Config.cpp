@@ -3,6 +3,7 @@
 
 #include "AutoHandle.h"
 #include "Color.h"
+#include "CommandLine.h"
 #include "FileAttributeMap.h"
 
 
@@ -805,7 +806,8 @@ void CConfig::ProcessColorOverrideEntry (wstring_view entry, EAttributeSource so
     }
 
     //
-    // Check for parameterized config entries (Depth=N, TreeIndent=N, Size=Auto|Bytes)
+    // Check for parameterized config entries (Depth=N, TreeIndent=N, Size=Auto|Bytes,
+    // Threads=N|Auto)
     //
 
     if (TryProcessIntSwitch (entry, source))
@@ -1340,7 +1342,8 @@ bool CConfig::IsSwitchName (wstring_view entry)
 //  CConfig::TryProcessIntSwitch
 //
 //  Check if entry matches a parameterized config key (Depth=N, TreeIndent=N,
-//  Size=Auto|Bytes).  Returns true if the entry was consumed (even on error).
+//  Size=Auto|Bytes, Threads=N|Auto).  Returns true if the entry was consumed
+//  (even on error).
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -1433,6 +1436,38 @@ bool CConfig::TryProcessIntSwitch (wstring_view entry, EAttributeSource source)
         return true;
     }
 
+    //
+    // Threads=N|Auto
+    //
+
+    if (entry.length() > 8 && _wcsnicmp (entry.data(), L"Threads=", 8) == 0)
+    {
+        wstring_view valueView = entry.substr (8);
+        int          value     = _wtoi (wstring (valueView).c_str());
+
+        if (_wcsnicmp (valueView.data(), L"Auto", valueView.length()) == 0 && valueView.length() == 4)
+        {
+            m_cThreads       = CCommandLine::s_kcThreadsAuto;
+            m_eThreadsSource = source;
+        }
+        else if (value >= 1 && value <= CCommandLine::s_kcMaxThreads)
+        {
+            m_cThreads       = value;
+            m_eThreadsSource = source;
+        }
+        else
+        {
+            parseResult.errors.push_back ({
+                format (L"Threads value must be Auto or between 1 and {}", CCommandLine::s_kcMaxThreads),
+                wstring (entry),
+                wstring (valueView),
+                8
+            });
+        }
+
+        return true;
+    }
+
     return false;
 }
 
@@ -1876,7 +1911,7 @@ char32_t CConfig::GetCloudStatusIcon (DWORD dwCloudStatus)
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CConfig::ResolveFileAttributeStyle (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style)
+void CConfig::ResolveFileAttributeStyle (const FileInfo & fileInfo, SFileDisplayStyle & style)
 {
     for (size_t i = g_cAttributePrecedenceOrder; i-- > 0; )
     {
@@ -1884,7 +1919,7 @@ void CConfig::ResolveFileAttributeStyle (const WIN32_FIND_DATA & wfd, SFileDispl
 
 
 
-        if ((wfd.dwFileAttributes & mapping.m_dwAttribute) == 0)
+        if ((fileInfo.m_dwAttributes & mapping.m_dwAttribute) == 0)
         {
             continue;
         }
@@ -1917,7 +1952,7 @@ void CConfig::ResolveFileAttributeStyle (const WIN32_FIND_DATA & wfd, SFileDispl
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CConfig::ResolveDirectoryStyle (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style)
+void CConfig::ResolveDirectoryStyle (const FileInfo & fileInfo, LPCWSTR pszName, SFileDisplayStyle & style)
 {
     wchar_t      szNameLower[MAX_PATH] = { };
     size_t       cchName               = 0;
@@ -1932,7 +1967,7 @@ void CConfig::ResolveDirectoryStyle (const WIN32_FIND_DATA & wfd, SFileDisplaySt
     // a per-entry heap allocation).
     //
 
-    for (const wchar_t * p = wfd.cFileName; *p != L'\0' && cchName < ARRAYSIZE (szNameLower) - 1; ++p)
+    for (const wchar_t * p = pszName; *p != L'\0' && cchName < ARRAYSIZE (szNameLower) - 1; ++p)
     {
         szNameLower[cchName++] = (wchar_t) towlower (*p);
     }
@@ -1950,9 +1985,9 @@ void CConfig::ResolveDirectoryStyle (const WIN32_FIND_DATA & wfd, SFileDisplaySt
     // Reparse points get special icons
     //
 
-    if (wfd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+    if (fileInfo.m_dwAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
     {
-        switch (wfd.dwReserved0)
+        switch (fileInfo.m_dwReparseTag)
         {
             case IO_REPARSE_TAG_SYMLINK:     style.m_iconCodePoint = m_iconSymlink;          break;
             case IO_REPARSE_TAG_MOUNT_POINT: style.m_iconCodePoint = m_iconJunction;         break;
@@ -1978,11 +2013,11 @@ void CConfig::ResolveDirectoryStyle (const WIN32_FIND_DATA & wfd, SFileDisplaySt
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CConfig::ResolveExtensionStyle (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style)
+void CConfig::ResolveExtensionStyle (LPCWSTR pszName, SFileDisplayStyle & style)
 {
     wchar_t         szExtLower[MAX_PATH] = { };
     size_t          cchExt              = 0;
-    const wchar_t * pszDot              = wcsrchr (wfd.cFileName, L'.');
+    const wchar_t * pszDot              = wcsrchr (pszName, L'.');
     wstring_view    extView;
 
 
@@ -1994,7 +2029,7 @@ void CConfig::ResolveExtensionStyle (const WIN32_FIND_DATA & wfd, SFileDisplaySt
     // map lookups avoid a per-entry heap allocation.
     //
 
-    if (pszDot != nullptr && pszDot != wfd.cFileName)
+    if (pszDot != nullptr && pszDot != pszName)
     {
         for (const wchar_t * p = pszDot; *p != L'\0' && cchExt < ARRAYSIZE (szExtLower) - 1; ++p)
         {
@@ -2030,10 +2065,10 @@ void CConfig::ResolveExtensionStyle (const WIN32_FIND_DATA & wfd, SFileDisplaySt
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CConfig::ResolveFileFallbackIcon (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style)
+void CConfig::ResolveFileFallbackIcon (const FileInfo & fileInfo, SFileDisplayStyle & style)
 {
-    if (wfd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT &&
-        wfd.dwReserved0 == IO_REPARSE_TAG_SYMLINK)
+    if (fileInfo.m_dwAttributes & FILE_ATTRIBUTE_REPARSE_POINT &&
+        fileInfo.m_dwReparseTag == IO_REPARSE_TAG_SYMLINK)
     {
         style.m_iconCodePoint = m_iconSymlink;
     }
@@ -2061,23 +2096,23 @@ void CConfig::ResolveFileFallbackIcon (const WIN32_FIND_DATA & wfd, SFileDisplay
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-CConfig::SFileDisplayStyle CConfig::GetDisplayStyleForFile (const WIN32_FIND_DATA & wfd)
+CConfig::SFileDisplayStyle CConfig::GetDisplayStyleForFile (const FileInfo & fileInfo, LPCWSTR pszName)
 {
     SFileDisplayStyle style = { m_rgAttributes[EAttribute::Default], 0, false };
 
 
 
-    if (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+    if (fileInfo.IsDirectory())
     {
-        ResolveDirectoryStyle     (wfd, style);
+        ResolveDirectoryStyle     (fileInfo, pszName, style);
     }
     else
     {
-        ResolveFileFallbackIcon   (wfd, style);
-        ResolveExtensionStyle     (wfd, style);
+        ResolveFileFallbackIcon   (fileInfo, style);
+        ResolveExtensionStyle     (pszName, style);
     }
 
-    ResolveFileAttributeStyle (wfd, style);
+    ResolveFileAttributeStyle (fileInfo, style);
 
     if ((style.m_wTextAttr & BC_Mask) == 0)
     {
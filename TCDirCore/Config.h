@@ -6,6 +6,7 @@
 #include "IconMapping.h"
 #include "SizeFormat.h"
 #include "TransparentWStringHash.h"
+#include "DirectoryInfo.h"
 
 #define TCDIR_ENV_VAR_NAME L"TCDIR"
 
@@ -125,7 +126,7 @@ public:
     CConfig (void);
    
     void              Initialize                  (WORD wDefaultAttr);
-    SFileDisplayStyle GetDisplayStyleForFile      (const WIN32_FIND_DATA & wfd);
+    SFileDisplayStyle GetDisplayStyleForFile      (const FileInfo & fileInfo, LPCWSTR pszName);
     char32_t          GetCloudStatusIcon          (DWORD dwCloudStatus);
     ValidationResult  ValidateEnvironmentVariable (void);
     void              SetEnvironmentProvider      (const IEnvironmentProvider * pProvider);
@@ -159,12 +160,14 @@ public:
     optional<int>                              m_cMaxDepth;
     optional<int>                              m_cTreeIndent;
     optional<ESizeFormat>                      m_eSizeFormat;
+    optional<int>                              m_cThreads;             // CCommandLine::s_kcThreadsAuto = adaptive
 
     // Switch and parameter source tracking
     EAttributeSource                           m_rgSwitchSources[10]  = { EAttributeSource::Default };
     EAttributeSource                           m_eMaxDepthSource      = EAttributeSource::Default;
     EAttributeSource                           m_eTreeIndentSource    = EAttributeSource::Default;
     EAttributeSource                           m_eSizeFormatSource    = EAttributeSource::Default;
+    EAttributeSource                           m_eThreadsSource       = EAttributeSource::Default;
 
     // Icon mapping tables (parallel to color tables)
     IconMap                                    m_mapExtensionToIcon;
@@ -211,10 +214,10 @@ protected:
     HRESULT      ParseIconValue                       (wstring_view iconSpec, char32_t & codePoint, bool & fSuppressed);
     void         ApplyIconOverride                    (wstring_view name, char32_t iconCodePoint, bool fSuppressed, IconMap & mapIcons, unordered_map<wstring, EAttributeSource> & mapSources, EAttributeSource source = EAttributeSource::Environment);
     void         ProcessFileAttributeIconOverride     (DWORD dwAttribute, char32_t iconCodePoint);
-    void         ResolveFileAttributeStyle            (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style);
-    void         ResolveDirectoryStyle                (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style);
-    void         ResolveExtensionStyle                (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style);
-    void         ResolveFileFallbackIcon              (const WIN32_FIND_DATA & wfd, SFileDisplayStyle & style);
+    void         ResolveFileAttributeStyle            (const FileInfo & fileInfo, SFileDisplayStyle & style);
+    void         ResolveDirectoryStyle                (const FileInfo & fileInfo, LPCWSTR pszName, SFileDisplayStyle & style);
+    void         ResolveExtensionStyle                (LPCWSTR pszName, SFileDisplayStyle & style);
+    void         ResolveFileFallbackIcon              (const FileInfo & fileInfo, SFileDisplayStyle & style);
     wstring_view TrimWhitespace                       (wstring_view str);
     void         ProcessConfigLines                   (const vector<wstring> & lines);
 
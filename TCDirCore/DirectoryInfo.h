@@ -1,5 +1,7 @@
 #pragma once
 
+#include "IDirectoryEnumerator.h"
+
 
 
 
@@ -22,31 +24,105 @@ struct SStreamInfo
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  SFileInfoExtras
+//
+//  Per-entry data that only a few entries have.  Kept out of line so the
+//  common entry doesn't pay for it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct SFileInfoExtras
+{
+    vector<SStreamInfo> m_vStreams;          // Alternate data streams (empty if none or not collected)
+    wstring             m_strReparseTarget;  // Resolved link target path (empty if not a supported reparse point)
+};
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  FileInfo
 //
-//  Extended file information that includes WIN32_FIND_DATA plus streams.
-//  Derives from WIN32_FIND_DATA so it can be used interchangeably.
+//  Compact record for one directory entry.  Sizes and times are packed
+//  into 64-bit integers, and the name lives in the owning CDirectoryInfo's
+//  name arena (see CDirectoryInfo::AddMatch and CDirectoryInfo::Name), so
+//  an entry is 64 bytes instead of the ~650 a WIN32_FIND_DATA-based record
+//  with inline stream and reparse members took.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-struct FileInfo : public WIN32_FIND_DATA
+struct FileInfo
 {
-    // Default constructor
-    FileInfo() : 
-        WIN32_FIND_DATA {} 
+    static constexpr UINT s_kiNoChild = UINT_MAX;
+
+
+
+    FileInfo (void) = default;
+
+    explicit FileInfo (const WIN32_FIND_DATA & wfd) :
+        m_cbSize       (PackULongLong (wfd.nFileSizeHigh,                   wfd.nFileSizeLow)),
+        m_ftCreation   (PackULongLong (wfd.ftCreationTime.dwHighDateTime,   wfd.ftCreationTime.dwLowDateTime)),
+        m_ftLastAccess (PackULongLong (wfd.ftLastAccessTime.dwHighDateTime, wfd.ftLastAccessTime.dwLowDateTime)),
+        m_ftLastWrite  (PackULongLong (wfd.ftLastWriteTime.dwHighDateTime,  wfd.ftLastWriteTime.dwLowDateTime)),
+        m_dwAttributes (wfd.dwFileAttributes),
+        m_dwReparseTag (wfd.dwReserved0)
     {
     }
-    
-    // Construct from WIN32_FIND_DATA
-    FileInfo (const WIN32_FIND_DATA & wfd) : 
-        WIN32_FIND_DATA (wfd)
+
+    static ULONGLONG PackULongLong (DWORD dwHigh, DWORD dwLow)
     {
+        return (static_cast<ULONGLONG> (dwHigh) << 32) | dwLow;
     }
 
-    vector<SStreamInfo> m_vStreams;        // Alternate data streams (empty if none or not collected)
-    wstring             m_strReparseTarget;  // Resolved link target path (empty if not a supported reparse point)
+    static FILETIME ToFileTime (ULONGLONG ullTime)
+    {
+        return FILETIME { static_cast<DWORD> (ullTime), static_cast<DWORD> (ullTime >> 32) };
+    }
+
+    bool IsDirectory (void) const
+    {
+        return (m_dwAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    }
+
+    bool HasChild (void) const
+    {
+        return m_iChild != s_kiNoChild;
+    }
+
+    bool HasStreams (void) const
+    {
+        return m_pExtras && !m_pExtras->m_vStreams.empty();
+    }
+
+    bool HasReparseTarget (void) const
+    {
+        return m_pExtras && !m_pExtras->m_strReparseTarget.empty();
+    }
+
+    SFileInfoExtras & Extras (void)
+    {
+        if (!m_pExtras)
+        {
+            m_pExtras = make_unique<SFileInfoExtras>();
+        }
+
+        return *m_pExtras;
+    }
+
+    ULONGLONG                   m_cbSize       = 0;
+    ULONGLONG                   m_ftCreation   = 0;
+    ULONGLONG                   m_ftLastAccess = 0;
+    ULONGLONG                   m_ftLastWrite  = 0;
+    DWORD                       m_dwAttributes = 0;
+    DWORD                       m_dwReparseTag = 0;     // dwReserved0; meaningful only with FILE_ATTRIBUTE_REPARSE_POINT
+    UINT                        m_ibName       = 0;     // Offset of the name in the directory's name arena
+    UINT                        m_iChild       = s_kiNoChild;   // This directory's node in CDirectoryInfo::m_vChildren (multithreaded lister)
+    USHORT                      m_cchName      = 0;
+    unique_ptr<SFileInfoExtras> m_pExtras;              // Streams and reparse target; null for most entries
 };
 
 typedef vector<FileInfo>         FileInfoVector;
@@ -75,21 +151,215 @@ public:
     
     CDirectoryInfo (const filesystem::path & dirPath, const filesystem::path & fileSpec) :
         m_dirPath    (dirPath),
-        m_vFileSpecs ({ fileSpec })
+        m_pFileSpecs (make_shared<const vector<filesystem::path>> (1, fileSpec))
     {
     }
 
     CDirectoryInfo (const filesystem::path & dirPath, const vector<filesystem::path> & fileSpecs) :
         m_dirPath    (dirPath),
-        m_vFileSpecs (fileSpecs)
+        m_pFileSpecs (make_shared<const vector<filesystem::path>> (fileSpecs))
+    {
+    }
+
+    //
+    // A subdirectory found while enumerating pParent.  Only the leaf name
+    // is stored; the file specs are shared with the parent.
+    //
+
+    CDirectoryInfo (const shared_ptr<CDirectoryInfo> & pParent, wstring_view leafName) :
+        m_pParent     (pParent),
+        m_strLeafName (leafName),
+        m_pFileSpecs  (pParent->m_pFileSpecs)
     {
     }
 
     
 
+    //
+    // The full path is composed on demand from the root's path and the
+    // leaf names below it.
+    //
+
+    filesystem::path DirPath (void) const
+    {
+        const CDirectoryInfo   * pNode = this;
+        vector<const wstring *>  vLeaves;
+        filesystem::path         dirPath;
+
+
+
+        for (; pNode->m_pParent; pNode = pNode->m_pParent.get())
+        {
+            vLeaves.push_back (&pNode->m_strLeafName);
+        }
+
+        dirPath = pNode->m_dirPath;
+
+        for (auto it = vLeaves.rbegin(); it != vLeaves.rend(); ++it)
+        {
+            dirPath /= **it;
+        }
+
+        return dirPath;
+    }
+
+    const vector<filesystem::path> & FileSpecs (void) const
+    {
+        return *m_pFileSpecs;
+    }
+
+
+
+    //
+    // Node state word (multithreaded lister).  The low bits hold the
+    // Status; the flags above them are set once and never cleared.  The
+    // display thread blocks on the word itself with atomic::wait, and every
+    // change notifies it, so no per-node mutex or condition variable is
+    // involved in waiting for a node.
+    //
+    // The tree-pruning flags (tree mode with a file mask only) are set by
+    // workers and propagated upward through m_pParent; the display waits
+    // until one of them decides the node's visibility.  See research.md R14.
+    // --Usage waits on s_kfSubtreeComplete for the root alone.
+    //
+    // Until a worker publishes the node by moving it to Done or Error, its
+    // matches, name arena, counters and child list belong to that worker
+    // alone.  The status change is the release that hands them over.
+    //
+
+    static constexpr UINT s_kmStatus          = 0x03;
+    static constexpr UINT s_kfDiscarded       = 0x04;   // The display is done with the node; see CMultiThreadedLister::ReleaseSubtree
+    static constexpr UINT s_kfDemanded        = 0x08;   // Queued again on the scheduler's urgent lane
+    static constexpr UINT s_kfDescendantMatch = 0x10;   // Tree pruning: this node or one below it has a match
+    static constexpr UINT s_kfSubtreeComplete = 0x20;   // Tree pruning and --Usage: every node below this one is enumerated
+
+    static Status StatusOf (UINT state)
+    {
+        return static_cast<Status> (state & s_kmStatus);
+    }
+
+    static bool IsSettled (UINT state)
+    {
+        return StatusOf (state) == Status::Done || StatusOf (state) == Status::Error;
+    }
+
+    UINT GetState (void) const
+    {
+        return m_state.load();
+    }
+
+    bool HasFlags (UINT fFlags) const
+    {
+        return (m_state.load() & fFlags) != 0;
+    }
+
+    // Returns the state before the flags were set
+    UINT SetFlags (UINT fFlags)
+    {
+        UINT prev = m_state.fetch_or (fFlags);
+
+
+
+        if ((prev & fFlags) != fFlags)
+        {
+            m_state.notify_all();
+        }
+
+        return prev;
+    }
+
+    // Returns the state before the status changed
+    UINT SetStatus (Status status)
+    {
+        UINT prev = m_state.load();
+
+
+
+        while (!m_state.compare_exchange_weak (prev, (prev & ~s_kmStatus) | static_cast<UINT> (status)))
+        {
+        }
+
+        m_state.notify_all();
+        return prev;
+    }
+
+    // Waiting -> InProgress; false if another worker already took the node
+    bool TryBeginEnumeration (UINT & prevState)
+    {
+        prevState = m_state.load();
+
+
+
+        do
+        {
+            if (StatusOf (prevState) != Status::Waiting)
+            {
+                return false;
+            }
+        }
+        while (!m_state.compare_exchange_weak (prevState, prevState | static_cast<UINT> (Status::InProgress)));
+
+        return true;
+    }
+
+    // Blocks until fnDone (state) is true; returns that state
+    template<typename Fn>
+    UINT WaitForState (Fn fnDone) const
+    {
+        UINT state = m_state.load();
+
+
+
+        while (!fnDone (state))
+        {
+            m_state.wait (state);
+            state = m_state.load();
+        }
+
+        return state;
+    }
+
+
+
+    //
+    // Match names, each null-terminated, in the order they were added.
+    // FileInfo::m_ibName indexes into this rather than each entry owning
+    // its own MAX_PATH buffer.
+    //
+
+    void AddMatch (FileInfo && fileInfo, LPCWSTR pszName, size_t cchName)
+    {
+        fileInfo.m_ibName  = static_cast<UINT>   (m_vNameArena.size());
+        fileInfo.m_cchName = static_cast<USHORT> (cchName);
+
+        m_vNameArena.insert (m_vNameArena.end(), pszName, pszName + cchName);
+        m_vNameArena.push_back (L'\0');
+        m_vMatches.push_back (move (fileInfo));
+    }
+
+    void AddMatch (FileInfo && fileInfo, LPCWSTR pszName)
+    {
+        AddMatch (move (fileInfo), pszName, wcslen (pszName));
+    }
+
+    LPCWSTR Name (const FileInfo & fileInfo) const
+    {
+        return m_vNameArena.data() + fileInfo.m_ibName;
+    }
+
+    wstring_view NameView (const FileInfo & fileInfo) const
+    {
+        return wstring_view (Name (fileInfo), fileInfo.m_cchName);
+    }
+
+
+
     FileInfoVector                          m_vMatches;
-    filesystem::path                        m_dirPath;
-    vector<filesystem::path>                m_vFileSpecs;    // File specs to match (one or more)
+    vector<WCHAR>                           m_vNameArena;
+    shared_ptr<CDirectoryInfo>              m_pParent;           // Null for the listing root
+    wstring                                 m_strLeafName;       // Set on every node but the root
+    filesystem::path                        m_dirPath;           // Set only on the root; see DirPath
+    shared_ptr<const vector<filesystem::path>> m_pFileSpecs;     // File specs to match (one or more), shared by the whole listing
     ULARGE_INTEGER                          m_uliLargestFileSize = {};
     size_t                                  m_cchLargestFileName = 0;
     UINT                                    m_cFiles             = 0;
@@ -102,20 +372,64 @@ public:
     // Multithreading support members (unused in single-threaded mode)
     //
 
-    Status                                  m_status = Status::Waiting;
-    HRESULT                                 m_hr     = S_OK;
+    atomic<UINT>                            m_state     { static_cast<UINT> (Status::Waiting) };
+    HRESULT                                 m_hr        = S_OK;
+    size_t                                  m_cDepth    = 0;    // Levels below the listing root
+    uint64_t                                m_globState = 0;    // Recursive masks: the CPathGlob segments reached here
     vector<shared_ptr<CDirectoryInfo>>      m_vChildren;
-    mutex                                   m_mutex;
-    condition_variable                      m_cvStatusChanged;
+    vector<UINT>                            m_vDfsKey;          // Child index at each level; orders nodes as the display visits them
+
+    //
+    // Tree pruning: one for this node's own enumeration plus one for each
+    // child whose subtree is not complete yet.  Whoever takes it to zero
+    // sets s_kfSubtreeComplete and decrements the parent's count, so
+    // completion costs a constant amount of work per edge.
+    //
+
+    atomic<UINT>                            m_cPendingSubtrees { 1 };
+
+    //
+    // --Usage: bytes, files, and matching subdirectories of this node and
+    // everything below it.  The node's worker adds its own counts before
+    // retiring its enumeration, and each child adds its totals as its
+    // subtree completes, so they are final once s_kfSubtreeComplete is set.
+    //
+
+    atomic<ULONGLONG>                       m_cbSubtree           { 0 };
+    atomic<UINT>                            m_cSubtreeFiles       { 0 };
+    atomic<UINT>                            m_cSubtreeDirectories { 0 };
+
+    //
+    // Nodes below --Depth are never displayed, but with a file mask the
+    // deepest displayed directories are pruned unless something under them
+    // matches.  Such nodes are enumerated as probes: they only look for one
+    // matching file, and stop once any probe under the same depth-limit
+    // directory (m_pProbeRoot) has found one.  The probe root is this node
+    // or one of its ancestors, so m_pParent keeps it alive.
+    //
+
+    bool                                    m_fProbeOnly = false;
+    CDirectoryInfo                        * m_pProbeRoot = nullptr;
+
+    //
+    // Read-ahead accounting.  Once the display is finished with a node it
+    // is discarded (s_kfDiscarded): its matches and children are freed, and
+    // a worker still enumerating it (or about to) stops early.
+    // m_cBufferedEntries is this node's share of CMultiThreadedLister's
+    // read-ahead count: one for the node itself, plus its matches once it
+    // is enumerated.
+    //
+
+    size_t                                  m_cBufferedEntries  = 0;
 
     //
-    // Tree-pruning support (used only when tree mode + file mask is active).
-    // Producer threads propagate match/completion signals upward through the
-    // parent chain; the display thread waits on m_cvStatusChanged until
-    // visibility is determined.  See research.md R14.
+    // Directory link following (see CLinkFollowPolicy).  m_id is looked up
+    // at most once, when a link below this node is first checked for a
+    // cycle; a node reached through a link starts with its target's ID.
     //
 
-    weak_ptr<CDirectoryInfo>                m_wpParent;
-    atomic<bool>                            m_fDescendantMatchFound { false };
-    atomic<bool>                            m_fSubtreeComplete      { false };
+    UINT                                    m_cLinksFollowed    = 0;    // Links entered on the path down to this node
+    UINT                                    m_cPrunedLinks      = 0;    // Links among this node's entries not followed
+    once_flag                               m_idOnce;
+    optional<SDirectoryId>                  m_id;
 };
@@ -7,8 +7,11 @@
 #include "Console.h"
 #include "FileComparator.h"
 #include "Flag.h"
+#include "MatchSorter.h"
 #include "MultiThreadedLister.h"
+#include "PathGlob.h"
 #include "ReparsePointResolver.h"
+#include "Win32DirectoryEnumerator.h"
 
 
 
@@ -26,7 +29,8 @@ CDirectoryLister::CDirectoryLister (shared_ptr<CCommandLine> pCmdLine, shared_pt
     m_cmdLinePtr        (pCmdLine),
     m_consolePtr        (pConsole),
     m_configPtr         (pConfig),
-    m_displayer         (std::move (displayer))
+    m_displayer         (std::move (displayer)),
+    m_pEnumerator       (make_shared<CWin32DirectoryEnumerator>())
 {
 }
 
@@ -46,7 +50,8 @@ CDirectoryLister::CDirectoryLister (shared_ptr<CCommandLine> pCmdLine, shared_pt
 CDirectoryLister::CDirectoryLister (shared_ptr<CCommandLine> pCmdLine, shared_ptr<CConsole> pConsole, shared_ptr<CConfig> pConfig) :
     m_cmdLinePtr        (pCmdLine),
     m_consolePtr        (pConsole),
-    m_configPtr         (pConfig)
+    m_configPtr         (pConfig),
+    m_pEnumerator       (make_shared<CWin32DirectoryEnumerator>())
 {
 }
 
@@ -70,14 +75,34 @@ CDirectoryLister::~CDirectoryLister (void)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::SetDirectoryEnumerator
+//
+//  Replaces the backend used to read directories.  Tests use this to list
+//  an in-memory tree instead of the real file system.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CDirectoryLister::SetDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pEnumerator)
+{
+    m_pEnumerator = std::move (pEnumerator);
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CDirectoryLister::List
 //
 //  Entry point for listing a directory with file specs applied.
 //  For multithreaded recursive mode, all specs are processed together in a
-//  single pass with deduplication. Otherwise falls back to sequential
-//  processing per spec.
+//  single pass with deduplication.  --Top always takes that path, since
+//  its per-worker collectors live in CMultiThreadedLister, and so do
+//  recursive masks ("**\*.cpp"), which only it can match.  Otherwise
+//  falls back to sequential processing per spec.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -108,7 +133,8 @@ void CDirectoryLister::List (const MaskGroup & group)
     {
         CDriveInfo driveInfo (dirPath);
 
-        if ((m_cmdLinePtr->m_fMultiThreaded && m_cmdLinePtr->m_fRecurse) || m_cmdLinePtr->m_fTree)
+        if ((m_cmdLinePtr->m_fMultiThreaded && m_cmdLinePtr->m_fRecurse) || m_cmdLinePtr->m_fTree || m_cmdLinePtr->m_fUsage || m_cmdLinePtr->m_cTop > 0 ||
+            CPathGlob::AnyGlobSpec (fileSpecs))
         {
             hr = ProcessDirectoryMultiThreaded (driveInfo, dirPath, fileSpecs, IResultsDisplayer::EDirectoryLevel::Initial);
             CHR (hr);
@@ -133,6 +159,150 @@ Error:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::PrefetchListings
+//
+//  Starts reading every directory + spec of a non-recursive listing in the
+//  background, so that a command line naming many directories (or one
+//  directory with several specs) pays for the slowest read rather than the
+//  sum of them.  Output order is unchanged: List still displays each group
+//  and spec in turn, waiting for its prefetched result (see
+//  ProcessDirectory).
+//
+//  Recursive and tree listings are already parallel inside
+//  CMultiThreadedLister and are not prefetched.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CDirectoryLister::PrefetchListings (const vector<MaskGroup> & groups)
+{
+    size_t cThreads = 0;
+
+
+
+    if (!m_cmdLinePtr->m_fMultiThreaded || m_cmdLinePtr->m_fRecurse || m_cmdLinePtr->m_fTree || m_cmdLinePtr->m_fUsage || m_cmdLinePtr->m_cTop > 0)
+    {
+        return;
+    }
+
+    for (const auto & [dirPath, fileSpecs] : groups)
+    {
+        // Listed recursively by CMultiThreadedLister; see List
+        if (CPathGlob::AnyGlobSpec (fileSpecs))
+        {
+            continue;
+        }
+
+        for (const auto & fileSpec : fileSpecs)
+        {
+            auto & pListing = m_prefetched[PrefetchKey (dirPath, fileSpec)];
+
+            if (!pListing)
+            {
+                pListing = make_unique<SPrefetchedListing> (dirPath, fileSpec);
+                m_vPrefetchQueue.push_back (pListing.get());
+            }
+        }
+    }
+
+    //
+    // A lone spec gains nothing from a second thread
+    //
+
+    if (m_vPrefetchQueue.size() < 2)
+    {
+        m_prefetched.clear();
+        m_vPrefetchQueue.clear();
+        return;
+    }
+
+    cThreads = min (m_vPrefetchQueue.size(), max<size_t> (s_kcMinPrefetchThreads, jthread::hardware_concurrency()));
+
+    for (size_t i = 0; i < cThreads; ++i)
+    {
+        m_prefetchThreads.emplace_back ([this]() { PrefetchWorker(); });
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::PrefetchWorker
+//
+//  Prefetch thread body: reads queued listings in display order until the
+//  queue is exhausted.  Each listing gets its own totals, which the display
+//  thread folds into m_totals when it shows the listing.  The promise is
+//  always completed; an exception is handed to the display thread, which
+//  would otherwise wait on the listing forever.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CDirectoryLister::PrefetchWorker (void)
+{
+    for (;;)
+    {
+        size_t i = m_iNextPrefetch.fetch_add (1, memory_order_relaxed);
+
+        if (i >= m_vPrefetchQueue.size())
+        {
+            break;
+        }
+
+        SPrefetchedListing & listing = *m_vPrefetchQueue[i];
+
+        try
+        {
+            listing.m_hr = CollectMatchingFilesAndDirectories (listing.m_dirInfo.DirPath(),
+                                                               listing.m_dirInfo.FileSpecs().front(),
+                                                               listing.m_dirInfo,
+                                                               listing.m_totals);
+            listing.m_collected.set_value();
+        }
+        catch (...)
+        {
+            listing.m_collected.set_exception (current_exception());
+        }
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::TakePrefetchedListing
+//
+//  Hands the prefetched listing for a directory + spec to the caller, or
+//  returns null if it was not prefetched (or was already taken).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unique_ptr<CDirectoryLister::SPrefetchedListing> CDirectoryLister::TakePrefetchedListing (const filesystem::path & dirPath, const filesystem::path & fileSpec)
+{
+    unique_ptr<SPrefetchedListing> pListing;
+
+
+
+    auto it = m_prefetched.find (PrefetchKey (dirPath, fileSpec));
+
+    if (it != m_prefetched.end())
+    {
+        pListing = std::move (it->second);
+        m_prefetched.erase (it);
+    }
+
+    return pListing;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CDirectoryLister::ProcessDirectory
@@ -147,16 +317,30 @@ HRESULT CDirectoryLister::ProcessDirectory (
     const filesystem::path             & fileSpec, 
     IResultsDisplayer::EDirectoryLevel   level)
 {
-    HRESULT          hr = S_OK;
-    CDirectoryInfo   di   (dirPath, fileSpec);
+    HRESULT                        hr          = S_OK;
+    HRESULT                        hrCollect   = S_OK;
+    unique_ptr<SPrefetchedListing> pPrefetched = TakePrefetchedListing (dirPath, fileSpec);
+    CDirectoryInfo                 localDi       (dirPath, fileSpec);
+    CDirectoryInfo               & di          = pPrefetched ? pPrefetched->m_dirInfo : localDi;
 
 
 
     //
-    // Search for matching files and directories
+    // Search for matching files and directories, unless a prefetch thread
+    // already has.  get() rethrows anything the prefetch thread threw, as
+    // the inline call would have.
     //     
     
-    CollectMatchingFilesAndDirectories (dirPath, fileSpec, di);
+    if (pPrefetched)
+    {
+        pPrefetched->m_fCollected.get();
+        hrCollect = pPrefetched->m_hr;
+        m_totals.Add (pPrefetched->m_totals);
+    }
+    else
+    {
+        hrCollect = CollectMatchingFilesAndDirectories (dirPath, fileSpec, di, m_totals);
+    }
 
     //
     // Count directories whose names matched the mask
@@ -168,7 +352,7 @@ HRESULT CDirectoryLister::ProcessDirectory (
     // Sort the results using FileComparator
     //
 
-    SortMatches (di.m_vMatches, FileComparator (m_cmdLinePtr));
+    SortMatches (di.m_vMatches, FileComparator (m_cmdLinePtr, di));
 
     //
     // Show the directory contents using the displayer
@@ -182,6 +366,12 @@ HRESULT CDirectoryLister::ProcessDirectory (
 
     if (m_cmdLinePtr->m_fRecurse)
     {
+        if (level == IResultsDisplayer::EDirectoryLevel::Initial)
+        {
+            m_pLinkPolicy = make_unique<CLinkFollowPolicy> (m_cmdLinePtr->m_eFollowLinks, m_cmdLinePtr->m_fTree);
+            m_vRecursionPath.assign (1, SRecursionFrame { dirPath });
+        }
+
         hr = RecurseIntoSubdirectories (driveInfo, dirPath, fileSpec);
         CHR (hr);
 
@@ -195,6 +385,16 @@ HRESULT CDirectoryLister::ProcessDirectory (
         }
     }
 
+    //
+    // A spec that matched nothing is shown as an empty listing; any other
+    // failure to read the directory is reported once the listing is shown
+    //
+
+    if (hrCollect != HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND))
+    {
+        CHR (hrCollect);
+    }
+
 
 
 Error:    
@@ -208,10 +408,8 @@ Error:
 //
 //  CDirectoryLister::SortMatches
 //
-//  Sorts a lightweight index permutation (cheap size_t moves) with the given
-//  comparator, then reorders the matches once into a reserved buffer. Each
-//  heavyweight FileInfo is moved exactly once instead of the N log N
-//  relocations an in-place value sort would perform.
+//  Sorts precomputed keys rather than calling the comparator per pair;
+//  see CMatchSorter.  The result is the comparator's order.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -219,33 +417,13 @@ void CDirectoryLister::SortMatches (
     FileInfoVector       & matches,
     const FileComparator & comparator)
 {
-    size_t           cMatches = matches.size();
-    vector<size_t>   order    (cMatches);
-    FileInfoVector   sorted;
-
-
-
-    for (size_t i = 0; i < cMatches; ++i)
-    {
-        order[i] = i;
-    }
-
-    std::sort (order.begin(), order.end(),
-               [&] (size_t a, size_t b) { return comparator (matches[a], matches[b]); });
-
-    sorted.reserve (cMatches);
-
-    for (size_t i : order)
-    {
-        sorted.push_back (std::move (matches[i]));
-    }
-
-    matches = std::move (sorted);
+    CMatchSorter (matches, comparator).Sort();
 }
 
 
 
 
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CDirectoryLister::CollectMatchingFilesAndDirectories
@@ -257,38 +435,34 @@ void CDirectoryLister::SortMatches (
 HRESULT CDirectoryLister::CollectMatchingFilesAndDirectories (
     const std::filesystem::path & dirPath, 
     const std::filesystem::path & fileSpec, 
-    CDirectoryInfo              & di)
+    CDirectoryInfo              & di,
+    SListingTotals              & totals)
 {
-    HRESULT          hr              = S_OK;
-    filesystem::path pathAndFileSpec = dirPath / fileSpec;
-    BOOL             fSuccess        = FALSE;
-    AutoFindHandle   hFind;
-    WIN32_FIND_DATA  wfd             = { 0 };
+    HRESULT hr = S_OK;
 
 
 
-    hFind = FindFirstFile (pathAndFileSpec.c_str(), &wfd);
-    CWR (hFind != INVALID_HANDLE_VALUE);
-
-    do
+    hr = m_pEnumerator->Enumerate (dirPath, fileSpec, false, [&] (span<const WIN32_FIND_DATA> batch)
     {
-        if (!IsDots (wfd.cFileName))
+        for (const WIN32_FIND_DATA & wfd : batch)
         {
             //
-            // If the required attributes are present and the excluded attributes are not 
-            // then add the file to the list of matches for this directory
+            // If the required attributes are present, the excluded attributes are not,
+            // and the size, date, and name filters pass, then add the file to the list
+            // of matches for this directory
             //
 
             if (CFlag::IsSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesRequired) &&
-                CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded))
+                CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded) &&
+                m_cmdLinePtr->m_entryFilter.Matches (wfd))
             {
-                AddMatchToList (wfd, di, &m_totals);
+                AddMatchToList (wfd, di, &totals);
             }
         }
 
-        fSuccess = FindNextFile (hFind, &wfd);
-    }
-    while (fSuccess);
+        return true;
+    });
+    CHR (hr);
 
 
 Error:
@@ -321,12 +495,15 @@ HRESULT CDirectoryLister::ProcessDirectoryMultiThreaded (
     
 
 
+    mtLister.SetDirectoryEnumerator (m_pEnumerator);
+
     hr = mtLister.ProcessDirectoryMultiThreaded (driveInfo, 
                                                  dirPath, 
                                                  fileSpecs,
                                                  *m_displayer, 
                                                  level,
                                                  m_totals);
+    m_consumerStall += mtLister.GetConsumerStallTime();
     CHR (hr);
 
     m_displayer->DisplayRecursiveSummary (summaryDirInfo, m_totals);
@@ -344,7 +521,8 @@ Error:
 //
 //  CDirectoryLister::RecurseIntoSubdirectories
 //
-//  
+//  Lists each subdirectory in turn, keeping m_vRecursionPath in step so
+//  that directory links can be checked against the directories above them.
 //
 ////////////////////////////////////////////////////////////////////////////////  
 
@@ -353,11 +531,7 @@ HRESULT CDirectoryLister::RecurseIntoSubdirectories (
     const filesystem::path & dirPath, 
     const filesystem::path & fileSpec)
 {
-    HRESULT          hr              = S_OK;
-    filesystem::path pathAndFileSpec = dirPath / L"*";    
-    BOOL             fSuccess        = FALSE;                    
-    AutoFindHandle   hFind;
-    WIN32_FIND_DATA  wfd             = { };                         
+    HRESULT hr = S_OK;
 
     
 
@@ -365,29 +539,33 @@ HRESULT CDirectoryLister::RecurseIntoSubdirectories (
     // Search for subdirectories to recurse into
     // 
     
-    hFind = FindFirstFile (pathAndFileSpec.c_str(), &wfd);
-    CBR (hFind != INVALID_HANDLE_VALUE);
-
-    do 
+    hr = m_pEnumerator->Enumerate (dirPath, L"*", false, [&] (span<const WIN32_FIND_DATA> batch)
     {
-        //
-        // Add directories, except "." and "..", to a list
-        // of subdirectories we'll recurse into
-        //
-                
-        if (!IsDots (wfd.cFileName))
+        for (const WIN32_FIND_DATA & wfd : batch)
         {
             if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
             {
-                filesystem::path subdirPath = dirPath / wfd.cFileName;            
-                hr = ProcessDirectory (driveInfo, subdirPath, fileSpec, IResultsDisplayer::EDirectoryLevel::Subdirectory);
-                IGNORE_RETURN_VALUE (hr, S_OK);
+                filesystem::path subdirPath = dirPath / wfd.cFileName;
+                SRecursionFrame  frame      { subdirPath, m_vRecursionPath.back().m_cLinksFollowed };
+                HRESULT          hrSubdir   = S_OK;
+
+                if (CLinkFollowPolicy::IsDirectoryLink (wfd) && !ShouldFollowLink (subdirPath, frame))
+                {
+                    continue;
+                }
+
+                m_vRecursionPath.push_back (std::move (frame));
+
+                hrSubdir = ProcessDirectory (driveInfo, subdirPath, fileSpec, IResultsDisplayer::EDirectoryLevel::Subdirectory);
+                IGNORE_RETURN_VALUE (hrSubdir, S_OK);
+
+                m_vRecursionPath.pop_back();
             }
         }
-            
-        fSuccess = FindNextFile (hFind, &wfd);
-    }
-    while (fSuccess);
+
+        return true;
+    });
+    CBR (SUCCEEDED (hr));
 
 
 
@@ -399,6 +577,111 @@ Error:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::ShouldFollowLink
+//
+//  Applies the --Follow policy to a directory link met on the
+//  single-threaded recursion path.  On success frame describes the link
+//  as it will sit on that path; a pruned link is counted in m_totals.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CDirectoryLister::ShouldFollowLink (const filesystem::path & linkPath, SRecursionFrame & frame)
+{
+    CLinkFollowPolicy::EDecision decision;
+
+
+
+    decision = DecideLink (linkPath, frame.m_cLinksFollowed, frame.m_id, [this] (const SDirectoryId & id)
+    {
+        for (SRecursionFrame & ancestor : m_vRecursionPath)
+        {
+            if (!ancestor.m_fIdResolved)
+            {
+                ancestor.m_id          = GetDirectoryId (ancestor.m_dirPath);
+                ancestor.m_fIdResolved = true;
+            }
+
+            if (ancestor.m_id == id)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    });
+
+    if (decision == CLinkFollowPolicy::EDecision::Prune)
+    {
+        ++m_totals.m_cPrunedLinks;
+    }
+
+    frame.m_fIdResolved = frame.m_id.has_value();
+    ++frame.m_cLinksFollowed;
+
+    return decision == CLinkFollowPolicy::EDecision::Follow;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::DecideLink
+//
+//  Looks up the link's target ID when the policy needs it (returned in
+//  targetId, so a followed link's node need not look it up again) and
+//  asks the policy.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CLinkFollowPolicy::EDecision CDirectoryLister::DecideLink (
+    const filesystem::path              & linkPath,
+    UINT                                  cLinksAbove,
+    optional<SDirectoryId>              & targetId,
+    const CLinkFollowPolicy::IsOnPathFn & fnIsOnPath)
+{
+    if (m_pLinkPolicy->NeedsDirectoryIds())
+    {
+        targetId = GetDirectoryId (linkPath);
+    }
+
+    return m_pLinkPolicy->Decide (cLinksAbove, targetId, fnIsOnPath);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryLister::GetDirectoryId
+//
+//  The ID of the directory dirPath resolves to, or nullopt if it cannot be
+//  opened.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+optional<SDirectoryId> CDirectoryLister::GetDirectoryId (const filesystem::path & dirPath) const
+{
+    SDirectoryId id;
+
+
+
+    if (FAILED (m_pEnumerator->GetDirectoryId (dirPath, id)))
+    {
+        return nullopt;
+    }
+
+    return id;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CDirectoryLister::AddMatchToList
@@ -412,16 +695,27 @@ void CDirectoryLister::AddMatchToList (
     CDirectoryInfo        & di, 
     SListingTotals        * pTotals)
 {
-    size_t   cchFileName = 0; 
-    FileInfo fileEntry     (wfd);
-
-    fileEntry.m_strReparseTarget = ResolveReparseTarget (di.m_dirPath, wfd);
+    size_t   cchName          = wcslen (wfd.cFileName);
+    size_t   cchFileName      = 0; 
+    wstring  strReparseTarget;
+    FileInfo fileEntry          (wfd);
 
     
 
+    // Only reparse points need the directory's full path composed
+    if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+    {
+        strReparseTarget = ResolveReparseTarget (di.DirPath(), wfd);
+    }
+
+    if (!strReparseTarget.empty())
+    {
+        fileEntry.Extras().m_strReparseTarget = move (strReparseTarget);
+    }
+
     if (m_cmdLinePtr->m_fWideListing)
     {
-        cchFileName = wcslen (wfd.cFileName);
+        cchFileName = cchName;
     }
     
     if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
@@ -441,7 +735,7 @@ void CDirectoryLister::AddMatchToList (
         }
     }
     
-    di.m_vMatches.push_back (move (fileEntry));
+    di.AddMatch (move (fileEntry), wfd.cFileName, cchName);
 }
 
 
@@ -537,7 +831,7 @@ void CDirectoryLister::HandleFileMatch (const WIN32_FIND_DATA & wfd, FileInfo &
 HRESULT CDirectoryLister::HandleFileMatchStreams (const WIN32_FIND_DATA & wfd, FileInfo & fileEntry, CDirectoryInfo & di, SListingTotals * pTotals)
 {
     HRESULT                hr         = S_OK;
-    filesystem::path       fullPath   = di.m_dirPath / wfd.cFileName;
+    filesystem::path       fullPath   = di.DirPath() / wfd.cFileName;
     WIN32_FIND_STREAM_DATA streamData = { };
     AutoFindHandle         hFind;
 
@@ -583,7 +877,7 @@ HRESULT CDirectoryLister::HandleFileMatchStreams (const WIN32_FIND_DATA & wfd, F
             si.m_strName.resize (si.m_strName.length() - 6);
         }
 
-        fileEntry.m_vStreams.push_back (move (si));
+        fileEntry.Extras().m_vStreams.push_back (move (si));
     }
     while (FindNextStreamW (hFind, &streamData));
 
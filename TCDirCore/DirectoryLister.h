@@ -1,7 +1,9 @@
 #pragma once
 
 #include "DirectoryInfo.h"
+#include "IDirectoryEnumerator.h"
 #include "IResultsDisplayer.h"
+#include "LinkFollowPolicy.h"
 #include "ListingTotals.h"
 #include "MaskGrouper.h"
 
@@ -24,13 +26,62 @@ public:
     CDirectoryLister  (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr, unique_ptr<IResultsDisplayer> displayer);
     ~CDirectoryLister (void); 
 
-    void List         (const MaskGroup & group);
+    void List                   (const MaskGroup & group);
+    void PrefetchListings       (const vector<MaskGroup> & groups);
+    void SetDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pEnumerator);
+
+    // Time the multi-threaded display spent waiting on workers (for -P)
+    chrono::steady_clock::duration GetConsumerStallTime (void) const { return m_consumerStall; }
     
     static bool IsDots (LPCWSTR pszFileName);
 
 protected:
+    //
+    // One non-recursive directory + spec listing, read by PrefetchListings
+    // ahead of the display.  m_fCollected becomes ready once m_dirInfo,
+    // m_totals and m_hr are final.
+    //
+
+    struct SPrefetchedListing
+    {
+        SPrefetchedListing (const filesystem::path & dirPath, const filesystem::path & fileSpec) :
+            m_dirInfo (dirPath, fileSpec)
+        {
+            m_fCollected = m_collected.get_future();
+        }
+
+        CDirectoryInfo  m_dirInfo;
+        SListingTotals  m_totals;
+        HRESULT         m_hr = S_OK;
+        promise<void>   m_collected;
+        future<void>    m_fCollected;
+    };
+
+    using PrefetchKey = pair<filesystem::path, filesystem::path>;    // Directory, file spec
+
+    //
+    // One directory on the single-threaded /S recursion path, for link
+    // cycle detection.  m_id is looked up the first time a link below
+    // needs it (or is the link's target ID for a followed link).
+    //
+
+    struct SRecursionFrame
+    {
+        filesystem::path       m_dirPath;
+        UINT                   m_cLinksFollowed = 0;     // Links entered on the way down to here
+        bool                   m_fIdResolved    = false;
+        optional<SDirectoryId> m_id;
+    };
+
+    static constexpr size_t s_kcMinPrefetchThreads = 8;   // Reads are mostly I/O wait; matters on network shares
+
+
+
     CDirectoryLister  (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr);
 
+    void    PrefetchWorker                     (void);
+    unique_ptr<SPrefetchedListing> TakePrefetchedListing (const filesystem::path & dirPath, const filesystem::path & fileSpec);
+
     HRESULT ProcessDirectory                   (const CDriveInfo                   & driveInfo, 
                                                 const filesystem::path             & dirPath, 
                                                 const filesystem::path             & fileSpec, 
@@ -38,7 +89,8 @@ protected:
     
     HRESULT CollectMatchingFilesAndDirectories (const std::filesystem::path & dirPath,
                                                 const std::filesystem::path & fileSpec,
-                                                CDirectoryInfo              & di);
+                                                CDirectoryInfo              & di,
+                                                SListingTotals              & totals);
 
     HRESULT ProcessDirectoryMultiThreaded      (const CDriveInfo                   & driveInfo, 
                                                 const filesystem::path             & dirPath, 
@@ -49,6 +101,11 @@ protected:
                                                 const filesystem::path & dirPath, 
                                                 const filesystem::path & fileSpec);
 
+    bool    ShouldFollowLink                   (const filesystem::path & linkPath, SRecursionFrame & frame);
+
+    CLinkFollowPolicy::EDecision DecideLink     (const filesystem::path & linkPath, UINT cLinksAbove, optional<SDirectoryId> & targetId, const CLinkFollowPolicy::IsOnPathFn & fnIsOnPath);
+    optional<SDirectoryId>       GetDirectoryId (const filesystem::path & dirPath) const;
+
     void    AddMatchToList                     (const WIN32_FIND_DATA & wfd, CDirectoryInfo & di, SListingTotals * pTotals);
     void    HandleDirectoryMatch               (size_t & cchFileName, CDirectoryInfo & di);
     void    HandleFileMatch                    (const WIN32_FIND_DATA & wfd, FileInfo & fileEntry, CDirectoryInfo & di, SListingTotals * pTotals);
@@ -66,5 +123,21 @@ protected:
     shared_ptr<CConsole>                  m_consolePtr;
     shared_ptr<CConfig>                   m_configPtr;
     unique_ptr<IResultsDisplayer>         m_displayer;
+    shared_ptr<IDirectoryEnumerator>      m_pEnumerator;
     SListingTotals                        m_totals;
+    chrono::steady_clock::duration        m_consumerStall = {};
+    unique_ptr<CLinkFollowPolicy>         m_pLinkPolicy;                // Created per recursive listing
+    vector<SRecursionFrame>               m_vRecursionPath;             // Single-threaded /S only
+
+    //
+    // Prefetched listings by (directory, spec), and the queue the prefetch
+    // threads pull from.  Only the display thread touches the map.  The
+    // threads are declared last so they are joined before anything they
+    // touch is destroyed.
+    //
+
+    map<PrefetchKey, unique_ptr<SPrefetchedListing>> m_prefetched;
+    vector<SPrefetchedListing *>                     m_vPrefetchQueue;
+    atomic<size_t>                                   m_iNextPrefetch = 0;
+    vector<jthread>                                  m_prefetchThreads;
 };
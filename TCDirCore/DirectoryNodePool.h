@@ -0,0 +1,189 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryNodePool
+//
+//  Fixed-size block pool for the directory nodes of one listing.  Blocks
+//  are carved from chunks of s_kcBlocksPerChunk and recycled through a
+//  free list, so creating a node (together with its shared_ptr control
+//  block, see CDirectoryNodeAllocator) costs no heap allocation once the
+//  pool has warmed up.  The block size is fixed by the first allocation;
+//  anything of another size goes to the heap.
+//
+//  Workers allocate children while the display thread frees nodes it is
+//  done with, so the free list is guarded by a mutex.  It is held only
+//  for a pointer swap or, once per chunk, a heap allocation.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CDirectoryNodePool
+{
+public:
+    CDirectoryNodePool (void) = default;
+    CDirectoryNodePool (const CDirectoryNodePool &) = delete;
+    CDirectoryNodePool & operator= (const CDirectoryNodePool &) = delete;
+
+
+
+    void * Allocate (size_t cb)
+    {
+        lock_guard<mutex> lock (m_mutex);
+
+
+
+        if (m_cbBlock == 0)
+        {
+            m_cbBlock = RoundUpBlockSize (cb);
+        }
+
+        if (RoundUpBlockSize (cb) != m_cbBlock)
+        {
+            return ::operator new (cb);
+        }
+
+        if (m_pFree == nullptr)
+        {
+            AddChunk();
+        }
+
+        SFreeBlock * pBlock = m_pFree;
+
+        m_pFree = pBlock->m_pNext;
+        return pBlock;
+    }
+
+
+
+    void Free (void * p, size_t cb) noexcept
+    {
+        lock_guard<mutex> lock (m_mutex);
+
+
+
+        if (RoundUpBlockSize (cb) != m_cbBlock)
+        {
+            ::operator delete (p);
+            return;
+        }
+
+        SFreeBlock * pBlock = static_cast<SFreeBlock *> (p);
+
+        pBlock->m_pNext = m_pFree;
+        m_pFree         = pBlock;
+    }
+
+
+
+    size_t GetChunkCount (void) const
+    {
+        lock_guard<mutex> lock (m_mutex);
+
+        return m_vChunks.size();
+    }
+
+
+
+    static constexpr size_t s_kcBlocksPerChunk = 256;
+
+
+
+private:
+    struct SFreeBlock
+    {
+        SFreeBlock * m_pNext;
+    };
+
+    static size_t RoundUpBlockSize (size_t cb)
+    {
+        constexpr size_t kcbAlign = alignof (max_align_t);
+
+        return ((std::max) (cb, sizeof (SFreeBlock)) + kcbAlign - 1) & ~(kcbAlign - 1);
+    }
+
+    void AddChunk (void)
+    {
+        auto   pChunk = make_unique<BYTE[]> (m_cbBlock * s_kcBlocksPerChunk);
+        BYTE * pbBase = pChunk.get();
+
+
+
+        for (size_t i = s_kcBlocksPerChunk; i-- > 0; )
+        {
+            SFreeBlock * pBlock = reinterpret_cast<SFreeBlock *> (pbBase + i * m_cbBlock);
+
+            pBlock->m_pNext = m_pFree;
+            m_pFree         = pBlock;
+        }
+
+        m_vChunks.push_back (move (pChunk));
+    }
+
+    mutable mutex              m_mutex;
+    SFreeBlock               * m_pFree   = nullptr;
+    size_t                     m_cbBlock = 0;
+    vector<unique_ptr<BYTE[]>> m_vChunks;
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CDirectoryNodeAllocator
+//
+//  Allocator for allocate_shared over a CDirectoryNodePool.  The control
+//  block keeps a copy of the allocator, so every node holds a reference to
+//  its pool and the pool outlives the last node even if a worker still has
+//  one queued when the listing ends.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+class CDirectoryNodeAllocator
+{
+public:
+    using value_type = T;
+
+    static_assert (alignof (T) <= alignof (max_align_t), "Pool blocks are only aligned for max_align_t");
+
+
+
+    explicit CDirectoryNodeAllocator (shared_ptr<CDirectoryNodePool> pPool) noexcept :
+        m_pPool (move (pPool))
+    {
+    }
+
+    template<typename U>
+    CDirectoryNodeAllocator (const CDirectoryNodeAllocator<U> & other) noexcept :
+        m_pPool (other.m_pPool)
+    {
+    }
+
+
+
+    T * allocate (size_t n)
+    {
+        return static_cast<T *> (m_pPool->Allocate (n * sizeof (T)));
+    }
+
+    void deallocate (T * p, size_t n) noexcept
+    {
+        m_pPool->Free (p, n * sizeof (T));
+    }
+
+    template<typename U>
+    bool operator== (const CDirectoryNodeAllocator<U> & other) const noexcept
+    {
+        return m_pPool == other.m_pPool;
+    }
+
+
+
+    shared_ptr<CDirectoryNodePool> m_pPool;
+};
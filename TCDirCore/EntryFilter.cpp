@@ -0,0 +1,339 @@
+#include "pch.h"
+#include "EntryFilter.h"
+
+#include "DirectoryInfo.h"
+#include "Flag.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::AddSizeBound
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CEntryFilter::AddSizeBound (wstring_view text, bool fAbove)
+{
+    HRESULT   hr     = S_OK;
+    ULONGLONG cbSize = 0;
+
+
+
+    hr = ParseSize (text, cbSize);
+    CHR (hr);
+
+    m_vProgram.push_back ({ fAbove ? EOp::SizeAbove : EOp::SizeBelow, cbSize });
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::AddTimeBound
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CEntryFilter::AddTimeBound (wstring_view text, bool fNewer)
+{
+    HRESULT   hr     = S_OK;
+    ULONGLONG ftDate = 0;
+
+
+
+    hr = ParseDate (text, ftDate);
+    CHR (hr);
+
+    m_vProgram.push_back ({ fNewer ? EOp::TimeFrom : EOp::TimeBefore, ftDate });
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::AddNamePattern
+//
+//  std::regex reports a malformed pattern only by throwing, so this is the
+//  one place the exception is caught and turned into an HRESULT.  Names
+//  compare case-insensitively, as the file system does.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CEntryFilter::AddNamePattern (const wstring & pattern)
+{
+    HRESULT hr = S_OK;
+
+
+
+    CBREx (!pattern.empty(), E_INVALIDARG);
+
+    try
+    {
+        m_vPatterns.emplace_back (pattern, regex_constants::ECMAScript | regex_constants::icase | regex_constants::optimize);
+    }
+    catch (const regex_error &)
+    {
+        hr = E_INVALIDARG;
+    }
+
+    CHR (hr);
+
+    m_vProgram.push_back ({ EOp::NameRegex, m_vPatterns.size() - 1 });
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::Compile
+//
+//  Orders the program by the cost of each test (the ops are declared
+//  cheapest first) and folds each run of bounds of the same kind into the
+//  tightest of them.  Patterns are all kept.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CEntryFilter::Compile (FILETIME WIN32_FIND_DATA::* pftTime)
+{
+    vector<SInstruction> vCompiled;
+
+
+
+    m_pftTime = pftTime;
+
+    stable_sort (m_vProgram.begin(), m_vProgram.end(), [] (const SInstruction & lhs, const SInstruction & rhs)
+    {
+        return lhs.m_op < rhs.m_op;
+    });
+
+    for (const SInstruction & instruction : m_vProgram)
+    {
+        if (vCompiled.empty() || vCompiled.back().m_op != instruction.m_op || instruction.m_op == EOp::NameRegex)
+        {
+            vCompiled.push_back (instruction);
+            continue;
+        }
+
+        ULONGLONG & ullBound = vCompiled.back().m_ullOperand;
+
+        switch (instruction.m_op)
+        {
+            case EOp::SizeAbove:
+            case EOp::TimeFrom:
+                ullBound = (max) (ullBound, instruction.m_ullOperand);
+                break;
+
+            case EOp::SizeBelow:
+            case EOp::TimeBefore:
+                ullBound = (min) (ullBound, instruction.m_ullOperand);
+                break;
+        }
+    }
+
+    m_vProgram = move (vCompiled);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::Matches
+//
+//  Runs the program on one entry, stopping at the first test it fails.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CEntryFilter::Matches (const WIN32_FIND_DATA & wfd) const
+{
+    const FILETIME & ftTime  = wfd.*m_pftTime;
+    bool             fIsFile = CFlag::IsNotSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+    ULONGLONG        cbSize  = FileInfo::PackULongLong (wfd.nFileSizeHigh, wfd.nFileSizeLow);
+    ULONGLONG        ullTime = FileInfo::PackULongLong (ftTime.dwHighDateTime, ftTime.dwLowDateTime);
+
+
+
+    for (const SInstruction & instruction : m_vProgram)
+    {
+        bool fPass = false;
+
+        switch (instruction.m_op)
+        {
+            case EOp::SizeAbove:
+                fPass = fIsFile && cbSize > instruction.m_ullOperand;
+                break;
+
+            case EOp::SizeBelow:
+                fPass = fIsFile && cbSize < instruction.m_ullOperand;
+                break;
+
+            case EOp::TimeFrom:
+                fPass = ullTime >= instruction.m_ullOperand;
+                break;
+
+            case EOp::TimeBefore:
+                fPass = ullTime < instruction.m_ullOperand;
+                break;
+
+            case EOp::NameRegex:
+                fPass = regex_search (wfd.cFileName, m_vPatterns[static_cast<size_t> (instruction.m_ullOperand)]);
+                break;
+        }
+
+        if (!fPass)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::ParseSize
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CEntryFilter::ParseSize (wstring_view text, ULONGLONG & cbSize)
+{
+    static constexpr wchar_t s_krgchUnits[] = L"KMGT";
+
+    HRESULT   hr        = S_OK;
+    size_t    i         = 0;
+    ULONGLONG ullWhole  = 0;
+    double    dFraction = 0;
+    double    dScale    = 0.1;
+    int       cShift    = 0;
+
+
+
+    for (; i < text.size() && iswdigit (text[i]); ++i)
+    {
+        CBREx (ullWhole <= (ULLONG_MAX - 9) / 10, E_INVALIDARG);
+        ullWhole = ullWhole * 10 + (text[i] - L'0');
+    }
+
+    CBREx (i > 0, E_INVALIDARG);
+
+    if (i < text.size() && text[i] == L'.')
+    {
+        for (++i; i < text.size() && iswdigit (text[i]); ++i)
+        {
+            dFraction += (text[i] - L'0') * dScale;
+            dScale    /= 10;
+        }
+    }
+
+    if (i < text.size())
+    {
+        const wchar_t * pchUnit = wcschr (s_krgchUnits, towupper (text[i]));
+
+        if (pchUnit != nullptr && *pchUnit != L'\0')
+        {
+            cShift = 10 * static_cast<int> (pchUnit - s_krgchUnits + 1);
+            ++i;
+        }
+    }
+
+    if (i < text.size() && towupper (text[i]) == L'B')
+    {
+        ++i;
+    }
+
+    CBREx (i == text.size(), E_INVALIDARG);
+    CBREx (ullWhole <= (ULLONG_MAX >> cShift) - 1, E_INVALIDARG);
+
+    cbSize = (ullWhole << cShift) + static_cast<ULONGLONG> (dFraction * static_cast<double> (1ull << cShift));
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter::ParseDate
+//
+//  A date alone means midnight at its start.  SystemTimeToFileTime rejects
+//  days and times out of range (e.g. 2026-02-30).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CEntryFilter::ParseDate (wstring_view text, ULONGLONG & ftDate)
+{
+    HRESULT    hr         = S_OK;
+    wstring    strText    (text);
+    SYSTEMTIME stLocal    = {};
+    SYSTEMTIME stUtc      = {};
+    FILETIME   ft         = {};
+    int        cchDate    = 0;
+    int        cchTime    = 0;
+    int        cchSeconds = 0;
+
+
+
+    CBREx (swscanf_s (strText.c_str(), L"%4hu-%2hu-%2hu%n", &stLocal.wYear, &stLocal.wMonth, &stLocal.wDay, &cchDate) == 3, E_INVALIDARG);
+    CBREx (cchDate == 10, E_INVALIDARG);
+
+    if (static_cast<size_t> (cchDate) < strText.size())
+    {
+        LPCWSTR pszTime = strText.c_str() + cchDate;
+
+        CBREx (*pszTime == L'T' || *pszTime == L't' || *pszTime == L' ', E_INVALIDARG);
+        ++pszTime;
+
+        CBREx (swscanf_s (pszTime, L"%2hu:%2hu%n", &stLocal.wHour, &stLocal.wMinute, &cchTime) == 2, E_INVALIDARG);
+        pszTime += cchTime;
+
+        if (*pszTime == L':')
+        {
+            CBREx (swscanf_s (pszTime, L":%2hu%n", &stLocal.wSecond, &cchSeconds) == 1, E_INVALIDARG);
+            pszTime += cchSeconds;
+        }
+
+        CBREx (*pszTime == L'\0', E_INVALIDARG);
+    }
+
+    CWREx (TzSpecificLocalTimeToSystemTime (nullptr, &stLocal, &stUtc), E_INVALIDARG);
+    CWREx (SystemTimeToFileTime (&stUtc, &ft), E_INVALIDARG);
+
+    ftDate = FileInfo::PackULongLong (ft.dwHighDateTime, ft.dwLowDateTime);
+
+
+
+Error:
+    return hr;
+}
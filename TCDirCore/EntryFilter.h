@@ -0,0 +1,73 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CEntryFilter
+//
+//  The size, date, and name predicates of --Size>N, --Size<N, --Newer,
+//  --Older, and --Regex.  They are compiled once, after the command line
+//  is parsed, into a short program that the enumeration evaluates on each
+//  entry next to the attribute filters, so an entry that fails them is
+//  never stored, sorted, formatted, or counted.
+//
+//  Compiling folds repeated bounds into the tightest one and puts the
+//  regular expressions last, so most entries are rejected by an integer
+//  compare before a regex runs.  Size bounds match only files; dates and
+//  names match directories too.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CEntryFilter
+{
+public:
+    HRESULT AddSizeBound    (wstring_view text, bool fAbove);
+    HRESULT AddTimeBound    (wstring_view text, bool fNewer);
+    HRESULT AddNamePattern  (const wstring & pattern);
+
+    //
+    // Builds the program.  pftTime is the field compared with the dates
+    // (the /T: time field).
+    //
+
+    void    Compile         (FILETIME WIN32_FIND_DATA::* pftTime);
+
+    bool    IsEmpty         (void) const { return m_vProgram.empty(); }
+    bool    Matches         (const WIN32_FIND_DATA & wfd) const;
+
+    //
+    // "100", "100K", "1.5M", "2GB": bytes, or 1024-based units
+    //
+
+    static HRESULT ParseSize (wstring_view text, ULONGLONG & cbSize);
+
+    //
+    // "2026-10-01" or "2026-10-01T14:30[:15]", local time, as a UTC FILETIME
+    //
+
+    static HRESULT ParseDate (wstring_view text, ULONGLONG & ftDate);
+
+
+private:
+    enum class EOp : BYTE
+    {
+        SizeAbove,          // File size >  operand
+        SizeBelow,          // File size <  operand
+        TimeFrom,           // Time      >= operand
+        TimeBefore,         // Time      <  operand
+        NameRegex,          // Name matches m_vPatterns[operand]
+    };
+
+    struct SInstruction
+    {
+        EOp       m_op;
+        ULONGLONG m_ullOperand;
+    };
+
+    vector<SInstruction>        m_vProgram;
+    vector<wregex>              m_vPatterns;
+    FILETIME WIN32_FIND_DATA::* m_pftTime = &WIN32_FIND_DATA::ftLastWriteTime;
+};
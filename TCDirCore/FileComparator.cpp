@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "FileComparator.h"
 
+#include "CaseFolding.h"
+
 
 
 
@@ -9,14 +11,21 @@
 //
 //  FileComparator::FileComparator
 //
-//  
+//  di is the directory whose matches are being compared; entry names are
+//  looked up in its name arena.  The matches must all be present: a
+//  natural sort tokenizes them here, once.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-FileComparator::FileComparator (shared_ptr<const CCommandLine> cmdLinePtr, bool fInterleavedSort) :
+FileComparator::FileComparator (shared_ptr<const CCommandLine> cmdLinePtr, const CDirectoryInfo & di, bool fInterleavedSort) :
     m_cmdLinePtr       (cmdLinePtr),
+    m_pDirInfo         (&di),
     m_fInterleavedSort (fInterleavedSort)
 {
+    if (PrimaryAttribute() == CCommandLine::ESortOrder::SO_NATURAL)
+    {
+        BuildNaturalKeys();
+    }
 }
 
 
@@ -27,18 +36,17 @@ FileComparator::FileComparator (shared_ptr<const CCommandLine> cmdLinePtr, bool
 //
 //  FileComparator::operator()
 //
-//  Compare two WIN32_FIND_DATA entries for sorting
+//  Compare two FileInfo entries for sorting
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-bool FileComparator::operator() (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const
+bool FileComparator::operator() (const FileInfo & lhs, const FileInfo & rhs) const
 {
-    bool                             comesBeforeRhs = false;
-    bool                             isLhsDirectory = false;
-    bool                             isRhsDirectory = false;
-    const CCommandLine::ESortOrder * pSortAttribute = NULL;
-    const CCommandLine::ESortOrder * pLastAttribute = &m_cmdLinePtr->m_rgSortPreference[ARRAYSIZE(m_cmdLinePtr->m_rgSortPreference)];
-    LONGLONG                         cmp            = 0;
+    bool     comesBeforeRhs     = false;
+    bool     isLhsDirectory     = false;
+    bool     isRhsDirectory     = false;
+    size_t   iDecidingAttribute = 0;
+    LONGLONG cmp                = 0;
 
 
 
@@ -47,8 +55,8 @@ bool FileComparator::operator() (const WIN32_FIND_DATA & lhs, const WIN32_FIND_D
     // In interleaved sort mode (tree view), directories and files sort together.
     //
 
-    isLhsDirectory = lhs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
-    isRhsDirectory = rhs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+    isLhsDirectory = lhs.IsDirectory();
+    isRhsDirectory = rhs.IsDirectory();
 
     if (!m_fInterleavedSort && (isLhsDirectory ^ isRhsDirectory))
     {
@@ -59,11 +67,70 @@ bool FileComparator::operator() (const WIN32_FIND_DATA & lhs, const WIN32_FIND_D
     // Compare based on requested sort attribute with fallbacks
     //
 
-    for (pSortAttribute = m_cmdLinePtr->m_rgSortPreference;
-         pSortAttribute < pLastAttribute;
-         ++pSortAttribute)
+    cmp            = CompareFrom (lhs, rhs, 0, iDecidingAttribute);
+    comesBeforeRhs = cmp < 0;
+
+    //
+    // Only respect reverse sorting if the comparison was against the requested attribute.  
+    // If we had to fall back to another attribute because we did not differ from rhs in the
+    // requested attribute, *ignore* reverse sorting for this attribute.
+    //
+
+    if (iDecidingAttribute == 0 && IsDescending())
     {
-        switch (*pSortAttribute)
+        comesBeforeRhs = !comesBeforeRhs;
+    }
+
+    return comesBeforeRhs;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::CompareSecondary
+//
+//  Compare two entries that tie on the primary attribute, using the
+//  fallback attributes.  Reverse sorting never applies to these.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LONGLONG FileComparator::CompareSecondary (const FileInfo & lhs, const FileInfo & rhs) const
+{
+    size_t iDecidingAttribute = 0;
+
+
+
+    return CompareFrom (lhs, rhs, 1, iDecidingAttribute);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::CompareFrom
+//
+//  Walk the sort preferences from iFirstAttribute and return the first
+//  non-zero comparison.  iDecidingAttribute receives the index of the
+//  attribute that decided it, or the preference count if all tied.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LONGLONG FileComparator::CompareFrom (const FileInfo & lhs, const FileInfo & rhs, size_t iFirstAttribute, size_t & iDecidingAttribute) const
+{
+    LONGLONG cmp = 0;
+
+
+
+    for (iDecidingAttribute = iFirstAttribute;
+         iDecidingAttribute < ARRAYSIZE (m_cmdLinePtr->m_rgSortPreference);
+         ++iDecidingAttribute)
+    {
+        switch (m_cmdLinePtr->m_rgSortPreference[iDecidingAttribute])
         {
             case CCommandLine::ESortOrder::SO_DEFAULT:
             case CCommandLine::ESortOrder::SO_NAME:
@@ -81,39 +148,23 @@ bool FileComparator::operator() (const WIN32_FIND_DATA & lhs, const WIN32_FIND_D
             case CCommandLine::ESortOrder::SO_SIZE:
                 cmp = CompareSize (lhs, rhs);
                 break;
+
+            case CCommandLine::ESortOrder::SO_NATURAL:
+                cmp = CompareNatural (lhs, rhs);
+                break;
         }
 
         //
-        // If we didn't differ from rhs in this attribute, move on to the next one
+        // Stop at the first attribute where we differ from rhs
         //
 
-        if (cmp == 0)
+        if (cmp != 0)
         {
-            continue;
+            break;
         }
-
-        comesBeforeRhs = cmp < 0;
-
-        //
-        // We found an attribute where we're different from the rhs, so break out of the sort loop
-        //
-
-        break;
-    }
-
-    //
-    // Only respect reverse sorting if the comparison was against the requested attribute.  
-    // If we had to fall back to another attribute because we did not differ from rhs in the
-    // requested attribute, *ignore* reverse sorting for this attribute.
-    //
-
-    if (pSortAttribute == m_cmdLinePtr->m_rgSortPreference &&
-        m_cmdLinePtr->m_sortdirection == CCommandLine::ESortDirection::SD_DESCENDING)
-    {
-        comesBeforeRhs = !comesBeforeRhs;
     }
 
-    return comesBeforeRhs;
+    return cmp;
 }
 
 
@@ -124,13 +175,19 @@ bool FileComparator::operator() (const WIN32_FIND_DATA & lhs, const WIN32_FIND_D
 //
 //  FileComparator::CompareName
 //
-//  Compare two files by name (case-insensitive)
+//  Compare two files by name (case-insensitive).  Ordinal by default;
+//  --Sort=Locale uses lstrcmpiW, which follows the user's locale.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-LONGLONG FileComparator::CompareName (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const
+LONGLONG FileComparator::CompareName (const FileInfo & lhs, const FileInfo & rhs) const
 {
-    return lstrcmpiW (lhs.cFileName, rhs.cFileName);
+    if (IsLocaleCompare())
+    {
+        return lstrcmpiW (m_pDirInfo->Name (lhs), m_pDirInfo->Name (rhs));
+    }
+
+    return CCaseFolding::CompareOrdinalIgnoreCase (m_pDirInfo->NameView (lhs), m_pDirInfo->NameView (rhs));
 }
 
 
@@ -145,33 +202,47 @@ LONGLONG FileComparator::CompareName (const WIN32_FIND_DATA & lhs, const WIN32_F
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-LONGLONG FileComparator::CompareDate (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const
+LONGLONG FileComparator::CompareDate (const FileInfo & lhs, const FileInfo & rhs) const
 {
-    const FILETIME * pftLhs = nullptr;
-    const FILETIME * pftRhs = nullptr;
+    ULONGLONG ullLhs = SelectedTime (lhs);
+    ULONGLONG ullRhs = SelectedTime (rhs);
+
+
+
+    //
+    // The packed times compare as plain integers, which is what
+    // CompareFileTime does with the two halves.
+    //
+
+    return (ullLhs < ullRhs) ? -1 : (ullLhs > ullRhs) ? 1 : 0;
+}
 
 
 
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::SelectedTime
+//
+//  The packed time field selected via the /T: switch
+//
+////////////////////////////////////////////////////////////////////////////////
+
+ULONGLONG FileComparator::SelectedTime (const FileInfo & fileInfo) const
+{
     switch (m_cmdLinePtr->m_timeField)
     {
         case CCommandLine::ETimeField::TF_CREATION:
-            pftLhs = &lhs.ftCreationTime;
-            pftRhs = &rhs.ftCreationTime;
-            break;
+            return fileInfo.m_ftCreation;
 
         case CCommandLine::ETimeField::TF_ACCESS:
-            pftLhs = &lhs.ftLastAccessTime;
-            pftRhs = &rhs.ftLastAccessTime;
-            break;
+            return fileInfo.m_ftLastAccess;
 
         case CCommandLine::ETimeField::TF_WRITTEN:
         default:
-            pftLhs = &lhs.ftLastWriteTime;
-            pftRhs = &rhs.ftLastWriteTime;
-            break;
+            return fileInfo.m_ftLastWrite;
     }
-
-    return CompareFileTime (pftLhs, pftRhs);
 }
 
 
@@ -186,14 +257,19 @@ LONGLONG FileComparator::CompareDate (const WIN32_FIND_DATA & lhs, const WIN32_F
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-LONGLONG FileComparator::CompareExtension (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const
+LONGLONG FileComparator::CompareExtension (const FileInfo & lhs, const FileInfo & rhs) const
 {
-    LPCWSTR pszLhsExt = wcsrchr (lhs.cFileName, L'.');
-    LPCWSTR pszRhsExt = wcsrchr (rhs.cFileName, L'.');
+    wstring_view lhsExt = Extension (lhs);
+    wstring_view rhsExt = Extension (rhs);
 
 
 
-    return lstrcmpiW (pszLhsExt ? pszLhsExt : L"", pszRhsExt ? pszRhsExt : L"");    
+    if (IsLocaleCompare())
+    {
+        return lstrcmpiW (lhsExt.data(), rhsExt.data());
+    }
+
+    return CCaseFolding::CompareOrdinalIgnoreCase (lhsExt, rhsExt);
 }
 
 
@@ -202,35 +278,53 @@ LONGLONG FileComparator::CompareExtension (const WIN32_FIND_DATA & lhs, const WI
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  FileComparator::CompareSize
+//  FileComparator::Extension
 //
-//  Compare two files by size
+//  The name from its last '.' on, or an empty string.  Either way the
+//  view is null-terminated.  --Top names entries by their full paths, so
+//  a dot in a directory name is not an extension.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-LONGLONG FileComparator::CompareSize (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const
+wstring_view FileComparator::Extension (const FileInfo & fileInfo) const
 {
-    ULARGE_INTEGER uliLhsSize;
-    ULARGE_INTEGER uliRhsSize;
+    wstring_view name = m_pDirInfo->NameView (fileInfo);
+    size_t       iDot = name.rfind (L'.');
+
+
+
+    if (iDot == wstring_view::npos || name.find (L'\\', iDot) != wstring_view::npos)
+    {
+        return wstring_view (L"");
+    }
+
+    return name.substr (iDot);
+}
 
 
 
-    uliLhsSize.HighPart = lhs.nFileSizeHigh;
-    uliLhsSize.LowPart  = lhs.nFileSizeLow;
 
-    uliRhsSize.HighPart = rhs.nFileSizeHigh;
-    uliRhsSize.LowPart  = rhs.nFileSizeLow;
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::CompareSize
+//
+//  Compare two files by size
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LONGLONG FileComparator::CompareSize (const FileInfo & lhs, const FileInfo & rhs) const
+{
     //
     // Use explicit relational comparison to avoid signed overflow 
     // from subtraction on 64-bit sizes.
     //
 
-    if (uliLhsSize.QuadPart < uliRhsSize.QuadPart)
+    if (lhs.m_cbSize < rhs.m_cbSize)
     {
         return -1;
     }
-    else if (uliLhsSize.QuadPart > uliRhsSize.QuadPart)
+    else if (lhs.m_cbSize > rhs.m_cbSize)
     {
         return 1;
     }
@@ -239,3 +333,153 @@ LONGLONG FileComparator::CompareSize (const WIN32_FIND_DATA & lhs, const WIN32_F
         return 0;
     }
 }
+
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::CompareNatural
+//
+//  Compare two files by name with digit runs compared by value
+//  (shard2 < shard10), using the keys built by BuildNaturalKeys.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LONGLONG FileComparator::CompareNatural (const FileInfo & lhs, const FileInfo & rhs) const
+{
+    if (!m_pNaturalKeys)
+    {
+        return CompareName (lhs, rhs);
+    }
+
+    return NaturalKey (lhs).compare (NaturalKey (rhs));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::NaturalKey
+//
+////////////////////////////////////////////////////////////////////////////////
+
+wstring_view FileComparator::NaturalKey (const FileInfo & fileInfo) const
+{
+    const vector<SNaturalKeys::SEntry> & vEntries = m_pNaturalKeys->m_vEntries;
+
+    auto iter = lower_bound (vEntries.begin(), vEntries.end(), fileInfo.m_ibName,
+                             [] (const SNaturalKeys::SEntry & entry, UINT ibName) { return entry.m_ibName < ibName; });
+
+
+
+    if (iter == vEntries.end() || iter->m_ibName != fileInfo.m_ibName)
+    {
+        return wstring_view();
+    }
+
+    return wstring_view (m_pNaturalKeys->m_vArena.data() + iter->m_ibKey, iter->m_cchKey);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::BuildNaturalKeys
+//
+//  Tokenizes every match of the directory into its natural sort key.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void FileComparator::BuildNaturalKeys (void)
+{
+    auto            pKeys = make_shared<SNaturalKeys>();
+    vector<wchar_t> key;
+
+
+
+    pKeys->m_vEntries.reserve (m_pDirInfo->m_vMatches.size());
+    pKeys->m_vArena.reserve (m_pDirInfo->m_vNameArena.size() + m_pDirInfo->m_vMatches.size() * 2);
+
+    for (const FileInfo & fileInfo : m_pDirInfo->m_vMatches)
+    {
+        BuildNaturalKey (m_pDirInfo->NameView (fileInfo), key);
+
+        pKeys->m_vEntries.push_back ({ fileInfo.m_ibName, static_cast<UINT> (pKeys->m_vArena.size()), static_cast<UINT> (key.size()) });
+        pKeys->m_vArena.insert (pKeys->m_vArena.end(), key.begin(), key.end());
+    }
+
+    //
+    // Matches are normally still in arena order here, so this is a check
+    // rather than a real sort
+    //
+
+    if (!is_sorted (pKeys->m_vEntries.begin(), pKeys->m_vEntries.end(),
+                    [] (const SNaturalKeys::SEntry & lhs, const SNaturalKeys::SEntry & rhs) { return lhs.m_ibName < rhs.m_ibName; }))
+    {
+        sort (pKeys->m_vEntries.begin(), pKeys->m_vEntries.end(),
+              [] (const SNaturalKeys::SEntry & lhs, const SNaturalKeys::SEntry & rhs) { return lhs.m_ibName < rhs.m_ibName; });
+    }
+
+    m_pNaturalKeys = move (pKeys);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileComparator::BuildNaturalKey
+//
+//  Encodes a name so that comparing keys unit by unit gives the natural
+//  order.  Other characters are upcased, as in the ordinal name sort.  A
+//  run of ASCII digits becomes '0', the run's length without leading
+//  zeros, then those digits: the '0' keeps a number sorting where a digit
+//  would against the surrounding text, and a longer number (a larger
+//  value) then sorts after a shorter one.  Names that differ only in
+//  leading zeros get equal keys and fall through to the next sort
+//  preference.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void FileComparator::BuildNaturalKey (wstring_view name, vector<wchar_t> & key)
+{
+    size_t i = 0;
+
+
+
+    key.clear();
+
+    while (i < name.size())
+    {
+        if (name[i] < L'0' || name[i] > L'9')
+        {
+            key.push_back (CCaseFolding::UpcaseChar (name[i]));
+            ++i;
+            continue;
+        }
+
+        size_t iStart = i;
+
+        while (i < name.size() && name[i] >= L'0' && name[i] <= L'9')
+        {
+            ++i;
+        }
+
+        while (iStart + 1 < i && name[iStart] == L'0')
+        {
+            ++iStart;
+        }
+
+        key.push_back (L'0');
+        key.push_back (static_cast<wchar_t> (i - iStart));
+        key.insert (key.end(), name.begin() + iStart, name.begin() + i);
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CommandLine.h"
+#include "DirectoryInfo.h"
 
 
 
@@ -9,16 +10,58 @@
 class FileComparator
 {
 public:
-    FileComparator (shared_ptr<const CCommandLine> cmdLinePtr, bool fInterleavedSort = false);
+    FileComparator (shared_ptr<const CCommandLine> cmdLinePtr, const CDirectoryInfo & di, bool fInterleavedSort = false);
     
-    bool operator()(const WIN32_FIND_DATA& lhs, const WIN32_FIND_DATA& rhs) const;
+    bool operator()(const FileInfo & lhs, const FileInfo & rhs) const;
+
+    //
+    // Pieces of the ordering for CMatchSorter, which sorts precomputed keys
+    // for the primary attribute and only calls back here to break ties
+    //
+
+    CCommandLine::ESortOrder PrimaryAttribute  (void) const { return m_cmdLinePtr->m_rgSortPreference[0]; }
+    bool                     IsDescending      (void) const { return m_cmdLinePtr->m_sortdirection == CCommandLine::ESortDirection::SD_DESCENDING; }
+    bool                     IsInterleaved     (void) const { return m_fInterleavedSort; }
+    bool                     IsLocaleCompare   (void) const { return m_cmdLinePtr->m_eNameCompare == CCommandLine::ENameCompare::Locale; }
+    const CDirectoryInfo &   DirInfo           (void) const { return *m_pDirInfo; }
+    ULONGLONG                SelectedTime      (const FileInfo & fileInfo) const;
+    wstring_view             Extension         (const FileInfo & fileInfo) const;
+    bool                     HasNaturalKeys    (void) const { return m_pNaturalKeys != nullptr; }
+    wstring_view             NaturalKey        (const FileInfo & fileInfo) const;
+    LONGLONG                 CompareSecondary  (const FileInfo & lhs, const FileInfo & rhs) const;
+
+    static void BuildNaturalKey (wstring_view name, vector<wchar_t> & key);
 
 private:
-    LONGLONG CompareName      (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const;
-    LONGLONG CompareDate      (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const;
-    LONGLONG CompareExtension (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const;
-    LONGLONG CompareSize      (const WIN32_FIND_DATA & lhs, const WIN32_FIND_DATA & rhs) const;
+    //
+    // Natural sort (/OV) keys for every entry of the directory, built once
+    // by the constructor.  Entries are found by their name arena offset,
+    // which stays with an entry however the matches are reordered.
+    //
+
+    struct SNaturalKeys
+    {
+        struct SEntry
+        {
+            UINT m_ibName;
+            UINT m_ibKey;
+            UINT m_cchKey;
+        };
+
+        vector<wchar_t> m_vArena;
+        vector<SEntry>  m_vEntries;     // Sorted by m_ibName
+    };
+
+    void     BuildNaturalKeys (void);
+    LONGLONG CompareFrom      (const FileInfo & lhs, const FileInfo & rhs, size_t iFirstAttribute, size_t & iDecidingAttribute) const;
+    LONGLONG CompareName      (const FileInfo & lhs, const FileInfo & rhs) const;
+    LONGLONG CompareDate      (const FileInfo & lhs, const FileInfo & rhs) const;
+    LONGLONG CompareExtension (const FileInfo & lhs, const FileInfo & rhs) const;
+    LONGLONG CompareSize      (const FileInfo & lhs, const FileInfo & rhs) const;
+    LONGLONG CompareNatural   (const FileInfo & lhs, const FileInfo & rhs) const;
 
     shared_ptr<const CCommandLine> m_cmdLinePtr;
+    const CDirectoryInfo *         m_pDirInfo         = nullptr;    // Owns the name arena the entries index
+    shared_ptr<const SNaturalKeys> m_pNaturalKeys;                  // Null unless /OV; shared so copies of the comparator stay cheap
     bool                           m_fInterleavedSort = false;
 };
@@ -0,0 +1,651 @@
+#include "pch.h"
+#include "FileSpecMatcher.h"
+
+#include "CaseFolding.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::CFileSpecMatcher
+//
+//  Translates, upcases, and compiles every spec once so that per-entry
+//  matching does no allocation.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CFileSpecMatcher::CFileSpecMatcher (const vector<filesystem::path> & fileSpecs)
+{
+    wchar_t szUpcased[MAX_PATH] = { 0 };
+
+
+
+    for (const auto & fileSpec : fileSpecs)
+    {
+        wstring expression = TranslateDosWildcards (fileSpec.wstring());
+        size_t  cchUpcased = 0;
+
+        //
+        // "*" and "*.*" (which translates to <"*) match every name, so the
+        // per-entry check can be skipped entirely.
+        //
+
+        if (expression == L"*" || expression == L"<\"*")
+        {
+            m_fMatchesAll = true;
+        }
+
+        //
+        // A component longer than MAX_PATH cannot exist on disk, and
+        // FindFirstFile rejects such a spec outright.
+        //
+
+        cchUpcased = CCaseFolding::Upcase (expression, szUpcased, ARRAYSIZE (szUpcased));
+
+        if (cchUpcased > 0)
+        {
+            CompileExpression (wstring (szUpcased, cchUpcased));
+        }
+    }
+
+    BuildNfa();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::CompileExpression
+//
+//  Routes an upcased, DOS-translated expression to the cheapest structure
+//  that can evaluate it exactly.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CFileSpecMatcher::CompileExpression (const wstring & expression)
+{
+    static constexpr wchar_t s_kszWildcards[] = { L'*', L'?', s_kchDosStar, s_kchDosQm, s_kchDosDot, L'\0' };
+
+    size_t       iFirstWildcard = expression.find_first_of (s_kszWildcards);
+    wstring_view rest;
+
+
+
+    if (iFirstWildcard == wstring::npos)
+    {
+        m_exactNames.insert (expression);
+        return;
+    }
+
+    //
+    // Only a single leading wildcard qualifies for the tables below
+    //
+
+    rest = wstring_view (expression).substr (1);
+
+    if (iFirstWildcard == 0 && rest.find_first_of (s_kszWildcards) == wstring_view::npos)
+    {
+        //
+        // <.EXT with no further dots: DOS_STAR runs up to the final '.',
+        // so this is exactly "the extension is EXT".
+        //
+
+        if (expression[0] == s_kchDosStar         &&
+            rest.size() > 1                       &&
+            rest[0] == L'.'                       &&
+            rest.find (L'.', 1) == wstring_view::npos)
+        {
+            m_extensions.insert (wstring (rest.substr (1)));
+            return;
+        }
+
+        if (expression[0] == L'*')
+        {
+            m_vSuffixes.push_back (wstring (rest));
+            return;
+        }
+    }
+
+    m_vNfaExpressions.push_back (expression);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::BuildNfa
+//
+//  Lays the remaining expressions end to end in one state space: the states
+//  of an expression of length n are its n positions plus an accept state.
+//  Each transition type gets a bit mask over all states, so a whole set of
+//  live states advances with a few word-wide ANDs, ORs, and shifts.  Accept
+//  states carry no transitions, so nothing shifts from one expression into
+//  the next.
+//
+//  If the expressions need more than s_kcMaxNfaWords words of state, they
+//  are matched one at a time by IsNameInExpression instead.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CFileSpecMatcher::BuildNfa (void)
+{
+    static constexpr size_t s_kcBitsPerWord = 64;
+
+    size_t cStates = 0;
+    size_t iState  = 0;
+
+
+
+    for (const wstring & expression : m_vNfaExpressions)
+    {
+        cStates += expression.size() + 1;
+    }
+
+    m_cNfaWords = (cStates + s_kcBitsPerWord - 1) / s_kcBitsPerWord;
+
+    if (m_cNfaWords > s_kcMaxNfaWords)
+    {
+        m_cNfaWords = 0;
+        return;
+    }
+
+    m_vNfaMasks.assign ((static_cast<size_t> (ENfaMask::__Count) + s_kcAsciiLiterals) * m_cNfaWords, 0);
+
+    for (const wstring & expression : m_vNfaExpressions)
+    {
+        SetNfaBit (static_cast<size_t> (ENfaMask::Start), iState);
+
+        for (wchar_t ch : expression)
+        {
+            switch (ch)
+            {
+                case L'*':
+                    SetNfaBit (static_cast<size_t> (ENfaMask::StarStay),       iState);
+                    SetNfaBit (static_cast<size_t> (ENfaMask::SkipAlways),     iState);
+                    break;
+
+                case s_kchDosStar:
+                    SetNfaBit (static_cast<size_t> (ENfaMask::DosStarStay),    iState);
+                    SetNfaBit (static_cast<size_t> (ENfaMask::SkipAlways),     iState);
+                    break;
+
+                case L'?':
+                    SetNfaBit (static_cast<size_t> (ENfaMask::AnyStep),        iState);
+                    break;
+
+                case s_kchDosQm:
+                    SetNfaBit (static_cast<size_t> (ENfaMask::QmStep),         iState);
+                    SetNfaBit (static_cast<size_t> (ENfaMask::SkipAtDotOrEnd), iState);
+                    break;
+
+                case s_kchDosDot:
+                    SetNfaBit (static_cast<size_t> (ENfaMask::DotStep),        iState);
+                    SetNfaBit (static_cast<size_t> (ENfaMask::SkipAtEnd),      iState);
+                    break;
+
+                default:
+                    if (ch < s_kcAsciiLiterals)
+                    {
+                        SetNfaBit (static_cast<size_t> (ENfaMask::__Count) + ch, iState);
+                    }
+                    else
+                    {
+                        auto [it, fInserted] = m_nonAsciiLiterals.try_emplace (ch, m_vNfaMasks.size() / m_cNfaWords);
+
+                        if (fInserted)
+                        {
+                            m_vNfaMasks.resize (m_vNfaMasks.size() + m_cNfaWords, 0);
+                        }
+
+                        SetNfaBit (it->second, iState);
+                    }
+                    break;
+            }
+
+            ++iState;
+        }
+
+        SetNfaBit (static_cast<size_t> (ENfaMask::Accept), iState);
+        ++iState;
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::SetNfaBit
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CFileSpecMatcher::SetNfaBit (size_t iMask, size_t iState)
+{
+    m_vNfaMasks[iMask * m_cNfaWords + iState / 64] |= uint64_t (1) << (iState % 64);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::Matches
+//
+//  Returns true if the entry would have been returned by FindFirstFile for
+//  any of the specs.  FindFirstFile also matches against the 8.3 short name
+//  (e.g. *.htm finds "index.html" via INDEX~1.HTM), so the alternate name is
+//  tried when present.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CFileSpecMatcher::Matches (const WIN32_FIND_DATA & wfd) const
+{
+    if (m_fMatchesAll)
+    {
+        return true;
+    }
+
+    if (MatchesName (wfd.cFileName))
+    {
+        return true;
+    }
+
+    return wfd.cAlternateFileName[0] != L'\0' && MatchesName (wfd.cAlternateFileName);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::MatchesName
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CFileSpecMatcher::MatchesName (wstring_view name) const
+{
+    wchar_t szUpcased[MAX_PATH];
+    size_t  cchUpcased = CCaseFolding::Upcase (name, szUpcased, ARRAYSIZE (szUpcased));
+
+
+
+    return cchUpcased > 0 && MatchesUpcased (wstring_view (szUpcased, cchUpcased));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::MatchesUpcased
+//
+//  Tries the hash lookups first, then the suffixes, then the NFA.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CFileSpecMatcher::MatchesUpcased (wstring_view upcased) const
+{
+    size_t iLastDot = upcased.rfind (L'.');
+
+
+
+    if (!m_exactNames.empty() && m_exactNames.contains (upcased))
+    {
+        return true;
+    }
+
+    if (!m_extensions.empty() && iLastDot != wstring_view::npos && m_extensions.contains (upcased.substr (iLastDot + 1)))
+    {
+        return true;
+    }
+
+    for (const wstring & suffix : m_vSuffixes)
+    {
+        if (upcased.ends_with (suffix))
+        {
+            return true;
+        }
+    }
+
+    return !m_vNfaExpressions.empty() && RunNfa (upcased);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::RunNfa
+//
+//  Bit-parallel simulation of the merged NFA built by BuildNfa.  Same
+//  semantics as IsNameInExpression, one word of states at a time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CFileSpecMatcher::RunNfa (wstring_view upcased) const
+{
+    uint64_t         rgLive[s_kcMaxNfaWords];
+    size_t           cchName     = upcased.size();
+    size_t           iLastDot    = upcased.rfind (L'.');
+    const uint64_t * pStarStay   = GetNfaMask (ENfaMask::StarStay);
+    const uint64_t * pDosStay    = GetNfaMask (ENfaMask::DosStarStay);
+    const uint64_t * pAnyStep    = GetNfaMask (ENfaMask::AnyStep);
+    const uint64_t * pQmStep     = GetNfaMask (ENfaMask::QmStep);
+    const uint64_t * pDotStep    = GetNfaMask (ENfaMask::DotStep);
+    const uint64_t * pAccept     = GetNfaMask (ENfaMask::Accept);
+
+
+
+    if (m_cNfaWords == 0)
+    {
+        return ranges::any_of (m_vNfaExpressions, [&](const wstring & expression) {
+            return IsNameInExpression (expression, upcased);
+        });
+    }
+
+    copy_n (GetNfaMask (ENfaMask::Start), m_cNfaWords, rgLive);
+
+    for (size_t iName = 0; iName < cchName; ++iName)
+    {
+        wchar_t          ch        = upcased[iName];
+        bool             fIsDot    = (ch == L'.');
+        bool             fFinalDot = fIsDot && iName == iLastDot;
+        const uint64_t * pLiteral  = GetLiteralMask (ch);
+        const uint64_t * pDotOrQm  = fIsDot ? pDotStep : pQmStep;
+        uint64_t         carry     = 0;
+        uint64_t         alive     = 0;
+
+        CloseNfaStates (rgLive, fIsDot, false);
+
+        for (size_t iWord = 0; iWord < m_cNfaWords; ++iWord)
+        {
+            uint64_t live = rgLive[iWord];
+            uint64_t stay = live & (pStarStay[iWord] | (fFinalDot ? 0 : pDosStay[iWord]));
+            uint64_t step = live & (pAnyStep[iWord] | pDotOrQm[iWord] | (pLiteral ? pLiteral[iWord] : 0));
+
+            rgLive[iWord]  = stay | (step << 1) | carry;
+            carry          = step >> 63;
+            alive         |= rgLive[iWord];
+        }
+
+        if (alive == 0)
+        {
+            return false;
+        }
+    }
+
+    CloseNfaStates (rgLive, true, true);
+
+    for (size_t iWord = 0; iWord < m_cNfaWords; ++iWord)
+    {
+        if (rgLive[iWord] & pAccept[iWord])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::CloseNfaStates
+//
+//  Adds every state reachable without consuming a character.  Skips only
+//  move forward one state, so this repeats until a pass adds nothing (runs
+//  of '*' or '>' take one pass each).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CFileSpecMatcher::CloseNfaStates (uint64_t * rgLive, bool fAtDotOrEnd, bool fAtEnd) const
+{
+    const uint64_t * pSkipAlways = GetNfaMask (ENfaMask::SkipAlways);
+    const uint64_t * pSkipAtDot  = GetNfaMask (ENfaMask::SkipAtDotOrEnd);
+    const uint64_t * pSkipAtEnd  = GetNfaMask (ENfaMask::SkipAtEnd);
+    bool             fChanged    = true;
+
+
+
+    while (fChanged)
+    {
+        uint64_t carry = 0;
+
+        fChanged = false;
+
+        for (size_t iWord = 0; iWord < m_cNfaWords; ++iWord)
+        {
+            uint64_t skip  = pSkipAlways[iWord]                    |
+                             (fAtDotOrEnd ? pSkipAtDot[iWord] : 0) |
+                             (fAtEnd      ? pSkipAtEnd[iWord] : 0);
+            uint64_t moved = rgLive[iWord] & skip;
+            uint64_t added = (moved << 1) | carry;
+
+            carry     = moved >> 63;
+            fChanged |= (added & ~rgLive[iWord]) != 0;
+
+            rgLive[iWord] |= added;
+        }
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::GetLiteralMask
+//
+//  Returns the states that consume ch as a literal, or nullptr if none do.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const uint64_t * CFileSpecMatcher::GetLiteralMask (wchar_t ch) const
+{
+    if (ch < s_kcAsciiLiterals)
+    {
+        return m_vNfaMasks.data() + (static_cast<size_t> (ENfaMask::__Count) + ch) * m_cNfaWords;
+    }
+
+    auto it = m_nonAsciiLiterals.find (ch);
+
+    return (it != m_nonAsciiLiterals.end()) ? m_vNfaMasks.data() + it->second * m_cNfaWords : nullptr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::TranslateDosWildcards
+//
+//  Applies the rewrite FindFirstFile performs before handing a spec to the
+//  file system:
+//
+//    ?                      -> DOS_QM   (any char; none at a '.' or the end)
+//    * followed by .        -> DOS_STAR (anything up to the final '.')
+//    . followed by ? or *,
+//      or at the end        -> DOS_DOT  ('.' or the end of the name)
+//
+//  This is what makes "*." list names without an extension and
+//  "????????.???" match every 8.3 name.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+wstring CFileSpecMatcher::TranslateDosWildcards (wstring_view fileSpec)
+{
+    wstring expression (fileSpec);
+    size_t  cch        = fileSpec.size();
+
+
+
+    for (size_t i = 0; i < cch; ++i)
+    {
+        wchar_t ch     = fileSpec[i];
+        wchar_t chNext = (i + 1 < cch) ? fileSpec[i + 1] : L'\0';
+
+        if (ch == L'?')
+        {
+            expression[i] = s_kchDosQm;
+        }
+        else if (ch == L'*' && chNext == L'.')
+        {
+            expression[i] = s_kchDosStar;
+        }
+        else if (ch == L'.' && (chNext == L'?' || chNext == L'*' || chNext == L'\0'))
+        {
+            expression[i] = s_kchDosDot;
+        }
+    }
+
+    return expression;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher::IsNameInExpression
+//
+//  Equivalent of FsRtlIsNameInExpression for an already upcased expression
+//  and name.  Simulates the expression as an NFA: each expression position
+//  is a state, and the name is consumed one character at a time while the
+//  set of live states is tracked.  Runs in O(expression x name) with no
+//  backtracking.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CFileSpecMatcher::IsNameInExpression (wstring_view expression, wstring_view name)
+{
+    size_t cchExpression = expression.size();
+    size_t cchName       = name.size();
+    size_t iLastDot      = name.rfind (L'.');
+    bool   rgfLive[MAX_PATH + 1];
+    bool   rgfNext[MAX_PATH + 1];
+
+
+
+    //
+    // A component longer than MAX_PATH cannot exist on disk, and
+    // FindFirstFile rejects such a spec outright.
+    //
+
+    if (cchExpression > MAX_PATH)
+    {
+        return false;
+    }
+
+    fill_n (rgfLive, cchExpression + 1, false);
+    rgfLive[0] = true;
+
+    for (size_t iName = 0; ; ++iName)
+    {
+        bool    fAtEnd = (iName == cchName);
+        wchar_t ch     = fAtEnd ? L'\0' : name[iName];
+        bool    fAlive = false;
+
+        //
+        // Zero-length transitions.  States only ever move forward, so one
+        // ascending pass reaches the full closure.
+        //
+
+        for (size_t iExpr = 0; iExpr < cchExpression; ++iExpr)
+        {
+            wchar_t chExpr = expression[iExpr];
+
+            if (!rgfLive[iExpr])
+            {
+                continue;
+            }
+
+            if (chExpr == L'*'                                      ||
+                chExpr == s_kchDosStar                              ||
+                (chExpr == s_kchDosQm  && (fAtEnd || ch == L'.'))   ||
+                (chExpr == s_kchDosDot && fAtEnd))
+            {
+                rgfLive[iExpr + 1] = true;
+            }
+        }
+
+        if (fAtEnd)
+        {
+            break;
+        }
+
+        //
+        // Consume one name character
+        //
+
+        fill_n (rgfNext, cchExpression + 1, false);
+
+        for (size_t iExpr = 0; iExpr < cchExpression; ++iExpr)
+        {
+            wchar_t chExpr = expression[iExpr];
+            bool    fStay  = false;
+            bool    fStep  = false;
+
+            if (!rgfLive[iExpr])
+            {
+                continue;
+            }
+
+            switch (chExpr)
+            {
+                case L'*':
+                    fStay = true;
+                    break;
+
+                case s_kchDosStar:
+                    fStay = (ch != L'.' || iName != iLastDot);
+                    break;
+
+                case L'?':
+                    fStep = true;
+                    break;
+
+                case s_kchDosQm:
+                    fStep = (ch != L'.');
+                    break;
+
+                case s_kchDosDot:
+                    fStep = (ch == L'.');
+                    break;
+
+                default:
+                    fStep = (chExpr == ch);
+                    break;
+            }
+
+            rgfNext[iExpr]     |= fStay;
+            rgfNext[iExpr + 1] |= fStep;
+            fAlive             |= fStay || fStep;
+        }
+
+        if (!fAlive)
+        {
+            return false;
+        }
+
+        copy_n (rgfNext, cchExpression + 1, rgfLive);
+    }
+
+    return rgfLive[cchExpression];
+}
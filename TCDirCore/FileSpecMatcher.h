@@ -0,0 +1,96 @@
+#pragma once
+
+#include "TransparentWStringHash.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CFileSpecMatcher
+//
+//  Matches directory entries against a set of file specs the same way
+//  FindFirstFile does, so a directory can be read once with "*" and each
+//  entry classified in process.
+//
+//  FindFirstFile rewrites the spec into the file system's DOS wildcards
+//  before matching (see TranslateDosWildcards) and reports an entry when
+//  either its long name or its 8.3 short name matches.  Both quirks are
+//  reproduced here.  Names compare case-insensitively.
+//
+//  All specs are compiled together so that each name is upcased once and
+//  tested in one pass regardless of how many specs there are:
+//
+//    - specs without wildcards go into a hash set of exact names
+//    - "*.ext" specs go into a hash set of extensions
+//    - "*literal" specs become a list of literal suffixes
+//    - everything else is merged into one bit-parallel NFA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CFileSpecMatcher
+{
+public:
+    explicit CFileSpecMatcher (const vector<filesystem::path> & fileSpecs);
+
+    bool Matches    (const WIN32_FIND_DATA & wfd) const;
+    bool MatchesAll (void) const { return m_fMatchesAll; }
+
+    //
+    // File system DOS wildcards produced by TranslateDosWildcards
+    //
+
+    static constexpr wchar_t s_kchDosStar = L'<';   // * before a '.': up to the final '.'
+    static constexpr wchar_t s_kchDosQm   = L'>';   // ?: one char, or none at a '.' or the end
+    static constexpr wchar_t s_kchDosDot  = L'"';   // . before ?/* or at the end: '.' or the end
+
+    static wstring TranslateDosWildcards (wstring_view fileSpec);
+    static bool    IsNameInExpression    (wstring_view expression, wstring_view name);
+
+
+private:
+    using NameSet = unordered_set<wstring, STransparentWStringHash, std::equal_to<>>;
+
+    //
+    // Per-state bit masks of the merged NFA, each m_cNfaWords words long.
+    // The 128 ASCII literal masks follow these in m_vNfaMasks.
+    //
+
+    enum class ENfaMask
+    {
+        Start,              // First state of each expression
+        Accept,             // One past the last state of each expression
+        StarStay,           // '*' consumes any char
+        DosStarStay,        // '<' consumes any char but the final '.'
+        AnyStep,            // '?' consumes any char
+        QmStep,             // '>' consumes any char but '.'
+        DotStep,            // '"' consumes '.'
+        SkipAlways,         // '*' and '<' may match nothing
+        SkipAtDotOrEnd,     // '>' matches nothing at a '.' or the end
+        SkipAtEnd,          // '"' matches nothing at the end
+        __Count
+    };
+
+    static constexpr size_t s_kcAsciiLiterals = 128;
+    static constexpr size_t s_kcMaxNfaWords   = 8;
+
+    void             CompileExpression (const wstring & expression);
+    void             BuildNfa          (void);
+    void             SetNfaBit         (size_t iMask, size_t iState);
+    bool             MatchesName       (wstring_view name) const;
+    bool             MatchesUpcased    (wstring_view upcased) const;
+    bool             RunNfa            (wstring_view upcased) const;
+    void             CloseNfaStates    (uint64_t * rgLive, bool fAtDotOrEnd, bool fAtEnd) const;
+    const uint64_t * GetNfaMask        (ENfaMask mask) const { return m_vNfaMasks.data() + static_cast<size_t> (mask) * m_cNfaWords; }
+    const uint64_t * GetLiteralMask    (wchar_t ch) const;
+
+    NameSet                         m_exactNames;           // Specs without wildcards
+    NameSet                         m_extensions;           // "*.ext" specs, as "EXT"
+    vector<wstring>                 m_vSuffixes;            // "*literal" specs, as "LITERAL"
+    vector<wstring>                 m_vNfaExpressions;      // Everything else
+    vector<uint64_t>                m_vNfaMasks;
+    unordered_map<wchar_t, size_t>  m_nonAsciiLiterals;     // Literal char -> mask index
+    size_t                          m_cNfaWords   = 0;
+    bool                            m_fMatchesAll = false;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  SChangeSet
+//
+//  The directories whose entries changed since the last time they were
+//  read.  A backend that lost track of what changed (its buffer overflowed)
+//  sets m_fRescan instead, and the whole tree is read again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct SChangeSet
+{
+    set<filesystem::path> m_changedDirs;
+    bool                  m_fRescan = false;
+
+
+
+    void Merge (SChangeSet && other)
+    {
+        m_changedDirs.merge (other.m_changedDirs);
+        m_fRescan = m_fRescan || other.m_fRescan;
+    }
+
+    bool IsEmpty (void) const
+    {
+        return m_changedDirs.empty() && !m_fRescan;
+    }
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  IChangeNotifier
+//
+//  --Watch: reports which directories of a tree have changed.  Watch is
+//  called once, before the tree is first read, so nothing that changes
+//  while it is being read is missed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class IChangeNotifier
+{
+public:
+    virtual ~IChangeNotifier (void) = default;
+
+    //
+    // Starts watching root, and every directory below it when fRecursive
+    // is set.  Directory links are not watched through.
+    //
+
+    virtual HRESULT Watch (const filesystem::path & root, bool fRecursive) = 0;
+
+    //
+    // Waits up to msTimeout (or INFINITE) for something to change and adds
+    // the changed directories to changes.  Returns S_FALSE if nothing
+    // changed in that time.
+    //
+
+    virtual HRESULT WaitForChanges (DWORD msTimeout, SChangeSet & changes) = 0;
+};
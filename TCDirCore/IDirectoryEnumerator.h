@@ -0,0 +1,104 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  SDirectoryId
+//
+//  Identifies a directory independently of the path used to reach it: the
+//  volume serial number plus the 128-bit file ID.  Two paths with the same
+//  ID name the same directory, e.g. a junction and its target.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct SDirectoryId
+{
+    ULONGLONG   m_ullVolumeSerial = 0;
+    FILE_ID_128 m_fileId          = {};
+
+    bool operator== (const SDirectoryId & other) const
+    {
+        return m_ullVolumeSerial == other.m_ullVolumeSerial &&
+               memcmp (&m_fileId, &other.m_fileId, sizeof (m_fileId)) == 0;
+    }
+};
+
+struct SDirectoryIdHash
+{
+    size_t operator() (const SDirectoryId & id) const
+    {
+        ULONGLONG rgull[2];
+
+
+
+        memcpy (rgull, &id.m_fileId, sizeof (rgull));
+
+        return hash<ULONGLONG>{} (id.m_ullVolumeSerial ^ rgull[0] ^ (rgull[1] * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  IDirectoryEnumerator
+//
+//  Interface for reading the entries of a directory.  Entries are handed
+//  to the caller in batches so the per-entry cost of crossing the
+//  interface (and of taking any lock the caller needs to store them) is
+//  paid once per batch rather than once per file.
+//
+//  Implementations must be safe to call concurrently from all of the
+//  enumeration worker threads, since one instance is shared by them all.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class IDirectoryEnumerator
+{
+public:
+    //
+    // Receives each batch of entries.  Return false to stop enumerating the
+    // rest of the directory.
+    //
+
+    using BatchCallback = function<bool (span<const WIN32_FIND_DATA> batch)>;
+
+    //
+    // Enumerates the entries of dirPath that match fileSpec, never including
+    // "." and "..".  Returns the Win32 error from opening the directory as
+    // an HRESULT (ERROR_FILE_NOT_FOUND when nothing matches, as with
+    // FindFirstFile), or the error that ended the enumeration early.
+    // cAlternateFileName (the 8.3 name) is only filled in when
+    // fNeedShortNames is set, since fetching it costs extra work on some
+    // file systems.
+    //
+
+    virtual ~IDirectoryEnumerator (void) = default;
+    virtual HRESULT Enumerate     (const filesystem::path & dirPath,
+                                   const filesystem::path & fileSpec,
+                                   bool                     fNeedShortNames,
+                                   const BatchCallback    & onBatch) const = 0;
+
+    //
+    // Identifies the directory dirPath resolves to.  Links along the path,
+    // including dirPath itself, are followed, so a link yields its
+    // target's ID.
+    //
+
+    virtual HRESULT GetDirectoryId (const filesystem::path & dirPath,
+                                    SDirectoryId           & id) const = 0;
+
+    //
+    // Returns dirPath's last-write time, which changes whenever an entry is
+    // added to, removed from, or renamed within the directory.  Used by
+    // --Cache to tell whether a cached listing is still current.
+    //
+
+    virtual HRESULT GetDirectoryStamp (const filesystem::path & dirPath,
+                                       ULONGLONG              & ullStamp) const = 0;
+};
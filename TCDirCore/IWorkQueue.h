@@ -0,0 +1,39 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  IWorkQueue
+//
+//  Interface for the producer/consumer queue that feeds the directory
+//  enumeration workers.  Pop receives the calling worker's index so that
+//  schedulers with per-worker state (work stealing) can find their own
+//  queue; schedulers with a single shared queue ignore it.
+//
+//  PushUrgent is for items somebody is already waiting on.  Schedulers
+//  with an urgent lane pop those before anything else, lowest first;
+//  the default treats them like any other item.  TryPopUrgent takes an
+//  item from the urgent lane only, without blocking, for a worker that is
+//  not allowed speculative work (see the --ReadAhead budget).
+//
+//  GetQueuedCount is a snapshot for monitoring (the --Threads=Auto
+//  governor); it may be stale by the time the caller looks at it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+class IWorkQueue
+{
+public:
+    virtual ~IWorkQueue (void) = default;
+    virtual void   Push           (T item)                   = 0;
+    virtual void   PushUrgent     (T item)                   { Push (move (item)); }
+    virtual bool   Pop            (size_t iWorker, T & item) = 0;
+    virtual bool   TryPopUrgent   (T &)                      { return false; }
+    virtual bool   HasUrgent      (void) const               { return false; }
+    virtual void   SetDone()                                 = 0;
+    virtual size_t GetQueuedCount (void) const               = 0;
+};
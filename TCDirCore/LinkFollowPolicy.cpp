@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "LinkFollowPolicy.h"
+
+#include "Flag.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLinkFollowPolicy::CLinkFollowPolicy
+//
+//  Without --Follow, tree mode keeps its existing behavior of never
+//  expanding links, and /S follows them with cycle detection.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CLinkFollowPolicy::CLinkFollowPolicy (CCommandLine::EFollowLinks eFollow, bool fTree) :
+    m_eFollow (eFollow)
+{
+    if (m_eFollow == CCommandLine::EFollowLinks::Default)
+    {
+        m_eFollow = fTree ? CCommandLine::EFollowLinks::Never : CCommandLine::EFollowLinks::Always;
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLinkFollowPolicy::IsDirectoryLink
+//
+//  A directory whose reparse tag is a name surrogate (junctions, symlinks,
+//  and other tags that redirect to another namespace location).  Cloud
+//  placeholders and other non-surrogate reparse points are real
+//  directories and are always entered.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CLinkFollowPolicy::IsDirectoryLink (const WIN32_FIND_DATA & wfd)
+{
+    return CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)     &&
+           CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT) &&
+           IsReparseTagNameSurrogate (wfd.dwReserved0);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLinkFollowPolicy::Decide
+//
+//  cLinksAbove is the number of links entered on the path down to this
+//  one.  targetId is the ID of the link's target, required only when
+//  NeedsDirectoryIds; a link whose target cannot be identified (e.g. a
+//  dangling link) is followed and fails like any unreadable directory.
+//  fnIsOnPath reports whether an ID is one of the directories the link
+//  sits under.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CLinkFollowPolicy::EDecision CLinkFollowPolicy::Decide (UINT cLinksAbove, const optional<SDirectoryId> & targetId, const IsOnPathFn & fnIsOnPath)
+{
+    switch (m_eFollow)
+    {
+        case CCommandLine::EFollowLinks::Never:
+            return EDecision::Skip;
+
+        case CCommandLine::EFollowLinks::Once:
+            return (cLinksAbove == 0) ? EDecision::Follow : EDecision::Prune;
+
+        default:
+            break;
+    }
+
+    if (!targetId)
+    {
+        return EDecision::Follow;
+    }
+
+    if (fnIsOnPath (*targetId) || !MarkTargetFollowed (*targetId))
+    {
+        return EDecision::Prune;
+    }
+
+    return EDecision::Follow;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLinkFollowPolicy::MarkTargetFollowed
+//
+//  Records a link target as entered.  Returns false if some link to it
+//  (on this or any other worker) already was.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CLinkFollowPolicy::MarkTargetFollowed (const SDirectoryId & id)
+{
+    SShard & shard = m_rgShards[SDirectoryIdHash{} (id) % s_kcShards];
+
+
+
+    lock_guard<mutex> lock (shard.m_mutex);
+
+    return shard.m_setTargets.insert (id).second;
+}
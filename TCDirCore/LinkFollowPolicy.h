@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CommandLine.h"
+#include "IDirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLinkFollowPolicy
+//
+//  Decides whether a recursive listing descends into a directory link
+//  (junction, directory symlink, mount point) according to --Follow:
+//
+//      Never   The link is listed but not entered.
+//      Once    A link is entered only if no link was entered above it.
+//      Always  Every link is entered unless doing so would revisit a
+//              directory: its target is one of the directories on the
+//              path down to the link (a cycle), or another link to the
+//              same target was already entered.
+//
+//  Links refused by Once or by cycle detection are pruned, and the lister
+//  counts them for the summary.  Links refused by Never are not counted.
+//
+//  The set of entered link targets is shared by all enumeration workers,
+//  so it is sharded by ID hash to keep them from contending on one lock.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CLinkFollowPolicy
+{
+public:
+    enum class EDecision
+    {
+        Follow,
+        Skip,           // Not followed by policy (--Follow=Never)
+        Prune           // Not followed to bound the walk; counted
+    };
+
+    using IsOnPathFn = function<bool (const SDirectoryId & id)>;
+
+    CLinkFollowPolicy (CCommandLine::EFollowLinks eFollow, bool fTree);
+
+    static bool IsDirectoryLink   (const WIN32_FIND_DATA & wfd);
+
+    bool        NeedsDirectoryIds (void) const { return m_eFollow == CCommandLine::EFollowLinks::Always; }
+    EDecision   Decide            (UINT cLinksAbove, const optional<SDirectoryId> & targetId, const IsOnPathFn & fnIsOnPath);
+
+
+private:
+    struct SShard
+    {
+        mutex                                          m_mutex;
+        unordered_set<SDirectoryId, SDirectoryIdHash> m_setTargets;
+    };
+
+    static constexpr size_t s_kcShards = 16;
+
+    bool MarkTargetFollowed (const SDirectoryId & id);
+
+    CCommandLine::EFollowLinks m_eFollow;
+    array<SShard, s_kcShards>  m_rgShards;
+};
@@ -0,0 +1,695 @@
+#include "pch.h"
+#include "ListingCache.h"
+
+#include "CaseFolding.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::CListingCache
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CListingCache::CListingCache (filesystem::path cacheFile, ULONGLONG cbCapacity) :
+    m_cacheFile  (move (cacheFile)),
+    m_cbCapacity (cbCapacity)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Open
+//
+//  Opens (or creates) the cache file, maps it, and indexes its records.  A
+//  file that is empty, too short, or not a cache of this version opens as
+//  an empty cache and is replaced by Save.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CListingCache::Open (void)
+{
+    HRESULT             hr      = S_OK;
+    LARGE_INTEGER       liSize  = {};
+    const SFileHeader * pHeader = nullptr;
+
+
+
+    // Fails harmlessly when the directory already exists
+    CreateDirectoryW (m_cacheFile.parent_path().c_str(), nullptr);
+
+    m_hFile = CreateFileW (m_cacheFile.c_str(),
+                           GENERIC_READ | GENERIC_WRITE,
+                           0,
+                           nullptr,
+                           OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+    CWR (m_hFile != INVALID_HANDLE_VALUE);
+
+    CWR (GetFileSizeEx (m_hFile, &liSize));
+
+    m_cbUsed = sizeof (SFileHeader);
+
+    BAIL_OUT_IF (static_cast<ULONGLONG> (liSize.QuadPart) < sizeof (SFileHeader), S_OK);
+
+    m_hMapping = CreateFileMappingW (m_hFile, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    CWR (m_hMapping != nullptr);
+
+    m_pView = MapViewOfFile (m_hMapping, FILE_MAP_WRITE, 0, 0, 0);
+    CWR (m_pView != nullptr);
+
+    pHeader = static_cast<const SFileHeader *> (static_cast<LPVOID> (m_pView));
+
+    BAIL_OUT_IF (pHeader->m_dwMagic   != s_kdwMagic              ||
+                 pHeader->m_dwVersion != s_kdwVersion            ||
+                 pHeader->m_cbUsed    <  sizeof (SFileHeader)    ||
+                 pHeader->m_cbUsed    >  static_cast<ULONGLONG> (liSize.QuadPart), S_OK);
+
+    m_cbUsed     = pHeader->m_cbUsed;
+    m_fValidFile = true;
+
+    IndexRecords();
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Lookup
+//
+//  Copies dirPath's cached entries into vEntries if its record is current
+//  (see the class comment), and marks the record as just used.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CListingCache::Lookup (const filesystem::path & dirPath, ULONGLONG ullStamp, vector<WIN32_FIND_DATA> & vEntries)
+{
+    wstring           key    = MakeKey (dirPath);
+    ULONGLONG         ullNow = Now();
+    lock_guard<mutex> lock     (m_mutex);
+    auto              it     = m_mapIndex.find (key);
+
+
+
+    if (it == m_mapIndex.end())
+    {
+        return false;
+    }
+
+    SRecordHeader & header = *reinterpret_cast<SRecordHeader *> (it->second.m_pRecord);
+
+    // A clock set back makes the age wrap around, which also counts as too old
+    if (header.m_ullStamp != ullStamp || ullNow - header.m_ullRead > s_kullMaxAge)
+    {
+        return false;
+    }
+
+    if (!DecodeRecord (it->second.m_pRecord, vEntries))
+    {
+        return false;
+    }
+
+    header.m_ullLastUsed = ullNow;
+    m_fDirty             = true;
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Store
+//
+//  Records dirPath's entries, as read just now, in place of any earlier
+//  record.  The record is written to the file by Save.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CListingCache::Store (const filesystem::path & dirPath, ULONGLONG ullStamp, span<const WIN32_FIND_DATA> entries)
+{
+    wstring      key;
+    vector<BYTE> record;
+
+
+
+    // The directory may change again without its stamp moving
+    if (ullStamp + s_kullSettleTime > Now())
+    {
+        return;
+    }
+
+    key    = MakeKey (dirPath);
+    record = BuildRecord (key, ullStamp, entries);
+
+    // One huge directory should not push everything else out
+    if (record.size() > m_cbCapacity / 4)
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock (m_mutex);
+        SSlot &           slot = m_mapIndex[key];
+
+
+
+        if (slot.m_pRecord != nullptr && !slot.m_fPending)
+        {
+            m_cbLive -= reinterpret_cast<const SRecordHeader *> (slot.m_pRecord)->m_cbRecord;
+        }
+
+        // Moving the inner vector keeps its buffer, so earlier slots stay valid
+        m_vPending.push_back (move (record));
+
+        slot.m_pRecord  = m_vPending.back().data();
+        slot.m_fPending = true;
+        m_fDirty        = true;
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Save
+//
+//  Appends the records stored this run, or rewrites the file when it is
+//  over capacity, mostly garbage, or was not a valid cache.  Closes the
+//  file either way.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CListingCache::Save (void)
+{
+    HRESULT           hr        = S_OK;
+    lock_guard<mutex> lock        (m_mutex);
+    ULONGLONG         cbRecords = m_cbUsed - sizeof (SFileHeader);
+    ULONGLONG         cbPending = 0;
+
+
+
+    BAIL_OUT_IF (!m_fDirty, S_OK);
+
+    for (const auto & [key, slot] : m_mapIndex)
+    {
+        if (slot.m_fPending)
+        {
+            cbPending += reinterpret_cast<const SRecordHeader *> (slot.m_pRecord)->m_cbRecord;
+        }
+    }
+
+    if (m_cbLive + cbPending > m_cbCapacity)
+    {
+        hr = Rewrite (m_cbCapacity / 4 * 3);
+        CHR (hr);
+    }
+    else if (!m_fValidFile || cbRecords - m_cbLive > cbRecords / 2)
+    {
+        hr = Rewrite (m_cbCapacity);
+        CHR (hr);
+    }
+    else
+    {
+        hr = AppendPending();
+        CHR (hr);
+    }
+
+
+
+Error:
+    Close();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::GetDefaultPath
+//
+//  %LOCALAPPDATA%\TCDir\ListingCache.bin, or an empty path if the folder
+//  cannot be resolved.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+filesystem::path CListingCache::GetDefaultPath (void)
+{
+    PWSTR            pszLocalAppData = nullptr;
+    filesystem::path cacheFile;
+
+
+
+    if (SUCCEEDED (SHGetKnownFolderPath (FOLDERID_LocalAppData, 0, nullptr, &pszLocalAppData)))
+    {
+        cacheFile = filesystem::path (pszLocalAppData) / L"TCDir" / L"ListingCache.bin";
+    }
+
+    CoTaskMemFree (pszLocalAppData);
+
+    return cacheFile;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::RecordSize
+//
+//  Header and path, then the entries at the next 8-byte boundary, then the
+//  names, padded so the next record is aligned too.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+ULONGLONG CListingCache::RecordSize (ULONGLONG cchPath, ULONGLONG cEntries, ULONGLONG cchNames)
+{
+    auto align8 = [] (ULONGLONG cb) { return (cb + 7) & ~7ull; };
+
+
+
+    return align8 (sizeof (SRecordHeader) + cchPath * sizeof (wchar_t)) +
+           cEntries * sizeof (SCachedEntry)                              +
+           align8 (cchNames * sizeof (wchar_t));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::IsValid
+//
+//  Checks that a record's sizes agree with each other and that it fits in
+//  the cbAvailable bytes left in the file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CListingCache::IsValid (const SRecordHeader & header, ULONGLONG cbAvailable)
+{
+    return header.m_cbRecord >= sizeof (SRecordHeader)                                     &&
+           header.m_cbRecord %  8 == 0                                                      &&
+           header.m_cbRecord <= cbAvailable                                                 &&
+           header.m_cbRecord == RecordSize (header.m_cchPath, header.m_cEntries, header.m_cchNames);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::MakeKey
+//
+//  Paths compare case-insensitively, as the file system does.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+wstring CListingCache::MakeKey (const filesystem::path & dirPath)
+{
+    wstring key = dirPath.wstring();
+
+
+
+    for (wchar_t & ch : key)
+    {
+        ch = CCaseFolding::UpcaseChar (ch);
+    }
+
+    return key;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Now
+//
+////////////////////////////////////////////////////////////////////////////////
+
+ULONGLONG CListingCache::Now (void)
+{
+    FILETIME ft;
+
+
+
+    GetSystemTimeAsFileTime (&ft);
+
+    return (static_cast<ULONGLONG> (ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::BuildRecord
+//
+////////////////////////////////////////////////////////////////////////////////
+
+vector<BYTE> CListingCache::BuildRecord (wstring_view key, ULONGLONG ullStamp, span<const WIN32_FIND_DATA> entries)
+{
+    auto         packTime = [] (const FILETIME & ft) { return (static_cast<ULONGLONG> (ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+    size_t       cchNames = 0;
+    vector<BYTE> record;
+
+
+
+    for (const WIN32_FIND_DATA & wfd : entries)
+    {
+        cchNames += wcsnlen (wfd.cFileName,          MAX_PATH);
+        cchNames += wcsnlen (wfd.cAlternateFileName, ARRAYSIZE (wfd.cAlternateFileName));
+    }
+
+    record.resize (static_cast<size_t> (RecordSize (key.size(), entries.size(), cchNames)));
+
+    SRecordHeader * pHeader   = reinterpret_cast<SRecordHeader *> (record.data());
+    BYTE          * pbEntries = record.data() + RecordSize (key.size(), 0, 0);
+    SCachedEntry  * pEntry    = reinterpret_cast<SCachedEntry *> (pbEntries);
+    wchar_t       * pchName   = reinterpret_cast<wchar_t *> (pEntry + entries.size());
+
+    pHeader->m_cbRecord    = static_cast<UINT> (record.size());
+    pHeader->m_cEntries    = static_cast<UINT> (entries.size());
+    pHeader->m_ullStamp    = ullStamp;
+    pHeader->m_ullRead     = Now();
+    pHeader->m_ullLastUsed = pHeader->m_ullRead;
+    pHeader->m_cchPath     = static_cast<UINT> (key.size());
+    pHeader->m_cchNames    = static_cast<UINT> (cchNames);
+
+    memcpy (pHeader + 1, key.data(), key.size() * sizeof (wchar_t));
+
+    for (const WIN32_FIND_DATA & wfd : entries)
+    {
+        size_t cchName      = wcsnlen (wfd.cFileName,          MAX_PATH);
+        size_t cchShortName = wcsnlen (wfd.cAlternateFileName, ARRAYSIZE (wfd.cAlternateFileName));
+
+        pEntry->m_cbSize       = (static_cast<ULONGLONG> (wfd.nFileSizeHigh) << 32) | wfd.nFileSizeLow;
+        pEntry->m_ftCreation   = packTime (wfd.ftCreationTime);
+        pEntry->m_ftLastAccess = packTime (wfd.ftLastAccessTime);
+        pEntry->m_ftLastWrite  = packTime (wfd.ftLastWriteTime);
+        pEntry->m_dwAttributes = wfd.dwFileAttributes;
+        pEntry->m_dwReparseTag = wfd.dwReserved0;
+        pEntry->m_cchName      = static_cast<UINT> (cchName);
+        pEntry->m_cchShortName = static_cast<UINT> (cchShortName);
+
+        memcpy (pchName,           wfd.cFileName,          cchName      * sizeof (wchar_t));
+        memcpy (pchName + cchName, wfd.cAlternateFileName, cchShortName * sizeof (wchar_t));
+
+        pchName += cchName + cchShortName;
+        ++pEntry;
+    }
+
+    return record;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::DecodeRecord
+//
+//  Rebuilds the WIN32_FIND_DATA entries of a record, 8.3 names included.
+//  Fails if the names do not add up, which IsValid cannot check.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CListingCache::DecodeRecord (const BYTE * pRecord, vector<WIN32_FIND_DATA> & vEntries)
+{
+    auto                  unpackTime = [] (ULONGLONG ull) { return FILETIME { static_cast<DWORD> (ull), static_cast<DWORD> (ull >> 32) }; };
+    const SRecordHeader & header     = *reinterpret_cast<const SRecordHeader *> (pRecord);
+    const SCachedEntry  * pEntry     = reinterpret_cast<const SCachedEntry *> (pRecord + RecordSize (header.m_cchPath, 0, 0));
+    const wchar_t       * pchName    = reinterpret_cast<const wchar_t *> (pEntry + header.m_cEntries);
+    size_t                cchLeft    = header.m_cchNames;
+
+
+
+    vEntries.assign (header.m_cEntries, WIN32_FIND_DATA {});
+
+    for (WIN32_FIND_DATA & wfd : vEntries)
+    {
+        size_t cchEntry = static_cast<size_t> (pEntry->m_cchName) + pEntry->m_cchShortName;
+
+        if (pEntry->m_cchName      == 0                                    ||
+            pEntry->m_cchName      >= MAX_PATH                             ||
+            pEntry->m_cchShortName >= ARRAYSIZE (wfd.cAlternateFileName)   ||
+            cchEntry               >  cchLeft)
+        {
+            return false;
+        }
+
+        wfd.dwFileAttributes = pEntry->m_dwAttributes;
+        wfd.ftCreationTime   = unpackTime (pEntry->m_ftCreation);
+        wfd.ftLastAccessTime = unpackTime (pEntry->m_ftLastAccess);
+        wfd.ftLastWriteTime  = unpackTime (pEntry->m_ftLastWrite);
+        wfd.nFileSizeHigh    = static_cast<DWORD> (pEntry->m_cbSize >> 32);
+        wfd.nFileSizeLow     = static_cast<DWORD> (pEntry->m_cbSize);
+        wfd.dwReserved0      = pEntry->m_dwReparseTag;
+
+        memcpy (wfd.cFileName,          pchName,                     pEntry->m_cchName      * sizeof (wchar_t));
+        memcpy (wfd.cAlternateFileName, pchName + pEntry->m_cchName, pEntry->m_cchShortName * sizeof (wchar_t));
+
+        pchName += cchEntry;
+        cchLeft -= cchEntry;
+        ++pEntry;
+    }
+
+    return cchLeft == 0;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::IndexRecords
+//
+//  Walks the mapped records in file order, so a directory's later record
+//  replaces its earlier one in the index.  A damaged record ends the walk;
+//  the file is treated as ending there, and Save appends over it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CListingCache::IndexRecords (void)
+{
+    BYTE      * pbView = static_cast<BYTE *> (static_cast<LPVOID> (m_pView));
+    ULONGLONG   ib     = sizeof (SFileHeader);
+
+
+
+    while (ib < m_cbUsed)
+    {
+        SRecordHeader * pHeader = reinterpret_cast<SRecordHeader *> (pbView + ib);
+
+
+
+        if (m_cbUsed - ib < sizeof (SRecordHeader) || !IsValid (*pHeader, m_cbUsed - ib))
+        {
+            m_cbUsed = ib;
+            break;
+        }
+
+        SSlot & slot = m_mapIndex[wstring (reinterpret_cast<const wchar_t *> (pHeader + 1), pHeader->m_cchPath)];
+
+        if (slot.m_pRecord != nullptr)
+        {
+            m_cbLive -= reinterpret_cast<const SRecordHeader *> (slot.m_pRecord)->m_cbRecord;
+        }
+
+        slot.m_pRecord  = pbView + ib;
+        m_cbLive       += pHeader->m_cbRecord;
+        ib             += pHeader->m_cbRecord;
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::AppendPending
+//
+//  Writes this run's records after the existing ones, then the header
+//  that takes them in.  The view is released first, which also flushes the
+//  last-used times Lookup wrote through it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CListingCache::AppendPending (void)
+{
+    HRESULT       hr        = S_OK;
+    SFileHeader   header    = { s_kdwMagic, s_kdwVersion, 0 };
+    LARGE_INTEGER liPos     = {};
+    DWORD         cbWritten = 0;
+
+
+
+    m_pView    = CAutoMappedView();
+    m_hMapping = AutoHandle();
+
+    liPos.QuadPart = static_cast<LONGLONG> (m_cbUsed);
+    CWR (SetFilePointerEx (m_hFile, liPos, nullptr, FILE_BEGIN));
+
+    for (const auto & [key, slot] : m_mapIndex)
+    {
+        if (slot.m_fPending)
+        {
+            UINT cbRecord = reinterpret_cast<const SRecordHeader *> (slot.m_pRecord)->m_cbRecord;
+
+            CWR (WriteFile (m_hFile, slot.m_pRecord, cbRecord, &cbWritten, nullptr));
+            CBRAEx (cbWritten == cbRecord, HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+            m_cbUsed += cbRecord;
+        }
+    }
+
+    // Drops anything an interrupted append left past the old end
+    CWR (SetEndOfFile (m_hFile));
+
+    header.m_cbUsed = m_cbUsed;
+    liPos.QuadPart  = 0;
+    CWR (SetFilePointerEx (m_hFile, liPos, nullptr, FILE_BEGIN));
+    CWR (WriteFile (m_hFile, &header, sizeof (header), &cbWritten, nullptr));
+    CBRAEx (cbWritten == sizeof (header), HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Rewrite
+//
+//  Writes the indexed records, most recently used first, to a new file
+//  until the next one would take it past cbTarget, then replaces the
+//  cache with it.  The records not written are the ones evicted.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CListingCache::Rewrite (ULONGLONG cbTarget)
+{
+    HRESULT                       hr        = S_OK;
+    filesystem::path              tempFile  = m_cacheFile;
+    SFileHeader                   header    = { s_kdwMagic, s_kdwVersion, sizeof (SFileHeader) };
+    LARGE_INTEGER                 liPos     = {};
+    DWORD                         cbWritten = 0;
+    vector<const SRecordHeader *> vRecords;
+    AutoHandle                    hTemp;
+
+
+
+    tempFile += L".tmp";
+
+    vRecords.reserve (m_mapIndex.size());
+
+    for (const auto & [key, slot] : m_mapIndex)
+    {
+        vRecords.push_back (reinterpret_cast<const SRecordHeader *> (slot.m_pRecord));
+    }
+
+    sort (vRecords.begin(), vRecords.end(), [] (const SRecordHeader * pLhs, const SRecordHeader * pRhs)
+    {
+        return pLhs->m_ullLastUsed > pRhs->m_ullLastUsed;
+    });
+
+    hTemp = CreateFileW (tempFile.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    CWR (hTemp != INVALID_HANDLE_VALUE);
+
+    // Reserves the header's place; it is written again once the size is known
+    CWR (WriteFile (hTemp, &header, sizeof (header), &cbWritten, nullptr));
+    CBRAEx (cbWritten == sizeof (header), HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+
+    for (const SRecordHeader * pRecord : vRecords)
+    {
+        if (header.m_cbUsed + pRecord->m_cbRecord > cbTarget)
+        {
+            break;
+        }
+
+        CWR (WriteFile (hTemp, pRecord, pRecord->m_cbRecord, &cbWritten, nullptr));
+        CBRAEx (cbWritten == pRecord->m_cbRecord, HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+        header.m_cbUsed += pRecord->m_cbRecord;
+    }
+
+    CWR (SetFilePointerEx (hTemp, liPos, nullptr, FILE_BEGIN));
+    CWR (WriteFile (hTemp, &header, sizeof (header), &cbWritten, nullptr));
+    CBRAEx (cbWritten == sizeof (header), HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+
+    hTemp = AutoHandle();
+
+    // The records came from the view and m_vPending, so they go only now
+    Close();
+
+    CWR (MoveFileExW (tempFile.c_str(), m_cacheFile.c_str(), MOVEFILE_REPLACE_EXISTING));
+
+
+
+Error:
+    if (FAILED (hr))
+    {
+        hTemp = AutoHandle();
+        DeleteFileW (tempFile.c_str());
+    }
+
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache::Close
+//
+//  Releases the view, mapping, and file, and forgets the index.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CListingCache::Close (void)
+{
+    m_pView    = CAutoMappedView();
+    m_hMapping = AutoHandle();
+    m_hFile    = AutoHandle();
+
+    m_mapIndex.clear();
+    m_vPending.clear();
+
+    m_cbUsed     = 0;
+    m_cbLive     = 0;
+    m_fValidFile = false;
+    m_fDirty     = false;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "AutoHandle.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CListingCache
+//
+//  The on-disk index behind --Cache: the entries of each directory read
+//  with "*", keyed by the directory's upcased path and stamped with its
+//  last-write time.  A directory whose stamp still matches is served from
+//  the index instead of being read again.
+//
+//  The file is a header followed by variable-length records, each holding
+//  the path, one fixed-size SCachedEntry per entry, and the entry names,
+//  each followed by its 8.3 name if it has one.  Keeping the 8.3 names
+//  lets a record serve masked listings, which match them too.
+//  It is memory-mapped when opened and indexed in one pass; records read
+//  this run are appended when it is saved, and the header's m_cbUsed is
+//  written last, so an interrupted append is simply ignored next time.  A
+//  directory read again leaves its old record behind as garbage.
+//
+//  A record is not used when:
+//    - the directory's stamp differs (an entry was added, removed, or
+//      renamed)
+//    - it was read more than s_kullMaxAge ago, since changing a file in
+//      place (its size or write time) does not touch the directory's stamp
+//    - the directory changed within s_kullSettleTime of being read, since
+//      a later change in the same clock tick would leave the stamp as it
+//      was (such a listing is never stored)
+//
+//  When the live records and this run's new ones exceed the capacity, or
+//  garbage is more than half the file, Save rewrites the file with the
+//  most recently used records that fit in three quarters of the capacity.
+//
+//  The file is opened exclusively; a second tcdir running at the same
+//  time fails Open and lists without the cache.  Lookup and Store may be
+//  called from any thread.  Save ends the cache's use: it writes the file
+//  and closes it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CListingCache
+{
+public:
+    explicit CListingCache (filesystem::path cacheFile, ULONGLONG cbCapacity = s_kcbDefaultCapacity);
+
+    HRESULT Open   (void);
+    bool    Lookup (const filesystem::path & dirPath, ULONGLONG ullStamp, vector<WIN32_FIND_DATA> & vEntries);
+    void    Store  (const filesystem::path & dirPath, ULONGLONG ullStamp, span<const WIN32_FIND_DATA> entries);
+    HRESULT Save   (void);
+
+    static filesystem::path GetDefaultPath (void);
+
+    static constexpr ULONGLONG s_kcbDefaultCapacity = 256ull << 20;
+    static constexpr ULONGLONG s_kullMaxAge         = 24ull * 60 * 60 * 10000000;   // One day, in FILETIME units
+    static constexpr ULONGLONG s_kullSettleTime     = 2ull * 10000000;              // FAT's 2-second timestamp granularity
+
+
+
+private:
+    struct SFileHeader
+    {
+        DWORD     m_dwMagic;
+        DWORD     m_dwVersion;
+        ULONGLONG m_cbUsed;             // Records end here; anything after it is an interrupted append
+    };
+
+    struct SRecordHeader
+    {
+        UINT      m_cbRecord;           // The whole record, padded to a multiple of 8 bytes
+        UINT      m_cEntries;
+        ULONGLONG m_ullStamp;           // The directory's last-write time when it was read
+        ULONGLONG m_ullRead;            // When it was read
+        ULONGLONG m_ullLastUsed;        // When it was last read or served; the LRU key
+        UINT      m_cchPath;            // Upcased path, right after the header
+        UINT      m_cchNames;           // Entry names, concatenated after the entries
+    };
+
+    struct SCachedEntry
+    {
+        ULONGLONG m_cbSize;
+        ULONGLONG m_ftCreation;
+        ULONGLONG m_ftLastAccess;
+        ULONGLONG m_ftLastWrite;
+        DWORD     m_dwAttributes;
+        DWORD     m_dwReparseTag;
+        UINT      m_cchName;
+        UINT      m_cchShortName;       // 0 if the entry has no 8.3 name
+    };
+
+    struct SSlot
+    {
+        BYTE * m_pRecord  = nullptr;    // In the mapped view, or in m_vPending
+        bool   m_fPending = false;      // Read this run and not yet saved
+    };
+
+    static constexpr DWORD s_kdwMagic   = 0x4354434C;     // "LCTC"
+    static constexpr DWORD s_kdwVersion = 2;          // 2: 8.3 names
+
+    static ULONGLONG    RecordSize   (ULONGLONG cchPath, ULONGLONG cEntries, ULONGLONG cchNames);
+    static bool         IsValid      (const SRecordHeader & header, ULONGLONG cbAvailable);
+    static wstring      MakeKey      (const filesystem::path & dirPath);
+    static ULONGLONG    Now          (void);
+    static vector<BYTE> BuildRecord  (wstring_view key, ULONGLONG ullStamp, span<const WIN32_FIND_DATA> entries);
+    static bool         DecodeRecord (const BYTE * pRecord, vector<WIN32_FIND_DATA> & vEntries);
+
+    void    IndexRecords  (void);
+    HRESULT AppendPending (void);
+    HRESULT Rewrite       (ULONGLONG cbTarget);
+    void    Close         (void);
+
+    filesystem::path               m_cacheFile;
+    ULONGLONG                      m_cbCapacity;
+    AutoHandle                     m_hFile;
+    AutoHandle                     m_hMapping;
+    CAutoMappedView                m_pView;
+    ULONGLONG                      m_cbUsed      = 0;       // Header and records in the file
+    ULONGLONG                      m_cbLive      = 0;       // Of which in records still indexed
+    bool                           m_fValidFile  = false;   // The file held a cache (possibly empty) when opened
+    bool                           m_fDirty      = false;   // Records stored or served since Open
+    unordered_map<wstring, SSlot>  m_mapIndex;              // Upcased path -> newest record
+    vector<vector<BYTE>>           m_vPending;              // Records stored this run
+    mutex                          m_mutex;
+};
@@ -20,6 +20,7 @@ struct SListingTotals
     ULARGE_INTEGER m_uliFileBytes   = {};
     UINT           m_cStreams       = 0;
     ULARGE_INTEGER m_uliStreamBytes = {};
+    UINT           m_cPrunedLinks   = 0;     // Directory links not followed (--Follow limit or cycle)
 
 
 
@@ -34,5 +35,6 @@ struct SListingTotals
         m_uliFileBytes.QuadPart   += other.m_uliFileBytes.QuadPart;
         m_cStreams                += other.m_cStreams;
         m_uliStreamBytes.QuadPart += other.m_uliStreamBytes.QuadPart;
+        m_cPrunedLinks            += other.m_cPrunedLinks;
     }
 };
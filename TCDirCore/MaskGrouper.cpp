@@ -46,6 +46,35 @@ bool CMaskGrouper::IsPureMask (const wstring & mask)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMaskGrouper::IsRecursiveGlob
+//
+//  Returns true if the mask has a wildcard in a directory segment, or ends
+//  in "**" (e.g., "**\\*.cpp", "src\\*\\test_*", "docs\\**").  Such a mask
+//  names files in more than one directory, so it cannot be split into a
+//  single directory and a file spec.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMaskGrouper::IsRecursiveGlob (const wstring & mask)
+{
+    size_t iLastSeparator = mask.find_last_of (L"\\/");
+
+
+
+    if (iLastSeparator != wstring::npos && FindFirstWildcard (mask) < iLastSeparator)
+    {
+        return true;
+    }
+
+    return mask == L"**" || mask.ends_with (L"\\**") || mask.ends_with (L"/**");
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CMaskGrouper::SplitMaskIntoDirAndFileSpec
@@ -53,7 +82,8 @@ bool CMaskGrouper::IsPureMask (const wstring & mask)
 //  Takes a mask and splits it into a directory path and file spec.  Pure masks
 //  use the provided cwd.  Directory-qualified masks are made absolute and split
 //  into their components.  If the mask is a directory (ends with separator or
-//  exists as a directory), "*" is used as the file spec.
+//  exists as a directory), "*" is used as the file spec.  Recursive globs
+//  keep every segment from the first wildcard on in the file spec.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -63,7 +93,11 @@ void CMaskGrouper::SplitMaskIntoDirAndFileSpec (
     filesystem::path       & dirPath,
     filesystem::path       & fileSpec)
 {
-    if (IsPureMask (mask))
+    if (IsRecursiveGlob (mask))
+    {
+        SplitRecursiveGlob (mask, cwd, dirPath, fileSpec);
+    }
+    else if (IsPureMask (mask))
     {
         SplitPureMask (mask, cwd, dirPath, fileSpec);
     }
@@ -207,6 +241,87 @@ void CMaskGrouper::SplitQualifiedMask (
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMaskGrouper::FindFirstWildcard
+//
+//  Returns the index of the first '*' or '?' in the mask, or npos.  The '?'
+//  of a "\\?\" or "\\.\" device prefix (including "\\?\UNC\") is part of
+//  the path, not a wildcard, so the search starts after it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+size_t CMaskGrouper::FindFirstWildcard (const wstring & mask)
+{
+    auto   isSeparator = [] (wchar_t ch) { return ch == L'\\' || ch == L'/'; };
+    size_t iStart      = 0;
+
+
+
+    if (mask.size() >= 4                              &&
+        isSeparator (mask[0]) && isSeparator (mask[1]) &&
+        (mask[2] == L'?' || mask[2] == L'.')          &&
+        isSeparator (mask[3]))
+    {
+        iStart = 4;
+    }
+
+    return mask.find_first_of (L"*?", iStart);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMaskGrouper::SplitRecursiveGlob
+//
+//  The segments before the first wildcard name the directory to start
+//  from; the rest, with backslash separators, is the file spec that
+//  CPathGlob matches against the paths below it.  A trailing "**" lists
+//  everything under it.
+//
+//  "src\\**\\test_*"  ->  { "C:\\cwd\\src\\",  "**\\test_*" }
+//  "**\\*.cpp"        ->  { "C:\\cwd",          "**\\*.cpp"  }
+//  "docs/**"          ->  { "C:\\cwd\\docs\\", "**\\*"      }
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMaskGrouper::SplitRecursiveGlob (
+    const wstring          & mask,
+    const filesystem::path & cwd,
+    filesystem::path       & dirPath,
+    filesystem::path       & fileSpec)
+{
+    size_t  iPrefixEnd = mask.find_last_of (L"\\/", FindFirstWildcard (mask));
+    wstring pattern    = iPrefixEnd == wstring::npos ? mask : mask.substr (iPrefixEnd + 1);
+
+
+
+    if (iPrefixEnd == wstring::npos)
+    {
+        dirPath = cwd;
+    }
+    else
+    {
+        dirPath = (cwd / mask.substr (0, iPrefixEnd + 1)).lexically_normal();
+    }
+
+    ranges::replace (pattern, L'/', L'\\');
+
+    if (pattern == L"**" || pattern.ends_with (L"\\**"))
+    {
+        pattern += L"\\*";
+    }
+
+    fileSpec = pattern;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CMaskGrouper::AddMaskToGroups
@@ -25,6 +25,7 @@ private:
 
 public:
     static bool              IsPureMask            (const wstring       & mask);
+    static bool              IsRecursiveGlob       (const wstring       & mask);
     static vector<MaskGroup> GroupMasksByDirectory (const list<wstring> & masks);
 
 private:
@@ -42,6 +43,13 @@ private:
                                                     filesystem::path        & dirPath,
                                                     filesystem::path        & fileSpec);
 
+    static size_t FindFirstWildcard                 (const wstring          & mask);
+
+    static void SplitRecursiveGlob                  (const wstring          & mask,
+                                                    const filesystem::path  & cwd,
+                                                    filesystem::path        & dirPath,
+                                                    filesystem::path        & fileSpec);
+
     static void AddMaskToGroups                    (const filesystem::path                      & dirPath,
                                                     const filesystem::path                      & fileSpec,
                                                     vector<MaskGroup>                           & groups,
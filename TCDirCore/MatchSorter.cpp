@@ -0,0 +1,464 @@
+#include "pch.h"
+#include "MatchSorter.h"
+
+#include "CaseFolding.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::CMatchSorter
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CMatchSorter::CMatchSorter (FileInfoVector & matches, const FileComparator & comparator) :
+    m_matches     (matches),
+    m_comparator  (comparator),
+    m_fDescending (comparator.IsDescending())
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::Sort
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMatchSorter::Sort (void)
+{
+    if (m_matches.size() < s_kcMinKeyedEntries || !BuildKeys())
+    {
+        std::sort (m_matches.begin(), m_matches.end(), m_comparator);
+        return false;
+    }
+
+    RadixSort();
+    SortTiedRuns();
+    ApplyOrder();
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::BuildKeys
+//
+//  Computes every entry's key once, so the sort itself never unpacks
+//  times, searches for the extension, or compares strings.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMatchSorter::BuildKeys (void)
+{
+    const CDirectoryInfo &   di       = m_comparator.DirInfo();
+    CCommandLine::ESortOrder primary  = m_comparator.PrimaryAttribute();
+    bool                     fGrouped = !m_comparator.IsInterleaved();
+
+
+
+    m_fNaturalKeys = primary == CCommandLine::ESortOrder::SO_NATURAL;
+    m_fStringKeys  = primary == CCommandLine::ESortOrder::SO_DEFAULT   ||
+                     primary == CCommandLine::ESortOrder::SO_NAME      ||
+                     primary == CCommandLine::ESortOrder::SO_EXTENSION ||
+                     m_fNaturalKeys;
+    m_fLocaleKeys  = m_fStringKeys && !m_fNaturalKeys && m_comparator.IsLocaleCompare();
+
+    if (m_fNaturalKeys && !m_comparator.HasNaturalKeys())
+    {
+        return false;
+    }
+
+    m_vKeys.resize (m_matches.size());
+
+    if (m_fStringKeys)
+    {
+        m_vStrings.resize (m_matches.size());
+    }
+
+    if (m_fLocaleKeys)
+    {
+        m_vSortKeyOffsets.resize (m_matches.size() + 1);
+        m_vSortKeyArena.reserve (m_matches.size() * 32);
+    }
+
+    for (size_t i = 0; i < m_matches.size(); ++i)
+    {
+        const FileInfo & fileInfo = m_matches[i];
+        SSortKey       & key      = m_vKeys[i];
+        ULONGLONG        ullKey   = 0;
+
+
+
+        switch (primary)
+        {
+            case CCommandLine::ESortOrder::SO_SIZE:
+                ullKey = fileInfo.m_cbSize;
+                break;
+
+            case CCommandLine::ESortOrder::SO_DATE:
+                ullKey = m_comparator.SelectedTime (fileInfo);
+                break;
+
+            case CCommandLine::ESortOrder::SO_NATURAL:
+                m_vStrings[i] = m_comparator.NaturalKey (fileInfo);
+                ullKey        = StringPrefix (m_vStrings[i], false);
+                break;
+
+            case CCommandLine::ESortOrder::SO_EXTENSION:
+            case CCommandLine::ESortOrder::SO_DEFAULT:
+            case CCommandLine::ESortOrder::SO_NAME:
+            default:
+                m_vStrings[i] = (primary == CCommandLine::ESortOrder::SO_EXTENSION) ? m_comparator.Extension (fileInfo)
+                                                                                    : di.NameView (fileInfo);
+
+                if (!m_fLocaleKeys)
+                {
+                    ullKey = StringPrefix (m_vStrings[i], true);
+                    break;
+                }
+
+                m_vSortKeyOffsets[i] = static_cast<UINT> (m_vSortKeyArena.size());
+
+                if (!AppendSortKey (m_vStrings[i], ullKey))
+                {
+                    return false;
+                }
+                break;
+        }
+
+        key.m_ullKey = m_fDescending ? ~ullKey : ullKey;
+        key.m_uGroup = (fGrouped && !fileInfo.IsDirectory()) ? 1 : 0;
+        key.m_iEntry = static_cast<UINT> (i);
+    }
+
+    if (m_fLocaleKeys)
+    {
+        m_vSortKeyOffsets.back() = static_cast<UINT> (m_vSortKeyArena.size());
+    }
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::StringPrefix
+//
+//  The first four UTF-16 units, big-endian, as the radix key for an
+//  ordinal sort (upcased) or a natural sort (whose keys are already
+//  folded).  Neither contains NULs, so padding a short string with zeros
+//  keeps it ahead of the longer strings it is a prefix of.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+ULONGLONG CMatchSorter::StringPrefix (wstring_view text, bool fUpcase)
+{
+    ULONGLONG ullPrefix = 0;
+
+
+
+    for (size_t i = 0; i < sizeof (ullPrefix) / sizeof (wchar_t); ++i)
+    {
+        wchar_t ch = (i < text.size()) ? text[i] : 0;
+
+        ullPrefix = (ullPrefix << 16) | (fUpcase ? CCaseFolding::UpcaseChar (ch) : ch);
+    }
+
+    return ullPrefix;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::AppendSortKey
+//
+//  Appends the locale sort key of a string to the arena and returns its
+//  first eight bytes, big-endian, as the radix key (--Sort=Locale).
+//  lstrcmpiW compares with CompareString in the user's locale ignoring
+//  case, and comparing LCMAP_SORTKEY keys bytewise gives the same order.
+//  Sort keys end in a single zero byte, so a short key padded with zeros
+//  still orders correctly against its neighbors.  LCMapStringW rejects an
+//  empty string (a name with no extension, for /OE), so that gets an empty
+//  key, which orders ahead of every other, as lstrcmpiW orders "".
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMatchSorter::AppendSortKey (wstring_view text, ULONGLONG & ullPrefix)
+{
+    static constexpr DWORD s_kdwFlags = LCMAP_SORTKEY | NORM_IGNORECASE;
+
+    LPCWSTR      pszText = text.data();
+    int          cchText = static_cast<int> (text.size());
+    BYTE         rgbKey[1024];
+    vector<BYTE> vLongKey;
+    const BYTE * pbKey   = rgbKey;
+    int          cbKey   = 0;
+
+
+
+    if (text.empty())
+    {
+        ullPrefix = 0;
+        return true;
+    }
+
+    cbKey = LCMapStringW (LOCALE_USER_DEFAULT, s_kdwFlags, pszText, cchText, reinterpret_cast<LPWSTR> (rgbKey), sizeof (rgbKey));
+
+    if (cbKey == 0 && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+    {
+        cbKey = LCMapStringW (LOCALE_USER_DEFAULT, s_kdwFlags, pszText, cchText, nullptr, 0);
+
+        if (cbKey > 0)
+        {
+            vLongKey.resize (cbKey);
+            cbKey = LCMapStringW (LOCALE_USER_DEFAULT, s_kdwFlags, pszText, cchText, reinterpret_cast<LPWSTR> (vLongKey.data()), cbKey);
+            pbKey = vLongKey.data();
+        }
+    }
+
+    if (cbKey <= 0)
+    {
+        return false;
+    }
+
+    m_vSortKeyArena.insert (m_vSortKeyArena.end(), pbKey, pbKey + cbKey);
+
+    ullPrefix = 0;
+
+    for (int i = 0; i < static_cast<int> (sizeof (ullPrefix)); ++i)
+    {
+        ullPrefix = (ullPrefix << 8) | (i < cbKey ? pbKey[i] : 0);
+    }
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::RadixSort
+//
+//  Stable LSD radix sort on the 64-bit image, one byte per pass, followed
+//  by a pass on the group so directories come first.  All eight
+//  histograms are gathered in one read of the keys, and a byte every key
+//  shares (the high bytes of sizes and times, usually) costs no pass.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMatchSorter::RadixSort (void)
+{
+    static constexpr size_t s_kcDigits  = sizeof (ULONGLONG);
+    static constexpr size_t s_kcBuckets = 256;
+
+    using Histograms = array<array<size_t, s_kcBuckets>, s_kcDigits>;
+
+    vector<SSortKey>       vScratch (m_vKeys.size());
+    unique_ptr<Histograms> pCounts  = make_unique<Histograms>();
+    size_t                 cFiles   = 0;
+
+
+
+    for (const SSortKey & key : m_vKeys)
+    {
+        for (size_t iDigit = 0; iDigit < s_kcDigits; ++iDigit)
+        {
+            ++(*pCounts)[iDigit][(key.m_ullKey >> (iDigit * 8)) & 0xFF];
+        }
+
+        cFiles += key.m_uGroup;
+    }
+
+    for (size_t iDigit = 0; iDigit < s_kcDigits; ++iDigit)
+    {
+        array<size_t, s_kcBuckets> & rgiNext = (*pCounts)[iDigit];
+        size_t                       iShift  = iDigit * 8;
+        size_t                       iStart  = 0;
+
+
+
+        if (rgiNext[(m_vKeys.front().m_ullKey >> iShift) & 0xFF] == m_vKeys.size())
+        {
+            continue;
+        }
+
+        for (size_t & c : rgiNext)
+        {
+            size_t cBucket = c;
+
+            c       = iStart;
+            iStart += cBucket;
+        }
+
+        for (const SSortKey & key : m_vKeys)
+        {
+            vScratch[rgiNext[(key.m_ullKey >> iShift) & 0xFF]++] = key;
+        }
+
+        m_vKeys.swap (vScratch);
+    }
+
+    if (cFiles != 0 && cFiles != m_vKeys.size())
+    {
+        size_t rgiNext[2] = { 0, m_vKeys.size() - cFiles };
+
+        for (const SSortKey & key : m_vKeys)
+        {
+            vScratch[rgiNext[key.m_uGroup]++] = key;
+        }
+
+        m_vKeys.swap (vScratch);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::SortTiedRuns
+//
+//  Entries whose group and image are equal are adjacent after the radix
+//  sort; order each such run with the full comparison.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMatchSorter::SortTiedRuns (void)
+{
+    auto fnLess = [this] (const SSortKey & lhs, const SSortKey & rhs)
+    {
+        return CompareTied (lhs.m_iEntry, rhs.m_iEntry) < 0;
+    };
+
+    size_t iEnd = 0;
+
+
+
+    for (size_t iStart = 0; iStart < m_vKeys.size(); iStart = iEnd)
+    {
+        iEnd = iStart + 1;
+
+        while (iEnd < m_vKeys.size()                                &&
+               m_vKeys[iEnd].m_ullKey == m_vKeys[iStart].m_ullKey   &&
+               m_vKeys[iEnd].m_uGroup == m_vKeys[iStart].m_uGroup)
+        {
+            ++iEnd;
+        }
+
+        if (iEnd - iStart > 1)
+        {
+            std::sort (m_vKeys.begin() + iStart, m_vKeys.begin() + iEnd, fnLess);
+        }
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::CompareTied
+//
+//  Order two entries whose keys tie.  For name and extension sorts the
+//  rest of the sort keys still decide the primary attribute, and reverse
+//  sorting applies to them; the fallback attributes never reverse.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+LONGLONG CMatchSorter::CompareTied (UINT iLhs, UINT iRhs) const
+{
+    if (m_fStringKeys)
+    {
+        int cmp = m_fLocaleKeys  ? CompareSortKeys (iLhs, iRhs)                                           :
+                  m_fNaturalKeys ? m_vStrings[iLhs].compare (m_vStrings[iRhs])                             :
+                                   CCaseFolding::CompareOrdinalIgnoreCase (m_vStrings[iLhs], m_vStrings[iRhs]);
+
+
+
+        if (cmp != 0)
+        {
+            return m_fDescending ? -cmp : cmp;
+        }
+    }
+
+    return m_comparator.CompareSecondary (m_matches[iLhs], m_matches[iRhs]);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::CompareSortKeys
+//
+//  Bytewise comparison of two entries' locale sort keys
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int CMatchSorter::CompareSortKeys (UINT iLhs, UINT iRhs) const
+{
+    size_t cbLhs = m_vSortKeyOffsets[iLhs + 1] - m_vSortKeyOffsets[iLhs];
+    size_t cbRhs = m_vSortKeyOffsets[iRhs + 1] - m_vSortKeyOffsets[iRhs];
+    int    cmp   = memcmp (m_vSortKeyArena.data() + m_vSortKeyOffsets[iLhs],
+                           m_vSortKeyArena.data() + m_vSortKeyOffsets[iRhs],
+                           (std::min) (cbLhs, cbRhs));
+
+
+
+    if (cmp == 0)
+    {
+        cmp = (cbLhs < cbRhs) ? -1 : (cbLhs > cbRhs) ? 1 : 0;
+    }
+
+    return cmp;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter::ApplyOrder
+//
+//  Move the matches into key order.  FileInfo is small and its extras are
+//  behind a unique_ptr, so this is one pass of 64-byte moves.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMatchSorter::ApplyOrder (void)
+{
+    FileInfoVector sorted;
+
+
+
+    sorted.reserve (m_matches.size());
+
+    for (const SSortKey & key : m_vKeys)
+    {
+        sorted.push_back (move (m_matches[key.m_iEntry]));
+    }
+
+    m_matches.swap (sorted);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "DirectoryInfo.h"
+#include "FileComparator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMatchSorter
+//
+//  Puts a directory's matches into FileComparator order without calling
+//  the comparator O(n log n) times.  Each entry gets a 16-byte key: its
+//  directory-first group, a 64-bit image of the primary sort attribute,
+//  and its index.  For size and date sorts the image is the value itself;
+//  for name and extension sorts it is the string's first four upcased
+//  UTF-16 units or, with --Sort=Locale, the first eight bytes of its
+//  locale sort key, whose byte order matches lstrcmpiW; for a natural
+//  sort it is the start of the comparator's precomputed natural key.
+//
+//  The keys are LSD radix sorted, then each run of tied keys is ordered
+//  by the full strings or sort keys (name and extension sorts) and the
+//  comparator's fallback attributes.  Reverse sorting complements the
+//  image, so it applies to the primary attribute only, as in
+//  FileComparator.
+//
+//  Small directories, and any directory whose sort keys cannot be built,
+//  go to std::sort with the comparator; Sort returns false for those.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CMatchSorter
+{
+public:
+    CMatchSorter (FileInfoVector & matches, const FileComparator & comparator);
+
+    bool Sort (void);
+
+    static constexpr size_t s_kcMinKeyedEntries = 64;
+
+
+
+private:
+    struct SSortKey
+    {
+        ULONGLONG m_ullKey;     // Primary attribute image; complemented for a descending sort
+        UINT      m_uGroup;     // 0 = directory, 1 = file; 0 for every entry in an interleaved sort
+        UINT      m_iEntry;     // Index into the unsorted matches
+    };
+
+    bool             BuildKeys       (void);
+    static ULONGLONG StringPrefix    (wstring_view text, bool fUpcase);
+    bool             AppendSortKey   (wstring_view text, ULONGLONG & ullPrefix);
+    void             RadixSort       (void);
+    void             SortTiedRuns    (void);
+    LONGLONG         CompareTied     (UINT iLhs, UINT iRhs) const;
+    int              CompareSortKeys (UINT iLhs, UINT iRhs) const;
+    void             ApplyOrder      (void);
+
+    FileInfoVector       & m_matches;
+    const FileComparator & m_comparator;
+    vector<SSortKey>       m_vKeys;
+    vector<wstring_view>   m_vStrings;              // Name, extension, or natural key per entry; string sorts only
+    vector<BYTE>           m_vSortKeyArena;         // Locale sort keys; --Sort=Locale only
+    vector<UINT>           m_vSortKeyOffsets;       // Start of each entry's sort key, plus the arena end
+    bool                   m_fStringKeys  = false;
+    bool                   m_fLocaleKeys  = false;
+    bool                   m_fNaturalKeys = false;
+    bool                   m_fDescending  = false;
+};
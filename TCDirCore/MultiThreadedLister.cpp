@@ -59,7 +59,20 @@ CMultiThreadedLister::~CMultiThreadedLister()
 void CMultiThreadedLister::StopWorkers()
 {
     m_stopSource.request_stop();
-    m_workQueue.SetDone();
+
+    if (m_pWorkQueue)
+    {
+        m_pWorkQueue->SetDone();
+    }
+
+    NotifyReadAheadWaiters();
+
+    {
+        lock_guard<mutex> lock (m_parkMutex);
+    }
+
+    m_cvPark.notify_all();
+
     m_workers.clear();  // jthreads auto-join on destruction
 }
 
@@ -67,13 +80,79 @@ void CMultiThreadedLister::StopWorkers()
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::StartWorkerPool
+//
+//  Starts the enumeration workers.  --Threads=N starts N; the default is one
+//  per logical CPU.  --Threads=Auto starts a larger pool with one worker per
+//  CPU active and lets the governor decide how many of the rest to wake.
+//  Returns the number of workers started.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+size_t CMultiThreadedLister::StartWorkerPool (void)
+{
+    const size_t cCpus     = max (1u, jthread::hardware_concurrency());
+    size_t       cWorkers  = cCpus;
+
+
+
+    if (m_cmdLinePtr->m_cThreads == CCommandLine::s_kcThreadsAuto)
+    {
+        cWorkers    = (std::min) (cCpus * s_kcAutoWorkersPerCpu, s_kcMaxAutoWorkers);
+        cWorkers    = (std::max) (cWorkers, cCpus);
+        m_pGovernor = make_unique<CThreadPoolGovernor> (1, cWorkers, cCpus);
+
+        m_sampleStart = chrono::steady_clock::now();
+        m_cActiveWorkers.store (m_pGovernor->GetActiveWorkers(), memory_order_relaxed);
+    }
+    else
+    {
+        if (m_cmdLinePtr->m_cThreads > 0)
+        {
+            cWorkers = static_cast<size_t> (m_cmdLinePtr->m_cThreads);
+        }
+
+        m_cActiveWorkers.store (cWorkers, memory_order_relaxed);
+    }
+
+    //
+    // Each worker owns a deque in the work-stealing scheduler: children it
+    // discovers stay local (LIFO) and idle workers steal the oldest pending
+    // directories from the others.  Parked workers' deques are stolen from
+    // like any other.
+    //
+
+    m_pWorkQueue = make_unique<CWorkStealingQueue<WorkItem>> (cWorkers);
+
+    if (m_cmdLinePtr->m_cTop > 0)
+    {
+        for (size_t i = 0; i < cWorkers; ++i)
+        {
+            m_vTopMatches.push_back (make_unique<CTopMatches> (m_cmdLinePtr, static_cast<size_t> (m_cmdLinePtr->m_cTop)));
+        }
+    }
+
+    for (size_t i = 0; i < cWorkers; ++i)
+    {
+        m_workers.emplace_back ([this, i](stop_token st) { WorkerThreadFunc (st, i); });
+    }
+
+    return cWorkers;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CMultiThreadedLister::ProcessDirectoryMultiThreaded
 //
 //  Main entry point for multithreaded directory enumeration.  Takes multiple
-//  file specs and applies them to each directory, deduplicating results when
-//  a file matches more than one spec.
+//  file specs and applies them to each directory; each directory is read
+//  once and an entry matching several specs is reported once.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -89,14 +168,42 @@ HRESULT CMultiThreadedLister::ProcessDirectoryMultiThreaded (
 
     
 
-    // Create root directory info node with multiple file specs
-    auto pRootDirInfo = make_shared<CDirectoryInfo> (dirPath, fileSpecs);
+    //
+    // Every node of this listing, and its shared_ptr control block, comes
+    // from one pool.  Only the root holds the file specs and a full path;
+    // the nodes below share the specs and keep just their leaf names.
+    //
+
+    m_pNodePool = make_shared<CDirectoryNodePool>();
+
+    auto pRootDirInfo = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (m_pNodePool), dirPath, fileSpecs);
+
+    m_pFileSpecMatcher = make_unique<CFileSpecMatcher> (fileSpecs);
+    m_cReadAheadLimit  = static_cast<size_t> (max (0, m_cmdLinePtr->m_cReadAhead));
+
+    //
+    // Recursive masks ("**\*.cpp", "*\src\**\test_*") are matched against
+    // each directory's path as well as its entries.  The root starts at the
+    // first segment of every spec, and each child's state is worked out
+    // from its parent's when it is found (see EnqueueChildDirectory).
+    //
+
+    if (CPathGlob::AnyGlobSpec (fileSpecs))
+    {
+        m_pPathGlob = make_unique<CPathGlob>();
+
+        hr = m_pPathGlob->Compile (fileSpecs, m_cmdLinePtr->m_fRecurse);
+        CHRF (hr, m_consolePtr->ColorPrintf (L"{Error}Error:   the file masks have more than %zu path segments\n", CPathGlob::s_kcMaxPositions));
+
+        pRootDirInfo->m_globState = m_pPathGlob->GetStartState();
+    }
 
     //
     // Determine whether tree-pruning is active.  This is true only in tree
-    // mode with a non-"*" file mask — i.e., when empty subdirectories should
-    // be hidden.  When all specs are "*", every directory is visible and no
-    // pruning logic runs.  The /S recursive path is never affected.
+    // mode with a non-"*" file mask or an entry filter (--Size>N, --Newer,
+    // ...) — i.e., when empty subdirectories should be hidden.  When all
+    // specs are "*" and nothing is filtered, every directory is visible and
+    // no pruning logic runs.  The /S recursive path is never affected.
     //
 
     if (m_cmdLinePtr->m_fTree)
@@ -104,22 +211,35 @@ HRESULT CMultiThreadedLister::ProcessDirectoryMultiThreaded (
         bool fAllStar = all_of (fileSpecs.begin(), fileSpecs.end(),
                                 [](const auto & spec) { return spec == L"*"; });
 
-        m_fTreePruningActive = !fAllStar;
+        m_fTreePruningActive = !fAllStar || !m_cmdLinePtr->m_entryFilter.IsEmpty();
     }
 
-    // Initialize work queue with root
-    m_workQueue.Push (WorkItem { pRootDirInfo });
+    //
+    // --Usage rolls each directory's totals up into its parent as its
+    // subtree completes, which needs the same pending-subtree counts.
+    // Like tree mode it does not follow links by default, so a junction
+    // does not count its target's bytes twice.
+    //
 
-    // Create worker threads
-    const size_t numThreads = max(1u, jthread::hardware_concurrency());
+    m_fTrackSubtrees = m_fTreePruningActive || m_cmdLinePtr->m_fUsage;
 
-    for (size_t i = 0; i < numThreads; ++i)
-    {
-        m_workers.emplace_back ([this](stop_token st) { WorkerThreadFunc (st); });
-    }
+    m_pLinkPolicy = make_unique<CLinkFollowPolicy> (m_cmdLinePtr->m_eFollowLinks, m_cmdLinePtr->m_fTree || m_cmdLinePtr->m_fUsage);
+
+    StartWorkerPool();
+
+    // Initialize work queue with root
+    m_pWorkQueue->Push (WorkItem { pRootDirInfo });
 
     // Start consuming immediately (streaming output)
-    if (m_cmdLinePtr->m_fTree)
+    if (m_cmdLinePtr->m_fUsage)
+    {
+        hr = PrintUsageTree (pRootDirInfo,
+                             driveInfo,
+                             static_cast<CResultsDisplayerTree &>(displayer),
+                             totals);
+        CHR (hr);
+    }
+    else if (m_cmdLinePtr->m_fTree)
     {
         CResultsDisplayerTree & treeDisplayer = static_cast<CResultsDisplayerTree &>(displayer);
         STreeConnectorState     treeState       (m_cmdLinePtr->m_cTreeIndent);
@@ -140,6 +260,11 @@ HRESULT CMultiThreadedLister::ProcessDirectoryMultiThreaded (
                                  level,
                                  totals);
         CHR (hr);
+
+        if (!m_vTopMatches.empty())
+        {
+            DisplayTopMatches (dirPath, driveInfo, displayer, level);
+        }
     }
 
 
@@ -157,35 +282,45 @@ Error:
 //
 //  CMultiThreadedLister::EnumerateDirectoryNode
 //
-//  Enumerates a single directory node using Win32 API (producer function)
+//  Enumerates a single directory node using Win32 API (producer function).
+//
+//  The node is private to this worker until SetStatus publishes it, so the
+//  matches are built without any lock.  If the display discarded the node
+//  in the meantime it left the contents for this worker to free.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CMultiThreadedLister::EnumerateDirectoryNode (shared_ptr<CDirectoryInfo> pDirInfo)
+void CMultiThreadedLister::EnumerateDirectoryNode (shared_ptr<CDirectoryInfo> pDirInfo, size_t iWorker)
 {
-    HRESULT hr = S_OK;
+    HRESULT hr        = S_OK;
+    UINT    prevState = 0;
 
 
 
+    // A demanded node is queued twice; the copy popped second has nothing to do
+    if (!pDirInfo->TryBeginEnumeration (prevState))
     {
-        lock_guard<mutex> lock (pDirInfo->m_mutex);
-        pDirInfo->m_status = CDirectoryInfo::Status::InProgress;
+        return;
     }
 
-    
-
-    hr = PerformEnumeration (pDirInfo);
+    if (!(prevState & CDirectoryInfo::s_kfDiscarded) && !IsProbeSettled (pDirInfo))
+    {
+        hr = PerformEnumeration (pDirInfo, iWorker);
+    }
 
+    //
+    // The matches count against the read-ahead budget, on top of the node
+    // itself (see EnqueueChildDirectory), until the display releases this
+    // node.  They are counted before publishing so a display that releases
+    // the node right away never takes the count below zero.
+    //
 
+    pDirInfo->m_hr                = hr;
+    pDirInfo->m_cBufferedEntries += pDirInfo->m_vMatches.size();
+    m_cBufferedEntries.fetch_add (pDirInfo->m_vMatches.size(), memory_order_relaxed);
 
-    {
-        lock_guard<mutex> lock (pDirInfo->m_mutex);
-        pDirInfo->m_status = FAILED (hr) ? CDirectoryInfo::Status::Error
-                                         : CDirectoryInfo::Status::Done;
-        pDirInfo->m_hr = hr;
-    }
-    
-    pDirInfo->m_cvStatusChanged.notify_one();
+    prevState = pDirInfo->SetStatus (FAILED (hr) ? CDirectoryInfo::Status::Error
+                                                 : CDirectoryInfo::Status::Done);
 
     //
     // Tree-pruning propagation (only when m_fTreePruningActive).
@@ -194,38 +329,194 @@ void CMultiThreadedLister::EnumerateDirectoryNode (shared_ptr<CDirectoryInfo> pD
     //    signal upward through all ancestors so the display thread knows
     //    they are visible.
     //
-    // 2. If this node is a leaf (no children), mark its subtree as complete
-    //    and try to propagate subtree-completion upward.
+    // 2. Count this node's own enumeration as done.  If every child (if
+    //    any) had already completed its subtree, this node's subtree is
+    //    complete too; otherwise the last child to complete signals it.
+    //    --Usage first adds the node's own counts to its subtree totals.
+    //
+    // This runs even for a discarded node, whose ancestors may still be
+    // waiting on the signal.
     //
 
-    if (m_fTreePruningActive)
+    if (m_fTreePruningActive && pDirInfo->m_cFiles > 0)
     {
-        if (pDirInfo->m_cFiles > 0)
-        {
-            pDirInfo->m_fDescendantMatchFound.store (true, memory_order_release);
-            pDirInfo->m_cvStatusChanged.notify_all();
+        pDirInfo->SetFlags (CDirectoryInfo::s_kfDescendantMatch);
+
+        PropagateDescendantMatch (pDirInfo);
+    }
 
-            PropagateDescendantMatch (pDirInfo);
+    if (m_fTrackSubtrees)
+    {
+        if (m_cmdLinePtr->m_fUsage)
+        {
+            pDirInfo->m_cbSubtree.fetch_add           (pDirInfo->m_uliBytesUsed.QuadPart, memory_order_relaxed);
+            pDirInfo->m_cSubtreeFiles.fetch_add       (pDirInfo->m_cFiles,                memory_order_relaxed);
+            pDirInfo->m_cSubtreeDirectories.fetch_add (pDirInfo->m_cSubDirectories,       memory_order_relaxed);
         }
 
-        bool fIsLeaf;
+        CompletePendingSubtree (pDirInfo);
+    }
 
+    // Discarded before it was published: the display left it for us to free
+    if (prevState & CDirectoryInfo::s_kfDiscarded)
+    {
+        ReleaseSubtree (pDirInfo, true);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::PerformEnumeration
+//
+//  Reads the directory once with "*" and classifies every entry in process:
+//  entries matching a file spec (and the attribute filters) become matches,
+//  and subdirectories are enqueued when recursing.  This replaces one
+//  FindFirstFile pass per file spec plus a separate "*" pass for
+//  subdirectories, and since each name is seen exactly once there is no
+//  need to deduplicate entries matched by more than one spec.
+//
+//  m_pFileSpecMatcher reproduces FindFirstFile's wildcard semantics, so the
+//  set of matches is the same as before.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CMultiThreadedLister::PerformEnumeration (shared_ptr<CDirectoryInfo> pDirInfo, size_t iWorker)
+{
+    HRESULT hr              = S_OK;
+    bool    fRecurse        = m_cmdLinePtr->m_fRecurse || m_cmdLinePtr->m_fTree || m_cmdLinePtr->m_fUsage || m_pPathGlob;
+    bool    fNeedShortNames = m_pPathGlob ? m_pPathGlob->NeedsShortNames() : !m_pFileSpecMatcher->MatchesAll();
+    auto    dirPath         = pDirInfo->DirPath();
+
+
+
+    hr = m_pEnumerator->Enumerate (dirPath, L"*", fNeedShortNames, [&] (span<const WIN32_FIND_DATA> batch)
+    {
+        bool fContinue = true;
+
+        // The display has already moved past this directory
+        if (pDirInfo->HasFlags (CDirectoryInfo::s_kfDiscarded))
         {
-            lock_guard<mutex> lock (pDirInfo->m_mutex);
-            fIsLeaf = pDirInfo->m_vChildren.empty();
+            return false;
         }
 
-        if (fIsLeaf)
+        m_cEnumeratedEntries.fetch_add (batch.size(), memory_order_relaxed);
+
+        for (const WIN32_FIND_DATA & wfd : batch)
         {
-            pDirInfo->m_fSubtreeComplete.store (true, memory_order_release);
-            pDirInfo->m_cvStatusChanged.notify_all();
+            if (pDirInfo->m_fProbeOnly)
+            {
+                fContinue = ProbeEntry (wfd, pDirInfo, dirPath);
+
+                if (!fContinue)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                ClassifyEntry (wfd, pDirInfo, dirPath, fRecurse, iWorker);
+            }
+        }
+
+        return fContinue && !StopRequested();
+    });
+
+    m_cEnumeratedDirs.fetch_add (1, memory_order_relaxed);
+
+    // An empty or inaccessible directory simply has no entries
+    if (hr == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND) ||
+        hr == HRESULT_FROM_WIN32 (ERROR_ACCESS_DENIED)  ||
+        hr == HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND))
+    {
+        hr = S_OK;
+    }
+
+    CHRA (hr);
+
+Error:
+    return hr;
+}
+
+
+
 
-            auto pParent = pDirInfo->m_wpParent.lock();
 
-            if (pParent)
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::ClassifyEntry
+//
+//  Handles one entry of the single "*" pass.  A directory can be both a
+//  match (its name matched a spec, e.g. *.cpp matching "foo.cpp/") and a
+//  child to recurse into.  In tree mode every directory must also appear in
+//  m_vMatches so the tree display can show it and recurse into it.
+//
+//  With --Top the match is counted in the node but moved to this worker's
+//  collector (see CollectTopCandidate).  --Usage only counts it.
+//
+//  Runs on the worker enumerating pDirInfo, which owns the node until it
+//  is published.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::ClassifyEntry (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath, bool fRecurse, size_t iWorker)
+{
+    bool fIsDir   = CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+    bool fMatched = false;
+
+
+
+    // Check if this entry matches a spec and passes the attribute and entry filters
+    if (MatchesFileSpec (wfd, *pDirInfo)                                              &&
+        CFlag::IsSet    (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesRequired) &&
+        CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded) &&
+        m_cmdLinePtr->m_entryFilter.Matches (wfd))
+    {
+        if (m_cmdLinePtr->m_fUsage)
+        {
+            // No FileInfo is built; the totals are all --Usage shows
+            if (fIsDir)
             {
-                TrySignalParentSubtreeComplete (pParent);
+                ++pDirInfo->m_cSubDirectories;
             }
+            else
+            {
+                ++pDirInfo->m_cFiles;
+                pDirInfo->m_uliBytesUsed.QuadPart += FileInfo::PackULongLong (wfd.nFileSizeHigh, wfd.nFileSizeLow);
+            }
+        }
+        else
+        {
+            AddMatchToList (wfd, *pDirInfo, nullptr);
+
+            if (m_vTopMatches.empty())
+            {
+                fMatched = true;
+            }
+            else
+            {
+                CollectTopCandidate (*pDirInfo, dirPath, iWorker);
+            }
+        }
+    }
+
+    if (fIsDir && fRecurse)
+    {
+        bool fHasChild = EnqueueChildDirectory (wfd, pDirInfo, dirPath);
+
+        if (m_cmdLinePtr->m_fTree && !fMatched)
+        {
+            AddMatchToList (wfd, *pDirInfo, nullptr);
+            fMatched = true;
+        }
+
+        // Link the entry to its node so the tree display needs no lookup by name
+        if (fHasChild && fMatched)
+        {
+            pDirInfo->m_vMatches.back().m_iChild = static_cast<UINT> (pDirInfo->m_vChildren.size() - 1);
         }
     }
 }
@@ -236,29 +527,72 @@ void CMultiThreadedLister::EnumerateDirectoryNode (shared_ptr<CDirectoryInfo> pD
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::PerformEnumeration
+//  CMultiThreadedLister::CollectTopCandidate
 //
-//  Performs the actual directory enumeration
+//  --Top: takes the match ClassifyEntry just added back out of the node,
+//  leaving its counts behind for the totals, and offers a file to this
+//  worker's collector under its full path.  Directories are never
+//  candidates.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-HRESULT CMultiThreadedLister::PerformEnumeration (shared_ptr<CDirectoryInfo> pDirInfo)
+void CMultiThreadedLister::CollectTopCandidate (CDirectoryInfo & di, const filesystem::path & dirPath, size_t iWorker)
 {
-    HRESULT hr = S_OK;
+    FileInfo & fileInfo = di.m_vMatches.back();
+    UINT       ibName   = fileInfo.m_ibName;
 
-    
 
-    hr = EnumerateMatchingFiles (pDirInfo);
-    CHR (hr);
 
-    if (m_cmdLinePtr->m_fRecurse || m_cmdLinePtr->m_fTree)
+    if (!fileInfo.IsDirectory())
     {
-        hr = EnumerateSubdirectories (pDirInfo);
-        CHR (hr);
+        filesystem::path fullPath = dirPath / di.NameView (fileInfo);
+
+        m_vTopMatches[iWorker]->Add (move (fileInfo), fullPath.native());
     }
 
-Error:
-    return hr;
+    di.m_vMatches.pop_back();
+    di.m_vNameArena.resize (ibName);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::ProbeEntry
+//
+//  Handles one entry of a probe node (a directory below --Depth that only
+//  decides whether its depth-limit ancestor is visible).  Matches are not
+//  kept: the first matching file is counted in m_cFiles, which is all
+//  EnumerateDirectoryNode needs to propagate the match, and the rest of
+//  the directory is skipped.  Returns false to stop enumerating.
+//
+//  Runs on the worker enumerating pDirInfo, which owns the node until it
+//  is published.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::ProbeEntry (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath)
+{
+    bool fContinue = true;
+
+
+
+    if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+    {
+        EnqueueChildDirectory (wfd, pDirInfo, dirPath);
+    }
+    else if (MatchesFileSpec (wfd, *pDirInfo)                                              &&
+             CFlag::IsSet    (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesRequired) &&
+             CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded) &&
+             m_cmdLinePtr->m_entryFilter.Matches (wfd))
+    {
+        ++pDirInfo->m_cFiles;
+        fContinue = false;
+    }
+
+    return fContinue;
 }
 
 
@@ -267,100 +601,322 @@ Error:
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::EnumerateMatchingFiles
+//  CMultiThreadedLister::MatchesFileSpec
 //
-//  Searches for files matching the file spec pattern(s).
-//  If multiple file specs are provided, deduplicates results by filename
-//  (case-insensitive on Windows).
+//  With recursive masks an entry is matched against the specs that have
+//  reached its directory; otherwise against every spec.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-HRESULT CMultiThreadedLister::EnumerateMatchingFiles (shared_ptr<CDirectoryInfo> pDirInfo)
+bool CMultiThreadedLister::MatchesFileSpec (const WIN32_FIND_DATA & wfd, const CDirectoryInfo & dirInfo) const
 {
-    HRESULT                hr               = S_OK;
-    filesystem::path       pathAndFileSpec;
-    AutoFindHandle         hFind;
-    WIN32_FIND_DATA        wfd              = { 0 };
-    NameSet                seenFilenames;
-    DWORD                  dwError          = 0;
+    if (m_pPathGlob)
+    {
+        return m_pPathGlob->Matches (dirInfo.m_globState, wfd);
+    }
+
+    return m_pFileSpecMatcher->Matches (wfd);
+}
 
 
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::IsProbeSettled
+//
+//  True for a probe node whose depth-limit ancestor is already known to be
+//  visible, so there is nothing left for this node to find.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::IsProbeSettled (shared_ptr<CDirectoryInfo> pDirInfo) const
+{
+    if (!pDirInfo->m_fProbeOnly)
+    {
+        return false;
+    }
+
+    return pDirInfo->m_pProbeRoot->HasFlags (CDirectoryInfo::s_kfDescendantMatch);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::EnqueueChildDirectory
+//
+//  Creates and enqueues a child directory for processing.  dirPath is
+//  pDirInfo's full path, which the enumerating worker already has; the
+//  child itself keeps only its leaf name.  Returns true if a child node
+//  was added (at the end of pDirInfo->m_vChildren).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::EnqueueChildDirectory (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath)
+{
+    size_t                     cChildDepth  = pDirInfo->m_cDepth + 1;
+    bool                       fBeyondDepth = m_cmdLinePtr->m_fTree         &&
+                                              m_cmdLinePtr->m_cMaxDepth > 0 &&
+                                              cChildDepth >= static_cast<size_t> (m_cmdLinePtr->m_cMaxDepth);
+    UINT                       cLinks       = pDirInfo->m_cLinksFollowed;
+    uint64_t                   globState    = 0;
+    optional<SDirectoryId>     targetId;
+    shared_ptr<CDirectoryInfo> pChild;
+
+
+
     //
-    // Iterate through each file spec
+    // With recursive masks, a subdirectory through which no spec can reach
+    // a match is never read, and nothing below it is either.
     //
 
-    for (const auto & fileSpec : pDirInfo->m_vFileSpecs)
+    if (m_pPathGlob)
     {
-        // Build search path for files matching this pattern
-        try
-        {
-            pathAndFileSpec = pDirInfo->m_dirPath / fileSpec;
-        }
-        catch (const filesystem::filesystem_error &)
+        globState = m_pPathGlob->Step (pDirInfo->m_globState, wfd);
+
+        if (globState == 0)
         {
-            continue;  // Skip this spec on error
+            return false;
         }
+    }
+
+    //
+    // The display never recurses into a directory at or below --Depth
+    // (see RecurseIntoChildDirectory).  Without a file mask nothing about
+    // such a directory is needed beyond the entry its parent already
+    // holds, so it is not enumerated at all.  With a mask it is probed
+    // for visibility.
+    //
+
+    if (fBeyondDepth && !m_fTreePruningActive)
+    {
+        return false;
+    }
+
+    // A discarded parent will never be displayed, so neither will its children
+    if (pDirInfo->HasFlags (CDirectoryInfo::s_kfDiscarded))
+    {
+        return false;
+    }
+
+    //
+    // A directory link the --Follow policy refuses gets no node: the
+    // display lists its entry but has nothing to expand under it.
+    //
 
-        hFind = FindFirstFile (pathAndFileSpec.c_str(), &wfd);
-        if (hFind == INVALID_HANDLE_VALUE)
+    if (CLinkFollowPolicy::IsDirectoryLink (wfd))
+    {
+        if (!ShouldFollowChildLink (dirPath / wfd.cFileName, pDirInfo, targetId))
         {
-            continue;  // No matches for this spec, try next
+            return false;
         }
 
-        do
+        ++cLinks;
+    }
+
+    pChild = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (m_pNodePool), pDirInfo, wfd.cFileName);
+
+    pChild->m_cDepth         = cChildDepth;
+    pChild->m_cLinksFollowed = cLinks;
+    pChild->m_globState      = globState;
+    pChild->m_id             = targetId;
+
+    // Sized once: copying the parent's key and then appending would reallocate
+    pChild->m_vDfsKey.reserve (pDirInfo->m_vDfsKey.size() + 1);
+    pChild->m_vDfsKey.assign  (pDirInfo->m_vDfsKey.begin(), pDirInfo->m_vDfsKey.end());
+    pChild->m_vDfsKey.push_back (static_cast<UINT> (pDirInfo->m_vChildren.size()));
+
+    if (fBeyondDepth)
+    {
+        pChild->m_fProbeOnly = true;
+        pChild->m_pProbeRoot = pDirInfo->m_fProbeOnly ? pDirInfo->m_pProbeRoot : pChild.get();
+    }
+
+    pDirInfo->m_vChildren.push_back (pChild);
+
+    // Counted before the child is queued, since it may complete its subtree right away
+    if (m_fTrackSubtrees)
+    {
+        pDirInfo->m_cPendingSubtrees.fetch_add (1, memory_order_relaxed);
+    }
+
+    //
+    // Count this subdirectory only if it won't be counted during file enumeration.
+    // When a file spec matches this directory name, HandleDirectoryMatch will
+    // count it. Avoid double-counting by checking if any pattern matches.
+    //
+    // Note: We don't increment m_cSubDirectories here. That counter tracks
+    // directories that matched the file pattern (e.g., lib.cpp matching *.cpp),
+    // which is handled in HandleDirectoryMatch when the dir is added to results.
+    //
+
+    //
+    // The node counts against the read-ahead budget like one entry from
+    // now until the display releases it.  Otherwise a sparse mask, which
+    // leaves most directories without matches, would let the workers
+    // queue and read the whole tree ahead of the display.
+    //
+
+    pChild->m_cBufferedEntries = 1;
+    m_cBufferedEntries.fetch_add (1, memory_order_relaxed);
+
+    //
+    // Called on the worker thread that enumerated the parent, so the child
+    // lands on that worker's own deque.
+    //
+
+    m_pWorkQueue->Push (WorkItem { pChild });
+
+    return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::ShouldFollowChildLink
+//
+//  Applies the --Follow policy to a directory link found in pDirInfo.
+//  The cycle check walks m_pParent from pDirInfo to the root; the target
+//  ID comes back in targetId for the child node.  A pruned link is
+//  counted on pDirInfo.
+//
+//  Runs on the worker enumerating pDirInfo.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::ShouldFollowChildLink (const filesystem::path & linkPath, shared_ptr<CDirectoryInfo> pDirInfo, optional<SDirectoryId> & targetId)
+{
+    CLinkFollowPolicy::EDecision decision;
+
+
+
+    decision = DecideLink (linkPath, pDirInfo->m_cLinksFollowed, targetId, [&] (const SDirectoryId & id)
+    {
+        for (shared_ptr<CDirectoryInfo> pAncestor = pDirInfo; pAncestor; pAncestor = pAncestor->m_pParent)
         {
-            if (StopRequested())
-            {
-                break;
-            }
+            const SDirectoryId * pId = GetNodeDirectoryId (*pAncestor);
 
-            // Skip "." and ".."
-            if (IsDots (wfd.cFileName))
+            if (pId && *pId == id)
             {
-                continue;
+                return true;
             }
+        }
 
-            //
-            // Deduplicate across file specs: skip if we've already emitted this
-            // entry.  Names come from FindFirstFile on this one directory, so
-            // they are the canonical on-disk bytes and compare directly.
-            //
+        return false;
+    });
 
-            if (seenFilenames.contains (wfd.cFileName))
-            {
-                continue;
-            }
-            seenFilenames.insert (wfd.cFileName);
+    if (decision == CLinkFollowPolicy::EDecision::Prune)
+    {
+        ++pDirInfo->m_cPrunedLinks;
+    }
+
+    return decision == CLinkFollowPolicy::EDecision::Follow;
+}
 
-            // Check if this entry should be displayed based on attribute filters
-            if (CFlag::IsSet    (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesRequired) &&
-                CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded))
-            {
-                lock_guard<mutex> lock (pDirInfo->m_mutex);
 
-                AddMatchToList (wfd, *pDirInfo, nullptr);
-            }
 
-        } 
-        while (FindNextFile (hFind, &wfd));
 
-        // Check if loop ended due to error or naturally
-        dwError = GetLastError();
-        if (dwError != ERROR_NO_MORE_FILES && dwError != ERROR_FILE_NOT_FOUND)
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::GetNodeDirectoryId
+//
+//  A node's directory ID, looked up on first use.  Workers checking links
+//  under the same ancestor race here, so the lookup is guarded by the
+//  node's once_flag rather than its mutex, which the caller may hold for
+//  a different node.  Returns null if the directory could not be opened.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const SDirectoryId * CMultiThreadedLister::GetNodeDirectoryId (CDirectoryInfo & dirInfo)
+{
+    call_once (dirInfo.m_idOnce, [&]
+    {
+        if (!dirInfo.m_id)
         {
-            CHRA (HRESULT_FROM_WIN32 (dwError));
+            dirInfo.m_id = GetDirectoryId (dirInfo.DirPath());
         }
+    });
 
-        if (StopRequested())
+    return dirInfo.m_id ? &*dirInfo.m_id : nullptr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::WorkerThreadFunc
+//
+//  Worker thread function - processes items from work queue.  iWorker
+//  identifies this worker's deque in the work-stealing scheduler.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::WorkerThreadFunc (stop_token stopToken, size_t iWorker)
+{
+    while (!stopToken.stop_requested())
+    {
+        WorkItem item;
+
+        WaitForActiveSlot (iWorker);
+
+        if (PopWithinReadAheadBudget (iWorker, item))
         {
+            if (m_pGovernor)
+            {
+                auto start = chrono::steady_clock::now();
+
+                EnumerateDirectoryNode (item.m_pDirInfo, iWorker);
+                SampleEnumeration (chrono::steady_clock::now() - start);
+            }
+            else
+            {
+                EnumerateDirectoryNode (item.m_pDirInfo, iWorker);
+            }
+        }
+        else
+        {
+            // Queue is done
             break;
         }
     }
+}
 
-Error:
-    return hr;
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::WaitForActiveSlot
+//
+//  Parks a worker the governor has retired until it is needed again or the
+//  listing is stopped.  A worker already asleep in Pop when it is retired
+//  finishes at most one more directory before parking here.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::WaitForActiveSlot (size_t iWorker)
+{
+    if (iWorker < m_cActiveWorkers.load (memory_order_relaxed))
+    {
+        return;
+    }
+
+    unique_lock<mutex> lock (m_parkMutex);
+
+    m_cvPark.wait (lock, [&]() {
+        return iWorker < m_cActiveWorkers.load (memory_order_relaxed) || StopRequested();
+    });
 }
 
 
@@ -369,96 +925,150 @@ Error:
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::EnumerateSubdirectories
+//  CMultiThreadedLister::SampleEnumeration
 //
-//  Searches for subdirectories and enqueues them for processing
+//  --Threads=Auto: records one directory's enumeration time.  The worker
+//  that finishes a directory after the sample window has elapsed hands the
+//  window to the governor and applies its decision; the others skip ahead
+//  without waiting on the lock.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-HRESULT CMultiThreadedLister::EnumerateSubdirectories (shared_ptr<CDirectoryInfo> pDirInfo)
+void CMultiThreadedLister::SampleEnumeration (chrono::steady_clock::duration latency)
 {
-    HRESULT          hr          = S_OK;
-    filesystem::path pathForDirs;
-    AutoFindHandle   hFind;
-    WIN32_FIND_DATA  wfd         = { 0 };
-    DWORD            dwError     = 0;
+    auto                         now = chrono::steady_clock::now();
+    CThreadPoolGovernor::SSample sample;
+    size_t                       cActive = 0;
 
-    //
-    // In tree mode, directories must also appear in m_vMatches so they are
-    // visible in the interleaved tree display. Build a set of directory names
-    // already present (from EnumerateMatchingFiles) to avoid duplicates.
-    //
 
-    NameSet seenDirs;
 
+    m_cSampleDirectories.fetch_add  (1,               memory_order_relaxed);
+    m_cSampleLatencyTicks.fetch_add (latency.count(), memory_order_relaxed);
 
+    unique_lock<mutex> lock (m_governorMutex, try_to_lock);
 
-    if (m_cmdLinePtr->m_fTree)
+    if (!lock.owns_lock() || now - m_sampleStart < CThreadPoolGovernor::s_kSampleWindow)
     {
-        lock_guard<mutex> lock (pDirInfo->m_mutex);
+        return;
+    }
+
+    sample.m_cDirectories = m_cSampleDirectories.exchange (0, memory_order_relaxed);
+    sample.m_latency      = chrono::steady_clock::duration (m_cSampleLatencyTicks.exchange (0, memory_order_relaxed));
+    sample.m_elapsed      = now - m_sampleStart;
+    sample.m_cQueued      = m_pWorkQueue->GetQueuedCount();
+    m_sampleStart         = now;
 
-        for (const auto & entry : pDirInfo->m_vMatches)
+    cActive = m_pGovernor->Update (sample);
+
+    if (cActive != m_cActiveWorkers.load (memory_order_relaxed))
+    {
         {
-            if (CFlag::IsSet (entry.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
-            {
-                seenDirs.insert (entry.cFileName);
-            }
+            lock_guard<mutex> parkLock (m_parkMutex);
+            m_cActiveWorkers.store (cActive, memory_order_relaxed);
         }
+
+        m_cvPark.notify_all();
     }
+}
 
-    // Search using "*" to find all directories
-    pathForDirs = pDirInfo->m_dirPath / L"*";
-    hFind = FindFirstFile (pathForDirs.c_str(), &wfd);
-    BAIL_OUT_IF (hFind == INVALID_HANDLE_VALUE, S_OK);
 
-    do
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::PopWithinReadAheadBudget
+//
+//  Backpressure for the workers.  While the entries enumerated but not yet
+//  released by the display, counting each directory node found as one,
+//  are at the --ReadAhead limit, a worker takes only nodes the display has
+//  demanded (the urgent lane) and otherwise blocks, so the workers cannot
+//  run arbitrarily far ahead of the output.  The display waiting on
+//  visibility lifts the limit (see SetConsumerWaiting), since that needs
+//  whole subtrees read rather than one node.
+//
+//  Checking the budget before popping, rather than after, means no worker
+//  sits on a node it has popped while the display waits for it.  Returns
+//  false once the queue is done or the listing is stopped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::PopWithinReadAheadBudget (size_t iWorker, WorkItem & item)
+{
+    if (m_cReadAheadLimit == 0)
     {
-        if (StopRequested())
-        {
-            break;
-        }
+        return m_pWorkQueue->Pop (iWorker, item);
+    }
 
-        if (IsDots (wfd.cFileName))
+    for (;;)
+    {
+        if (HasReadAheadRoom())
         {
-            continue;
+            return m_pWorkQueue->Pop (iWorker, item);
         }
 
-        // Enqueue directories for recursion
-        if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+        if (m_pWorkQueue->TryPopUrgent (item))
         {
-            lock_guard<mutex> lock (pDirInfo->m_mutex);
+            return true;
+        }
 
-            EnqueueChildDirectory (wfd, pDirInfo);
+        unique_lock<mutex> lock (m_readAheadMutex);
 
-            //
-            // In tree mode, add every directory to m_vMatches so the tree
-            // display can show it and recurse into it.  Skip if the directory
-            // was already added by EnumerateMatchingFiles (e.g., a directory
-            // whose name matched the file spec like *.cpp matching "foo.cpp/").
-            //
+        m_cvReadAhead.wait (lock, [&]() {
+            return HasReadAheadRoom() || m_pWorkQueue->HasUrgent() || StopRequested();
+        });
 
-            if (m_cmdLinePtr->m_fTree)
-            {
-                if (!seenDirs.contains (wfd.cFileName))
-                {
-                    seenDirs.insert (wfd.cFileName);
-                    AddMatchToList (wfd, *pDirInfo, nullptr);
-                }
-            }
+        if (StopRequested())
+        {
+            return false;
         }
     }
-    while (FindNextFile (hFind, &wfd));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::HasReadAheadRoom
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CMultiThreadedLister::HasReadAheadRoom (void) const
+{
+    return m_cBufferedEntries.load (memory_order_relaxed) < m_cReadAheadLimit ||
+           m_fConsumerWaiting.load (memory_order_relaxed);
+}
+
+
+
+
 
-    // Check if loop ended due to error or naturally
-    dwError = GetLastError();
-    if (dwError != ERROR_NO_MORE_FILES)
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::SetConsumerWaiting
+//
+//  Called by the display thread around each blocking wait on a node.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::SetConsumerWaiting (bool fWaiting)
+{
+    if (m_cReadAheadLimit == 0)
     {
-        CHRA (HRESULT_FROM_WIN32 (dwError));
+        return;
     }
 
+    {
+        lock_guard<mutex> lock (m_readAheadMutex);
+        m_fConsumerWaiting = fWaiting;
+    }
 
-Error:
-    return hr;
+    if (fWaiting)
+    {
+        m_cvReadAhead.notify_all();
+    }
 }
 
 
@@ -467,41 +1077,99 @@ Error:
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::EnqueueChildDirectory
+//  CMultiThreadedLister::ReleaseMatches
 //
-//  Creates and enqueues a child directory for processing
+//  Frees a displayed node's matches and returns them, and the node's own
+//  share, to the read-ahead budget.  The node itself and its child list
+//  stay alive until ReleaseSubtree.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CMultiThreadedLister::EnqueueChildDirectory (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo)
+void CMultiThreadedLister::ReleaseMatches (shared_ptr<CDirectoryInfo> pDirInfo)
 {
-    filesystem::path subdirPath = pDirInfo->m_dirPath / wfd.cFileName;
-    auto             pChild     = make_shared<CDirectoryInfo> (subdirPath, pDirInfo->m_vFileSpecs);
+    size_t cReleased = pDirInfo->m_cBufferedEntries;
 
-    //
-    // Set parent back-pointer for tree-pruning propagation.  Only set when
-    // pruning is active so the /S path and tree-without-mask path are
-    // completely unaffected.
-    //
 
-    if (m_fTreePruningActive)
+
+    pDirInfo->m_cBufferedEntries = 0;
+
+    FileInfoVector().swap (pDirInfo->m_vMatches);
+    vector<WCHAR>().swap  (pDirInfo->m_vNameArena);
+
+    if (cReleased > 0)
     {
-        pChild->m_wpParent = pDirInfo;
+        m_cBufferedEntries.fetch_sub (cReleased, memory_order_relaxed);
+        NotifyReadAheadWaiters();
     }
+}
 
-    pDirInfo->m_vChildren.push_back (pChild);
 
-    //
-    // Count this subdirectory only if it won't be counted during file enumeration.
-    // When a file spec matches this directory name, HandleDirectoryMatch will
-    // count it. Avoid double-counting by checking if any pattern matches.
-    //
-    // Note: We don't increment m_cSubDirectories here. That counter tracks
-    // directories that matched the file pattern (e.g., lib.cpp matching *.cpp),
-    // which is handled in HandleDirectoryMatch when the dir is added to results.
-    //
 
-    m_workQueue.Push (WorkItem { pChild });
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::ReleaseSubtree
+//
+//  Discards a node and everything below it once the display is done with
+//  it (or has decided never to show it).  Matches and child lists are
+//  freed, so the tree in memory is only the path being displayed plus the
+//  read-ahead, not everything enumerated so far.  Workers stop early on
+//  discarded nodes that are still queued or being enumerated.
+//
+//  Walks the subtree with an explicit stack; detaching each child list
+//  before the node goes away also keeps the shared_ptr destructors from
+//  recursing once per level.
+//
+//  Setting s_kfDiscarded decides who frees a node.  A node that is already
+//  published is freed here; one still waiting or being enumerated belongs
+//  to its worker, which frees it when it finishes and finds the flag set
+//  (calling back in with fClaimed, as the flag is already taken).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::ReleaseSubtree (shared_ptr<CDirectoryInfo> pDirInfo, bool fClaimed)
+{
+    vector<shared_ptr<CDirectoryInfo>> vPending  = { move (pDirInfo) };
+    size_t                             cReleased = 0;
+
+
+
+    while (!vPending.empty())
+    {
+        shared_ptr<CDirectoryInfo>         pNode = move (vPending.back());
+        vector<shared_ptr<CDirectoryInfo>> vChildren;
+
+        vPending.pop_back();
+
+        if (!fClaimed)
+        {
+            UINT prevState = pNode->SetFlags (CDirectoryInfo::s_kfDiscarded);
+
+            if ((prevState & CDirectoryInfo::s_kfDiscarded) || !CDirectoryInfo::IsSettled (prevState))
+            {
+                continue;
+            }
+        }
+
+        fClaimed = false;
+
+        cReleased += pNode->m_cBufferedEntries;
+        pNode->m_cBufferedEntries = 0;
+
+        FileInfoVector().swap (pNode->m_vMatches);
+        vector<WCHAR>().swap  (pNode->m_vNameArena);
+
+        vChildren.swap (pNode->m_vChildren);
+
+        move (vChildren.begin(), vChildren.end(), back_inserter (vPending));
+    }
+
+    if (cReleased > 0)
+    {
+        m_cBufferedEntries.fetch_sub (cReleased, memory_order_relaxed);
+        NotifyReadAheadWaiters();
+    }
 }
 
 
@@ -510,28 +1178,21 @@ void CMultiThreadedLister::EnqueueChildDirectory (const WIN32_FIND_DATA & wfd, s
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::WorkerThreadFunc
+//  CMultiThreadedLister::NotifyReadAheadWaiters
 //
-//  Worker thread function - processes items from work queue
+//  Wakes workers blocked in WaitForReadAheadBudget.  Taking the mutex
+//  first orders this with a worker that has just checked the budget but
+//  not yet started waiting, so the wakeup cannot be lost.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CMultiThreadedLister::WorkerThreadFunc (stop_token stopToken)
+void CMultiThreadedLister::NotifyReadAheadWaiters (void)
 {
-    while (!stopToken.stop_requested())
     {
-        WorkItem item;
-
-        if (m_workQueue.Pop (item))
-        {
-            EnumerateDirectoryNode (item.m_pDirInfo);
-        }
-        else
-        {
-            // Queue is done
-            break;
-        }
+        lock_guard<mutex> lock (m_readAheadMutex);
     }
+
+    m_cvReadAhead.notify_all();
 }
 
 
@@ -560,18 +1221,28 @@ HRESULT CMultiThreadedLister::PrintDirectoryTree (
     hr = WaitForNodeCompletion (pDirInfo);
     CHR (hr);
 
-    SortResults (pDirInfo);
+    DemandChildren (pDirInfo);
+
+    // With --Top the matches went to the workers' collectors instead
+    if (m_vTopMatches.empty())
+    {
+        SortResults (pDirInfo);
 
-    displayer.DisplayResults (driveInfo, *pDirInfo, level);
+        displayer.DisplayResults (driveInfo, *pDirInfo, level);
+    }
 
     AccumulateTotals (pDirInfo, totals);
 
+    // Only the child list is needed from here on
+    ReleaseMatches (pDirInfo);
+
     hr = ProcessChildren (pDirInfo, driveInfo, displayer, totals);
     CHR (hr);
 
 
 
 Error:
+    ReleaseSubtree (pDirInfo);
     return hr;
 }
 
@@ -579,6 +1250,41 @@ Error:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::DisplayTopMatches
+//
+//  --Top: once every directory has been enumerated and counted, stops the
+//  workers, merges their collectors, and shows the N winners as a single
+//  directory under the listing root.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::DisplayTopMatches (
+    const filesystem::path             & dirPath,
+    const CDriveInfo                   & driveInfo,
+    IResultsDisplayer                  & displayer,
+    IResultsDisplayer::EDirectoryLevel   level)
+{
+    CTopMatches & top = *m_vTopMatches.front();
+
+
+
+    // The collectors are only safe to read once their workers have exited
+    StopWorkers();
+
+    for (size_t i = 1; i < m_vTopMatches.size(); ++i)
+    {
+        top.Merge (*m_vTopMatches[i]);
+    }
+
+    displayer.DisplayResults (driveInfo, top.Finish (dirPath), level);
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CMultiThreadedLister::WaitForNodeCompletion
@@ -589,15 +1295,32 @@ Error:
 
 HRESULT CMultiThreadedLister::WaitForNodeCompletion (shared_ptr<CDirectoryInfo> pDirInfo)
 {
-    HRESULT hr = S_OK;
+    HRESULT hr    = S_OK;
+    UINT    state = pDirInfo->GetState();
 
-    unique_lock<mutex> lock (pDirInfo->m_mutex);
 
-    pDirInfo->m_cvStatusChanged.wait (lock, [&]() {
-        return pDirInfo->m_status == CDirectoryInfo::Status::Done ||
-               pDirInfo->m_status == CDirectoryInfo::Status::Error ||
-               StopRequested();
-    });
+
+    //
+    // A demanded node is taken from the urgent lane even when the
+    // read-ahead budget is full.  Without demand scheduling the workers
+    // instead run past the budget while the display is blocked here;
+    // otherwise a full budget could keep the very node being waited on
+    // from ever being enumerated.  Only the display thread requests a
+    // stop, so nothing needs to wake it for one.
+    //
+
+    if (!CDirectoryInfo::IsSettled (state) && !StopRequested())
+    {
+        auto start = chrono::steady_clock::now();
+
+        DemandNode (pDirInfo);
+
+        SetConsumerWaiting (!m_fDemandScheduling);
+        state = pDirInfo->WaitForState (CDirectoryInfo::IsSettled);
+        SetConsumerWaiting (false);
+
+        m_consumerStall += chrono::steady_clock::now() - start;
+    }
 
     // Check for cancellation
     if (StopRequested())
@@ -606,10 +1329,10 @@ HRESULT CMultiThreadedLister::WaitForNodeCompletion (shared_ptr<CDirectoryInfo>
     }
 
     // Check for error
-    if (pDirInfo->m_status == CDirectoryInfo::Status::Error)
+    if (CDirectoryInfo::StatusOf (state) == CDirectoryInfo::Status::Error)
     {
         m_consolePtr->ColorPrintf (L"{Error}  Error accessing directory: {InformationHighlight}%s{Error}: HRESULT 0x%08X\n",
-                                    pDirInfo->m_dirPath.c_str(), 
+                                    pDirInfo->DirPath().c_str(), 
                                     pDirInfo->m_hr);
         CHR (pDirInfo->m_hr);
     }
@@ -622,6 +1345,80 @@ Error:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::DemandNode
+//
+//  Moves a node the display needs onto the scheduler's urgent lane, which
+//  workers drain (lowest DFS key first) before any speculative work.  The
+//  node stays in whichever worker deque it was pushed to; that copy is
+//  skipped when popped (see EnumerateDirectoryNode).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::DemandNode (shared_ptr<CDirectoryInfo> pDirInfo)
+{
+    if (!m_fDemandScheduling)
+    {
+        return;
+    }
+
+    if (CDirectoryInfo::StatusOf (pDirInfo->GetState()) != CDirectoryInfo::Status::Waiting)
+    {
+        return;
+    }
+
+    if (pDirInfo->SetFlags (CDirectoryInfo::s_kfDemanded) & CDirectoryInfo::s_kfDemanded)
+    {
+        return;
+    }
+
+    m_pWorkQueue->PushUrgent (WorkItem { pDirInfo });
+
+    // Workers held back by a full read-ahead budget still take demanded nodes
+    if (m_cReadAheadLimit != 0)
+    {
+        NotifyReadAheadWaiters();
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::DemandChildren
+//
+//  Called once a node is complete and about to be displayed: its first
+//  children are the next nodes the display will wait on, so demand up to
+//  one per worker before the display gets there.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::DemandChildren (shared_ptr<CDirectoryInfo> pDirInfo)
+{
+    size_t cLookahead = m_cActiveWorkers.load (memory_order_relaxed);
+    size_t cChildren  = min (cLookahead, pDirInfo->m_vChildren.size());
+
+
+
+    if (!m_fDemandScheduling)
+    {
+        return;
+    }
+
+    // The node is published, and only the display thread releases it
+    for (size_t i = 0; i < cChildren; ++i)
+    {
+        DemandNode (pDirInfo->m_vChildren[i]);
+    }
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  CMultiThreadedLister::SortResults
@@ -632,9 +1429,7 @@ Error:
 
 void CMultiThreadedLister::SortResults (shared_ptr<CDirectoryInfo> pDirInfo)
 {
-    lock_guard<mutex> lock (pDirInfo->m_mutex);
-
-    SortMatches (pDirInfo->m_vMatches, FileComparator (m_cmdLinePtr, m_cmdLinePtr->m_fTree));
+    SortMatches (pDirInfo->m_vMatches, FileComparator (m_cmdLinePtr, *pDirInfo, m_cmdLinePtr->m_fTree));
 }
 
 
@@ -651,12 +1446,11 @@ void CMultiThreadedLister::SortResults (shared_ptr<CDirectoryInfo> pDirInfo)
 
 void CMultiThreadedLister::AccumulateTotals (shared_ptr<CDirectoryInfo> pDirInfo, SListingTotals & totals)
 {
-    lock_guard<mutex> lock (pDirInfo->m_mutex);
-
     totals.m_cFiles                  += pDirInfo->m_cFiles;
     totals.m_uliFileBytes.QuadPart   += pDirInfo->m_uliBytesUsed.QuadPart;
     totals.m_cStreams                += pDirInfo->m_cStreams;
     totals.m_uliStreamBytes.QuadPart += pDirInfo->m_uliStreamBytesUsed.QuadPart;
+    totals.m_cPrunedLinks            += pDirInfo->m_cPrunedLinks;
 
     //
     // Count directories whose names matched the mask
@@ -711,16 +1505,16 @@ Error:
 //
 //  CMultiThreadedLister::PropagateDescendantMatch
 //
-//  Walks up the parent chain via m_wpParent, setting
-//  m_fDescendantMatchFound = true and notifying m_cvStatusChanged on each
-//  ancestor.  Stops when the parent is null (root reached) or the flag is
-//  already set (an earlier producer already propagated through this path).
+//  Walks up the parent chain via m_pParent, setting s_kfDescendantMatch
+//  (which wakes the display if it is waiting on that ancestor).  Stops
+//  when the parent is null (root reached) or the flag is already set (an
+//  earlier producer already propagated through this path).
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 void CMultiThreadedLister::PropagateDescendantMatch (shared_ptr<CDirectoryInfo> pDirInfo)
 {
-    auto pParent = pDirInfo->m_wpParent.lock();
+    CDirectoryInfo * pParent = pDirInfo->m_pParent.get();
 
 
 
@@ -731,14 +1525,12 @@ void CMultiThreadedLister::PropagateDescendantMatch (shared_ptr<CDirectoryInfo>
         // be by the thread that set this one).  Stop to avoid redundant work.
         //
 
-        if (pParent->m_fDescendantMatchFound.exchange (true, memory_order_acq_rel))
+        if (pParent->SetFlags (CDirectoryInfo::s_kfDescendantMatch) & CDirectoryInfo::s_kfDescendantMatch)
         {
             break;
         }
 
-        pParent->m_cvStatusChanged.notify_all();
-
-        pParent = pParent->m_wpParent.lock();
+        pParent = pParent->m_pParent.get();
     }
 }
 
@@ -748,43 +1540,177 @@ void CMultiThreadedLister::PropagateDescendantMatch (shared_ptr<CDirectoryInfo>
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::TrySignalParentSubtreeComplete
+//  CMultiThreadedLister::CompletePendingSubtree
 //
-//  Checks whether ALL of pParent's children have m_fSubtreeComplete == true.
-//  If so, sets pParent->m_fSubtreeComplete, notifies, and recurses upward
-//  to the grandparent.
+//  Retires one unit of pDirInfo's m_cPendingSubtrees: its own enumeration
+//  (when its worker publishes it) or one child's subtree.  The last unit
+//  marks the subtree complete and retires one unit of the parent, and so
+//  on up the chain.  Each edge is crossed at most once, with no lock and
+//  no scan over siblings.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CMultiThreadedLister::TrySignalParentSubtreeComplete (shared_ptr<CDirectoryInfo> pParent)
+void CMultiThreadedLister::CompletePendingSubtree (shared_ptr<CDirectoryInfo> pDirInfo)
 {
+    for (CDirectoryInfo * pNode = pDirInfo.get(); pNode != nullptr; pNode = pNode->m_pParent.get())
     {
-        lock_guard<mutex> lock (pParent->m_mutex);
+        if (pNode->m_cPendingSubtrees.fetch_sub (1, memory_order_acq_rel) != 1)
+        {
+            return;   // Its own enumeration or another child subtree is still in progress
+        }
 
-        for (const auto & pSibling : pParent->m_vChildren)
+        if (m_cmdLinePtr->m_fUsage)
         {
-            if (!pSibling->m_fSubtreeComplete.load (memory_order_acquire))
-            {
-                return;   // At least one sibling subtree is still in progress
-            }
+            RollUpUsage (*pNode);
         }
+
+        pNode->SetFlags (CDirectoryInfo::s_kfSubtreeComplete);
     }
+}
 
 
 
-    //
-    // All children are subtree-complete.  Mark this parent as well.
-    //
 
-    pParent->m_fSubtreeComplete.store (true, memory_order_release);
-    pParent->m_cvStatusChanged.notify_all();
 
-    auto pGrandparent = pParent->m_wpParent.lock();
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::RollUpUsage
+//
+//  --Usage: called when dirInfo's subtree completes, before its unit of
+//  the parent's m_cPendingSubtrees is retired.  Adds its totals to the
+//  parent's, which the parent's last decrement then sees.  A directory at
+//  the --Depth limit is never expanded by the display, so its children
+//  (all complete by now) are freed here rather than kept until the end.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::RollUpUsage (CDirectoryInfo & dirInfo)
+{
+    CDirectoryInfo * pParent   = dirInfo.m_pParent.get();
+    int              cMaxDepth = m_cmdLinePtr->m_cMaxDepth;
+
+
+
+    if (pParent != nullptr)
+    {
+        pParent->m_cbSubtree.fetch_add           (dirInfo.m_cbSubtree.load (memory_order_relaxed),           memory_order_relaxed);
+        pParent->m_cSubtreeFiles.fetch_add       (dirInfo.m_cSubtreeFiles.load (memory_order_relaxed),       memory_order_relaxed);
+        pParent->m_cSubtreeDirectories.fetch_add (dirInfo.m_cSubtreeDirectories.load (memory_order_relaxed), memory_order_relaxed);
+    }
+
+    if (cMaxDepth > 0 && dirInfo.m_cDepth >= static_cast<size_t> (cMaxDepth))
+    {
+        vector<shared_ptr<CDirectoryInfo>>().swap (dirInfo.m_vChildren);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::PrintUsageTree
+//
+//  --Usage display.  Nothing can be shown until every directory has been
+//  read, so the display waits for the root's subtree to complete and then
+//  draws the tree of directories down to --Depth, each with its recursive
+//  size and file count.  The grand totals come from the root.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CMultiThreadedLister::PrintUsageTree (
+    shared_ptr<CDirectoryInfo>   pRootDirInfo,
+    const CDriveInfo           & driveInfo,
+    CResultsDisplayerTree      & treeDisplayer,
+    SListingTotals             & totals)
+{
+    HRESULT             hr = S_OK;
+    STreeConnectorState treeState (m_cmdLinePtr->m_cTreeIndent);
+
+
+
+    hr = WaitForNodeCompletion (pRootDirInfo);
+    CHR (hr);
+
+    // Every node is kept until the whole tree is read, so no budget applies
+    SetConsumerWaiting (true);
+    pRootDirInfo->WaitForState ([] (UINT state) { return (state & CDirectoryInfo::s_kfSubtreeComplete) != 0; });
+    SetConsumerWaiting (false);
+
+    treeDisplayer.DisplayTreeRootHeader (driveInfo, *pRootDirInfo);
+    treeDisplayer.BeginUsage            (*pRootDirInfo);
+    treeDisplayer.DisplayUsageEntry     (*pRootDirInfo, pRootDirInfo->DirPath().c_str(), treeState, true);
+
+    treeState.Push (false);
+    DisplayUsageChildren (*pRootDirInfo, treeDisplayer, treeState);
+    treeState.Pop();
+
+    treeDisplayer.DisplayTreeRootSummary();
+
+    totals.m_cFiles                += pRootDirInfo->m_cSubtreeFiles.load (memory_order_relaxed);
+    totals.m_uliFileBytes.QuadPart += pRootDirInfo->m_cbSubtree.load (memory_order_relaxed);
+    totals.m_cDirectories          += pRootDirInfo->m_cSubtreeDirectories.load (memory_order_relaxed);
+
+
+
+Error:
+    ReleaseSubtree (pRootDirInfo);
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::DisplayUsageChildren
+//
+//  Shows dirInfo's subdirectories, largest first, each followed by its own
+//  subdirectories, unless dirInfo is at the --Depth limit.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CMultiThreadedLister::DisplayUsageChildren (
+    const CDirectoryInfo   & dirInfo,
+    CResultsDisplayerTree  & treeDisplayer,
+    STreeConnectorState    & treeState)
+{
+    int                            cMaxDepth = m_cmdLinePtr->m_cMaxDepth;
+    vector<const CDirectoryInfo *> vChildren;
+
 
-    if (pGrandparent)
+
+    if (cMaxDepth > 0 && dirInfo.m_cDepth >= static_cast<size_t> (cMaxDepth))
+    {
+        return;
+    }
+
+    vChildren.reserve (dirInfo.m_vChildren.size());
+
+    for (const auto & pChild : dirInfo.m_vChildren)
+    {
+        vChildren.push_back (pChild.get());
+    }
+
+    stable_sort (vChildren.begin(), vChildren.end(), [] (const CDirectoryInfo * pLhs, const CDirectoryInfo * pRhs)
     {
-        TrySignalParentSubtreeComplete (pGrandparent);
+        return pLhs->m_cbSubtree.load (memory_order_relaxed) > pRhs->m_cbSubtree.load (memory_order_relaxed);
+    });
+
+    for (size_t i = 0; i < vChildren.size(); ++i)
+    {
+        bool fIsLast = (i + 1 == vChildren.size());
+
+        treeDisplayer.DisplayUsageEntry (*vChildren[i], vChildren[i]->m_strLeafName.c_str(), treeState, fIsLast);
+
+        treeState.Push (!fIsLast);
+        DisplayUsageChildren (*vChildren[i], treeDisplayer, treeState);
+        treeState.Pop();
     }
+
+    m_consolePtr->Flush();
 }
 
 
@@ -799,42 +1725,44 @@ void CMultiThreadedLister::TrySignalParentSubtreeComplete (shared_ptr<CDirectory
 //  Returns true if the directory should be displayed (it or a descendant
 //  has matching files), false if it should be pruned.
 //
-//  Waits on m_cvStatusChanged until either m_fDescendantMatchFound or
-//  m_fSubtreeComplete becomes true.  Also wakes on stop-requested.
+//  Waits on the node's state word until either s_kfDescendantMatch or
+//  s_kfSubtreeComplete is set.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 bool CMultiThreadedLister::WaitForTreeVisibility (shared_ptr<CDirectoryInfo> pDirInfo)
 {
+    constexpr UINT kfDecided = CDirectoryInfo::s_kfDescendantMatch | CDirectoryInfo::s_kfSubtreeComplete;
+
+    UINT           state     = pDirInfo->GetState();
+
+
+
     //
-    // Fast path: check atomics before taking the lock.
+    // Fast path: already decided.
     //
 
-    if (pDirInfo->m_fDescendantMatchFound.load (memory_order_acquire))
+    if (state & kfDecided)
     {
-        return true;
+        return (state & CDirectoryInfo::s_kfDescendantMatch) != 0;
     }
 
-    if (pDirInfo->m_fSubtreeComplete.load (memory_order_acquire))
-    {
-        return false;
-    }
+    //
+    // Slow path: wait for a signal.  Only the display thread requests a
+    // stop, so nothing needs to wake it for one.
+    //
 
+    auto start = chrono::steady_clock::now();
 
+    SetConsumerWaiting (true);
 
-    //
-    // Slow path: wait for a signal.
-    //
+    state = pDirInfo->WaitForState ([] (UINT s) { return (s & kfDecided) != 0; });
 
-    unique_lock<mutex> lock (pDirInfo->m_mutex);
+    SetConsumerWaiting (false);
 
-    pDirInfo->m_cvStatusChanged.wait (lock, [&]() {
-        return pDirInfo->m_fDescendantMatchFound.load (memory_order_acquire) ||
-               pDirInfo->m_fSubtreeComplete.load (memory_order_acquire)     ||
-               StopRequested();
-    });
+    m_consumerStall += chrono::steady_clock::now() - start;
 
-    return pDirInfo->m_fDescendantMatchFound.load (memory_order_acquire);
+    return (state & CDirectoryInfo::s_kfDescendantMatch) != 0;
 }
 
 
@@ -869,6 +1797,8 @@ HRESULT CMultiThreadedLister::PrintDirectoryTreeMode (
     hr = WaitForNodeCompletion (pDirInfo);
     CHR (hr);
 
+    DemandChildren (pDirInfo);
+
     SortResults (pDirInfo);
 
     //
@@ -916,6 +1846,7 @@ HRESULT CMultiThreadedLister::PrintDirectoryTreeMode (
 
 
 Error:
+    ReleaseSubtree (pDirInfo);
     return hr;
 }
 
@@ -940,24 +1871,9 @@ HRESULT CMultiThreadedLister::DisplayTreeEntries (
     SListingTotals             & totals,
     STreeConnectorState        & treeState)
 {
-    HRESULT hr = S_OK;
-
-
-
-    //
-    // Build lookup from child directory name -> child CDirectoryInfo.  Both the
-    // keys here and the entry names probed below come from FindFirstFile on this
-    // directory, so they are the canonical on-disk bytes and compare directly.
-    //
-
-    ChildMap childMap;
-
-    for (const auto & pChild : pDirInfo->m_vChildren)
-    {
-        childMap[pChild->m_dirPath.filename().wstring()] = pChild;
-    }
-
-    size_t cEntries = pDirInfo->m_vMatches.size();
+    HRESULT hr           = S_OK;
+    size_t  cEntries     = pDirInfo->m_vMatches.size();
+    size_t  iLastVisible = FindLastVisibleEntry (*pDirInfo);
 
 
 
@@ -965,10 +1881,9 @@ HRESULT CMultiThreadedLister::DisplayTreeEntries (
     // Display each visible entry interleaved with directory recursion.
     //
     // When a file mask is active, directories with no matching files
-    // anywhere in their subtree are pruned from the display.  Use
-    // a look-ahead pattern: for each entry, determine its visibility;
-    // then peek forward to find the next visible entry to decide
-    // whether this entry is last (└──) or middle (├──).
+    // anywhere in their subtree are pruned from the display.  The last
+    // visible entry (drawn with └── rather than ├──) is found up front, so
+    // each directory's visibility is waited on at most once per pass.
     //
     // When m_fTreePruningActive is false (no file mask, or all specs
     // are "*"), every directory is visible — no waiting needed.
@@ -982,7 +1897,8 @@ HRESULT CMultiThreadedLister::DisplayTreeEntries (
         }
 
         const FileInfo & entry  = pDirInfo->m_vMatches[i];
-        bool             fIsDir = (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        bool             fIsDir = entry.IsDirectory();
+        bool             fIsLast;
 
         //
         // Determine visibility of this entry.
@@ -991,40 +1907,31 @@ HRESULT CMultiThreadedLister::DisplayTreeEntries (
         // is not active.
         //
 
-        if (fIsDir && m_fTreePruningActive)
+        if (fIsDir && !IsTreeEntryVisible (*pDirInfo, entry))
         {
-            auto it = childMap.find (entry.cFileName);
-
-            if (it != childMap.end() && !WaitForTreeVisibility (it->second))
-            {
-                //
-                // This directory was pruned (no matching descendants).
-                // Adjust the parent's subdirectory count so that
-                // AccumulateTotals only counts directories we actually show.
-                //
+            //
+            // This directory was pruned (no matching descendants).
+            // Adjust the parent's subdirectory count so that
+            // AccumulateTotals only counts directories we actually show.
+            //
 
-                --pDirInfo->m_cSubDirectories;
-                continue;
-            }
+            --pDirInfo->m_cSubDirectories;
+            ReleaseSubtree (pDirInfo->m_vChildren[entry.m_iChild]);
+            continue;
         }
 
-        bool fIsLast = IsLastVisibleEntry (pDirInfo->m_vMatches, i, childMap);
+        fIsLast = (i == iLastVisible);
 
-        treeDisplayer.DisplaySingleEntry (entry, treeState, fIsLast, i);
+        treeDisplayer.DisplaySingleEntry (*pDirInfo, entry, treeState, fIsLast, i);
 
         //
-        // If the entry is a directory, find its child node and recurse.
+        // If the entry is a directory with a child node, recurse into it.
         //
 
-        if (fIsDir)
+        if (fIsDir && entry.HasChild())
         {
-            auto it = childMap.find (entry.cFileName);
-
-            if (it != childMap.end())
-            {
-                hr = RecurseIntoChildDirectory (it->second, entry, fIsLast, driveInfo, treeDisplayer, totals, treeState);
-                IGNORE_RETURN_VALUE (hr, S_OK);
-            }
+            hr = RecurseIntoChildDirectory (pDirInfo->m_vChildren[entry.m_iChild], fIsLast, driveInfo, treeDisplayer, totals, treeState);
+            IGNORE_RETURN_VALUE (hr, S_OK);
         }
     }
 
@@ -1038,57 +1945,57 @@ Error:
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  CMultiThreadedLister::IsLastVisibleEntry
+//  CMultiThreadedLister::IsTreeEntryVisible
 //
-//  Looks ahead from the current index to determine whether the entry is
-//  the last visible one in the list.  Files are always visible; directories
-//  are visible only when pruning is inactive or the directory has matching
-//  descendants.
+//  Files are always visible; directories are visible when pruning is
+//  inactive or the directory has matching descendants.  While pruning, a
+//  directory with no node (a link that was not followed, or one no
+//  recursive mask can reach) has nothing below it to match, so it is
+//  hidden.  Waits for the directory's visibility to be decided; once it
+//  is, this is O(1).
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-bool CMultiThreadedLister::IsLastVisibleEntry (
-    const vector<FileInfo> & vMatches,
-    size_t                   iCurrent,
-    const ChildMap         & childMap)
+bool CMultiThreadedLister::IsTreeEntryVisible (const CDirectoryInfo & di, const FileInfo & entry)
 {
-    size_t cEntries = vMatches.size();
+    if (!entry.IsDirectory() || !m_fTreePruningActive)
+    {
+        return true;
+    }
 
+    if (!entry.HasChild())
+    {
+        return false;
+    }
 
+    return WaitForTreeVisibility (di.m_vChildren[entry.m_iChild]);
+}
 
-    for (size_t j = iCurrent + 1; j < cEntries; ++j)
-    {
-        const FileInfo & nextEntry  = vMatches[j];
-        bool             fNextIsDir = (nextEntry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 
-        if (!fNextIsDir)
-        {
-            return false;   // A file follows — always visible
-        }
 
-        //
-        // Next entry is a directory.  If pruning is not active,
-        // it's visible.  Otherwise wait for its visibility.
-        //
 
-        if (!m_fTreePruningActive)
-        {
-            return false;
-        }
 
-        auto itNext = childMap.find (nextEntry.cFileName);
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CMultiThreadedLister::FindLastVisibleEntry
+//
+//  Scans backward for the last entry that will be displayed, waiting only
+//  on the trailing directories that turn out to be pruned plus the first
+//  visible entry before them.  Returns SIZE_MAX if nothing is visible.
+//
+////////////////////////////////////////////////////////////////////////////////
 
-        if (itNext != childMap.end() && WaitForTreeVisibility (itNext->second))
+size_t CMultiThreadedLister::FindLastVisibleEntry (const CDirectoryInfo & di)
+{
+    for (size_t i = di.m_vMatches.size(); i-- > 0; )
+    {
+        if (StopRequested() || IsTreeEntryVisible (di, di.m_vMatches[i]))
         {
-            return false;
+            return i;
         }
-
-        //
-        // That directory was pruned — keep looking.
-        //
     }
 
-    return true;
+    return SIZE_MAX;
 }
 
 
@@ -1100,7 +2007,8 @@ bool CMultiThreadedLister::IsLastVisibleEntry (
 //  CMultiThreadedLister::RecurseIntoChildDirectory
 //
 //  Recurses into a child directory during tree-mode display.  Checks
-//  depth limit and reparse-point status before recursing.  Flushes the
+//  the depth limit before recursing; directory links only have a child
+//  node when the --Follow policy let them be enumerated.  Flushes the
 //  console and saves/restores the displayer's per-directory state so that
 //  column widths are correct across nesting levels.
 //
@@ -1108,7 +2016,6 @@ bool CMultiThreadedLister::IsLastVisibleEntry (
 
 HRESULT CMultiThreadedLister::RecurseIntoChildDirectory (
     shared_ptr<CDirectoryInfo>   pChild,
-    const FileInfo             & parentEntry,
     bool                         fIsLast,
     const CDriveInfo           & driveInfo,
     CResultsDisplayerTree      & treeDisplayer,
@@ -1119,13 +2026,17 @@ HRESULT CMultiThreadedLister::RecurseIntoChildDirectory (
 
     bool                   fDepthLimited  = (m_cmdLinePtr->m_cMaxDepth > 0 &&
                                              treeState.Depth() + 1 >= m_cmdLinePtr->m_cMaxDepth);
-    bool                   fIsReparse     = CFlag::IsSet (parentEntry.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT);
 
     CResultsDisplayerTree::SDirectoryDisplayState savedState;
 
 
 
-    BAIL_OUT_IF (fDepthLimited || fIsReparse, S_OK);
+    if (fDepthLimited)
+    {
+        // Never displayed, so nothing enumerated under it is needed
+        ReleaseSubtree (pChild);
+        BAIL_OUT_IF (TRUE, S_OK);
+    }
 
     //
     // Flush everything displayed so far (including this directory entry)
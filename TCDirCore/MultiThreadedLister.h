@@ -1,9 +1,13 @@
 #pragma once
 
 #include "DirectoryLister.h"
-#include "TransparentWStringHash.h"
+#include "DirectoryNodePool.h"
+#include "FileSpecMatcher.h"
+#include "PathGlob.h"
+#include "ThreadPoolGovernor.h"
+#include "TopMatches.h"
 #include "TreeConnectorState.h"
-#include "WorkQueue.h"
+#include "WorkStealingQueue.h"
 
 
 
@@ -19,6 +23,9 @@ class CResultsDisplayerTree;
 struct WorkItem
 {
     shared_ptr<CDirectoryInfo> m_pDirInfo;
+
+    // Display (DFS pre-order) order, for the scheduler's urgent lane
+    bool operator< (const WorkItem & other) const { return m_pDirInfo->m_vDfsKey < other.m_pDirInfo->m_vDfsKey; }
 };
 
 
@@ -40,11 +47,18 @@ public:
                                            IResultsDisplayer::EDirectoryLevel level,
                                            SListingTotals & totals);
 
+    void                           SetDemandScheduling   (bool fEnabled) { m_fDemandScheduling = fEnabled; }
+    chrono::steady_clock::duration GetConsumerStallTime  (void) const    { return m_consumerStall; }
+    size_t                         GetActiveWorkerCount  (void) const    { return m_cActiveWorkers.load (memory_order_relaxed); }
+    size_t                         GetBufferedEntryCount (void) const    { return m_cBufferedEntries.load (memory_order_relaxed); }
+    size_t                         GetEnumeratedDirs     (void) const    { return m_cEnumeratedDirs.load (memory_order_relaxed); }
+    size_t                         GetEnumeratedEntries  (void) const    { return m_cEnumeratedEntries.load (memory_order_relaxed); }
+
 
                                            
 protected:
-    void    EnumerateDirectoryNode        (shared_ptr<CDirectoryInfo> pDirInfo);
-    void    WorkerThreadFunc              (stop_token stopToken);
+    void    EnumerateDirectoryNode        (shared_ptr<CDirectoryInfo> pDirInfo, size_t iWorker);
+    void    WorkerThreadFunc              (stop_token stopToken, size_t iWorker);
     HRESULT PrintDirectoryTree            (shared_ptr<CDirectoryInfo> pDirInfo, 
                                            const CDriveInfo & driveInfo,
                                            IResultsDisplayer & displayer,
@@ -54,12 +68,35 @@ protected:
 
 
 private:
-    HRESULT PerformEnumeration            (shared_ptr<CDirectoryInfo> pDirInfo);
-    HRESULT EnumerateMatchingFiles        (shared_ptr<CDirectoryInfo> pDirInfo);
-    HRESULT EnumerateSubdirectories       (shared_ptr<CDirectoryInfo> pDirInfo);
-    void    EnqueueChildDirectory         (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo);
+    HRESULT PerformEnumeration            (shared_ptr<CDirectoryInfo> pDirInfo, size_t iWorker);
+    void    ClassifyEntry                 (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath, bool fRecurse, size_t iWorker);
+    void    CollectTopCandidate           (CDirectoryInfo & di, const filesystem::path & dirPath, size_t iWorker);
+    void    DisplayTopMatches             (const filesystem::path & dirPath,
+                                           const CDriveInfo & driveInfo,
+                                           IResultsDisplayer & displayer,
+                                           IResultsDisplayer::EDirectoryLevel level);
+    bool    ProbeEntry                    (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath);
+    bool    MatchesFileSpec               (const WIN32_FIND_DATA & wfd, const CDirectoryInfo & dirInfo) const;
+    bool    IsProbeSettled                (shared_ptr<CDirectoryInfo> pDirInfo) const;
+    bool    EnqueueChildDirectory         (const WIN32_FIND_DATA & wfd, shared_ptr<CDirectoryInfo> pDirInfo, const filesystem::path & dirPath);
+    bool    ShouldFollowChildLink         (const filesystem::path & linkPath, shared_ptr<CDirectoryInfo> pDirInfo, optional<SDirectoryId> & targetId);
+    const SDirectoryId * GetNodeDirectoryId (CDirectoryInfo & dirInfo);
     void    StopWorkers();
 
+    size_t  StartWorkerPool               (void);
+    void    WaitForActiveSlot             (size_t iWorker);
+    void    SampleEnumeration             (chrono::steady_clock::duration latency);
+
+    bool    PopWithinReadAheadBudget      (size_t iWorker, WorkItem & item);
+    bool    HasReadAheadRoom              (void) const;
+    void    SetConsumerWaiting            (bool fWaiting);
+    void    ReleaseMatches                (shared_ptr<CDirectoryInfo> pDirInfo);
+    void    ReleaseSubtree                (shared_ptr<CDirectoryInfo> pDirInfo, bool fClaimed = false);
+    void    NotifyReadAheadWaiters        (void);
+
+    void    DemandNode                    (shared_ptr<CDirectoryInfo> pDirInfo);
+    void    DemandChildren                (shared_ptr<CDirectoryInfo> pDirInfo);
+
     HRESULT WaitForNodeCompletion         (shared_ptr<CDirectoryInfo> pDirInfo);
     void    SortResults                   (shared_ptr<CDirectoryInfo> pDirInfo);
     void    AccumulateTotals              (shared_ptr<CDirectoryInfo> pDirInfo, SListingTotals & totals);
@@ -68,9 +105,6 @@ private:
                                            IResultsDisplayer & displayer,
                                            SListingTotals & totals);
 
-    using ChildMap = unordered_map<wstring, shared_ptr<CDirectoryInfo>, STransparentWStringHash, std::equal_to<>>;
-    using NameSet  = unordered_set<wstring, STransparentWStringHash, std::equal_to<>>;
-
     HRESULT PrintDirectoryTreeMode        (shared_ptr<CDirectoryInfo>           pDirInfo,
                                            const CDriveInfo                   & driveInfo,
                                            CResultsDisplayerTree              & treeDisplayer,
@@ -82,11 +116,9 @@ private:
                                            CResultsDisplayerTree & treeDisplayer,
                                            SListingTotals & totals,
                                            STreeConnectorState & treeState);
-    bool    IsLastVisibleEntry            (const vector<FileInfo> & vMatches,
-                                           size_t iCurrent,
-                                           const ChildMap & childMap);
+    bool    IsTreeEntryVisible            (const CDirectoryInfo & di, const FileInfo & entry);
+    size_t  FindLastVisibleEntry          (const CDirectoryInfo & di);
     HRESULT RecurseIntoChildDirectory     (shared_ptr<CDirectoryInfo> pChild,
-                                           const FileInfo & parentEntry,
                                            bool fIsLast,
                                            const CDriveInfo & driveInfo,
                                            CResultsDisplayerTree & treeDisplayer,
@@ -94,13 +126,82 @@ private:
                                            STreeConnectorState & treeState);
 
     void    PropagateDescendantMatch      (shared_ptr<CDirectoryInfo> pDirInfo);
-    void    TrySignalParentSubtreeComplete (shared_ptr<CDirectoryInfo> pParent);
+    void    CompletePendingSubtree        (shared_ptr<CDirectoryInfo> pDirInfo);
+    void    RollUpUsage                   (CDirectoryInfo & dirInfo);
     bool    WaitForTreeVisibility         (shared_ptr<CDirectoryInfo> pDirInfo);
 
+    HRESULT PrintUsageTree                (shared_ptr<CDirectoryInfo> pRootDirInfo,
+                                           const CDriveInfo & driveInfo,
+                                           CResultsDisplayerTree & treeDisplayer,
+                                           SListingTotals & totals);
+    void    DisplayUsageChildren          (const CDirectoryInfo & dirInfo,
+                                           CResultsDisplayerTree & treeDisplayer,
+                                           STreeConnectorState & treeState);
+
     bool    StopRequested() const { return m_stopSource.stop_requested(); }
 
-    stop_source               m_stopSource;
-    CWorkQueue<WorkItem>      m_workQueue;
-    vector<jthread>           m_workers;
-    bool                      m_fTreePruningActive = false;
+    stop_source                     m_stopSource;
+    unique_ptr<IWorkQueue<WorkItem>> m_pWorkQueue;
+    unique_ptr<CFileSpecMatcher>    m_pFileSpecMatcher;
+    unique_ptr<CPathGlob>           m_pPathGlob;                     // Recursive masks only; replaces m_pFileSpecMatcher
+    vector<jthread>                 m_workers;
+    bool                            m_fTreePruningActive = false;
+    bool                            m_fTrackSubtrees     = false;    // Tree pruning or --Usage: count m_cPendingSubtrees
+    shared_ptr<CDirectoryNodePool>  m_pNodePool;                     // Nodes of the current listing
+
+    //
+    // Read-ahead budget: entries held by enumerated nodes the display has
+    // not released yet, plus one for every node found and not yet released.
+    // While the count is at the limit workers take only demanded nodes,
+    // unless the display has lifted the limit to wait on a node.
+    //
+
+    atomic<size_t>                  m_cBufferedEntries   { 0 };
+    size_t                          m_cReadAheadLimit    = 0;        // 0 = unlimited
+    mutex                           m_readAheadMutex;
+    condition_variable              m_cvReadAhead;
+    atomic<bool>                    m_fConsumerWaiting   { false };  // Set under m_readAheadMutex
+
+    //
+    // Demand scheduling: the display pushes the nodes it needs next onto
+    // the scheduler's urgent lane.  m_consumerStall is the time the display
+    // spent blocked on workers (display thread only).
+    //
+
+    bool                            m_fDemandScheduling  = true;
+    chrono::steady_clock::duration  m_consumerStall      = {};
+
+    //
+    // Worker pool sizing: workers numbered at or above m_cActiveWorkers park
+    // in WaitForActiveSlot.  With --Threads=Auto the governor moves that
+    // line from samples the workers take as they finish directories.
+    //
+
+    static constexpr size_t         s_kcAutoWorkersPerCpu = 4;
+    static constexpr size_t         s_kcMaxAutoWorkers    = 64;
+
+    atomic<size_t>                  m_cActiveWorkers      { 0 };
+    mutex                           m_parkMutex;
+    condition_variable              m_cvPark;
+    unique_ptr<CThreadPoolGovernor> m_pGovernor;                     // --Threads=Auto only
+    mutex                           m_governorMutex;
+    chrono::steady_clock::time_point m_sampleStart;                  // Guarded by m_governorMutex
+    atomic<size_t>                  m_cSampleDirectories  { 0 };
+    atomic<int64_t>                 m_cSampleLatencyTicks { 0 };     // steady_clock ticks
+
+    //
+    // Directories read and the entries they returned, whether or not
+    // anything matched (--Benchmark throughput)
+    //
+
+    atomic<size_t>                  m_cEnumeratedDirs     { 0 };
+    atomic<size_t>                  m_cEnumeratedEntries  { 0 };
+
+    //
+    // --Top=N: each worker moves the matches it finds into its own
+    // collector instead of the node, so nothing is displayed per directory
+    // and memory is bounded by N per worker.  Merged after the workers stop.
+    //
+
+    vector<unique_ptr<CTopMatches>> m_vTopMatches;                   // Indexed by worker; empty unless --Top
 };
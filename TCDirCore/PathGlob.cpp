@@ -0,0 +1,246 @@
+#include "pch.h"
+#include "PathGlob.h"
+
+
+
+
+
+static constexpr wstring_view s_kszAnyDirs = L"**";
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::IsGlobSpec
+//
+//  CMaskGrouper leaves a separator in a spec only when the mask had
+//  wildcards above its last segment.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CPathGlob::IsGlobSpec (const filesystem::path & fileSpec)
+{
+    return fileSpec.native().find_first_of (L"\\/") != wstring::npos;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::AnyGlobSpec
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CPathGlob::AnyGlobSpec (const vector<filesystem::path> & fileSpecs)
+{
+    return any_of (fileSpecs.begin(), fileSpecs.end(), [] (const filesystem::path & fileSpec)
+    {
+        return IsGlobSpec (fileSpec);
+    });
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::Compile
+//
+//  Fails if the specs have more than s_kcMaxPositions segments between
+//  them, since a directory's state must fit in one word.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CPathGlob::Compile (const vector<filesystem::path> & fileSpecs, bool fRecurse)
+{
+    HRESULT hr = S_OK;
+
+
+
+    for (const filesystem::path & fileSpec : fileSpecs)
+    {
+        hr = AddSpec (fileSpec, fRecurse);
+        CHR (hr);
+    }
+
+    m_startState = Close (m_startState);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::AddSpec
+//
+//  Appends one position per segment.  A trailing "**" means everything
+//  under it, so it gets a "*" to match the entries there.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CPathGlob::AddSpec (const filesystem::path & fileSpec, bool fRecurse)
+{
+    HRESULT         hr     = S_OK;
+    const wstring & spec   = fileSpec.native();
+    size_t          iStart = 0;
+    vector<wstring> vSegments;
+
+
+
+    if (fRecurse && !IsGlobSpec (fileSpec))
+    {
+        vSegments.emplace_back (s_kszAnyDirs);
+    }
+
+    while (iStart < spec.size())
+    {
+        size_t iEnd = (min) (spec.find_first_of (L"\\/", iStart), spec.size());
+
+        if (iEnd > iStart)
+        {
+            vSegments.emplace_back (spec, iStart, iEnd - iStart);
+        }
+
+        iStart = iEnd + 1;
+    }
+
+    if (vSegments.empty() || vSegments.back() == s_kszAnyDirs)
+    {
+        vSegments.emplace_back (L"*");
+    }
+
+    CBREx (m_vPositions.size() + vSegments.size() <= s_kcMaxPositions, E_INVALIDARG);
+
+    m_startState |= 1ull << m_vPositions.size();
+
+    for (const wstring & segment : vSegments)
+    {
+        SPosition position;
+
+        if (segment == s_kszAnyDirs)
+        {
+            m_anyDirsMask |= 1ull << m_vPositions.size();
+        }
+        else
+        {
+            position.m_pMatcher = make_unique<CFileSpecMatcher> (vector<filesystem::path> { segment });
+            m_fNeedShortNames  |= !position.m_pMatcher->MatchesAll();
+        }
+
+        m_vPositions.push_back (move (position));
+    }
+
+    m_leafMask |= 1ull << (m_vPositions.size() - 1);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::Close
+//
+//  "**" may match no directories at all, so wherever it is reached the
+//  segment after it is reached too.  A "**" is never a spec's last segment.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t CPathGlob::Close (uint64_t state) const
+{
+    uint64_t pending = state & m_anyDirsMask;
+
+
+
+    while (pending != 0)
+    {
+        uint64_t next = (pending & (0 - pending)) << 1;
+
+        state   |= next;
+        pending &= pending - 1;
+        pending |= next & m_anyDirsMask;
+    }
+
+    return state;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::Step
+//
+//  Returns the state of the subdirectory wfd of a directory in state.  A
+//  "**" takes the directory and stays put; any other segment it matches
+//  moves on to the next one.  Zero means nothing under the subdirectory
+//  can match, so it need not be read.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t CPathGlob::Step (uint64_t state, const WIN32_FIND_DATA & wfd) const
+{
+    uint64_t next = 0;
+
+
+
+    for (uint64_t pending = state & ~m_leafMask; pending != 0; pending &= pending - 1)
+    {
+        int               iPosition = countr_zero (pending);
+        const SPosition & position  = m_vPositions[iPosition];
+
+        if (!position.m_pMatcher)
+        {
+            next |= 1ull << iPosition;
+        }
+        else if (position.m_pMatcher->Matches (wfd))
+        {
+            next |= 1ull << (iPosition + 1);
+        }
+    }
+
+    return Close (next);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob::Matches
+//
+//  True if an entry of a directory in state matches the last segment of
+//  any spec that has reached it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CPathGlob::Matches (uint64_t state, const WIN32_FIND_DATA & wfd) const
+{
+    for (uint64_t pending = state & m_leafMask; pending != 0; pending &= pending - 1)
+    {
+        if (m_vPositions[countr_zero (pending)].m_pMatcher->Matches (wfd))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
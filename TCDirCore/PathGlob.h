@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FileSpecMatcher.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPathGlob
+//
+//  The file specs of a mask group that name directories as well as files:
+//  "**\*.cpp", "*\src\**\test_*".  Each spec is relative to the group's
+//  directory; "**" matches any number of directories (including none), and
+//  every other segment is a FindFirstFile-style wildcard.  A spec with no
+//  separator applies only to the group's directory, or with /S to every
+//  directory under it, as "**\spec".
+//
+//  All specs are compiled into one NFA whose positions are the segments of
+//  every spec, so the state of a directory is a bit set.  The workers carry
+//  each directory's state down the tree: a child whose state is empty
+//  cannot lead to a match and is never enqueued, and a directory's entries
+//  are matched only against the final segments its state has reached.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CPathGlob
+{
+public:
+    static constexpr size_t s_kcMaxPositions = 64;
+
+    static bool IsGlobSpec  (const filesystem::path & fileSpec);
+    static bool AnyGlobSpec (const vector<filesystem::path> & fileSpecs);
+
+    HRESULT  Compile         (const vector<filesystem::path> & fileSpecs, bool fRecurse);
+
+    uint64_t GetStartState   (void) const { return m_startState; }
+    uint64_t Step            (uint64_t state, const WIN32_FIND_DATA & wfd) const;
+    bool     Matches         (uint64_t state, const WIN32_FIND_DATA & wfd) const;
+    bool     NeedsShortNames (void) const { return m_fNeedShortNames; }
+
+
+private:
+    struct SPosition
+    {
+        unique_ptr<CFileSpecMatcher> m_pMatcher;    // nullptr for "**"
+    };
+
+    HRESULT  AddSpec (const filesystem::path & fileSpec, bool fRecurse);
+    uint64_t Close   (uint64_t state) const;
+
+    vector<SPosition> m_vPositions;
+    uint64_t          m_startState      = 0;        // First segment of each spec, closed
+    uint64_t          m_leafMask        = 0;        // Last segment of each spec: matched against entries
+    uint64_t          m_anyDirsMask     = 0;        // "**" segments
+    bool              m_fNeedShortNames = false;
+};
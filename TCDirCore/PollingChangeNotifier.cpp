@@ -0,0 +1,281 @@
+#include "pch.h"
+#include "PollingChangeNotifier.h"
+
+#include "Flag.h"
+#include "LinkFollowPolicy.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  IsSameOrBelow
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static bool IsSameOrBelow (const filesystem::path & path, const filesystem::path & dirPath)
+{
+    auto [itDir, itPath] = mismatch (dirPath.begin(), dirPath.end(), path.begin(), path.end());
+
+
+
+    return itDir == dirPath.end();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::CPollingChangeNotifier
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CPollingChangeNotifier::CPollingChangeNotifier (shared_ptr<IDirectoryEnumerator> pEnumerator, chrono::milliseconds pollInterval) :
+    m_pEnumerator  (std::move (pEnumerator)),
+    m_pollInterval (pollInterval)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::Watch
+//
+//  Records the stamp of every directory in the tree.  The first poll is one
+//  interval later.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CPollingChangeNotifier::Watch (const filesystem::path & root, bool fRecursive)
+{
+    HRESULT hr = S_OK;
+
+
+
+    m_stamps.clear();
+    m_fRecursive = fRecursive;
+
+    hr = AddDirectory (root);
+    CHR (hr);
+
+    m_nextPoll = chrono::steady_clock::now() + m_pollInterval;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::WaitForChanges
+//
+//  Polls whenever an interval has passed, sleeping in between, until
+//  something has changed or msTimeout runs out.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CPollingChangeNotifier::WaitForChanges (DWORD msTimeout, SChangeSet & changes)
+{
+    HRESULT                          hr       = S_OK;
+    chrono::steady_clock::time_point now      = chrono::steady_clock::now();
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+
+
+
+    if (msTimeout != INFINITE)
+    {
+        deadline = now + chrono::milliseconds (msTimeout);
+    }
+
+    for (;;)
+    {
+        if (now >= m_nextPoll)
+        {
+            m_nextPoll = now + m_pollInterval;
+
+            BAIL_OUT_IF (Poll (changes), S_OK);
+        }
+
+        BAIL_OUT_IF (now >= deadline, S_FALSE);
+
+        this_thread::sleep_until ((min) (m_nextPoll, deadline));
+        now = chrono::steady_clock::now();
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::AddDirectory
+//
+//  The stamp is read before the subdirectories are, so one created in
+//  between moves the stamp and is picked up by the next poll.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CPollingChangeNotifier::AddDirectory (const filesystem::path & dirPath)
+{
+    HRESULT   hr       = S_OK;
+    ULONGLONG ullStamp = 0;
+
+
+
+    hr = m_pEnumerator->GetDirectoryStamp (dirPath, ullStamp);
+    CHR (hr);
+
+    m_stamps[dirPath] = ullStamp;
+
+    if (m_fRecursive)
+    {
+        AddSubdirectories (dirPath);
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::AddSubdirectories
+//
+//  Starts watching the subdirectories of dirPath not watched yet.  Links
+//  are not entered.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CPollingChangeNotifier::AddSubdirectories (const filesystem::path & dirPath)
+{
+    HRESULT          hr = S_OK;
+    vector<wstring>  vNames;
+
+
+
+    hr = m_pEnumerator->Enumerate (dirPath, L"*", false, [&] (span<const WIN32_FIND_DATA> batch)
+    {
+        for (const WIN32_FIND_DATA & wfd : batch)
+        {
+            if (CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY) && !CLinkFollowPolicy::IsDirectoryLink (wfd))
+            {
+                vNames.push_back (wfd.cFileName);
+            }
+        }
+
+        return true;
+    });
+    IGNORE_RETURN_VALUE (hr, S_OK);
+
+    for (const wstring & strName : vNames)
+    {
+        filesystem::path subdirPath = dirPath / strName;
+
+        if (!m_stamps.contains (subdirPath))
+        {
+            hr = AddDirectory (subdirPath);
+            IGNORE_RETURN_VALUE (hr, S_OK);
+        }
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::ForgetDirectory
+//
+//  Stops watching dirPath and everything below it, which sort right after
+//  it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CPollingChangeNotifier::ForgetDirectory (const filesystem::path & dirPath)
+{
+    auto it = m_stamps.lower_bound (dirPath);
+
+
+
+    while (it != m_stamps.end() && IsSameOrBelow (it->first, dirPath))
+    {
+        it = m_stamps.erase (it);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier::Poll
+//
+//  Reports every directory whose stamp moved or that can no longer be
+//  read.  Returns true if there were any.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CPollingChangeNotifier::Poll (SChangeSet & changes)
+{
+    vector<filesystem::path> vChanged;
+    vector<filesystem::path> vGone;
+
+
+
+    for (auto & [dirPath, ullStamp] : m_stamps)
+    {
+        ULONGLONG ullCurrent = 0;
+
+        if (FAILED (m_pEnumerator->GetDirectoryStamp (dirPath, ullCurrent)))
+        {
+            vGone.push_back (dirPath);
+        }
+        else if (ullCurrent != ullStamp)
+        {
+            ullStamp = ullCurrent;
+            vChanged.push_back (dirPath);
+        }
+    }
+
+    for (const filesystem::path & dirPath : vGone)
+    {
+        ForgetDirectory (dirPath);
+        changes.m_changedDirs.insert (dirPath);
+    }
+
+    for (const filesystem::path & dirPath : vChanged)
+    {
+        if (m_fRecursive && m_stamps.contains (dirPath))
+        {
+            AddSubdirectories (dirPath);
+        }
+
+        changes.m_changedDirs.insert (dirPath);
+    }
+
+    return !vGone.empty() || !vChanged.empty();
+}
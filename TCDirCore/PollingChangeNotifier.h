@@ -0,0 +1,50 @@
+#pragma once
+
+#include "IChangeNotifier.h"
+#include "IDirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CPollingChangeNotifier
+//
+//  Watches a tree by reading the stamp (see
+//  IDirectoryEnumerator::GetDirectoryStamp) of every directory in it once
+//  per poll interval and reporting those that moved.  A directory whose
+//  stamp moved is also checked for new subdirectories, which are watched
+//  from then on; one that can no longer be read is dropped along with
+//  everything below it.
+//
+//  Works on any file system and against any enumerator, at the cost of one
+//  attribute query per directory per poll.  Stamps move when entries are
+//  added, removed, or renamed, but not when a file is rewritten in place.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CPollingChangeNotifier : public IChangeNotifier
+{
+public:
+    static constexpr chrono::milliseconds s_kDefaultPollInterval { 1000 };
+
+    explicit CPollingChangeNotifier (shared_ptr<IDirectoryEnumerator> pEnumerator, chrono::milliseconds pollInterval = s_kDefaultPollInterval);
+
+    HRESULT Watch          (const filesystem::path & root, bool fRecursive) override;
+    HRESULT WaitForChanges (DWORD msTimeout, SChangeSet & changes) override;
+
+
+
+private:
+    HRESULT AddDirectory      (const filesystem::path & dirPath);
+    void    AddSubdirectories (const filesystem::path & dirPath);
+    void    ForgetDirectory   (const filesystem::path & dirPath);
+    bool    Poll              (SChangeSet & changes);
+
+    shared_ptr<IDirectoryEnumerator>     m_pEnumerator;
+    chrono::milliseconds                 m_pollInterval;
+    chrono::steady_clock::time_point     m_nextPoll;
+    map<filesystem::path, ULONGLONG>     m_stamps;              // Every watched directory, each followed by those below it
+    bool                                 m_fRecursive = false;
+};
@@ -40,14 +40,17 @@ CResultsDisplayerBare::CResultsDisplayerBare (shared_ptr<CCommandLine> cmdLinePt
 
 void CResultsDisplayerBare::DisplayResults (const CDriveInfo & driveInfo, const CDirectoryInfo & di, EDirectoryLevel level)
 {
-    UNREFERENCED_PARAMETER (driveInfo);
-    UNREFERENCED_PARAMETER (level);
+    filesystem::path dirPath = m_cmdLinePtr->m_fRecurse ? di.DirPath() : filesystem::path();
+
 
 
+    UNREFERENCED_PARAMETER (driveInfo);
+    UNREFERENCED_PARAMETER (level);
 
     for (const FileInfo & fileInfo : di.m_vMatches)
     {
-        CConfig::SFileDisplayStyle style    = m_configPtr->GetDisplayStyleForFile (fileInfo);
+        LPCWSTR                    pszName  = di.Name (fileInfo);
+        CConfig::SFileDisplayStyle style    = m_configPtr->GetDisplayStyleForFile (fileInfo, pszName);
         WORD                       textAttr = style.m_wTextAttr;
 
         //
@@ -65,13 +68,13 @@ void CResultsDisplayerBare::DisplayResults (const CDriveInfo & driveInfo, const
         if (m_cmdLinePtr->m_fRecurse)
         {
             // When recursing, show full path
-            filesystem::path fullPath = di.m_dirPath / fileInfo.cFileName;
+            filesystem::path fullPath = dirPath / pszName;
             m_consolePtr->Printf (textAttr, L"%s\n", fullPath.c_str());
         }
         else
         {
             // Just filename
-            m_consolePtr->Printf (textAttr, L"%s\n", fileInfo.cFileName);
+            m_consolePtr->Printf (textAttr, L"%s\n", pszName);
         }
     }
 
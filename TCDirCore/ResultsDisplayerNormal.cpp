@@ -42,7 +42,7 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
 {
     HRESULT         hr                           = S_OK;
     size_t          cchStringLengthOfMaxFileSize = GetStringLengthOfMaxFileSize (di.m_uliLargestFileSize);
-    bool            fInSyncRoot                  = IsUnderSyncRoot (di.m_dirPath.c_str());
+    bool            fInSyncRoot                  = IsUnderSyncRoot (di.DirPath().c_str());
     vector<wstring> owners;
     size_t          cchMaxOwnerLength            = 0;
     
@@ -63,17 +63,18 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
 
     for (auto && [idxFile, fileInfo] : views::enumerate (di.m_vMatches))
     {
-        CConfig::SFileDisplayStyle   style       = m_configPtr->GetDisplayStyleForFile (fileInfo);
+        LPCWSTR                      pszName     = di.Name (fileInfo);
+        CConfig::SFileDisplayStyle   style       = m_configPtr->GetDisplayStyleForFile (fileInfo, pszName);
         WORD                         textAttr    = style.m_wTextAttr;
         ECloudStatus                 cloudStatus = GetCloudStatus (fileInfo, fInSyncRoot);
-        const FILETIME             & ftDisplay   = GetTimeFieldForDisplay (fileInfo);
+        FILETIME                     ftDisplay   = GetTimeFieldForDisplay (fileInfo);
 
 
 
         hr = DisplayResultsNormalDateAndTime (ftDisplay);
         CHR (hr);
 
-        DisplayResultsNormalAttributes  (fileInfo.dwFileAttributes);
+        DisplayResultsNormalAttributes  (fileInfo.m_dwAttributes);
         DisplayResultsNormalFileSize    (fileInfo, cchStringLengthOfMaxFileSize);
         DisplayCloudStatusSymbol        (cloudStatus);
 
@@ -99,9 +100,9 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
             m_consolePtr->Printf (textAttr, L"%s ", szIcon);
         }
 
-        m_consolePtr->Printf (textAttr, L"%s", fileInfo.cFileName);
+        m_consolePtr->Printf (textAttr, L"%s", pszName);
 
-        if (!fileInfo.m_strReparseTarget.empty())
+        if (fileInfo.HasReparseTarget())
         {
             bool fEllipsize = !m_cmdLinePtr->m_fEllipsize.has_value() || m_cmdLinePtr->m_fEllipsize.value();
 
@@ -118,9 +119,9 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
                     m_cmdLinePtr->m_fShowOwner,
                     cchMaxOwnerLength,
                     0,
-                    wcslen (fileInfo.cFileName));
+                    fileInfo.m_cchName);
 
-                SEllipsizedPath ellipsized = EllipsizePath (fileInfo.m_strReparseTarget, availableWidth);
+                SEllipsizedPath ellipsized = EllipsizePath (fileInfo.m_pExtras->m_strReparseTarget, availableWidth);
 
                 if (ellipsized.fTruncated)
                 {
@@ -135,7 +136,7 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
             }
             else
             {
-                m_consolePtr->Printf (textAttr, L"%s", fileInfo.m_strReparseTarget.c_str());
+                m_consolePtr->Printf (textAttr, L"%s", fileInfo.m_pExtras->m_strReparseTarget.c_str());
             }
         }
 
@@ -145,9 +146,9 @@ void CResultsDisplayerNormal::DisplayFileResults (const CDirectoryInfo & di)
         // If showing streams and this is a file (not a directory), display any alternate data streams
         //
 
-        if (m_cmdLinePtr->m_fShowStreams && !(fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        if (m_cmdLinePtr->m_fShowStreams && !fileInfo.IsDirectory())
         {
-            DisplayFileStreams (fileInfo, cchStringLengthOfMaxFileSize, cchMaxOwnerLength);
+            DisplayFileStreams (fileInfo, pszName, cchStringLengthOfMaxFileSize, cchMaxOwnerLength);
         }
     }
     
@@ -255,19 +256,19 @@ Error:
 // 
 ////////////////////////////////////////////////////////////////////////////////  
 
-const FILETIME & CResultsDisplayerNormal::GetTimeFieldForDisplay (const WIN32_FIND_DATA & wfd) const
+FILETIME CResultsDisplayerNormal::GetTimeFieldForDisplay (const FileInfo & fileInfo) const
 {
     switch (m_cmdLinePtr->m_timeField)
     {
         case CCommandLine::ETimeField::TF_CREATION:
-            return wfd.ftCreationTime;
+            return FileInfo::ToFileTime (fileInfo.m_ftCreation);
 
         case CCommandLine::ETimeField::TF_ACCESS:
-            return wfd.ftLastAccessTime;
+            return FileInfo::ToFileTime (fileInfo.m_ftLastAccess);
 
         case CCommandLine::ETimeField::TF_WRITTEN:
         default:
-            return wfd.ftLastWriteTime;
+            return FileInfo::ToFileTime (fileInfo.m_ftLastWrite);
     }
 }
 
@@ -276,7 +277,6 @@ const FILETIME & CResultsDisplayerNormal::GetTimeFieldForDisplay (const WIN32_FI
 
 
 ////////////////////////////////////////////////////////////////////////////////
-//
 //  CResultsDisplayerNormal::DisplayResultsNormalAttributes
 //
 //  Displays the file attributes
@@ -313,18 +313,13 @@ void CResultsDisplayerNormal::DisplayResultsNormalAttributes  (DWORD dwFileAttri
 //  
 ////////////////////////////////////////////////////////////////////////////////  
 
-void CResultsDisplayerNormal::DisplayResultsNormalFileSize (const WIN32_FIND_DATA & fileInfo, size_t cchStringLengthOfMaxFileSize)
+void CResultsDisplayerNormal::DisplayResultsNormalFileSize (const FileInfo & fileInfo, size_t cchStringLengthOfMaxFileSize)
 {
     static constexpr WCHAR  kszDirSize[]    = L"<DIR>";
     static constexpr size_t kcchDirSize     = ARRAYSIZE (kszDirSize) - 1;
     static constexpr size_t kcchAbbreviated = 7;
 
-    ULARGE_INTEGER uliFileSize;
-
-
 
-    uliFileSize.LowPart  = fileInfo.nFileSizeLow;
-    uliFileSize.HighPart = fileInfo.nFileSizeHigh;
 
     //
     // Abbreviated size mode (Auto): fixed 7-character field, Explorer-style
@@ -332,9 +327,9 @@ void CResultsDisplayerNormal::DisplayResultsNormalFileSize (const WIN32_FIND_DAT
 
     if (m_cmdLinePtr->m_eSizeFormat == ESizeFormat::Auto)
     {
-        if ((fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        if (!fileInfo.IsDirectory())
         {
-            m_consolePtr->Printf (CConfig::EAttribute::Size, L"  %7s", FormatAbbreviatedSize (uliFileSize.QuadPart).c_str());
+            m_consolePtr->Printf (CConfig::EAttribute::Size, L"  %7s", FormatAbbreviatedSize (fileInfo.m_cbSize).c_str());
         }
         else
         {
@@ -350,12 +345,12 @@ void CResultsDisplayerNormal::DisplayResultsNormalFileSize (const WIN32_FIND_DAT
 
     size_t cchMaxFileSize = max (cchStringLengthOfMaxFileSize, kcchDirSize);
 
-    if ((fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+    if (!fileInfo.IsDirectory())
     {
         m_consolePtr->Printf (CConfig::EAttribute::Size, 
                               L"  %*s", 
                               cchMaxFileSize, 
-                              FormatNumberWithSeparators (uliFileSize.QuadPart).c_str());
+                              FormatNumberWithSeparators (fileInfo.m_cbSize).c_str());
     }
     else
     {
@@ -544,12 +539,25 @@ void CResultsDisplayerNormal::DisplayCloudStatusSymbol (ECloudStatus status)
 // 
 ////////////////////////////////////////////////////////////////////////////////  
 
-void CResultsDisplayerNormal::DisplayRawAttributes (const WIN32_FIND_DATA & wfd)
+void CResultsDisplayerNormal::DisplayRawAttributes (const FileInfo & fileInfo)
 {
-    CF_PLACEHOLDER_STATE cfState = CfGetPlaceholderStateFromFindData (&wfd);
+    WIN32_FIND_DATA      wfd     = { };
+    CF_PLACEHOLDER_STATE cfState = CF_PLACEHOLDER_STATE_NO_STATES;
+
+
+
+    //
+    // The placeholder state is derived from only the attributes and the
+    // reparse tag, which is all FileInfo keeps.
+    //
+
+    wfd.dwFileAttributes = fileInfo.m_dwAttributes;
+    wfd.dwReserved0      = fileInfo.m_dwReparseTag;
+
+    cfState = CfGetPlaceholderStateFromFindData (&wfd);
 
     m_consolePtr->Printf (CConfig::EAttribute::Information, L"[%08X:%02X] ", 
-                          wfd.dwFileAttributes, 
+                          fileInfo.m_dwAttributes, 
                           static_cast<DWORD>(cfState));
 }
 
@@ -653,12 +661,16 @@ void CResultsDisplayerNormal::DisplayFileOwner (const wstring & owner, size_t cc
 
 void CResultsDisplayerNormal::GetFileOwners (const CDirectoryInfo & di, vector<wstring> & owners, size_t & cchMaxOwnerLength)
 {
+    filesystem::path dirPath = di.DirPath();
+
+
+
     owners.reserve (di.m_vMatches.size());
     cchMaxOwnerLength = 0;
 
     for (const auto & fileInfo : di.m_vMatches)
     {
-        filesystem::path fullPath = di.m_dirPath / fileInfo.cFileName;
+        filesystem::path fullPath = dirPath / di.Name (fileInfo);
         wstring          owner    = GetFileOwner (fullPath.c_str());
         
         cchMaxOwnerLength = max (cchMaxOwnerLength, owner.length());
@@ -679,7 +691,7 @@ void CResultsDisplayerNormal::GetFileOwners (const CDirectoryInfo & di, vector<w
 // 
 ////////////////////////////////////////////////////////////////////////////////  
 
-void CResultsDisplayerNormal::DisplayFileStreams (const FileInfo & fileEntry, size_t cchStringLengthOfMaxFileSize, size_t cchOwnerWidth)
+void CResultsDisplayerNormal::DisplayFileStreams (const FileInfo & fileEntry, LPCWSTR pszName, size_t cchStringLengthOfMaxFileSize, size_t cchOwnerWidth)
 {
     //
     // Format: indentation + size + filename:streamname
@@ -698,7 +710,12 @@ void CResultsDisplayerNormal::DisplayFileStreams (const FileInfo & fileEntry, si
     size_t  cchMaxFileSize   = max (cchStringLengthOfMaxFileSize, size_t (5));
     LPCWSTR pszCloudStatusGap = m_fIconsActive ? L"    " : L"   ";
 
-    for (const SStreamInfo & si : fileEntry.m_vStreams)
+    if (!fileEntry.HasStreams())
+    {
+        return;
+    }
+
+    for (const SStreamInfo & si : fileEntry.m_pExtras->m_vStreams)
     {
         wstring pszStreamSize   = FormatNumberWithSeparators (si.m_liSize.QuadPart);
         int     cchOwnerPadding = (cchOwnerWidth > 0) ? static_cast<int>(cchOwnerWidth + 1) : 0;
@@ -708,7 +725,7 @@ void CResultsDisplayerNormal::DisplayFileStreams (const FileInfo & fileEntry, si
                                    static_cast<int>(cchMaxFileSize), pszStreamSize.c_str(),
                                    pszCloudStatusGap,
                                    cchOwnerPadding, L"",
-                                   fileEntry.cFileName, 
+                                   pszName, 
                                    si.m_strName.c_str());
     }
 }
@@ -19,14 +19,14 @@ public:
     static size_t    ComputeAvailableWidthForTarget  (size_t cxConsoleWidth, ESizeFormat eSizeFormat, size_t cchStringLengthOfMaxFileSize, bool fIconsActive, bool fDebug, bool fShowOwner, size_t cchMaxOwnerLength, size_t cchTreePrefix, size_t cchFileName);
 
 protected:
-    const FILETIME & GetTimeFieldForDisplay          (const WIN32_FIND_DATA & wfd) const;
+    FILETIME         GetTimeFieldForDisplay          (const FileInfo & fileInfo) const;
     HRESULT          DisplayResultsNormalDateAndTime (const FILETIME & ftLastWriteTime);
     void             DisplayResultsNormalAttributes  (DWORD dwFileAttributes);
-    void             DisplayResultsNormalFileSize    (const WIN32_FIND_DATA & fileInfo, size_t cchStringLengthOfMaxFileSize);
+    void             DisplayResultsNormalFileSize    (const FileInfo & fileInfo, size_t cchStringLengthOfMaxFileSize);
     void             DisplayCloudStatusSymbol        (ECloudStatus status);
-    void             DisplayRawAttributes            (const WIN32_FIND_DATA & wfd);
+    void             DisplayRawAttributes            (const FileInfo & fileInfo);
     void             DisplayFileOwner                (const wstring & owner, size_t cchColumnWidth);
     static wstring   GetFileOwner                    (LPCWSTR pszFilePath);
     void             GetFileOwners                   (const CDirectoryInfo & di, vector<wstring> & owners, size_t & cchMaxOwnerLength);
-    virtual void     DisplayFileStreams              (const FileInfo & fileEntry, size_t cchStringLengthOfMaxFileSize, size_t cchOwnerWidth);
+    virtual void     DisplayFileStreams              (const FileInfo & fileEntry, LPCWSTR pszName, size_t cchStringLengthOfMaxFileSize, size_t cchOwnerWidth);
 };
@@ -78,7 +78,7 @@ void CResultsDisplayerTree::DisplayTreeRootHeader (const CDriveInfo & driveInfo,
     m_consolePtr->WriteSeparatorLine (m_configPtr->m_rgAttributes[CConfig::EAttribute::SeparatorLine]);
 
     DisplayDriveHeader (driveInfo);
-    DisplayPathHeader  (di.m_dirPath);
+    DisplayPathHeader  (di.DirPath());
 }
 
 
@@ -98,7 +98,7 @@ void CResultsDisplayerTree::DisplayTreeRootHeader (const CDriveInfo & driveInfo,
 void CResultsDisplayerTree::BeginDirectory (const CDirectoryInfo & di)
 {
     m_cchStringLengthOfMaxFileSize = GetStringLengthOfMaxFileSize (di.m_uliLargestFileSize);
-    m_fInSyncRoot                  = IsUnderSyncRoot (di.m_dirPath.c_str());
+    m_fInSyncRoot                  = IsUnderSyncRoot (di.DirPath().c_str());
     m_owners.clear();
     m_cchMaxOwnerLength            = 0;
 
@@ -125,14 +125,15 @@ void CResultsDisplayerTree::BeginDirectory (const CDirectoryInfo & di)
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeConnectorState & treeState, bool fIsLastEntry, size_t idxFile)
+void CResultsDisplayerTree::DisplaySingleEntry (const CDirectoryInfo & di, const FileInfo & entry, STreeConnectorState & treeState, bool fIsLastEntry, size_t idxFile)
 {
     HRESULT hr = S_OK;
 
-    CConfig::SFileDisplayStyle style       = m_configPtr->GetDisplayStyleForFile (entry);
+    LPCWSTR                    pszName     = di.Name (entry);
+    CConfig::SFileDisplayStyle style       = m_configPtr->GetDisplayStyleForFile (entry, pszName);
     WORD                       textAttr    = style.m_wTextAttr;
     ECloudStatus               cloudStatus = GetCloudStatus (entry, m_fInSyncRoot);
-    const FILETIME           & ftDisplay   = GetTimeFieldForDisplay (entry);
+    FILETIME                   ftDisplay   = GetTimeFieldForDisplay (entry);
     wstring                    prefix;
 
 
@@ -144,7 +145,7 @@ void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeCon
     hr = DisplayResultsNormalDateAndTime (ftDisplay);
     CHR (hr);
 
-    DisplayResultsNormalAttributes (entry.dwFileAttributes);
+    DisplayResultsNormalAttributes (entry.m_dwAttributes);
     DisplayResultsNormalFileSize   (entry, m_cchStringLengthOfMaxFileSize);
     DisplayCloudStatusSymbol       (cloudStatus);
 
@@ -184,9 +185,9 @@ void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeCon
     // Filename
     //
 
-    m_consolePtr->Printf (textAttr, L"%s", entry.cFileName);
+    m_consolePtr->Printf (textAttr, L"%s", pszName);
 
-    if (!entry.m_strReparseTarget.empty())
+    if (entry.HasReparseTarget())
     {
         bool fEllipsize = !m_cmdLinePtr->m_fEllipsize.has_value() || m_cmdLinePtr->m_fEllipsize.value();
 
@@ -203,9 +204,9 @@ void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeCon
                 m_cmdLinePtr->m_fShowOwner,
                 m_cchMaxOwnerLength,
                 prefix.length(),
-                wcslen (entry.cFileName));
+                entry.m_cchName);
 
-            SEllipsizedPath ellipsized = EllipsizePath (entry.m_strReparseTarget, availableWidth);
+            SEllipsizedPath ellipsized = EllipsizePath (entry.m_pExtras->m_strReparseTarget, availableWidth);
 
             if (ellipsized.fTruncated)
             {
@@ -220,7 +221,7 @@ void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeCon
         }
         else
         {
-            m_consolePtr->Printf (textAttr, L"%s", entry.m_strReparseTarget.c_str());
+            m_consolePtr->Printf (textAttr, L"%s", entry.m_pExtras->m_strReparseTarget.c_str());
         }
     }
 
@@ -230,9 +231,9 @@ void CResultsDisplayerTree::DisplaySingleEntry (const FileInfo & entry, STreeCon
     // Alternate data streams (when --Streams is active)
     //
 
-    if (m_cmdLinePtr->m_fShowStreams && !entry.m_vStreams.empty())
+    if (m_cmdLinePtr->m_fShowStreams && entry.HasStreams())
     {
-        DisplayFileStreamsWithTreePrefix (entry, treeState);
+        DisplayFileStreamsWithTreePrefix (entry, pszName, treeState);
     }
 
 
@@ -255,7 +256,7 @@ Error:
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void CResultsDisplayerTree::DisplayFileStreamsWithTreePrefix (const FileInfo & entry, const STreeConnectorState & treeState)
+void CResultsDisplayerTree::DisplayFileStreamsWithTreePrefix (const FileInfo & entry, LPCWSTR pszName, const STreeConnectorState & treeState)
 {
     wstring continuationPrefix = treeState.GetStreamContinuation();
     size_t  cchMaxFileSize     = max (m_cchStringLengthOfMaxFileSize, size_t (5));
@@ -263,7 +264,7 @@ void CResultsDisplayerTree::DisplayFileStreamsWithTreePrefix (const FileInfo & e
 
 
 
-    for (const SStreamInfo & si : entry.m_vStreams)
+    for (const SStreamInfo & si : entry.m_pExtras->m_vStreams)
     {
         wstring pszStreamSize = FormatNumberWithSeparators (si.m_liSize.QuadPart);
 
@@ -278,7 +279,7 @@ void CResultsDisplayerTree::DisplayFileStreamsWithTreePrefix (const FileInfo & e
         }
 
         m_consolePtr->Printf (CConfig::EAttribute::Stream, L"%s%s\n",
-                              entry.cFileName,
+                              pszName,
                               si.m_strName.c_str());
     }
 }
@@ -381,3 +382,71 @@ void CResultsDisplayerTree::DisplayTreeEmptyRootMessage (const CDirectoryInfo &
 
     m_consolePtr->Flush();
 }
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CResultsDisplayerTree::BeginUsage
+//
+//  Sizes the --Usage columns.  The root's totals include every other
+//  directory's, so they are the widest values shown.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CResultsDisplayerTree::BeginUsage (const CDirectoryInfo & root)
+{
+    static constexpr size_t kcchAbbreviated = 7;
+
+
+
+    if (m_cmdLinePtr->m_eSizeFormat == ESizeFormat::Auto)
+    {
+        m_cchUsageSize = kcchAbbreviated;
+    }
+    else
+    {
+        m_cchUsageSize = FormatNumberWithSeparators (root.m_cbSubtree.load (memory_order_relaxed)).size();
+    }
+
+    m_cchUsageFileCount = FormatNumberWithSeparators (root.m_cSubtreeFiles.load (memory_order_relaxed)).size();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CResultsDisplayerTree::DisplayUsageEntry
+//
+//  Displays one --Usage line: the directory's recursive size and file
+//  count, then its name behind the tree connector prefix.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CResultsDisplayerTree::DisplayUsageEntry (const CDirectoryInfo & di, LPCWSTR pszName, const STreeConnectorState & treeState, bool fIsLastEntry)
+{
+    ULONGLONG cbSubtree = di.m_cbSubtree.load (memory_order_relaxed);
+    UINT      cFiles    = di.m_cSubtreeFiles.load (memory_order_relaxed);
+    wstring   prefix    = treeState.GetPrefix (fIsLastEntry);
+    wstring   size      = (m_cmdLinePtr->m_eSizeFormat == ESizeFormat::Auto) ? FormatAbbreviatedSize (cbSubtree)
+                                                                             : FormatNumberWithSeparators (cbSubtree);
+
+
+
+    m_consolePtr->Printf (CConfig::EAttribute::Size,        L"  %*s", m_cchUsageSize, size.c_str());
+    m_consolePtr->Printf (CConfig::EAttribute::Information, L"  %*s %s  ",
+                          m_cchUsageFileCount,
+                          FormatNumberWithSeparators (cFiles).c_str(),
+                          cFiles == 1 ? L"file " : L"files");
+
+    if (!prefix.empty())
+    {
+        m_consolePtr->Printf (CConfig::EAttribute::TreeConnector, L"%s", prefix.c_str());
+    }
+
+    m_consolePtr->Printf (CConfig::EAttribute::Directory, L"%s\n", pszName);
+}
@@ -48,13 +48,23 @@ public:
 
     void DisplayTreeRootHeader          (const CDriveInfo & driveInfo, const CDirectoryInfo & di);
     void BeginDirectory                 (const CDirectoryInfo & di);
-    void DisplaySingleEntry             (const FileInfo & entry, STreeConnectorState & treeState, bool fIsLastEntry, size_t idxFile);
-    void DisplayFileStreamsWithTreePrefix (const FileInfo & entry, const STreeConnectorState & treeState);
+    void DisplaySingleEntry             (const CDirectoryInfo & di, const FileInfo & entry, STreeConnectorState & treeState, bool fIsLastEntry, size_t idxFile);
+    void DisplayFileStreamsWithTreePrefix (const FileInfo & entry, LPCWSTR pszName, const STreeConnectorState & treeState);
     void DisplayTreeRootSummary();
     void DisplayTreeEmptyRootMessage    (const CDirectoryInfo & di);
 
 
 
+    //
+    // --Usage display methods: one line per directory with its recursive
+    // size and file count
+    //
+
+    void BeginUsage                     (const CDirectoryInfo & root);
+    void DisplayUsageEntry              (const CDirectoryInfo & di, LPCWSTR pszName, const STreeConnectorState & treeState, bool fIsLastEntry);
+
+
+
     //
     // Per-directory state snapshot used to save/restore across recursive
     // child directory calls that overwrite the member variables.
@@ -82,4 +92,11 @@ private:
     bool            m_fInSyncRoot                  = false;
     vector<wstring> m_owners;
     size_t          m_cchMaxOwnerLength            = 0;
+
+    //
+    // --Usage column widths set by BeginUsage()
+    //
+
+    size_t          m_cchUsageSize                 = 0;
+    size_t          m_cchUsageFileCount            = 0;
 };
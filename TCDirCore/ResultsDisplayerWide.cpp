@@ -37,9 +37,9 @@ CResultsDisplayerWide::CResultsDisplayerWide (shared_ptr<CCommandLine> cmdLinePt
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-size_t CResultsDisplayerWide::ComputeDisplayWidth (const WIN32_FIND_DATA & wfd, bool fIconsActive, bool fIconSuppressed, bool fInSyncRoot)
+size_t CResultsDisplayerWide::ComputeDisplayWidth (const FileInfo & fileInfo, bool fIconsActive, bool fIconSuppressed, bool fInSyncRoot)
 {
-    size_t cch = wcslen (wfd.cFileName);
+    size_t cch = fileInfo.m_cchName;
 
 
 
@@ -47,7 +47,7 @@ size_t CResultsDisplayerWide::ComputeDisplayWidth (const WIN32_FIND_DATA & wfd,
     // Directories get [brackets] when icons are off
     //
 
-    if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !fIconsActive)
+    if (fileInfo.IsDirectory() && !fIconsActive)
     {
         cch += 2;
     }
@@ -332,7 +332,7 @@ SColumnLayout CResultsDisplayerWide::TryColumnCount (const vector<size_t> & vEff
 void CResultsDisplayerWide::DisplayFileResults (const CDirectoryInfo & di)
 {                                 
     HRESULT        hr          = S_OK;
-    bool           fInSyncRoot = IsUnderSyncRoot (di.m_dirPath.c_str());
+    bool           fInSyncRoot = IsUnderSyncRoot (di.DirPath().c_str());
     bool           fEllipsize  = !m_cmdLinePtr->m_fEllipsize.has_value() || m_cmdLinePtr->m_fEllipsize.value();
     vector<size_t> vDisplayWidths;
     SColumnLayout  layout;
@@ -349,7 +349,7 @@ void CResultsDisplayerWide::DisplayFileResults (const CDirectoryInfo & di)
 
     for (const auto & fi : di.m_vMatches)
     {
-        CConfig::SFileDisplayStyle style = m_configPtr->GetDisplayStyleForFile (fi);
+        CConfig::SFileDisplayStyle style = m_configPtr->GetDisplayStyleForFile (fi, di.Name (fi));
         bool fIconSuppressed = style.m_fIconSuppressed || style.m_iconCodePoint == 0;
 
         vDisplayWidths.push_back (ComputeDisplayWidth (fi, m_fIconsActive, fIconSuppressed, fInSyncRoot));
@@ -400,7 +400,7 @@ void CResultsDisplayerWide::DisplayFileResults (const CDirectoryInfo & di)
 
             size_t cxColWidth = (nCol < layout.cColumns - 1) ? layout.vColumnWidths[nCol] : 0;
 
-            hr = DisplayFile (di.m_vMatches[idx], cxColWidth, layout.cchTruncCap, fInSyncRoot);
+            hr = DisplayFile (di.m_vMatches[idx], di.Name (di.m_vMatches[idx]), cxColWidth, layout.cchTruncCap, fInSyncRoot);
             CHR (hr);
         }
 
@@ -425,12 +425,12 @@ Error:
 //
 ////////////////////////////////////////////////////////////////////////////////  
 
-HRESULT CResultsDisplayerWide::DisplayFile (const WIN32_FIND_DATA & wfd, size_t cxColumnWidth, size_t cchTruncCap, bool fInSyncRoot)
+HRESULT CResultsDisplayerWide::DisplayFile (const FileInfo & fileInfo, LPCWSTR pszName, size_t cxColumnWidth, size_t cchTruncCap, bool fInSyncRoot)
 {
     WCHAR                        szDirName[MAX_PATH + 3]; // '[' + MAX_PATH + ']' + '\0'
-    CConfig::SFileDisplayStyle   style    = m_configPtr->GetDisplayStyleForFile (wfd);
+    CConfig::SFileDisplayStyle   style    = m_configPtr->GetDisplayStyleForFile (fileInfo, pszName);
     WORD                         textAttr = style.m_wTextAttr;
-    wstring_view                 name     = GetWideFormattedName (wfd, szDirName, ARRAYSIZE (szDirName));
+    wstring_view                 name     = GetWideFormattedName (fileInfo, pszName, szDirName, ARRAYSIZE (szDirName));
     size_t                       cchName  = name.length();
     wstring                      strTruncated;
 
@@ -442,7 +442,7 @@ HRESULT CResultsDisplayerWide::DisplayFile (const WIN32_FIND_DATA & wfd, size_t
 
     if (fInSyncRoot)
     {
-        ECloudStatus cloudStatus = GetCloudStatus (wfd, fInSyncRoot);
+        ECloudStatus cloudStatus = GetCloudStatus (fileInfo, fInSyncRoot);
 
         if (m_fIconsActive)
         {
@@ -540,20 +540,16 @@ HRESULT CResultsDisplayerWide::DisplayFile (const WIN32_FIND_DATA & wfd, size_t
 //
 ////////////////////////////////////////////////////////////////////////////////  
 
-wstring_view CResultsDisplayerWide::GetWideFormattedName (const WIN32_FIND_DATA & wfd, LPWSTR pszBuffer, size_t cchBuffer)
+wstring_view CResultsDisplayerWide::GetWideFormattedName (const FileInfo & fileInfo, LPCWSTR pszName, LPWSTR pszBuffer, size_t cchBuffer)
 {
-    LPCWSTR pszName = wfd.cFileName;
-
-
-
     //
     // Directories: use [name] brackets in classic mode, plain name when icons active
     // (the folder icon provides the distinction)
     //
 
-    if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !m_fIconsActive)
+    if (fileInfo.IsDirectory() && !m_fIconsActive)
     {
-        auto [out, _] = format_to_n (pszBuffer, cchBuffer - 1, L"[{}]", wfd.cFileName);
+        auto [out, _] = format_to_n (pszBuffer, cchBuffer - 1, L"[{}]", pszName);
         *out    = L'\0';
         pszName = pszBuffer;
     }
@@ -38,13 +38,13 @@ public:
     // Pure helper functions — public for unit testing
     //
 
-    static size_t        ComputeDisplayWidth        (const WIN32_FIND_DATA & wfd, bool fIconsActive, bool fIconSuppressed, bool fInSyncRoot);
+    static size_t        ComputeDisplayWidth        (const FileInfo & fileInfo, bool fIconsActive, bool fIconSuppressed, bool fInSyncRoot);
     static SColumnLayout ComputeColumnLayout         (const vector<size_t> & vDisplayWidths, size_t cxConsoleWidth, bool fEllipsize);
     static size_t        ComputeMedianDisplayWidth   (vector<size_t> vDisplayWidths);
 
 protected:
-    HRESULT      DisplayFile          (const WIN32_FIND_DATA & wfd, size_t cxColumnWidth, size_t cchTruncCap, bool fInSyncRoot);
-    wstring_view GetWideFormattedName (const WIN32_FIND_DATA & wfd, LPWSTR pszBuffer, size_t cchBuffer);
+    HRESULT      DisplayFile          (const FileInfo & fileInfo, LPCWSTR pszName, size_t cxColumnWidth, size_t cchTruncCap, bool fInSyncRoot);
+    wstring_view GetWideFormattedName (const FileInfo & fileInfo, LPCWSTR pszName, LPWSTR pszBuffer, size_t cchBuffer);
 
 private:
     static SColumnLayout TryColumnCount (const vector<size_t> & vEffective, size_t cxConsoleWidth, size_t nCols);
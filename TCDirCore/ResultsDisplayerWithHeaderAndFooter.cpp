@@ -79,7 +79,7 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayResults (const CDriveInfo & dr
         DisplayDriveHeader (driveInfo);
     }
 
-    DisplayPathHeader (di.m_dirPath); 
+    DisplayPathHeader (di.DirPath()); 
 
     if (di.m_vMatches.size() == 0)
     {
@@ -221,22 +221,26 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayPathHeader (const filesystem::
 
 void CResultsDisplayerWithHeaderAndFooter::DisplayEmptyDirectoryMessage (const CDirectoryInfo & di)
 {
+    const vector<filesystem::path> & vFileSpecs = di.FileSpecs();
+
+
+
     //
     // If all specs are "*", show "Directory is empty"
     // Otherwise, show "No files matching..." with the spec(s)
     //
 
-    bool fAllStar = all_of (di.m_vFileSpecs.begin(), di.m_vFileSpecs.end(),
+    bool fAllStar = all_of (vFileSpecs.begin(), vFileSpecs.end(),
                             [](const auto & spec) { return spec == L"*"; });
 
     if (fAllStar)
     {
         m_consolePtr->Puts (CConfig::EAttribute::Default, L"Directory is empty.");
     }
-    else if (di.m_vFileSpecs.size() == 1)
+    else if (vFileSpecs.size() == 1)
     {
         m_consolePtr->Printf (CConfig::EAttribute::Default, L"No files matching '%s' found.\n", 
-                              di.m_vFileSpecs[0].c_str());
+                              vFileSpecs[0].c_str());
     }
     else
     {
@@ -246,14 +250,14 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayEmptyDirectoryMessage (const C
 
         wstring specs;
 
-        for (size_t i = 0; i < di.m_vFileSpecs.size(); ++i)
+        for (size_t i = 0; i < vFileSpecs.size(); ++i)
         {
             if (i > 0)
             {
                 specs += L", ";
             }
 
-            specs += di.m_vFileSpecs[i].wstring();
+            specs += vFileSpecs[i].wstring();
         }
 
         m_consolePtr->Printf (CConfig::EAttribute::Default, L"No files matching '%s' found.\n", 
@@ -275,6 +279,7 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayEmptyDirectoryMessage (const C
 //         143 files using 123,456 bytes
 //           3 streams using 1,234 bytes (if streams found)
 //           7 subdirectories
+//           2 links not followed (if --Follow pruned any)
 // 
 //   123,123,123,123 bytes free on volume
 //   123,117,699,072 bytes available to user %s
@@ -308,6 +313,13 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayListingSummary (const CDirecto
                                    totals.m_uliStreamBytes.QuadPart == 1 ? L" byte" : L" bytes");
     }
 
+    if (totals.m_cPrunedLinks > 0)
+    {
+        m_consolePtr->ColorPrintf (L"{InformationHighlight}    %*s{Information}%s\n",
+                                   cMaxDigits, FormatNumberWithSeparators (totals.m_cPrunedLinks).c_str(),
+                                   totals.m_cPrunedLinks == 1 ? L" link not followed" : L" links not followed");
+    }
+
     DisplayVolumeFooter (di);
 
     m_consolePtr->WriteSeparatorLine (m_configPtr->m_rgAttributes[CConfig::EAttribute::SeparatorLine]);
@@ -376,7 +388,7 @@ void CResultsDisplayerWithHeaderAndFooter::DisplayVolumeFooter (const CDirectory
 
     
 
-    fSuccess = GetDiskFreeSpaceEx (di.m_dirPath.c_str(), &uliFreeBytesAvailable, &uliTotalBytes, &uliTotalFreeBytes);
+    fSuccess = GetDiskFreeSpaceEx (di.DirPath().c_str(), &uliFreeBytesAvailable, &uliTotalBytes, &uliTotalFreeBytes);
     CBRA (fSuccess);
 
     m_consolePtr->ColorPrintf (L"{InformationHighlight} %s{Information}%s\n",
@@ -532,7 +544,7 @@ bool CResultsDisplayerWithHeaderAndFooter::IsUnderSyncRoot (LPCWSTR pszPath)
 // 
 ////////////////////////////////////////////////////////////////////////////////  
 
-ECloudStatus CResultsDisplayerWithHeaderAndFooter::GetCloudStatus (const WIN32_FIND_DATA & wfd, bool fInSyncRoot)
+ECloudStatus CResultsDisplayerWithHeaderAndFooter::GetCloudStatus (const FileInfo & fileInfo, bool fInSyncRoot)
 {
     ECloudStatus status = ECloudStatus::CS_NONE;
 
@@ -546,19 +558,19 @@ ECloudStatus CResultsDisplayerWithHeaderAndFooter::GetCloudStatus (const WIN32_F
         return status;
     }
 
-    if (wfd.dwFileAttributes & FILE_ATTRIBUTE_PINNED)
+    if (fileInfo.m_dwAttributes & FILE_ATTRIBUTE_PINNED)
     {
         // Pinned takes priority - always available locally
         status = ECloudStatus::CS_PINNED;
     }
-    else if (wfd.dwFileAttributes & (FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS | 
-                                     FILE_ATTRIBUTE_RECALL_ON_OPEN | 
-                                     FILE_ATTRIBUTE_OFFLINE))
+    else if (fileInfo.m_dwAttributes & (FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS | 
+                                        FILE_ATTRIBUTE_RECALL_ON_OPEN | 
+                                        FILE_ATTRIBUTE_OFFLINE))
     {
         // Cloud-only: placeholder that requires download
         status = ECloudStatus::CS_CLOUD_ONLY;
     }
-    else if (wfd.dwFileAttributes & FILE_ATTRIBUTE_UNPINNED)
+    else if (fileInfo.m_dwAttributes & FILE_ATTRIBUTE_UNPINNED)
     {
         // Unpinned means locally available but can be dehydrated
         status = ECloudStatus::CS_LOCAL;
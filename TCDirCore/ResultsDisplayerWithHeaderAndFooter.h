@@ -52,7 +52,7 @@ protected:
     wstring FormatNumberWithSeparators              (ULONGLONG n);
 
     static bool         IsUnderSyncRoot            (LPCWSTR pszPath);
-    static ECloudStatus GetCloudStatus             (const WIN32_FIND_DATA & wfd, bool fInSyncRoot);
+    static ECloudStatus GetCloudStatus             (const FileInfo & fileInfo, bool fInSyncRoot);
 
     shared_ptr<CCommandLine> m_cmdLinePtr; 
     shared_ptr<CConsole>     m_consolePtr;
@@ -0,0 +1,628 @@
+#include "pch.h"
+#include "Snapshot.h"
+
+#include "CaseFolding.h"
+#include "DirectoryInfo.h"
+#include "Flag.h"
+#include "LinkFollowPolicy.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot::CompareNames
+//
+//  Orders names as the listing's ordinal sort does; names that differ only
+//  in case (possible in a case-sensitive directory) are then ordered by
+//  their exact code units, so no two entries of a directory compare equal.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int CSnapshot::CompareNames (wstring_view lhs, wstring_view rhs)
+{
+    int iCmp = CCaseFolding::CompareOrdinalIgnoreCase (lhs, rhs);
+
+
+
+    if (iCmp == 0)
+    {
+        iCmp = lhs.compare (rhs);
+    }
+
+    return iCmp;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot::ComparePaths
+//
+//  Compares relative paths a component at a time, a path sorting before
+//  every path it is a prefix of.  Comparing whole strings instead would put
+//  "a.txt" between directory "a" and "a\b", since '.' sorts before '\'.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int CSnapshot::ComparePaths (wstring_view lhs, wstring_view rhs)
+{
+    for (;;)
+    {
+        size_t cchLhs = (std::min) (lhs.find (L'\\'), lhs.size());
+        size_t cchRhs = (std::min) (rhs.find (L'\\'), rhs.size());
+        int    iCmp   = CompareNames (lhs.substr (0, cchLhs), rhs.substr (0, cchRhs));
+
+
+
+        if (iCmp != 0)
+        {
+            return iCmp;
+        }
+
+        if (cchLhs == lhs.size() || cchRhs == rhs.size())
+        {
+            return (cchLhs == lhs.size() && cchRhs == rhs.size()) ? 0 : (cchLhs == lhs.size()) ? -1 : 1;
+        }
+
+        lhs.remove_prefix (cchLhs + 1);
+        rhs.remove_prefix (cchRhs + 1);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot::IsChanged
+//
+//  A directory's last-write time moves whenever its contents do, which the
+//  entries below it already report, so only its attributes are compared.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CSnapshot::IsChanged (const SSnapshotEntry & oldEntry, const SSnapshotEntry & newEntry)
+{
+    if (oldEntry.m_dwAttributes != newEntry.m_dwAttributes)
+    {
+        return true;
+    }
+
+    return !newEntry.IsDirectory() &&
+           (oldEntry.m_cbSize != newEntry.m_cbSize || oldEntry.m_ftLastWrite != newEntry.m_ftLastWrite);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot::Diff
+//
+//  Merge-joins the two sources, both in snapshot order.  An entry only in
+//  oldSource was removed, one only in newSource added, and one in both is
+//  reported (with its new values) if IsChanged.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshot::Diff (ISnapshotSource & oldSource, ISnapshotSource & newSource, const ChangeCallback & onChange)
+{
+    HRESULT        hr    = S_OK;
+    HRESULT        hrOld = S_OK;
+    HRESULT        hrNew = S_OK;
+    SSnapshotEntry oldEntry;
+    SSnapshotEntry newEntry;
+
+
+
+    hrOld = oldSource.Next (oldEntry);
+    CHR (hrOld);
+
+    hrNew = newSource.Next (newEntry);
+    CHR (hrNew);
+
+    while (hrOld == S_OK || hrNew == S_OK)
+    {
+        int iCmp = (hrOld != S_OK) ?  1 :
+                   (hrNew != S_OK) ? -1 :
+                   ComparePaths (oldEntry.m_strPath, newEntry.m_strPath);
+
+
+
+        if (iCmp < 0)
+        {
+            onChange (EChange::Removed, oldEntry);
+        }
+        else if (iCmp > 0)
+        {
+            onChange (EChange::Added, newEntry);
+        }
+        else if (IsChanged (oldEntry, newEntry))
+        {
+            onChange (EChange::Changed, newEntry);
+        }
+
+        if (iCmp <= 0)
+        {
+            hrOld = oldSource.Next (oldEntry);
+            CHR (hrOld);
+        }
+
+        if (iCmp >= 0)
+        {
+            hrNew = newSource.Next (newEntry);
+            CHR (hrNew);
+        }
+    }
+
+    hr = S_OK;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot::IsSnapshot
+//
+//  True if file starts with a committed snapshot header of this version.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CSnapshot::IsSnapshot (const filesystem::path & file)
+{
+    SFileHeader header = {};
+    DWORD       cbRead = 0;
+    AutoHandle  hFile  = CreateFileW (file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+
+
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    return ReadFile (hFile, &header, sizeof (header), &cbRead, nullptr) &&
+           cbRead             == sizeof (header) &&
+           header.m_dwMagic   == s_kdwMagic      &&
+           header.m_dwVersion == s_kdwVersion;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter::Create
+//
+//  Starts the file with a placeholder header (no magic) and the root.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotWriter::Create (const filesystem::path & file, const filesystem::path & root)
+{
+    HRESULT       hr      = S_OK;
+    SFileHeader   header  = {};
+    const wstring strRoot = root.wstring();
+
+
+
+    m_hFile = CreateFileW (file.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    CWR (m_hFile != INVALID_HANDLE_VALUE);
+
+    m_vBuffer.reserve (s_kcbBuffer);
+
+    m_cchRoot        = static_cast<UINT> (strRoot.size());
+    header.m_cchRoot = m_cchRoot;
+
+    hr = Write (&header, sizeof (header));
+    CHR (hr);
+
+    hr = Write (strRoot.data(), strRoot.size() * sizeof (wchar_t));
+    CHR (hr);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter::Add
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotWriter::Add (const SSnapshotEntry & entry)
+{
+    HRESULT         hr        = S_OK;
+    const wstring & strPath   = entry.m_strPath;
+    SRecordHeader   record    = {};
+    size_t          cchShared = 0;
+
+
+
+    CBRAEx (m_cEntries == 0 || ComparePaths (m_strPrevious, strPath) < 0, E_UNEXPECTED);
+    CBREx  (strPath.size() <= USHRT_MAX, HRESULT_FROM_WIN32 (ERROR_FILENAME_EXCED_RANGE));
+
+    cchShared = static_cast<size_t> (mismatch (strPath.begin(), strPath.begin() + (std::min) (strPath.size(), m_strPrevious.size()), m_strPrevious.begin()).first - strPath.begin());
+
+    record.m_cbSize       = entry.m_cbSize;
+    record.m_ftCreation   = entry.m_ftCreation;
+    record.m_ftLastWrite  = entry.m_ftLastWrite;
+    record.m_dwAttributes = entry.m_dwAttributes;
+    record.m_cchShared    = static_cast<USHORT> (cchShared);
+    record.m_cchSuffix    = static_cast<USHORT> (strPath.size() - cchShared);
+
+    hr = Write (&record, sizeof (record));
+    CHR (hr);
+
+    hr = Write (strPath.data() + cchShared, record.m_cchSuffix * sizeof (wchar_t));
+    CHR (hr);
+
+    m_strPrevious = strPath;
+    ++m_cEntries;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter::Commit
+//
+//  Writes out the last of the records, then the real header, and closes
+//  the file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotWriter::Commit (void)
+{
+    HRESULT       hr        = S_OK;
+    SFileHeader   header    = { s_kdwMagic, s_kdwVersion, m_cEntries, m_cchRoot, 0 };
+    LARGE_INTEGER liPos     = {};
+    DWORD         cbWritten = 0;
+
+
+
+    hr = Flush();
+    CHR (hr);
+
+    CWR (SetFilePointerEx (m_hFile, liPos, nullptr, FILE_BEGIN));
+    CWR (WriteFile (m_hFile, &header, sizeof (header), &cbWritten, nullptr));
+    CBRAEx (cbWritten == sizeof (header), HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+
+    m_hFile = AutoHandle();
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter::Write
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotWriter::Write (const void * pData, size_t cb)
+{
+    HRESULT hr = S_OK;
+
+
+
+    if (m_vBuffer.size() + cb > s_kcbBuffer)
+    {
+        hr = Flush();
+        CHR (hr);
+    }
+
+    m_vBuffer.insert (m_vBuffer.end(), static_cast<const BYTE *> (pData), static_cast<const BYTE *> (pData) + cb);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter::Flush
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotWriter::Flush (void)
+{
+    HRESULT hr        = S_OK;
+    DWORD   cbWritten = 0;
+
+
+
+    CWR (WriteFile (m_hFile, m_vBuffer.data(), static_cast<DWORD> (m_vBuffer.size()), &cbWritten, nullptr));
+    CBRAEx (cbWritten == m_vBuffer.size(), HRESULT_FROM_WIN32 (ERROR_WRITE_FAULT));
+
+    m_vBuffer.clear();
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotReader::Open
+//
+//  Maps the whole file read-only; the records are then read in one
+//  sequential pass by Next.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotReader::Open (const filesystem::path & file)
+{
+    HRESULT       hr      = S_OK;
+    LARGE_INTEGER liSize  = {};
+    SFileHeader   header  = {};
+    const BYTE  * pBase   = nullptr;
+    ULONGLONG     cbRoot  = 0;
+
+
+
+    m_hFile = CreateFileW (file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    CWR (m_hFile != INVALID_HANDLE_VALUE);
+
+    CWR (GetFileSizeEx (m_hFile, &liSize));
+    CBREx (static_cast<ULONGLONG> (liSize.QuadPart) >= sizeof (SFileHeader), HRESULT_FROM_WIN32 (ERROR_BAD_FORMAT));
+
+    m_hMapping = CreateFileMappingW (m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CWR (m_hMapping != nullptr);
+
+    m_pView = MapViewOfFile (m_hMapping, FILE_MAP_READ, 0, 0, 0);
+    CWR (m_pView != nullptr);
+
+    pBase = static_cast<const BYTE *> (static_cast<LPVOID> (m_pView));
+    memcpy (&header, pBase, sizeof (header));
+
+    cbRoot = static_cast<ULONGLONG> (header.m_cchRoot) * sizeof (wchar_t);
+
+    CBREx (header.m_dwMagic   == s_kdwMagic   &&
+           header.m_dwVersion == s_kdwVersion &&
+           sizeof (header) + cbRoot <= static_cast<ULONGLONG> (liSize.QuadPart), HRESULT_FROM_WIN32 (ERROR_BAD_FORMAT));
+
+    m_root  = wstring (reinterpret_cast<const wchar_t *> (pBase + sizeof (header)), header.m_cchRoot);
+    m_pNext = pBase + sizeof (header) + cbRoot;
+    m_pEnd  = pBase + liSize.QuadPart;
+    m_cLeft = header.m_cEntries;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotReader::Next
+//
+//  Decodes the next record: the previous path cut to the shared length,
+//  plus the stored suffix.  Records are not aligned, so the fixed part is
+//  copied out rather than read in place.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotReader::Next (SSnapshotEntry & entry)
+{
+    HRESULT       hr     = S_OK;
+    SRecordHeader record = {};
+
+
+
+    BAIL_OUT_IF (m_cLeft == 0, S_FALSE);
+
+    CBREx (static_cast<size_t> (m_pEnd - m_pNext) >= sizeof (record), HRESULT_FROM_WIN32 (ERROR_FILE_CORRUPT));
+    memcpy (&record, m_pNext, sizeof (record));
+    m_pNext += sizeof (record);
+
+    CBREx (record.m_cchShared <= m_strPath.size() &&
+           static_cast<size_t> (m_pEnd - m_pNext) >= record.m_cchSuffix * sizeof (wchar_t), HRESULT_FROM_WIN32 (ERROR_FILE_CORRUPT));
+
+    m_strPath.resize (record.m_cchShared);
+    m_strPath.append (reinterpret_cast<const wchar_t *> (m_pNext), record.m_cchSuffix);
+    m_pNext += record.m_cchSuffix * sizeof (wchar_t);
+    --m_cLeft;
+
+    entry.m_strPath      = m_strPath;
+    entry.m_cbSize       = record.m_cbSize;
+    entry.m_ftCreation   = record.m_ftCreation;
+    entry.m_ftLastWrite  = record.m_ftLastWrite;
+    entry.m_dwAttributes = record.m_dwAttributes;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLiveSnapshotSource::CLiveSnapshotSource
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CLiveSnapshotSource::CLiveSnapshotSource (shared_ptr<IDirectoryEnumerator> pEnumerator, filesystem::path root) :
+    m_pEnumerator (move (pEnumerator)),
+    m_root        (move (root))
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLiveSnapshotSource::Next
+//
+//  Hands out the next entry of the innermost directory, reading a
+//  subdirectory's entries as soon as the subdirectory itself is handed
+//  out so they come next.  Only a failure to read the root is an error.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CLiveSnapshotSource::Next (SSnapshotEntry & entry)
+{
+    HRESULT hr     = S_OK;
+    bool    fEnter = false;
+
+
+
+    if (!m_fStarted)
+    {
+        m_fStarted = true;
+
+        hr = ReadDirectory (wstring());
+        CHR (hr);
+    }
+
+    while (!m_vStack.empty() && m_vStack.back().m_iNext == m_vStack.back().m_vEntries.size())
+    {
+        m_vStack.pop_back();
+    }
+
+    BAIL_OUT_IF (m_vStack.empty(), S_FALSE);
+
+    {
+        SFrame           & frame = m_vStack.back();
+        const SLiveEntry & live  = frame.m_vEntries[frame.m_iNext++];
+
+
+
+        entry.m_strPath = frame.m_strDir;
+
+        if (!entry.m_strPath.empty())
+        {
+            entry.m_strPath += L'\\';
+        }
+
+        entry.m_strPath     += live.m_strName;
+        entry.m_cbSize       = live.m_cbSize;
+        entry.m_ftCreation   = live.m_ftCreation;
+        entry.m_ftLastWrite  = live.m_ftLastWrite;
+        entry.m_dwAttributes = live.m_dwAttributes;
+        fEnter               = live.m_fEnter;
+    }
+
+    // Pushing the subdirectory's frame may move the one entry came from
+    if (fEnter)
+    {
+        hr = ReadDirectory (entry.m_strPath);
+        IGNORE_RETURN_VALUE (hr, S_OK);
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLiveSnapshotSource::ReadDirectory
+//
+//  Reads and sorts one directory's entries and pushes them as a frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CLiveSnapshotSource::ReadDirectory (const wstring & strDir)
+{
+    HRESULT hr    = S_OK;
+    SFrame  frame;
+
+
+
+    frame.m_strDir = strDir;
+
+    hr = m_pEnumerator->Enumerate (m_root / strDir, L"*", false, [&] (span<const WIN32_FIND_DATA> batch)
+    {
+        for (const WIN32_FIND_DATA & wfd : batch)
+        {
+            frame.m_vEntries.push_back (SLiveEntry {
+                wfd.cFileName,
+                FileInfo::PackULongLong (wfd.nFileSizeHigh,                   wfd.nFileSizeLow),
+                FileInfo::PackULongLong (wfd.ftCreationTime.dwHighDateTime,   wfd.ftCreationTime.dwLowDateTime),
+                FileInfo::PackULongLong (wfd.ftLastWriteTime.dwHighDateTime,  wfd.ftLastWriteTime.dwLowDateTime),
+                wfd.dwFileAttributes,
+                CFlag::IsSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY) && !CLinkFollowPolicy::IsDirectoryLink (wfd) });
+        }
+
+        return true;
+    });
+
+    // Nothing matching "*" is an empty directory, not an error
+    if (hr == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND))
+    {
+        hr = S_OK;
+    }
+
+    CHR (hr);
+
+    sort (frame.m_vEntries.begin(), frame.m_vEntries.end(), [] (const SLiveEntry & lhs, const SLiveEntry & rhs)
+    {
+        return CSnapshot::CompareNames (lhs.m_strName, rhs.m_strName) < 0;
+    });
+
+    m_vStack.push_back (move (frame));
+
+
+
+Error:
+    return hr;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "AutoHandle.h"
+#include "IDirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  SSnapshotEntry
+//
+//  One entry of a recursive listing, named by its path relative to the
+//  listing root ("sub\file.txt").
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct SSnapshotEntry
+{
+    wstring   m_strPath;
+    ULONGLONG m_cbSize       = 0;
+    ULONGLONG m_ftCreation   = 0;
+    ULONGLONG m_ftLastWrite  = 0;
+    DWORD     m_dwAttributes = 0;
+
+    bool IsDirectory (void) const
+    {
+        return (m_dwAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    }
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  ISnapshotSource
+//
+//  A recursive listing read one entry at a time in snapshot order (see
+//  CSnapshot::ComparePaths): a snapshot file, or a directory tree being
+//  enumerated.  Next returns S_FALSE once there are no more entries.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class ISnapshotSource
+{
+public:
+    virtual ~ISnapshotSource (void) = default;
+
+    virtual HRESULT Next (SSnapshotEntry & entry) = 0;
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshot
+//
+//  --Snapshot and --Diff.  A snapshot file is a header, the listing root,
+//  and one record per entry in snapshot order.  Paths compare a component
+//  at a time, so each directory is followed by everything under it, and a
+//  tree walked depth-first with each directory's entries sorted by name
+//  comes out already in order: neither writing nor diffing ever sorts more
+//  than one directory at a time.
+//
+//  Each record stores only the part of its path that differs from the
+//  previous record's (sorted neighbours share most of their paths), so a
+//  file is read front to back: sequentially through a read-only mapping,
+//  whose pages the system can drop as soon as they have been passed.
+//
+//  Diff merge-joins two sources in one pass, holding one entry from each.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CSnapshot
+{
+public:
+    enum class EChange
+    {
+        Added,
+        Removed,
+        Changed         // Attributes, or for a file its size or last-write time
+    };
+
+    using ChangeCallback = function<void (EChange change, const SSnapshotEntry & entry)>;
+
+    static int     CompareNames (wstring_view lhs, wstring_view rhs);
+    static int     ComparePaths (wstring_view lhs, wstring_view rhs);
+    static HRESULT Diff         (ISnapshotSource & oldSource, ISnapshotSource & newSource, const ChangeCallback & onChange);
+    static bool    IsSnapshot   (const filesystem::path & file);
+
+
+
+protected:
+    struct SFileHeader
+    {
+        DWORD     m_dwMagic;
+        DWORD     m_dwVersion;
+        ULONGLONG m_cEntries;
+        UINT      m_cchRoot;            // Absolute listing root, right after the header
+        UINT      m_uReserved;
+    };
+
+    struct SRecordHeader
+    {
+        ULONGLONG m_cbSize;
+        ULONGLONG m_ftCreation;
+        ULONGLONG m_ftLastWrite;
+        DWORD     m_dwAttributes;
+        USHORT    m_cchShared;          // Leading characters shared with the previous record's path
+        USHORT    m_cchSuffix;          // The rest of the path, right after the header
+    };
+
+    static constexpr DWORD s_kdwMagic   = 0x4E534354;     // "TCSN"
+    static constexpr DWORD s_kdwVersion = 1;
+
+    static bool    IsChanged    (const SSnapshotEntry & oldEntry, const SSnapshotEntry & newEntry);
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotWriter
+//
+//  Writes a snapshot file from entries added in snapshot order.  The header
+//  is written last, by Commit; until then the file does not read as a
+//  snapshot, so an interrupted export never leaves a truncated one behind
+//  that looks whole.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CSnapshotWriter : private CSnapshot
+{
+public:
+    HRESULT Create (const filesystem::path & file, const filesystem::path & root);
+    HRESULT Add    (const SSnapshotEntry & entry);
+    HRESULT Commit (void);
+
+    ULONGLONG GetCount (void) const { return m_cEntries; }
+
+
+
+private:
+    static constexpr size_t s_kcbBuffer = 1 << 20;
+
+    HRESULT Write (const void * pData, size_t cb);
+    HRESULT Flush (void);
+
+    AutoHandle   m_hFile;
+    vector<BYTE> m_vBuffer;
+    wstring      m_strPrevious;
+    ULONGLONG    m_cEntries = 0;
+    UINT         m_cchRoot  = 0;
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotReader
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CSnapshotReader : public ISnapshotSource, private CSnapshot
+{
+public:
+    HRESULT Open (const filesystem::path & file);
+    HRESULT Next (SSnapshotEntry & entry) override;
+
+    const filesystem::path & GetRoot (void) const { return m_root; }
+
+
+
+private:
+    AutoHandle       m_hFile;
+    AutoHandle       m_hMapping;
+    CAutoMappedView  m_pView;
+    const BYTE     * m_pNext     = nullptr;
+    const BYTE     * m_pEnd      = nullptr;
+    ULONGLONG        m_cLeft     = 0;
+    wstring          m_strPath;         // The previous record's path
+    filesystem::path m_root;
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CLiveSnapshotSource
+//
+//  Walks a directory tree depth-first, reading each directory when it is
+//  reached and sorting its entries, so only the directories on the current
+//  path are held at once.  Links are listed but not entered.  A
+//  subdirectory that cannot be read is treated as empty.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CLiveSnapshotSource : public ISnapshotSource
+{
+public:
+    CLiveSnapshotSource (shared_ptr<IDirectoryEnumerator> pEnumerator, filesystem::path root);
+
+    HRESULT Next (SSnapshotEntry & entry) override;
+
+
+
+private:
+    struct SLiveEntry
+    {
+        wstring   m_strName;
+        ULONGLONG m_cbSize;
+        ULONGLONG m_ftCreation;
+        ULONGLONG m_ftLastWrite;
+        DWORD     m_dwAttributes;
+        bool      m_fEnter;             // A directory, and not a link
+    };
+
+    struct SFrame
+    {
+        wstring            m_strDir;    // Relative to the root; empty for the root
+        vector<SLiveEntry> m_vEntries;
+        size_t             m_iNext = 0;
+    };
+
+    HRESULT ReadDirectory (const wstring & strDir);
+
+    shared_ptr<IDirectoryEnumerator> m_pEnumerator;
+    filesystem::path                 m_root;
+    vector<SFrame>                   m_vStack;
+    bool                             m_fStarted = false;
+};
@@ -0,0 +1,333 @@
+#include "pch.h"
+#include "SnapshotLister.h"
+
+#include "CommandLine.h"
+#include "Config.h"
+#include "Console.h"
+#include "Win32DirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::CSnapshotLister
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CSnapshotLister::CSnapshotLister (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, unique_ptr<IResultsDisplayer> displayer) :
+    m_cmdLinePtr  (cmdLinePtr),
+    m_consolePtr  (consolePtr),
+    m_displayer   (std::move (displayer)),
+    m_pEnumerator (make_shared<CWin32DirectoryEnumerator>())
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::SetDirectoryEnumerator
+//
+//  Replaces the enumerator used to read a live target (for unit tests).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CSnapshotLister::SetDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pEnumerator)
+{
+    m_pEnumerator = pEnumerator;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::Export
+//
+//  --Snapshot: walks the target depth-first straight into the writer, so
+//  only the directories on the current path are in memory.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotLister::Export (void)
+{
+    HRESULT          hr = S_OK;
+    std::error_code  ec;
+    filesystem::path root;
+    SSnapshotEntry   entry;
+    CSnapshotWriter  writer;
+
+
+
+    hr = GetTarget (root);
+    CHR (hr);
+
+    if (!filesystem::is_directory (root, ec))
+    {
+        m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} does not exist\n", root.c_str());
+        BAIL_OUT_IF (TRUE, HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND));
+    }
+
+    hr = writer.Create (m_cmdLinePtr->m_strSnapshotFile, root);
+    CHRF (hr, m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} could not be created\n", m_cmdLinePtr->m_strSnapshotFile.c_str()));
+
+    {
+        CLiveSnapshotSource source (m_pEnumerator, root);
+
+        for (;;)
+        {
+            hr = source.Next (entry);
+            CHR (hr);
+
+            if (hr == S_FALSE)
+            {
+                break;
+            }
+
+            hr = writer.Add (entry);
+            CHR (hr);
+        }
+    }
+
+    hr = writer.Commit();
+    CHR (hr);
+
+    m_consolePtr->ColorPrintf (L"{Information}Wrote {InformationHighlight}%llu{Information} entries of {InformationHighlight}%s{Information} to {InformationHighlight}%s{Information}\n",
+                               writer.GetCount(),
+                               root.c_str(),
+                               m_cmdLinePtr->m_strSnapshotFile.c_str());
+
+
+
+Error:
+    m_consolePtr->Flush();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::Diff
+//
+//  --Diff: merge-joins the old snapshot with the target, displaying each
+//  kind of change as it fills a section (see AddChange) and the rest at
+//  the end, followed by the totals of everything shown.
+//
+//  Removed entries are named under the old snapshot's root, the others
+//  under the target's.  The drive header and free-space footer describe
+//  the target, or the folder holding it when it is a snapshot.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotLister::Diff (void)
+{
+    HRESULT                     hr = S_OK;
+    std::error_code             ec;
+    filesystem::path            target;
+    filesystem::path            newRoot;
+    filesystem::path            volumePath;
+    CSnapshotReader             oldReader;
+    CSnapshotReader             newReader;
+    unique_ptr<ISnapshotSource> pLiveSource;
+    ISnapshotSource           * pNewSource = &newReader;
+
+
+
+    hr = oldReader.Open (m_cmdLinePtr->m_strDiffBase);
+    CHRF (hr, m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} is not a TCDir snapshot\n", m_cmdLinePtr->m_strDiffBase.c_str()));
+
+    hr = GetTarget (target);
+    CHR (hr);
+
+    if (filesystem::is_directory (target, ec))
+    {
+        pLiveSource = make_unique<CLiveSnapshotSource> (m_pEnumerator, target);
+        pNewSource  = pLiveSource.get();
+        newRoot     = target;
+        volumePath  = target;
+    }
+    else if (CSnapshot::IsSnapshot (target))
+    {
+        hr = newReader.Open (target);
+        CHR (hr);
+
+        newRoot    = newReader.GetRoot();
+        volumePath = target.parent_path();
+    }
+    else
+    {
+        m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} is neither a directory nor a TCDir snapshot\n", target.c_str());
+        BAIL_OUT_IF (TRUE, HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND));
+    }
+
+    m_pDriveInfo = make_unique<CDriveInfo> (volumePath);
+
+    m_rgSections[static_cast<size_t> (CSnapshot::EChange::Added)].m_dirPath   = format (L"{} (added)",   newRoot.wstring());
+    m_rgSections[static_cast<size_t> (CSnapshot::EChange::Removed)].m_dirPath = format (L"{} (removed)", oldReader.GetRoot().wstring());
+    m_rgSections[static_cast<size_t> (CSnapshot::EChange::Changed)].m_dirPath = format (L"{} (changed)", newRoot.wstring());
+
+    m_consolePtr->Puts (CConfig::EAttribute::Default, L"");
+
+    hr = CSnapshot::Diff (oldReader, *pNewSource, [this] (CSnapshot::EChange change, const SSnapshotEntry & entry)
+    {
+        AddChange (change, entry);
+    });
+    CHR (hr);
+
+    for (SSection & section : m_rgSections)
+    {
+        DisplaySection (section);
+    }
+
+    if (!m_fDisplayedAny)
+    {
+        m_consolePtr->ColorPrintf (L"{Information} No differences between {InformationHighlight}%s{Information} and {InformationHighlight}%s{Information}\n\n",
+                                   m_cmdLinePtr->m_strDiffBase.c_str(),
+                                   target.c_str());
+    }
+
+    {
+        CDirectoryInfo summary (volumePath, L"*");
+
+        m_displayer->DisplayRecursiveSummary (summary, m_totals);
+    }
+
+
+
+Error:
+    m_consolePtr->Flush();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::GetTarget
+//
+//  The one directory or snapshot named on the command line (the current
+//  directory if none), as an absolute path.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CSnapshotLister::GetTarget (filesystem::path & target)
+{
+    HRESULT         hr = S_OK;
+    std::error_code ec;
+
+
+
+    target = m_cmdLinePtr->m_listMask.empty() ? filesystem::path (L".") : filesystem::path (m_cmdLinePtr->m_listMask.front());
+    target = filesystem::absolute (target, ec);
+    CBREx (!ec, HRESULT_FROM_WIN32 (ec.value()));
+
+    // "C:\Out\" and "C:\Out" must name the same root
+    if (!target.has_filename() && target.has_relative_path())
+    {
+        target = target.parent_path();
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::AddChange
+//
+//  Adds one change to its section, counted the way a listing counts its
+//  matches, and displays the section once it is full.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CSnapshotLister::AddChange (CSnapshot::EChange change, const SSnapshotEntry & entry)
+{
+    SSection & section  = m_rgSections[static_cast<size_t> (change)];
+    FileInfo   fileInfo;
+
+
+
+    if (!section.m_pChanges)
+    {
+        section.m_pChanges = make_unique<CDirectoryInfo> (section.m_dirPath, L"*");
+    }
+
+    CDirectoryInfo & di = *section.m_pChanges;
+
+    fileInfo.m_cbSize       = entry.m_cbSize;
+    fileInfo.m_ftCreation   = entry.m_ftCreation;
+    fileInfo.m_ftLastWrite  = entry.m_ftLastWrite;
+    fileInfo.m_dwAttributes = entry.m_dwAttributes;
+
+    if (entry.IsDirectory())
+    {
+        ++di.m_cSubDirectories;
+        ++m_totals.m_cDirectories;
+    }
+    else
+    {
+        di.m_uliBytesUsed.QuadPart       += entry.m_cbSize;
+        di.m_uliLargestFileSize.QuadPart  = (std::max) (di.m_uliLargestFileSize.QuadPart, entry.m_cbSize);
+        ++di.m_cFiles;
+
+        m_totals.m_uliFileBytes.QuadPart += entry.m_cbSize;
+        ++m_totals.m_cFiles;
+    }
+
+    if (m_cmdLinePtr->m_fWideListing)
+    {
+        // Wide listings show directories in brackets
+        di.m_cchLargestFileName = (std::max) (di.m_cchLargestFileName, entry.m_strPath.size() + (entry.IsDirectory() ? 2 : 0));
+    }
+
+    di.AddMatch (move (fileInfo), entry.m_strPath.c_str(), entry.m_strPath.size());
+
+    if (di.m_vMatches.size() >= s_kcChangesPerDisplay)
+    {
+        DisplaySection (section);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister::DisplaySection
+//
+//  Shows and releases a section's pending changes, already in snapshot
+//  order.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CSnapshotLister::DisplaySection (SSection & section)
+{
+    if (!section.m_pChanges)
+    {
+        return;
+    }
+
+    m_displayer->DisplayResults (*m_pDriveInfo,
+                                 *section.m_pChanges,
+                                 m_fDisplayedAny ? IResultsDisplayer::EDirectoryLevel::Subdirectory : IResultsDisplayer::EDirectoryLevel::Initial);
+
+    m_fDisplayedAny = true;
+    section.m_pChanges.reset();
+}
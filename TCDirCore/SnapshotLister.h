@@ -0,0 +1,70 @@
+#pragma once
+
+#include "DirectoryInfo.h"
+#include "DriveInfo.h"
+#include "IDirectoryEnumerator.h"
+#include "IResultsDisplayer.h"
+#include "ListingTotals.h"
+#include "Snapshot.h"
+
+
+
+
+
+class CCommandLine;
+class CConsole;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CSnapshotLister
+//
+//  --Snapshot writes the target directory's recursive listing to a
+//  snapshot file.  --Diff compares a snapshot with the target, a directory
+//  or a second snapshot, and lists what was added, removed, or changed
+//  through the usual displayer: each kind of change is shown as a
+//  directory of its own, named after the root it belongs to, with the
+//  entries under their relative paths.
+//
+//  Changes are displayed every s_kcChangesPerDisplay entries of a kind
+//  rather than collected, so a diff of millions of entries holds no more
+//  than that many of each at once.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CSnapshotLister
+{
+public:
+    CSnapshotLister (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, unique_ptr<IResultsDisplayer> displayer);
+
+    HRESULT Export                 (void);
+    HRESULT Diff                   (void);
+    void    SetDirectoryEnumerator (shared_ptr<IDirectoryEnumerator> pEnumerator);
+
+    static constexpr size_t s_kcChangesPerDisplay = 4096;
+
+
+
+private:
+    struct SSection
+    {
+        filesystem::path           m_dirPath;       // Root and kind of change, as shown in the header
+        unique_ptr<CDirectoryInfo> m_pChanges;
+    };
+
+    HRESULT GetTarget      (filesystem::path & target);
+    void    AddChange      (CSnapshot::EChange change, const SSnapshotEntry & entry);
+    void    DisplaySection (SSection & section);
+
+    shared_ptr<CCommandLine>         m_cmdLinePtr;
+    shared_ptr<CConsole>             m_consolePtr;
+    unique_ptr<IResultsDisplayer>    m_displayer;
+    shared_ptr<IDirectoryEnumerator> m_pEnumerator;
+    unique_ptr<CDriveInfo>           m_pDriveInfo;
+    array<SSection, 3>               m_rgSections;          // Indexed by CSnapshot::EChange
+    SListingTotals                   m_totals;
+    bool                             m_fDisplayedAny = false;
+};
@@ -4,19 +4,27 @@
 #include "pch.h"
 
 #include "AliasManager.h"
+#include "CachingDirectoryEnumerator.h"
 #include "CommandLine.h"
 #include "Config.h"
 #include "Console.h"
 #include "DirectoryLister.h"
+#include "ListingCache.h"
 #include "MaskGrouper.h"
 #include "NerdFontDetector.h"
 #include "NerdFontInstaller.h"
 #include "PerfTimer.h"
+#include "PollingChangeNotifier.h"
 #include "ResultsDisplayerBare.h"
 #include "ResultsDisplayerNormal.h"
 #include "ResultsDisplayerTree.h"
 #include "ResultsDisplayerWide.h"
+#include "SnapshotLister.h"
+#include "ThreadBenchmark.h"
 #include "Usage.h"
+#include "WatchLister.h"
+#include "Win32ChangeNotifier.h"
+#include "Win32DirectoryEnumerator.h"
 
 
 
@@ -171,7 +179,7 @@ static unique_ptr<IResultsDisplayer> CreateDisplayer (
     {
         return make_unique<CResultsDisplayerWide> (cmdlinePtr, consolePtr, configPtr, fIconsActive);
     }
-    else if (cmdlinePtr->m_fTree)
+    else if (cmdlinePtr->m_fTree || cmdlinePtr->m_fUsage)
     {
         return make_unique<CResultsDisplayerTree> (cmdlinePtr, consolePtr, configPtr, fIconsActive);
     }
@@ -190,25 +198,238 @@ static unique_ptr<IResultsDisplayer> CreateDisplayer (
 //  RunDirectoryListing
 //
 //  Create the displayer, group masks by directory, and run the listing.
+//  Returns the time the display spent waiting on enumeration workers.
+//
+//  With --Cache, directories are read through the listing cache.  A cache
+//  that cannot be opened (another tcdir holds it, or there is no local
+//  app data folder) is not an error: the listing just reads everything.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-static void RunDirectoryListing (
+static chrono::steady_clock::duration RunDirectoryListing (
     shared_ptr<CCommandLine>   cmdlinePtr,
     shared_ptr<CConsole>       consolePtr,
     shared_ptr<CConfig>        configPtr)
 {
+    HRESULT                       hr        = S_OK;
     unique_ptr<IResultsDisplayer> displayer = CreateDisplayer (cmdlinePtr, consolePtr, configPtr);
     CDirectoryLister              dirLister   (cmdlinePtr, consolePtr, configPtr, std::move (displayer));
+    shared_ptr<CListingCache>     pCache;
 
     auto groups = CMaskGrouper::GroupMasksByDirectory (cmdlinePtr->m_listMask);
 
 
 
+    if (cmdlinePtr->m_eCacheMode != CCommandLine::ECacheMode::Off)
+    {
+        filesystem::path cacheFile = CListingCache::GetDefaultPath();
+
+        if (!cacheFile.empty())
+        {
+            pCache = make_shared<CListingCache> (cacheFile);
+
+            if (SUCCEEDED (pCache->Open()))
+            {
+                dirLister.SetDirectoryEnumerator (make_shared<CCachingDirectoryEnumerator> (
+                    make_shared<CWin32DirectoryEnumerator>(),
+                    pCache,
+                    cmdlinePtr->m_eCacheMode == CCommandLine::ECacheMode::Refresh));
+            }
+            else
+            {
+                pCache.reset();
+            }
+        }
+    }
+
+    // Read every group ahead of the display; output order is unchanged
+    dirLister.PrefetchListings (groups);
+
     for (const auto & group : groups)
     {
         dirLister.List (group);
     }
+
+    if (pCache)
+    {
+        hr = pCache->Save();
+        IGNORE_RETURN_VALUE (hr, S_OK);
+    }
+
+    return dirLister.GetConsumerStallTime();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  RunSnapshot
+//
+//  --Snapshot: write the target's recursive listing to a snapshot file.
+//  --Diff: list what changed between a snapshot and the target.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static HRESULT RunSnapshot (
+    shared_ptr<CCommandLine>   cmdlinePtr,
+    shared_ptr<CConsole>       consolePtr,
+    shared_ptr<CConfig>        configPtr)
+{
+    HRESULT         hr     = S_OK;
+    CSnapshotLister lister   (cmdlinePtr, consolePtr, CreateDisplayer (cmdlinePtr, consolePtr, configPtr));
+
+
+
+    if (!cmdlinePtr->m_strSnapshotFile.empty())
+    {
+        hr = lister.Export();
+        CHR (hr);
+    }
+    else
+    {
+        hr = lister.Diff();
+        CHR (hr);
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  RunWatch
+//
+//  --Watch: list the target and redraw it as it changes, until Ctrl+C.
+//  Change notifications come from ReadDirectoryChangesW where the file
+//  system supports it, and from polling directory stamps where it does
+//  not.  Watching starts before the first read, so nothing that changes
+//  during it is missed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static HRESULT RunWatch (
+    shared_ptr<CCommandLine>   cmdlinePtr,
+    shared_ptr<CConsole>       consolePtr,
+    shared_ptr<CConfig>        configPtr)
+{
+    HRESULT                     hr        = S_OK;
+    CWatchLister                lister      (cmdlinePtr, consolePtr, configPtr, CreateDisplayer (cmdlinePtr, consolePtr, configPtr));
+    unique_ptr<IChangeNotifier> pNotifier = make_unique<CWin32ChangeNotifier>();
+
+    auto groups = CMaskGrouper::GroupMasksByDirectory (cmdlinePtr->m_listMask);
+
+
+
+    if (groups.size() != 1)
+    {
+        consolePtr->ColorPrintf (L"{Error}Error:   --Watch lists a single directory\n");
+        BAIL_OUT_IF (TRUE, E_INVALIDARG);
+    }
+
+    hr = pNotifier->Watch (groups.front().first, cmdlinePtr->m_fRecurse);
+
+    if (FAILED (hr))
+    {
+        pNotifier = make_unique<CPollingChangeNotifier> (make_shared<CWin32DirectoryEnumerator>());
+
+        hr = pNotifier->Watch (groups.front().first, cmdlinePtr->m_fRecurse);
+        CHRF (hr, consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} does not exist\n", groups.front().first.c_str()));
+    }
+
+    hr = lister.Run (groups.front(), *pNotifier);
+    CHR (hr);
+
+
+
+Error:
+    consolePtr->Flush();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  RunThreadBenchmark
+//
+//  --Benchmark: measure enumeration throughput of each target directory
+//  across thread counts instead of listing it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static HRESULT RunThreadBenchmark (
+    shared_ptr<CCommandLine>   cmdlinePtr,
+    shared_ptr<CConsole>       consolePtr,
+    shared_ptr<CConfig>        configPtr)
+{
+    HRESULT          hr        = S_OK;
+    CThreadBenchmark benchmark   (cmdlinePtr, consolePtr, configPtr);
+
+
+
+    for (const auto & group : CMaskGrouper::GroupMasksByDirectory (cmdlinePtr->m_listMask))
+    {
+        hr = benchmark.Run (group);
+        CHR (hr);
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  PrintConsumerStall
+//
+//  Reported with the -P timing for multi-threaded listings: how long the
+//  display sat idle waiting for directories to be enumerated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void PrintConsumerStall (chrono::steady_clock::duration consumerStall)
+{
+    fputws (format (L"TCDir display stall time:  {:.2f} msec\n", chrono::duration<double, milli> (consumerStall).count()).c_str(), stdout);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  PrintPeakWorkingSet
+//
+//  Reported with the -P timing so memory use on large trees can be checked
+//  alongside elapsed time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void PrintPeakWorkingSet (void)
+{
+    PROCESS_MEMORY_COUNTERS pmc = { sizeof (pmc) };
+
+
+
+    if (GetProcessMemoryInfo (GetCurrentProcess(), &pmc, sizeof (pmc)))
+    {
+        fputws (format (L"TCDir peak working set:  {:.2f} MB\n", pmc.PeakWorkingSetSize / (1024.0 * 1024.0)).c_str(), stdout);
+    }
 }
 
 
@@ -225,12 +446,13 @@ static void RunDirectoryListing (
 
 int wmain (int argc, WCHAR * argv[])
 {
-    HRESULT                  hr           = S_OK;      
-    shared_ptr<CCommandLine> cmdlinePtr   = make_shared<CCommandLine>();
-    unique_ptr<PerfTimer>    perfTimerPtr;
-    shared_ptr<CConfig>      configPtr    = make_shared<CConfig>();
-    shared_ptr<CConsole>     consolePtr   = make_shared<CConsole>();
-    bool                     fWorkerHandled = false;
+    HRESULT                        hr             = S_OK;      
+    shared_ptr<CCommandLine>       cmdlinePtr     = make_shared<CCommandLine>();
+    chrono::steady_clock::duration consumerStall  = {};
+    unique_ptr<PerfTimer>          perfTimerPtr;
+    shared_ptr<CConfig>            configPtr      = make_shared<CConfig>();
+    shared_ptr<CConsole>           consolePtr     = make_shared<CConsole>();
+    bool                           fWorkerHandled = false;
 
  
 
@@ -273,16 +495,48 @@ int wmain (int argc, WCHAR * argv[])
     CHR (hr);
     BAIL_OUT_IF (hr == S_FALSE, S_OK);
 
+    if (cmdlinePtr->m_fBenchmark)
+    {
+        hr = RunThreadBenchmark (cmdlinePtr, consolePtr, configPtr);
+        CHR (hr);
+        BAIL_OUT_IF (TRUE, S_OK);
+    }
+
+    if (!cmdlinePtr->m_strSnapshotFile.empty() || !cmdlinePtr->m_strDiffBase.empty())
+    {
+        hr = RunSnapshot (cmdlinePtr, consolePtr, configPtr);
+        CHR (hr);
+        BAIL_OUT_IF (TRUE, S_OK);
+    }
+
+    if (cmdlinePtr->m_fWatch)
+    {
+        hr = RunWatch (cmdlinePtr, consolePtr, configPtr);
+        CHR (hr);
+        BAIL_OUT_IF (TRUE, S_OK);
+    }
+
     //
     // Run the directory listing
     //
 
     if (cmdlinePtr->m_fPerfTimer)
     {
-        perfTimerPtr = make_unique<PerfTimer> (L"TCDir time elapsed", PerfTimer::Automatic, PerfTimer::Msec, [] (const wchar_t * msg) { fputws (msg, stdout); });
+        perfTimerPtr = make_unique<PerfTimer> (L"TCDir time elapsed", PerfTimer::Automatic, PerfTimer::Msec, [&consumerStall, fMultiThreaded = cmdlinePtr->m_fMultiThreaded] (const wchar_t * msg)
+        {
+            fputws (msg, stdout);
+
+            if (fMultiThreaded)
+            {
+                PrintConsumerStall (consumerStall);
+            }
+
+            PrintPeakWorkingSet();
+        });
     }
 
-    RunDirectoryListing (cmdlinePtr, consolePtr, configPtr);
+    // Declared ahead of perfTimerPtr, so it outlives the timer's final report
+    consumerStall = RunDirectoryListing (cmdlinePtr, consolePtr, configPtr);
 
     //
     // Display any config file or TCDIR environment variable issues at the end of the run
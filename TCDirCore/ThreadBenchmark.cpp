@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "ThreadBenchmark.h"
+
+#include "CommandLine.h"
+#include "Config.h"
+#include "Console.h"
+#include "DriveInfo.h"
+#include "IResultsDisplayer.h"
+#include "MultiThreadedLister.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CNullResultsDisplayer
+//
+//  Discards the listing so a benchmark run measures enumeration only.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CNullResultsDisplayer : public IResultsDisplayer
+{
+public:
+    void DisplayResults          (const CDriveInfo &, const CDirectoryInfo &, EDirectoryLevel) override { }
+    void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &)              override { }
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadBenchmark::CThreadBenchmark
+//
+//  
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CThreadBenchmark::CThreadBenchmark (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr) :
+    m_cmdLinePtr (cmdLinePtr),
+    m_consolePtr (consolePtr),
+    m_configPtr  (configPtr)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadBenchmark::Run
+//
+//  Warm-up pass, then 1, 2, 4, ... threads up to four per logical CPU
+//  (capped at s_kcMaxBenchmarkThreads), then Auto.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CThreadBenchmark::Run (const MaskGroup & group)
+{
+    HRESULT         hr       = S_OK;
+    std::error_code ec;
+    const int       cCpus    = static_cast<int> (max (1u, jthread::hardware_concurrency()));
+    const int       cMax     = min (cCpus * 4, s_kcMaxBenchmarkThreads);
+    vector<int>     vThreads;
+    SRun            run;
+
+
+
+    if (!filesystem::exists (group.first, ec) || !filesystem::is_directory (group.first, ec))
+    {
+        m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} does not exist\n",
+                                   group.first.c_str());
+        BAIL_OUT_IF (TRUE, HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND));
+    }
+
+    for (int cThreads = 1; cThreads <= cMax; cThreads *= 2)
+    {
+        vThreads.push_back (cThreads);
+    }
+
+    vThreads.push_back (CCommandLine::s_kcThreadsAuto);
+
+    {
+        CDriveInfo driveInfo (group.first);
+
+        m_consolePtr->ColorPrintf (L"\n{Information}Benchmarking {InformationHighlight}%s{Information} (%d logical CPUs)\n\n",
+                                   group.first.c_str(),
+                                   cCpus);
+        m_consolePtr->Flush();
+
+        hr = MeasureRun (driveInfo, group, 0, run);
+        CHR (hr);
+
+        m_consolePtr->Printf (CConfig::EAttribute::Information, L"  Warm-up: %zu directories, %zu entries\n\n",
+                              run.m_cDirs,
+                              run.m_cEntries);
+        m_consolePtr->Printf (CConfig::EAttribute::Information, L"  %-10ls %12ls %12ls %14ls\n",
+                              L"Threads", L"Elapsed ms", L"Dirs/sec", L"Entries/sec");
+
+        for (int cThreads : vThreads)
+        {
+            hr = MeasureRun (driveInfo, group, cThreads, run);
+            CHR (hr);
+
+            PrintRun (run);
+        }
+    }
+
+
+
+Error:
+    m_consolePtr->Flush();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadBenchmark::MeasureRun
+//
+//  One recursive enumeration of the group at the given --Threads value,
+//  with the user's other switches (masks, attributes, --ReadAhead) intact.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CThreadBenchmark::MeasureRun (const CDriveInfo & driveInfo, const MaskGroup & group, int cThreads, SRun & run)
+{
+    HRESULT                  hr            = S_OK;
+    shared_ptr<CCommandLine> runCmdLinePtr = make_shared<CCommandLine> (*m_cmdLinePtr);
+    CNullResultsDisplayer    displayer;
+
+
+
+    runCmdLinePtr->m_fRecurse       = true;
+    runCmdLinePtr->m_fTree          = false;
+    runCmdLinePtr->m_fUsage         = false;
+    runCmdLinePtr->m_fMultiThreaded = true;
+    runCmdLinePtr->m_cThreads       = cThreads;
+
+    run            = SRun();
+    run.m_cThreads = cThreads;
+
+    {
+        CMultiThreadedLister mtLister (runCmdLinePtr, m_consolePtr, m_configPtr);
+        auto                 start = chrono::steady_clock::now();
+
+        hr = mtLister.ProcessDirectoryMultiThreaded (driveInfo,
+                                                     group.first,
+                                                     group.second,
+                                                     displayer,
+                                                     IResultsDisplayer::EDirectoryLevel::Initial,
+                                                     run.m_totals);
+
+        run.m_elapsed       = chrono::steady_clock::now() - start;
+        run.m_cWorkersAtEnd = mtLister.GetActiveWorkerCount();
+        run.m_cDirs         = mtLister.GetEnumeratedDirs();
+        run.m_cEntries      = mtLister.GetEnumeratedEntries();
+        CHR (hr);
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadBenchmark::PrintRun
+//
+//  Rates count every directory the workers read and every entry those
+//  reads returned, not just the ones that matched the masks, so a sparse
+//  mask does not understate the throughput.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CThreadBenchmark::PrintRun (const SRun & run)
+{
+    double  seconds  = (std::max) (chrono::duration<double> (run.m_elapsed).count(), 1e-9);
+    double  cDirs    = static_cast<double> (run.m_cDirs);
+    double  cEntries = static_cast<double> (run.m_cEntries);
+    wstring threads  = (run.m_cThreads == CCommandLine::s_kcThreadsAuto)
+                     ? format (L"Auto ({})", run.m_cWorkersAtEnd)
+                     : to_wstring (run.m_cThreads);
+
+
+
+    m_consolePtr->Printf (CConfig::EAttribute::Default, L"  %-10ls %12.1f %12.0f %14.0f\n",
+                          threads.c_str(),
+                          seconds * 1000.0,
+                          cDirs / seconds,
+                          cEntries / seconds);
+    m_consolePtr->Flush();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ListingTotals.h"
+#include "MaskGrouper.h"
+
+
+
+
+
+class CCommandLine;
+class CConfig;
+class CConsole;
+class CDriveInfo;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadBenchmark
+//
+//  --Benchmark: enumerates the target path recursively at doubling thread
+//  counts, then with --Threads=Auto, and prints the throughput of each run.
+//  Nothing is listed; a warm-up pass first brings the file system cache to
+//  the same state for every measured run.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CThreadBenchmark
+{
+public:
+    CThreadBenchmark (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr);
+
+    HRESULT Run (const MaskGroup & group);
+
+
+private:
+    struct SRun
+    {
+        int                            m_cThreads      = 0;     // CCommandLine::s_kcThreadsAuto for the adaptive run
+        size_t                         m_cWorkersAtEnd = 0;     // Active workers when the run finished
+        size_t                         m_cDirs         = 0;     // Directories enumerated, matched or not
+        size_t                         m_cEntries      = 0;     // Entries those directories returned
+        chrono::steady_clock::duration m_elapsed       = {};
+        SListingTotals                 m_totals;
+    };
+
+    static constexpr int s_kcMaxBenchmarkThreads = 64;
+
+    HRESULT MeasureRun (const CDriveInfo & driveInfo, const MaskGroup & group, int cThreads, SRun & run);
+    void    PrintRun   (const SRun & run);
+
+    shared_ptr<CCommandLine> m_cmdLinePtr;
+    shared_ptr<CConsole>     m_consolePtr;
+    shared_ptr<CConfig>      m_configPtr;
+};
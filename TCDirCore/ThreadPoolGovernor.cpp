@@ -0,0 +1,105 @@
+#include "pch.h"
+#include "ThreadPoolGovernor.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadPoolGovernor::CThreadPoolGovernor
+//
+//  
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CThreadPoolGovernor::CThreadPoolGovernor (size_t cMinWorkers, size_t cMaxWorkers, size_t cInitialWorkers) :
+    m_cMin    ((std::max) (cMinWorkers, size_t (1))),
+    m_cMax    ((std::max) (cMaxWorkers, m_cMin)),
+    m_cActive (clamp (cInitialWorkers, m_cMin, m_cMax))
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadPoolGovernor::Update
+//
+//  Judges the previous step against this sample, then decides the next one.
+//  Returns the number of workers that should be active.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+size_t CThreadPoolGovernor::Update (const SSample & sample)
+{
+    double seconds    = chrono::duration<double> (sample.m_elapsed).count();
+    double throughput = 0;
+    double latency    = 0;
+
+
+
+    if (seconds <= 0)
+    {
+        return m_cActive;
+    }
+
+    throughput = sample.m_cDirectories / seconds;
+
+    if (sample.m_cDirectories > 0)
+    {
+        latency = chrono::duration<double> (sample.m_latency).count() / sample.m_cDirectories;
+    }
+
+    //
+    // Judge the last grow.  Slower overall, or much slower per directory
+    // with nothing to show for it, means the extra workers only contend.
+    //
+
+    if (m_cLastStep > 0)
+    {
+        bool fSlower    = throughput < m_dBaselineThroughput * (1.0 - s_kdTolerance);
+        bool fThrashing = latency    > m_dBaselineLatency    * s_kdThrashFactor &&
+                          throughput < m_dBaselineThroughput * (1.0 + s_kdTolerance);
+
+        if (fSlower || fThrashing)
+        {
+            m_cActive     -= m_cLastStep;
+            m_cLastStep    = 0;
+            m_cHoldWindows = s_kcBackoffWindows;
+
+            return m_cActive;
+        }
+
+        m_cLastStep = 0;
+    }
+
+    if (m_cHoldWindows > 0)
+    {
+        --m_cHoldWindows;
+    }
+
+    if (sample.m_cQueued > m_cActive && m_cActive < m_cMax && m_cHoldWindows == 0)
+    {
+        //
+        // More directories waiting than workers to read them: grow by a
+        // quarter (at least one) and judge the result next window.
+        //
+
+        size_t cStep = (std::min) ((std::max) (m_cActive / 4, size_t (1)), m_cMax - m_cActive);
+
+        m_dBaselineThroughput = throughput;
+        m_dBaselineLatency    = latency;
+        m_cActive            += cStep;
+        m_cLastStep           = cStep;
+    }
+    else if (sample.m_cQueued == 0 && m_cActive > m_cMin)
+    {
+        // Nothing waiting: at least one worker is idle
+        --m_cActive;
+    }
+
+    return m_cActive;
+}
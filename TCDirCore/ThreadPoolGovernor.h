@@ -0,0 +1,58 @@
+#pragma once
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CThreadPoolGovernor
+//
+//  Decides how many enumeration workers should be active for --Threads=Auto.
+//  The lister feeds it one sample per window — directories enumerated, the
+//  summed per-directory enumeration time, and the queue depth at the end of
+//  the window — and parks or wakes workers to match the returned count.
+//
+//  This is a hill climber: when more directories are waiting than there are
+//  active workers, it adds a step of workers and records the throughput and
+//  latency it had before.  The next sample judges the step.  A step that
+//  lowered throughput, or that raised per-directory latency sharply without
+//  buying throughput (the volume is thrashing), is reverted and growth is
+//  held off for a few windows.  An empty queue means workers are idle, so
+//  one is parked per window down to the minimum.
+//
+//  Not thread-safe; the lister serializes Update calls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CThreadPoolGovernor
+{
+public:
+    struct SSample
+    {
+        size_t                         m_cDirectories = 0;     // Directories enumerated during the window
+        chrono::steady_clock::duration m_elapsed      = {};    // Length of the window
+        chrono::steady_clock::duration m_latency      = {};    // Summed per-directory enumeration time
+        size_t                         m_cQueued      = 0;     // Directories waiting at the end of the window
+    };
+
+    static constexpr chrono::milliseconds s_kSampleWindow      { 50 };
+    static constexpr double               s_kdTolerance        = 0.05;     // Throughput noise ignored when judging a step
+    static constexpr double               s_kdThrashFactor     = 2.0;      // Latency growth that marks a step as thrashing
+    static constexpr UINT                 s_kcBackoffWindows   = 8;        // Windows without growth after a revert
+
+    CThreadPoolGovernor (size_t cMinWorkers, size_t cMaxWorkers, size_t cInitialWorkers);
+
+    size_t Update           (const SSample & sample);
+    size_t GetActiveWorkers (void) const { return m_cActive; }
+
+
+private:
+    size_t m_cMin;
+    size_t m_cMax;
+    size_t m_cActive;
+    size_t m_cLastStep           = 0;      // Workers added by the step awaiting judgement
+    double m_dBaselineThroughput = 0;      // Directories per second before that step
+    double m_dBaselineLatency    = 0;      // Seconds per directory before that step
+    UINT   m_cHoldWindows        = 0;
+};
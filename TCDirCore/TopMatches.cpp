@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "TopMatches.h"
+
+#include "FileComparator.h"
+#include "MatchSorter.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches::CTopMatches
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CTopMatches::CTopMatches (shared_ptr<const CCommandLine> cmdLinePtr, size_t cTop) :
+    m_cmdLinePtr  (cmdLinePtr),
+    m_cTop        (cTop),
+    m_pCandidates (make_unique<CDirectoryInfo> (filesystem::path(), L"*"))
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches::Add
+//
+//  Buffers one candidate, cutting the buffer back to the best N once it
+//  holds 2N.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CTopMatches::Add (FileInfo && fileInfo, wstring_view fullPath)
+{
+    m_pCandidates->AddMatch (move (fileInfo), fullPath.data(), fullPath.size());
+
+    if (m_pCandidates->m_vMatches.size() >= 2 * m_cTop)
+    {
+        Trim();
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches::Merge
+//
+//  Moves another collector's candidates into this one, leaving it empty.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CTopMatches::Merge (CTopMatches & other)
+{
+    for (FileInfo & fileInfo : other.m_pCandidates->m_vMatches)
+    {
+        Add (move (fileInfo), other.m_pCandidates->NameView (fileInfo));
+    }
+
+    other.m_pCandidates = make_unique<CDirectoryInfo> (filesystem::path(), L"*");
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches::Finish
+//
+//  Cuts the candidates to the best N and sorts them for display under
+//  dirPath, the listing root.  The directory's counters describe the
+//  winners only.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CDirectoryInfo & CTopMatches::Finish (const filesystem::path & dirPath)
+{
+    Trim();
+
+    m_pCandidates->m_dirPath = dirPath;
+
+    CMatchSorter (m_pCandidates->m_vMatches, FileComparator (m_cmdLinePtr, *m_pCandidates)).Sort();
+
+    return *m_pCandidates;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches::Trim
+//
+//  Partitions the best N candidates to the front with nth_element (their
+//  own order is left to Finish) and copies them, with their names, into a
+//  fresh directory so the losers' names leave the arena too.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CTopMatches::Trim (void)
+{
+    FileInfoVector & vMatches = m_pCandidates->m_vMatches;
+    auto             pKept    = make_unique<CDirectoryInfo> (filesystem::path(), L"*");
+    size_t           cKeep    = (std::min) (m_cTop, vMatches.size());
+
+
+
+    if (cKeep < vMatches.size())
+    {
+        nth_element (vMatches.begin(), vMatches.begin() + cKeep, vMatches.end(), FileComparator (m_cmdLinePtr, *m_pCandidates));
+    }
+
+    pKept->m_vMatches.reserve (cKeep);
+
+    for (size_t i = 0; i < cKeep; ++i)
+    {
+        FileInfo     & fileInfo = vMatches[i];
+        wstring_view   fullPath = m_pCandidates->NameView (fileInfo);
+
+
+
+        pKept->m_uliBytesUsed.QuadPart       += fileInfo.m_cbSize;
+        pKept->m_uliLargestFileSize.QuadPart  = (std::max) (pKept->m_uliLargestFileSize.QuadPart, fileInfo.m_cbSize);
+        pKept->m_cchLargestFileName           = (std::max) (pKept->m_cchLargestFileName, fullPath.size());
+        ++pKept->m_cFiles;
+
+        if (fileInfo.HasStreams())
+        {
+            for (const SStreamInfo & si : fileInfo.m_pExtras->m_vStreams)
+            {
+                pKept->m_uliStreamBytesUsed.QuadPart += si.m_liSize.QuadPart;
+                pKept->m_uliLargestFileSize.QuadPart  = (std::max) (pKept->m_uliLargestFileSize.QuadPart, static_cast<ULONGLONG> (si.m_liSize.QuadPart));
+                ++pKept->m_cStreams;
+            }
+        }
+
+        pKept->AddMatch (move (fileInfo), fullPath.data(), fullPath.size());
+    }
+
+    m_pCandidates = move (pKept);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CommandLine.h"
+#include "DirectoryInfo.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CTopMatches
+//
+//  The first --Top=N files of a listing in /O order, collected while it is
+//  enumerated.  Candidates are named by their full paths, so entries from
+//  different directories can share one name arena and one FileComparator.
+//
+//  Candidates are buffered up to twice the limit and then cut back to the
+//  best N with the listing's own sort.  A heap would need a comparator
+//  that can rank an entry it has not seen before, which the natural sort's
+//  precomputed keys cannot; the buffer gives the same amortized cost per
+//  entry and the same O(N) memory.
+//
+//  Not thread-safe: the multithreaded lister keeps one per worker and
+//  merges them once the workers have stopped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CTopMatches
+{
+public:
+    CTopMatches (shared_ptr<const CCommandLine> cmdLinePtr, size_t cTop);
+
+    void             Add     (FileInfo && fileInfo, wstring_view fullPath);
+    void             Merge   (CTopMatches & other);
+    CDirectoryInfo & Finish  (const filesystem::path & dirPath);
+
+    size_t           GetCount (void) const { return m_pCandidates->m_vMatches.size(); }
+
+
+
+private:
+    void             Trim    (void);
+
+    shared_ptr<const CCommandLine> m_cmdLinePtr;
+    size_t                         m_cTop;
+    unique_ptr<CDirectoryInfo>     m_pCandidates;       // Names are full paths
+};
@@ -2,6 +2,7 @@
 #include "Usage.h"
 
 #include "Color.h"
+#include "CommandLine.h"
 #include "Config.h"
 #include "Console.h"
 #include "IconMapping.h"
@@ -580,6 +581,48 @@ static vector<SUsageOptionRow> BuildPrimaryOptionRows (wstring_view szShort, wst
         { format (L"{{InformationHighlight}}{0}Size{{Information}}={{InformationHighlight}}Auto{{Information}}|{{InformationHighlight}}Bytes{{Information}}", pszLong),
           L"File size format: {InformationHighlight}Auto{Information} = abbreviated (KB/MB/GB), {InformationHighlight}Bytes{Information} = exact with commas.",
           L"Default: {InformationHighlight}Auto{Information} in tree mode, {InformationHighlight}Bytes{Information} otherwise." },
+        { format (L"{{InformationHighlight}}{0}Size{{Information}}>{{InformationHighlight}}N{{Information}}|<{{InformationHighlight}}N{{Information}}", pszLong),
+          L"Lists only files larger or smaller than N bytes; N may end in K, M, G, or T (e.g. 100M).",
+          format (L"Quote it, or use {{InformationHighlight}}{0}Size{{Information}}=+N / =-N, as the shell redirects on > and <.", pszLong) },
+        { format (L"{{InformationHighlight}}{0}Newer{{Information}}|{{InformationHighlight}}{0}Older{{Information}}={{InformationHighlight}}date{{Information}}", pszLong),
+          format (L"Lists only entries whose {{InformationHighlight}}{0}T{{Information}} time is on or after, or before, yyyy-mm-dd[Thh:mm[:ss]].", szShort),
+          L"" },
+        { format (L"{{InformationHighlight}}{0}Regex{{Information}}={{InformationHighlight}}pattern{{Information}}", pszLong),
+          L"Lists only entries whose names contain a match for the regular expression (case-insensitive).",
+          L"May be repeated; every pattern must match." },
+        { format (L"{{InformationHighlight}}{0}ReadAhead{{Information}}={{InformationHighlight}}N{{Information}}", pszLong),
+          L"Limits how many entries are read ahead of the display (default 100000, 0 = unlimited).",
+          L"" },
+        { format (L"{{InformationHighlight}}{0}Threads{{Information}}={{InformationHighlight}}N{{Information}}|{{InformationHighlight}}Auto{{Information}}", pszLong),
+          L"Number of enumeration threads (default one per CPU). {InformationHighlight}Auto{Information} adapts to measured latency.",
+          L"" },
+        { format (L"{{InformationHighlight}}{0}Benchmark{{Information}}", pszLong),
+          L"Reports enumeration throughput of the target path at several thread counts.",
+          L"" },
+        { format (L"{{InformationHighlight}}{0}Follow{{Information}}={{InformationHighlight}}Never{{Information}}|{{InformationHighlight}}Once{{Information}}|{{InformationHighlight}}Always{{Information}}", pszLong),
+          L"Descends into junctions and directory symlinks never, through one link, or always (cycles pruned).",
+          format (L"Default: {{InformationHighlight}}Never{{Information}} with {{InformationHighlight}}{0}Tree{{Information}}, {{InformationHighlight}}Always{{Information}} with {{InformationHighlight}}{1}S{{Information}}.", pszLong, szShort) },
+        { format (L"{{InformationHighlight}}{0}Sort{{Information}}={{InformationHighlight}}Ordinal{{Information}}|{{InformationHighlight}}Locale{{Information}}", pszLong),
+          L"Compares names and extensions code unit by code unit ignoring case, as NTFS does, or in the user's locale.",
+          L"Default: {InformationHighlight}Ordinal{Information}." },
+        { format (L"{{InformationHighlight}}{0}Top{{Information}}={{InformationHighlight}}N{{Information}}", pszLong),
+          format (L"Shows only the first N files of the listing in {{InformationHighlight}}{0}O{{Information}} order, with full paths.", szShort),
+          format (L"With {{InformationHighlight}}{0}S{{Information}} they are chosen from the whole tree; use {{InformationHighlight}}{0}O-S{{Information}} for the largest.", szShort) },
+        { format (L"{{InformationHighlight}}{0}Usage{{Information}}", pszLong),
+          L"Shows the directory tree with each directory's total size and file count, largest first.",
+          format (L"Honors {{InformationHighlight}}{0}Depth{{Information}} and {{InformationHighlight}}{0}Size{{Information}}; every level is still counted.", pszLong) },
+        { format (L"{{InformationHighlight}}{0}Cache{{Information}}={{InformationHighlight}}Off{{Information}}|{{InformationHighlight}}Read{{Information}}|{{InformationHighlight}}Refresh{{Information}}", pszLong),
+          L"Reuses the listings of directories unchanged since they were last read, from a cache in %LOCALAPPDATA%\\TCDir.",
+          L"{InformationHighlight}Refresh{Information} reads every directory again and updates the cache." },
+        { format (L"{{InformationHighlight}}{0}Snapshot{{Information}}={{InformationHighlight}}file{{Information}}", pszLong),
+          L"Saves the recursive listing of the target directory to a snapshot file instead of displaying it.",
+          L"" },
+        { format (L"{{InformationHighlight}}{0}Diff{{Information}}={{InformationHighlight}}snapshot{{Information}}", pszLong),
+          L"Lists what was added, removed, or changed since the snapshot, in the target directory or a second snapshot.",
+          format (L"Cannot be combined with {{InformationHighlight}}{1}B{{Information}}, {{InformationHighlight}}{0}Tree{{Information}}, {{InformationHighlight}}{0}Usage{{Information}}, or {{InformationHighlight}}{0}Top{{Information}}.", pszLong, szShort) },
+        { format (L"{{InformationHighlight}}{0}Watch{{Information}}", pszLong),
+          L"Keeps the listing on screen and redraws it as files change, re-reading only the directories that changed.",
+          L"Press {InformationHighlight}Ctrl+C{Information} to stop." },
     };
 }
 
@@ -771,7 +814,7 @@ void CUsage::DisplayUsage (CConsole & console, wchar_t chPrefix, optional<bool>
     {
         { L"sortorder", L"{InformationHighlight}N{Information}  By name (alphabetic)",      L"{InformationHighlight}S{Information}  By size (smallest first)" },
         { L"",          L"{InformationHighlight}E{Information}  By extension (alphabetic)", L"{InformationHighlight}D{Information}  By date/time (oldest first)" },
-        { L"",          L"{InformationHighlight}-{Information}  Prefix to reverse order",   L"" },
+        { L"",          L"{InformationHighlight}V{Information}  By name, numbers by value", L"{InformationHighlight}-{Information}  Prefix to reverse order" },
     };
 
     AppendDetailGrid (usageBody, INDENT, subLevelDetailCol, COLUMN_GAP, SUBLEVEL_SECOND_COL_OFFSET, sortRows);
@@ -991,7 +1034,8 @@ void CUsage::DisplaySwitchConfiguration (CConsole & console, int columnWidthAttr
 
     bool fHasParams = config.m_cMaxDepth.has_value() ||
                       config.m_cTreeIndent.has_value() ||
-                      config.m_eSizeFormat.has_value();
+                      config.m_eSizeFormat.has_value() ||
+                      config.m_cThreads.has_value();
 
     if (!fHasSwitches && !fHasParams)
     {
@@ -1080,6 +1124,24 @@ void CUsage::DisplaySwitchConfiguration (CConsole & console, int columnWidthAttr
         console.Printf (sourceAttr,                        L"%-*ls", columnWidthSource, pszSource);
         console.Puts   (CConfig::EAttribute::Default,     L"");
     }
+
+    if (config.m_cThreads.has_value())
+    {
+        LPCWSTR pszSource = L"Default";
+        if (config.m_eThreadsSource == CConfig::EAttributeSource::ConfigFile)
+            pszSource = L"Config file";
+        else if (config.m_eThreadsSource == CConfig::EAttributeSource::Environment)
+            pszSource = L"Environment";
+
+        wstring value   = (config.m_cThreads.value() == CCommandLine::s_kcThreadsAuto) ? wstring (L"Auto") : to_wstring (config.m_cThreads.value());
+        wstring display = format (L"Threads   {}", value);
+        int pad = max (0, columnWidthAttr - static_cast<int> (display.size()));
+
+        console.Printf (CConfig::EAttribute::Information, L"  ");
+        console.Printf (CConfig::EAttribute::Default,     L"%ls%*ls  ", display.c_str(), pad, L"");
+        console.Printf (sourceAttr,                        L"%-*ls", columnWidthSource, pszSource);
+        console.Puts   (CConfig::EAttribute::Default,     L"");
+    }
 }
 
 
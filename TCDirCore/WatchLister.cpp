@@ -0,0 +1,424 @@
+#include "pch.h"
+#include "WatchLister.h"
+
+#include "AnsiCodes.h"
+#include "ChangeCoalescer.h"
+#include "CommandLine.h"
+#include "Config.h"
+#include "Console.h"
+#include "FileComparator.h"
+#include "Flag.h"
+#include "LinkFollowPolicy.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::CWatchLister
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CWatchLister::CWatchLister (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr, unique_ptr<IResultsDisplayer> displayer) :
+    CDirectoryLister (cmdLinePtr, consolePtr, configPtr, std::move (displayer))
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::Run
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWatchLister::Run (const MaskGroup & group, IChangeNotifier & notifier)
+{
+    HRESULT          hr        = S_OK;
+    CChangeCoalescer coalescer   (notifier);
+    size_t           cRead     = 0;
+
+
+
+    hr = Load (group);
+    CHR (hr);
+
+    Display();
+    DisplayStatus (m_cDirectoriesRead);
+
+    for (;;)
+    {
+        SChangeSet changes;
+
+        hr = coalescer.Wait (changes);
+        CHR (hr);
+
+        cRead = Refresh (changes);
+
+        Display();
+        DisplayStatus (cRead);
+    }
+
+
+
+Error:
+    m_consolePtr->Flush();
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::Load
+//
+//  Reads the whole tree.  Only the group's own directory failing to read
+//  is an error.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWatchLister::Load (const MaskGroup & group)
+{
+    HRESULT                          hr        = S_OK;
+    filesystem::path                 dirPath   = group.first;
+    const vector<filesystem::path> & fileSpecs = group.second;
+
+
+
+    // "C:\Src\" and "C:\Src" must name the same root, so changes map onto it
+    if (!dirPath.has_filename() && dirPath.has_relative_path())
+    {
+        dirPath = dirPath.parent_path();
+    }
+
+    m_pFileSpecMatcher = make_unique<CFileSpecMatcher> (fileSpecs);
+    m_pDriveInfo       = make_unique<CDriveInfo> (dirPath);
+    m_pRoot            = make_shared<CDirectoryInfo> (dirPath, fileSpecs);
+
+    hr = ReadDirectory (m_pRoot, true);
+    CHRF (hr, m_consolePtr->ColorPrintf (L"{Error}Error:   {InformationHighlight}%s{Error} does not exist\n", dirPath.c_str()));
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::Refresh
+//
+//  Reads each changed directory again, parents first (the set is sorted
+//  by path), so a parent that lost a subdirectory drops it before the
+//  subdirectory is looked up.  Changes in directories not in the tree are
+//  ignored: they were read whole as part of a new parent, or are gone.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+size_t CWatchLister::Refresh (const SChangeSet & changes)
+{
+    HRESULT hr      = S_OK;
+    size_t  cBefore = m_cDirectoriesRead;
+
+
+
+    if (changes.m_fRescan)
+    {
+        hr = ReadDirectory (m_pRoot, true);
+        IGNORE_RETURN_VALUE (hr, S_OK);
+    }
+    else
+    {
+        for (const filesystem::path & dirPath : changes.m_changedDirs)
+        {
+            shared_ptr<CDirectoryInfo> pDirInfo = FindDirectory (dirPath);
+
+            if (pDirInfo)
+            {
+                hr = ReadDirectory (pDirInfo, false);
+                IGNORE_RETURN_VALUE (hr, S_OK);
+            }
+        }
+    }
+
+    return m_cDirectoriesRead - cBefore;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::Display
+//
+//  Clears the screen and shows the tree in the order the single-threaded
+//  /S listing would, with totals summed from the nodes.  The console
+//  buffers the whole redraw, so it reaches the screen in one write.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CWatchLister::Display (void)
+{
+    SListingTotals totals;
+
+
+
+    m_consolePtr->Printf (CConfig::Information, L"%s", AnsiCodes::CLEAR_SCREEN);
+    m_consolePtr->Puts (CConfig::EAttribute::Default, L"");
+
+    DisplaySubtree (*m_pRoot, IResultsDisplayer::EDirectoryLevel::Initial, totals);
+
+    if (m_cmdLinePtr->m_fRecurse)
+    {
+        m_displayer->DisplayRecursiveSummary (*m_pRoot, totals);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::ReadDirectory
+//
+//  Replaces the node's matches with a fresh read, sorted.  With -S its
+//  subdirectories are matched by name to the nodes already below it:
+//  those still present keep their nodes (and, unless fWholeSubtree, their
+//  contents as last read), new ones are read with everything below them,
+//  and nodes for subdirectories that are gone are released.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWatchLister::ReadDirectory (const shared_ptr<CDirectoryInfo> & pDirInfo, bool fWholeSubtree)
+{
+    HRESULT                                            hr              = S_OK;
+    HRESULT                                            hrChild         = S_OK;
+    filesystem::path                                   dirPath         = pDirInfo->DirPath();
+    bool                                               fNeedShortNames = !m_pFileSpecMatcher->MatchesAll();
+    unordered_map<wstring, shared_ptr<CDirectoryInfo>> previous;
+    vector<shared_ptr<CDirectoryInfo>>                 vToRead;
+
+
+
+    for (shared_ptr<CDirectoryInfo> & pChild : pDirInfo->m_vChildren)
+    {
+        previous.emplace (pChild->m_strLeafName, std::move (pChild));
+    }
+
+    ResetListing (*pDirInfo);
+    ++m_cDirectoriesRead;
+
+    hr = m_pEnumerator->Enumerate (dirPath, L"*", fNeedShortNames, [&] (span<const WIN32_FIND_DATA> batch)
+    {
+        for (const WIN32_FIND_DATA & wfd : batch)
+        {
+            if (m_pFileSpecMatcher->Matches (wfd)                                             &&
+                CFlag::IsSet    (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesRequired) &&
+                CFlag::IsNotSet (wfd.dwFileAttributes, m_cmdLinePtr->m_dwAttributesExcluded) &&
+                m_cmdLinePtr->m_entryFilter.Matches (wfd))
+            {
+                AddMatchToList (wfd, *pDirInfo, nullptr);
+            }
+
+            if (!m_cmdLinePtr->m_fRecurse || CFlag::IsNotSet (wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+            {
+                continue;
+            }
+
+            if (CLinkFollowPolicy::IsDirectoryLink (wfd))
+            {
+                ++pDirInfo->m_cPrunedLinks;
+                continue;
+            }
+
+            auto it = previous.find (wfd.cFileName);
+
+            if (it != previous.end())
+            {
+                pDirInfo->m_vChildren.push_back (std::move (it->second));
+                previous.erase (it);
+
+                if (fWholeSubtree)
+                {
+                    vToRead.push_back (pDirInfo->m_vChildren.back());
+                }
+            }
+            else
+            {
+                pDirInfo->m_vChildren.push_back (make_shared<CDirectoryInfo> (pDirInfo, wfd.cFileName));
+                vToRead.push_back (pDirInfo->m_vChildren.back());
+            }
+        }
+
+        return true;
+    });
+
+    // An empty directory simply has no entries
+    if (hr == HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND))
+    {
+        hr = S_OK;
+    }
+
+    pDirInfo->m_hr = hr;
+
+    SortMatches (pDirInfo->m_vMatches, FileComparator (m_cmdLinePtr, *pDirInfo));
+
+    for (const shared_ptr<CDirectoryInfo> & pChild : vToRead)
+    {
+        hrChild = ReadDirectory (pChild, true);
+        IGNORE_RETURN_VALUE (hrChild, S_OK);
+    }
+
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::FindDirectory
+//
+//  The node for dirPath, or null if dirPath is not in the tree.  Names
+//  compare case-insensitively, as the file system does.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+shared_ptr<CDirectoryInfo> CWatchLister::FindDirectory (const filesystem::path & dirPath) const
+{
+    shared_ptr<CDirectoryInfo> pNode = m_pRoot;
+    auto                       it    = dirPath.begin();
+
+
+
+    for (const filesystem::path & element : m_pRoot->m_dirPath)
+    {
+        if (it == dirPath.end() || _wcsicmp (it->c_str(), element.c_str()) != 0)
+        {
+            return nullptr;
+        }
+
+        ++it;
+    }
+
+    for (; it != dirPath.end() && pNode; ++it)
+    {
+        shared_ptr<CDirectoryInfo> pParent = std::move (pNode);
+
+        // A trailing separator yields an empty last element
+        if (it->empty())
+        {
+            pNode = std::move (pParent);
+            continue;
+        }
+
+        for (const shared_ptr<CDirectoryInfo> & pChild : pParent->m_vChildren)
+        {
+            if (_wcsicmp (pChild->m_strLeafName.c_str(), it->c_str()) == 0)
+            {
+                pNode = pChild;
+                break;
+            }
+        }
+    }
+
+    return pNode;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::DisplaySubtree
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CWatchLister::DisplaySubtree (const CDirectoryInfo & di, IResultsDisplayer::EDirectoryLevel level, SListingTotals & totals)
+{
+    totals.m_cFiles                  += di.m_cFiles;
+    totals.m_uliFileBytes.QuadPart   += di.m_uliBytesUsed.QuadPart;
+    totals.m_cStreams                += di.m_cStreams;
+    totals.m_uliStreamBytes.QuadPart += di.m_uliStreamBytesUsed.QuadPart;
+    totals.m_cPrunedLinks            += di.m_cPrunedLinks;
+    totals.m_cDirectories            += di.m_cSubDirectories;
+
+    m_displayer->DisplayResults (*m_pDriveInfo, di, level);
+
+    for (const shared_ptr<CDirectoryInfo> & pChild : di.m_vChildren)
+    {
+        DisplaySubtree (*pChild, IResultsDisplayer::EDirectoryLevel::Subdirectory, totals);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::DisplayStatus
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CWatchLister::DisplayStatus (size_t cDirectoriesRead)
+{
+    SYSTEMTIME st = {};
+
+
+
+    GetLocalTime (&st);
+
+    m_consolePtr->ColorPrintf (L"{Information}Watching {InformationHighlight}%s{Information}: read %zu %s at %02u:%02u:%02u.  Press Ctrl+C to stop.\n",
+                               m_pRoot->m_dirPath.c_str(),
+                               cDirectoriesRead,
+                               cDirectoriesRead == 1 ? L"directory" : L"directories",
+                               st.wHour,
+                               st.wMinute,
+                               st.wSecond);
+
+    m_consolePtr->Flush();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister::ResetListing
+//
+//  Clears what the last read of the node collected.  The node itself is
+//  kept, since the nodes below it point at it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CWatchLister::ResetListing (CDirectoryInfo & di)
+{
+    di.m_vMatches.clear();
+    di.m_vNameArena.clear();
+    di.m_vChildren.clear();
+
+    di.m_uliLargestFileSize = {};
+    di.m_cchLargestFileName = 0;
+    di.m_cFiles             = 0;
+    di.m_cSubDirectories    = 0;
+    di.m_cStreams           = 0;
+    di.m_uliBytesUsed       = {};
+    di.m_uliStreamBytesUsed = {};
+    di.m_cPrunedLinks       = 0;
+    di.m_hr                 = S_OK;
+}
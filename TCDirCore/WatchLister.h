@@ -0,0 +1,58 @@
+#pragma once
+
+#include "DirectoryLister.h"
+#include "DriveInfo.h"
+#include "FileSpecMatcher.h"
+#include "IChangeNotifier.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWatchLister
+//
+//  --Watch: lists a directory (and with -S the tree below it), then keeps
+//  the listing on screen and current.  The CDirectoryInfo tree of the last
+//  pass is kept, each node with its matches already sorted; when the
+//  notifier reports changes only the changed directories are read and
+//  sorted again, and the screen is redrawn from the tree.
+//
+//  Directory links are listed but not entered, since changes below them
+//  are not reported.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CWatchLister : public CDirectoryLister
+{
+public:
+    CWatchLister (shared_ptr<CCommandLine> cmdLinePtr, shared_ptr<CConsole> consolePtr, shared_ptr<CConfig> configPtr, unique_ptr<IResultsDisplayer> displayer);
+
+    //
+    // Lists the group and redraws it after each burst of changes, until the
+    // notifier fails.  The notifier must already be watching the group's
+    // directory.
+    //
+
+    HRESULT Run     (const MaskGroup & group, IChangeNotifier & notifier);
+
+    HRESULT Load    (const MaskGroup & group);
+    size_t  Refresh (const SChangeSet & changes);        // Returns the number of directories read
+    void    Display (void);
+
+
+
+private:
+    HRESULT                    ReadDirectory  (const shared_ptr<CDirectoryInfo> & pDirInfo, bool fWholeSubtree);
+    shared_ptr<CDirectoryInfo> FindDirectory  (const filesystem::path & dirPath) const;
+    void                       DisplaySubtree (const CDirectoryInfo & di, IResultsDisplayer::EDirectoryLevel level, SListingTotals & totals);
+    void                       DisplayStatus  (size_t cDirectoriesRead);
+
+    static void                ResetListing   (CDirectoryInfo & di);
+
+    unique_ptr<CFileSpecMatcher> m_pFileSpecMatcher;
+    unique_ptr<CDriveInfo>       m_pDriveInfo;
+    shared_ptr<CDirectoryInfo>   m_pRoot;
+    size_t                       m_cDirectoriesRead = 0;
+};
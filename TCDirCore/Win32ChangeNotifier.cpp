@@ -0,0 +1,201 @@
+#include "pch.h"
+#include "Win32ChangeNotifier.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier::~CWin32ChangeNotifier
+//
+//  An outstanding read still owns the buffer, so it is cancelled and
+//  waited for before the buffer is freed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CWin32ChangeNotifier::~CWin32ChangeNotifier (void)
+{
+    DWORD cbReturned = 0;
+
+
+
+    if (m_fPending)
+    {
+        CancelIoEx (m_hDirectory, &m_overlapped);
+        GetOverlappedResult (m_hDirectory, &m_overlapped, &cbReturned, TRUE);
+    }
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier::Watch
+//
+//  Fails where the file system does not support change notification (some
+//  network file systems), so the caller can fall back to polling.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32ChangeNotifier::Watch (const filesystem::path & root, bool fRecursive)
+{
+    HRESULT hr = S_OK;
+
+
+
+    m_root       = root;
+    m_fRecursive = fRecursive;
+    m_vBuffer.resize (s_kcbBuffer / sizeof (DWORD));
+
+    m_hDirectory = CreateFileW (root.c_str(),
+                                FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                nullptr);
+    CWR (m_hDirectory != INVALID_HANDLE_VALUE);
+
+    m_hEvent = CreateEventW (nullptr, TRUE, FALSE, nullptr);
+    CWR (m_hEvent != nullptr);
+
+    hr = BeginRead();
+    CHR (hr);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier::WaitForChanges
+//
+//  Collects a completed read and starts the next one straight away, so
+//  changes made while the caller re-reads directories are queued by the
+//  system rather than lost.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32ChangeNotifier::WaitForChanges (DWORD msTimeout, SChangeSet & changes)
+{
+    HRESULT hr         = S_OK;
+    DWORD   dwWait     = 0;
+    DWORD   cbReturned = 0;
+
+
+
+    CBRAEx (m_fPending, E_UNEXPECTED);
+
+    dwWait = WaitForSingleObject (m_hEvent, msTimeout);
+    BAIL_OUT_IF (dwWait == WAIT_TIMEOUT, S_FALSE);
+    CWR (dwWait == WAIT_OBJECT_0);
+
+    m_fPending = false;
+
+    if (!GetOverlappedResult (m_hDirectory, &m_overlapped, &cbReturned, FALSE))
+    {
+        // ERROR_NOTIFY_ENUM_DIR: the changes did not fit and were discarded
+        CWR (GetLastError() == ERROR_NOTIFY_ENUM_DIR);
+        cbReturned = 0;
+    }
+
+    if (cbReturned == 0)
+    {
+        changes.m_fRescan = true;
+    }
+    else
+    {
+        AddChanges (cbReturned, changes);
+    }
+
+    hr = BeginRead();
+    CHR (hr);
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier::BeginRead
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32ChangeNotifier::BeginRead (void)
+{
+    HRESULT hr = S_OK;
+
+
+
+    m_overlapped        = {};
+    m_overlapped.hEvent = m_hEvent;
+
+    CWR (ResetEvent (m_hEvent));
+
+    CWR (ReadDirectoryChangesW (m_hDirectory,
+                                m_vBuffer.data(),
+                                static_cast<DWORD> (m_vBuffer.size() * sizeof (DWORD)),
+                                m_fRecursive,
+                                s_kdwFilter,
+                                nullptr,
+                                &m_overlapped,
+                                nullptr));
+
+    m_fPending = true;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier::AddChanges
+//
+//  A build touching thousands of files in a handful of directories yields
+//  thousands of records but only that handful of directories.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CWin32ChangeNotifier::AddChanges (DWORD cbReturned, SChangeSet & changes) const
+{
+    const BYTE * pbRecord = reinterpret_cast<const BYTE *> (m_vBuffer.data());
+    const BYTE * pbEnd    = pbRecord + cbReturned;
+
+
+
+    while (pbRecord + sizeof (FILE_NOTIFY_INFORMATION) <= pbEnd)
+    {
+        const FILE_NOTIFY_INFORMATION * pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION *> (pbRecord);
+        wstring_view                    name    (pInfo->FileName, pInfo->FileNameLength / sizeof (WCHAR));
+
+        changes.m_changedDirs.insert ((m_root / name).parent_path());
+
+        if (pInfo->NextEntryOffset == 0)
+        {
+            break;
+        }
+
+        pbRecord += pInfo->NextEntryOffset;
+    }
+}
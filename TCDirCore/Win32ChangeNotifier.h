@@ -0,0 +1,52 @@
+#pragma once
+
+#include "AutoHandle.h"
+#include "IChangeNotifier.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32ChangeNotifier
+//
+//  Watches a tree with one overlapped ReadDirectoryChangesW on its root.
+//  Each notification names an entry relative to the root; the directory
+//  holding it is the one whose listing changed.  When more changes arrive
+//  than the buffer holds the system discards them all, and the whole tree
+//  is read again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CWin32ChangeNotifier : public IChangeNotifier
+{
+public:
+    ~CWin32ChangeNotifier (void);
+
+    HRESULT Watch          (const filesystem::path & root, bool fRecursive) override;
+    HRESULT WaitForChanges (DWORD msTimeout, SChangeSet & changes) override;
+
+
+
+private:
+    static constexpr DWORD s_kcbBuffer = 64 * 1024;         // The most a network share will return at once
+
+    static constexpr DWORD s_kdwFilter = FILE_NOTIFY_CHANGE_FILE_NAME  |
+                                         FILE_NOTIFY_CHANGE_DIR_NAME   |
+                                         FILE_NOTIFY_CHANGE_ATTRIBUTES |
+                                         FILE_NOTIFY_CHANGE_SIZE       |
+                                         FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                         FILE_NOTIFY_CHANGE_CREATION;
+
+    HRESULT BeginRead  (void);
+    void    AddChanges (DWORD cbReturned, SChangeSet & changes) const;
+
+    AutoHandle       m_hDirectory;
+    AutoHandle       m_hEvent;
+    OVERLAPPED       m_overlapped = {};
+    vector<DWORD>    m_vBuffer;                              // FILE_NOTIFY_INFORMATION records must be DWORD aligned
+    filesystem::path m_root;
+    bool             m_fRecursive = false;
+    bool             m_fPending   = false;                   // A read is outstanding on m_vBuffer
+};
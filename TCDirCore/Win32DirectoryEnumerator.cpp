@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "Win32DirectoryEnumerator.h"
+
+#include "AutoHandle.h"
+#include "DirectoryLister.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32DirectoryEnumerator::Enumerate
+//
+//  FindFirstFileEx/FindNextFile write straight into the batch buffer, so
+//  each entry is copied only when the caller consumes it.  "." and ".."
+//  are dropped by leaving their slot to be overwritten by the next entry.
+//
+//  A failure part way through the directory is reported after the entries
+//  read so far have been delivered.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32DirectoryEnumerator::Enumerate (
+    const filesystem::path & dirPath,
+    const filesystem::path & fileSpec,
+    bool                     fNeedShortNames,
+    const BatchCallback    & onBatch) const
+{
+    HRESULT                 hr              = S_OK;
+    filesystem::path        pathAndFileSpec = dirPath / fileSpec;
+    FINDEX_INFO_LEVELS      infoLevel       = fNeedShortNames ? FindExInfoStandard : FindExInfoBasic;
+    vector<WIN32_FIND_DATA> vBatch            (s_kcEntriesPerBatch);
+    size_t                  cEntries        = 0;
+    bool                    fContinue       = true;
+    AutoFindHandle          hFind;
+
+
+
+    hFind = FindFirstFileEx (pathAndFileSpec.c_str(),
+                             infoLevel,
+                             &vBatch[0],
+                             FindExSearchNameMatch,
+                             nullptr,
+                             FIND_FIRST_EX_LARGE_FETCH);
+    CWR (hFind != INVALID_HANDLE_VALUE);
+
+    do
+    {
+        if (!CDirectoryLister::IsDots (vBatch[cEntries].cFileName))
+        {
+            ++cEntries;
+        }
+
+        if (cEntries == vBatch.size())
+        {
+            fContinue = onBatch (span<const WIN32_FIND_DATA> (vBatch.data(), cEntries));
+            cEntries  = 0;
+        }
+    }
+    while (fContinue && FindNextFile (hFind, &vBatch[cEntries]));
+
+    if (fContinue)
+    {
+        DWORD dwError = GetLastError();
+
+
+
+        if (cEntries > 0)
+        {
+            onBatch (span<const WIN32_FIND_DATA> (vBatch.data(), cEntries));
+        }
+
+        CBRAEx (dwError == ERROR_NO_MORE_FILES, HRESULT_FROM_WIN32 (dwError));
+    }
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32DirectoryEnumerator::GetDirectoryId
+//
+//  Opens the directory for attributes only (FILE_FLAG_BACKUP_SEMANTICS is
+//  required to open a directory at all) without FILE_FLAG_OPEN_REPARSE_POINT,
+//  so a junction or symlink is resolved to its target.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32DirectoryEnumerator::GetDirectoryId (
+    const filesystem::path & dirPath,
+    SDirectoryId           & id) const
+{
+    HRESULT      hr     = S_OK;
+    FILE_ID_INFO idInfo = {};
+    AutoHandle   hDir;
+
+
+
+    hDir = CreateFileW (dirPath.c_str(),
+                        FILE_READ_ATTRIBUTES,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr,
+                        OPEN_EXISTING,
+                        FILE_FLAG_BACKUP_SEMANTICS,
+                        nullptr);
+    CWR (hDir != INVALID_HANDLE_VALUE);
+
+    CWR (GetFileInformationByHandleEx (hDir, FileIdInfo, &idInfo, sizeof (idInfo)));
+
+    id.m_ullVolumeSerial = idInfo.VolumeSerialNumber;
+    id.m_fileId          = idInfo.FileId;
+
+
+
+Error:
+    return hr;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32DirectoryEnumerator::GetDirectoryStamp
+//
+//  One attribute query; on a share it is a single round trip rather than
+//  a read of the whole directory.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT CWin32DirectoryEnumerator::GetDirectoryStamp (
+    const filesystem::path & dirPath,
+    ULONGLONG              & ullStamp) const
+{
+    HRESULT                   hr   = S_OK;
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+
+
+
+    CWR (GetFileAttributesExW (dirPath.c_str(), GetFileExInfoStandard, &data));
+
+    ullStamp = (static_cast<ULONGLONG> (data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+
+
+Error:
+    return hr;
+}
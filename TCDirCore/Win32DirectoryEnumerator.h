@@ -0,0 +1,35 @@
+#pragma once
+
+#include "IDirectoryEnumerator.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWin32DirectoryEnumerator
+//
+//  Reads directories with FindFirstFileEx.  FIND_FIRST_EX_LARGE_FETCH asks
+//  the file system for entries in larger buffers, and FindExInfoBasic skips
+//  the 8.3 short name lookup whenever the caller does not need it.
+//  Directory IDs come from GetFileInformationByHandleEx (FileIdInfo).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class CWin32DirectoryEnumerator : public IDirectoryEnumerator
+{
+public:
+    HRESULT Enumerate (const filesystem::path & dirPath,
+                       const filesystem::path & fileSpec,
+                       bool                     fNeedShortNames,
+                       const BatchCallback    & onBatch) const override;
+
+    HRESULT GetDirectoryId (const filesystem::path & dirPath,
+                            SDirectoryId           & id) const override;
+
+    HRESULT GetDirectoryStamp (const filesystem::path & dirPath,
+                               ULONGLONG              & ullStamp) const override;
+
+    static constexpr size_t s_kcEntriesPerBatch = 64;
+};
@@ -1,11 +1,13 @@
 #pragma once
 
+#include "IWorkQueue.h"
+
 
 
 
 
 template<typename T>
-class CWorkQueue
+class CWorkQueue : public IWorkQueue<T>
 {
 public:
     CWorkQueue() : m_fDone (false) {} 
@@ -13,7 +15,7 @@ public:
     
 
 
-    void Push (T item)
+    void Push (T item) override
     {
         unique_lock<mutex> lock (m_mutex);
         
@@ -26,7 +28,7 @@ public:
     
 
 
-    bool Pop (T & item)
+    bool Pop (size_t, T & item) override
     {
         unique_lock<mutex> lock (m_mutex);
         
@@ -46,7 +48,7 @@ public:
     
 
 
-    void SetDone()
+    void SetDone() override
     {
         lock_guard<mutex> lock (m_mutex);
         m_fDone = true;
@@ -54,10 +56,18 @@ public:
     }
     
 
+
+    size_t GetQueuedCount (void) const override
+    {
+        lock_guard<mutex> lock (m_mutex);
+        return m_queue.size();
+    }
+    
+
     
 private:
     queue<T>            m_queue;
-    mutex               m_mutex;
+    mutable mutex       m_mutex;
     condition_variable  m_cv;
     bool                m_fDone;
 };
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "IWorkQueue.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CWorkStealingQueue
+//
+//  Work-stealing scheduler for the directory enumeration workers.  Each
+//  worker owns a deque; items pushed from a worker thread go to the back of
+//  that worker's own deque and are popped from the back again (LIFO), so a
+//  worker keeps descending into the subtree it just discovered with warm
+//  caches and without touching any shared lock.  An idle worker steals from
+//  the front of another worker's deque (FIFO), taking the oldest — and
+//  typically largest — pending subtree.
+//
+//  Items pushed from a non-worker thread (the root) are distributed round
+//  robin.  Workers with nothing to run or steal sleep on a single condition
+//  variable that is only touched when somebody is actually asleep.
+//
+//  PushUrgent puts an item on a shared min-heap (ordered by T's operator<)
+//  that every worker checks before its own deque, so items the display is
+//  waiting on jump ahead of speculative work.
+//
+//  Pop/SetDone semantics match CWorkQueue: Pop blocks until an item is
+//  available and returns false once SetDone has been called and no item can
+//  be found; Push after SetDone is ignored.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+class CWorkStealingQueue : public IWorkQueue<T>
+{
+public:
+    explicit CWorkStealingQueue (size_t cWorkers) :
+        m_fDone (false)
+    {
+        size_t cDeques = (std::max) (cWorkers, size_t (1));
+
+
+
+        m_vDeques.reserve (cDeques);
+
+        for (size_t i = 0; i < cDeques; ++i)
+        {
+            m_vDeques.push_back (make_unique<SWorkerDeque>());
+        }
+    }
+
+
+
+    ~CWorkStealingQueue()
+    {
+        if (s_pCurrentQueue == this)
+        {
+            s_pCurrentQueue = nullptr;
+        }
+    }
+
+
+
+    void Push (T item) override
+    {
+        size_t iDeque = 0;
+
+
+
+        if (m_fDone.load (memory_order_acquire))
+        {
+            return;
+        }
+
+        //
+        // A worker pushes onto its own deque; anybody else spreads the
+        // items across all deques so that every worker finds work without
+        // having to steal first.
+        //
+
+        if (s_pCurrentQueue == this)
+        {
+            iDeque = s_iCurrentWorker;
+        }
+        else
+        {
+            iDeque = m_iNextExternal.fetch_add (1, memory_order_relaxed) % m_vDeques.size();
+        }
+
+        //
+        // Count the item before it becomes visible: once it is in the deque
+        // another worker may steal it and decrement m_cQueued at once.
+        //
+
+        m_cQueued.fetch_add (1, memory_order_seq_cst);
+
+        try
+        {
+            SWorkerDeque    & workerDeque = *m_vDeques[iDeque];
+            lock_guard<mutex> lock (workerDeque.m_mutex);
+
+            workerDeque.m_items.push_back (move (item));
+        }
+        catch (...)
+        {
+            m_cQueued.fetch_sub (1, memory_order_relaxed);
+            throw;
+        }
+
+        WakeSleeper();
+    }
+
+
+
+    void PushUrgent (T item) override
+    {
+        if (m_fDone.load (memory_order_acquire))
+        {
+            return;
+        }
+
+        m_cQueued.fetch_add (1, memory_order_seq_cst);
+
+        try
+        {
+            lock_guard<mutex> lock (m_urgentMutex);
+
+            m_vUrgent.push_back (move (item));
+            push_heap (m_vUrgent.begin(), m_vUrgent.end(), IsLowerPriority);
+
+            // Under the lock, so TryPopUrgent never decrements it first
+            m_cUrgent.fetch_add (1, memory_order_release);
+        }
+        catch (...)
+        {
+            m_cQueued.fetch_sub (1, memory_order_relaxed);
+            throw;
+        }
+
+        WakeSleeper();
+    }
+
+
+
+    bool Pop (size_t iWorker, T & item) override
+    {
+        ASSERT (iWorker < m_vDeques.size());
+
+        s_pCurrentQueue  = this;
+        s_iCurrentWorker = iWorker;
+
+        for (;;)
+        {
+            if (TryPopUrgent (item))
+            {
+                return true;
+            }
+
+            if (TryPopLocal (iWorker, item) || TrySteal (iWorker, item))
+            {
+                m_cQueued.fetch_sub (1, memory_order_relaxed);
+                return true;
+            }
+
+            if (m_fDone.load (memory_order_acquire))
+            {
+                return false;
+            }
+
+            //
+            // Nothing to run and nothing to steal: sleep until an item is
+            // pushed or the queue is shut down.
+            //
+
+            unique_lock<mutex> lock (m_idleMutex);
+
+            m_cSleepers.fetch_add (1, memory_order_seq_cst);
+
+            m_cvIdle.wait (lock, [this] {
+                return m_cQueued.load (memory_order_seq_cst) > 0 || m_fDone.load (memory_order_acquire);
+            });
+
+            m_cSleepers.fetch_sub (1, memory_order_relaxed);
+        }
+    }
+
+
+
+    void SetDone() override
+    {
+        lock_guard<mutex> lock (m_idleMutex);
+        m_fDone.store (true, memory_order_release);
+        m_cvIdle.notify_all();
+    }
+
+
+
+    size_t GetQueuedCount (void) const override
+    {
+        return m_cQueued.load (memory_order_relaxed);
+    }
+
+
+
+    bool TryPopUrgent (T & item) override
+    {
+        // Cheap check so the common case never touches the shared lock
+        if (m_cUrgent.load (memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        {
+            lock_guard<mutex> lock (m_urgentMutex);
+
+            if (m_vUrgent.empty())
+            {
+                return false;
+            }
+
+            pop_heap (m_vUrgent.begin(), m_vUrgent.end(), IsLowerPriority);
+            item = move (m_vUrgent.back());
+            m_vUrgent.pop_back();
+
+            m_cUrgent.fetch_sub (1, memory_order_relaxed);
+        }
+
+        m_cQueued.fetch_sub (1, memory_order_relaxed);
+
+        return true;
+    }
+
+
+
+    bool HasUrgent (void) const override
+    {
+        return m_cUrgent.load (memory_order_acquire) > 0;
+    }
+
+
+
+private:
+    static constexpr size_t s_kcbCacheLine = 64;
+
+    //
+    // Each deque sits on its own cache line so that workers pushing and
+    // popping their own deques do not false-share with each other.
+    //
+
+    struct alignas(s_kcbCacheLine) SWorkerDeque
+    {
+        mutex    m_mutex;
+        deque<T> m_items;
+    };
+
+
+
+    void WakeSleeper (void)
+    {
+        //
+        // Only pay for the idle lock when a worker is (or is about to be)
+        // asleep.  Acquiring the lock before notifying closes the window in
+        // which a sleeper has checked m_cQueued but not yet started waiting.
+        //
+
+        if (m_cSleepers.load (memory_order_seq_cst) > 0)
+        {
+            {
+                lock_guard<mutex> lock (m_idleMutex);
+            }
+
+            m_cvIdle.notify_one();
+        }
+    }
+
+
+
+    static bool IsLowerPriority (const T & a, const T & b)
+    {
+        return b < a;   // Makes the heap a min-heap
+    }
+
+
+
+    bool TryPopLocal (size_t iWorker, T & item)
+    {
+        SWorkerDeque    & workerDeque = *m_vDeques[iWorker];
+        lock_guard<mutex> lock (workerDeque.m_mutex);
+
+
+
+        if (workerDeque.m_items.empty())
+        {
+            return false;
+        }
+
+        item = move (workerDeque.m_items.back());
+        workerDeque.m_items.pop_back();
+
+        return true;
+    }
+
+
+
+    bool TrySteal (size_t iThief, T & item)
+    {
+        size_t cDeques = m_vDeques.size();
+
+
+
+        for (size_t i = 1; i < cDeques; ++i)
+        {
+            SWorkerDeque    & victim = *m_vDeques[(iThief + i) % cDeques];
+            lock_guard<mutex> lock (victim.m_mutex);
+
+            if (!victim.m_items.empty())
+            {
+                item = move (victim.m_items.front());
+                victim.m_items.pop_front();
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+
+    //
+    // Identity of the worker running on the current thread, set by Pop.
+    // Lets Push route a worker's items to its own deque without threading
+    // the worker index through every caller.
+    //
+
+    static inline thread_local CWorkStealingQueue * s_pCurrentQueue  = nullptr;
+    static inline thread_local size_t               s_iCurrentWorker = 0;
+
+    vector<unique_ptr<SWorkerDeque>> m_vDeques;
+    mutex                            m_urgentMutex;
+    vector<T>                        m_vUrgent;              // Min-heap, see IsLowerPriority
+    atomic<size_t>                   m_cUrgent       { 0 };
+    atomic<size_t>                   m_cQueued       { 0 };
+    atomic<size_t>                   m_iNextExternal { 0 };
+    atomic<size_t>                   m_cSleepers     { 0 };
+    mutex                            m_idleMutex;
+    condition_variable               m_cvIdle;
+    atomic<bool>                     m_fDone;
+};
@@ -20,6 +20,7 @@
 #include <cfapi.h>
 #include <lmcons.h>
 #include <pathcch.h>
+#include <psapi.h>
 #include <shellapi.h>
 #include <shlobj.h>
 #include <strsafe.h>
@@ -40,6 +41,11 @@
 
 // C headers
 #include <assert.h>
+#if defined(_M_X64) || defined(_M_IX86)
+    #include <emmintrin.h>
+#elif defined(_M_ARM64)
+    #include <arm_neon.h>
+#endif
 #include <math.h>
 #include <shlwapi.h>
 #include <stdarg.h>
@@ -49,21 +55,29 @@
 
 // C++ headers
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <ranges>
+#include <regex>
+#include <set>
 #include <string>
 #include <string_view>
+#include <span>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
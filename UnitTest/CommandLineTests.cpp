@@ -129,6 +129,24 @@ namespace UnitTest
 
 
 
+        TEST_METHOD(ParseOrderNatural)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"/oV";
+            wchar_t       * argv1[] = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse(1, argv1);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (static_cast<int>(CCommandLine::ESortOrder::SO_NATURAL), static_cast<int>(cl.m_sortorder));
+            Assert::AreEqual (static_cast<int>(CCommandLine::ESortOrder::SO_NATURAL), static_cast<int>(cl.m_rgSortPreference[0]));
+            Assert::AreEqual (static_cast<int>(CCommandLine::ESortOrder::SO_NAME),    static_cast<int>(cl.m_rgSortPreference[1]));
+        }
+
+
+
+
         TEST_METHOD(ParseAttributesAndFlags)
         {
             CCommandLine    cl;
@@ -1107,6 +1125,23 @@ namespace UnitTest
                 { L"TreeWithRecurse",             { L"--Tree", L"/s" },                       L"--Tree" },
                 { L"TreeWithOwner",               { L"--Tree", L"--Owner" },                  L"--Tree" },
                 { L"TreeWithSizeBytes",           { L"--Tree", L"--Size=Bytes" },             L"--Size=Bytes" },
+                { L"TreeWithTop",                 { L"--Tree", L"--Top=10" },                 L"--Top" },
+                { L"TopZero",                     { L"--Top=0" },                             L"--Top" },
+                { L"UsageWithTree",               { L"--Usage", L"--Tree" },                  L"--Usage" },
+                { L"UsageWithTop",                { L"--Usage", L"--Top=10" },                L"--Usage" },
+                { L"CacheBadValue",               { L"--Cache=Sometimes" },                   L"--Cache" },
+                { L"SnapshotWithDiff",            { L"--Snapshot=a.snap", L"--Diff=b.snap" }, L"--Snapshot and --Diff" },
+                { L"DiffWithBare",                { L"--Diff=old.snap", L"/b" },              L"--Snapshot and --Diff" },
+                { L"DiffWithTwoTargets",          { L"--Diff=old.snap", L"C:\\A", L"C:\\B" }, L"single directory" },
+                { L"WatchWithTree",               { L"--Watch", L"--Tree" },                  L"--Watch" },
+                { L"WatchWithCache",              { L"--Watch", L"--Cache=Read" },            L"--Watch" },
+                { L"SizeBoundBadUnit",            { L"--Size>10Q" },                          L"--Size" },
+                { L"SizeBoundNoNumber",           { L"--Size=+" },                            L"--Size" },
+                { L"NewerBadDate",                { L"--Newer=2026-13-01" },                  L"--Newer" },
+                { L"RegexInvalid",                { L"--Regex=(unclosed" },                   L"--Regex" },
+                { L"SnapshotWithSizeBound",       { L"--Snapshot=a.snap", L"--Size>1M" },     L"--Snapshot and --Diff" },
+                { L"RecursiveGlobWithTree",       { L"--Tree", L"**\\*.cpp" },                L"Recursive masks" },
+                { L"RecursiveGlobWithWatch",      { L"--Watch", L"src\\*\\*.h" },             L"Recursive masks" },
                 { L"DepthWithoutTree",            { L"--Depth=3" },                           L"--Depth" },
                 { L"TreeIndentWithoutTree",       { L"--TreeIndent=2" },                      L"--TreeIndent" },
                 { L"TreeIndentOutOfRange",        { L"--Tree", L"--TreeIndent=10" },          L"--TreeIndent" },
@@ -1857,5 +1892,467 @@ namespace UnitTest
             Assert::IsTrue (cl.m_eSizeFormat == ESizeFormat::Bytes);
         }
 
+
+
+        //
+        //  --ReadAhead=N switch parsing
+        //
+
+        TEST_METHOD(ParseReadAheadWithEquals)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--ReadAhead=5000";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (5000, cl.m_cReadAhead);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseReadAheadZeroMeansUnlimited)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"-S";
+            const wchar_t * a2      = L"--ReadAhead";
+            const wchar_t * a3      = L"0";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2), const_cast<wchar_t *>(a3) };
+            HRESULT         hr      = cl.Parse (3, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (0, cl.m_cReadAhead);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseReadAheadNegativeFails)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--ReadAhead=-1";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (FAILED(hr));
+            Assert::IsTrue (cl.m_strValidationError.find(L"--ReadAhead") != wstring::npos);
+        }
+
+
+
+
+
+        //
+        //  --Threads=N|Auto and --Benchmark switch parsing
+        //
+
+        TEST_METHOD(ParseThreadsDefaultIsOnePerCpu)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"-S";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (0, cl.m_cThreads);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseThreadsWithEquals)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Threads=8";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (8, cl.m_cThreads);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseThreadsAuto)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--threads=auto";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (CCommandLine::s_kcThreadsAuto, cl.m_cThreads);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseThreadsOutOfRangeFails)
+        {
+            const wchar_t * rgValues[] = { L"--Threads=0", L"--Threads=257", L"--Threads=lots" };
+
+
+
+            for (const wchar_t * pszArg : rgValues)
+            {
+                CCommandLine cl;
+                wchar_t    * argv[] = { const_cast<wchar_t *>(pszArg) };
+                HRESULT      hr     = cl.Parse (1, argv);
+
+                Assert::IsTrue (FAILED(hr), pszArg);
+                Assert::IsTrue (cl.m_strValidationError.find(L"--Threads") != wstring::npos, pszArg);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ApplyConfigDefaults_Threads_CommandLineOverrides)
+        {
+            CConfig         config;
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Threads=2";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = S_OK;
+
+            config.SetEnvironmentProvider (&s_noOpEnv);
+            config.Initialize (FC_LightGrey);
+            config.m_cThreads = CCommandLine::s_kcThreadsAuto;
+
+            cl.ApplyConfigDefaults (config);
+            Assert::AreEqual (CCommandLine::s_kcThreadsAuto, cl.m_cThreads);
+
+            hr = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (2, cl.m_cThreads);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseBenchmark)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Benchmark";
+            const wchar_t * a2      = L"--Threads";
+            const wchar_t * a3      = L"4";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2), const_cast<wchar_t *>(a3) };
+            HRESULT         hr      = cl.Parse (3, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsTrue (cl.m_fBenchmark);
+            Assert::AreEqual (4, cl.m_cThreads);
+        }
+
+
+
+
+
+        //
+        //  --Follow=Never|Once|Always switch parsing
+        //
+
+        TEST_METHOD(ParseFollowDefault)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"-S";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsTrue (cl.m_eFollowLinks == CCommandLine::EFollowLinks::Default);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseFollowValues)
+        {
+            struct { const wchar_t * pszArg; CCommandLine::EFollowLinks eExpected; } rgCases[] =
+            {
+                { L"--Follow=Never",  CCommandLine::EFollowLinks::Never  },
+                { L"--follow=once",   CCommandLine::EFollowLinks::Once   },
+                { L"--FOLLOW=ALWAYS", CCommandLine::EFollowLinks::Always },
+            };
+
+
+
+            for (const auto & testCase : rgCases)
+            {
+                CCommandLine cl;
+                wchar_t    * argv[] = { const_cast<wchar_t *>(testCase.pszArg) };
+                HRESULT      hr     = cl.Parse (1, argv);
+
+                Assert::IsTrue (SUCCEEDED(hr), testCase.pszArg);
+                Assert::IsTrue (cl.m_eFollowLinks == testCase.eExpected, testCase.pszArg);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ParseFollowInvalidFails)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Follow=Sometimes";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (FAILED(hr));
+            Assert::IsTrue (cl.m_strValidationError.find(L"--Follow") != wstring::npos);
+        }
+
+
+
+
+
+        //
+        //  --Sort=Ordinal|Locale switch parsing
+        //
+
+        TEST_METHOD(ParseSortValues)
+        {
+            struct { const wchar_t * pszArg; CCommandLine::ENameCompare eExpected; } rgCases[] =
+            {
+                { L"--Sort=Locale",  CCommandLine::ENameCompare::Locale  },
+                { L"--sort=ordinal", CCommandLine::ENameCompare::Ordinal },
+            };
+
+
+
+            Assert::IsTrue (CCommandLine().m_eNameCompare == CCommandLine::ENameCompare::Ordinal);
+
+            for (const auto & testCase : rgCases)
+            {
+                CCommandLine cl;
+                wchar_t    * argv[] = { const_cast<wchar_t *>(testCase.pszArg) };
+                HRESULT      hr     = cl.Parse (1, argv);
+
+                Assert::IsTrue (SUCCEEDED(hr), testCase.pszArg);
+                Assert::IsTrue (cl.m_eNameCompare == testCase.eExpected, testCase.pszArg);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ParseSortInvalidFails)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Sort=Natural";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1) };
+            HRESULT         hr      = cl.Parse (1, argv);
+
+
+
+            Assert::IsTrue (FAILED(hr));
+            Assert::IsTrue (cl.m_strValidationError.find(L"--Sort") != wstring::npos);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseTopValue)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"/s";
+            const wchar_t * a2      = L"--Top";
+            const wchar_t * a3      = L"50";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2), const_cast<wchar_t *>(a3) };
+            HRESULT         hr      = cl.Parse (3, argv);
+
+
+
+            Assert::AreEqual (0, CCommandLine().m_cTop);
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (50, cl.m_cTop);
+        }
+
+
+
+
+        TEST_METHOD(ParseUsageWithDepth)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Usage";
+            const wchar_t * a2      = L"--Depth=2";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2) };
+            HRESULT         hr      = cl.Parse (2, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsTrue (cl.m_fUsage);
+            Assert::AreEqual (2, cl.m_cMaxDepth);
+            Assert::IsTrue (cl.m_eSizeFormat == ESizeFormat::Auto);
+        }
+
+
+
+
+
+        //
+        //  --Cache=Off|Read|Refresh switch parsing
+        //
+
+        TEST_METHOD(ParseCacheValues)
+        {
+            struct { const wchar_t * pszArg; CCommandLine::ECacheMode eExpected; } rgCases[] =
+            {
+                { L"--Cache=Read",    CCommandLine::ECacheMode::Read    },
+                { L"--cache=refresh", CCommandLine::ECacheMode::Refresh },
+                { L"--Cache=OFF",     CCommandLine::ECacheMode::Off     },
+            };
+
+
+
+            Assert::IsTrue (CCommandLine().m_eCacheMode == CCommandLine::ECacheMode::Off);
+
+            for (const auto & testCase : rgCases)
+            {
+                CCommandLine cl;
+                wchar_t    * argv[] = { const_cast<wchar_t *>(testCase.pszArg) };
+                HRESULT      hr     = cl.Parse (1, argv);
+
+                Assert::IsTrue (SUCCEEDED(hr), testCase.pszArg);
+                Assert::IsTrue (cl.m_eCacheMode == testCase.eExpected, testCase.pszArg);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ParseSnapshotAndDiffImplyRecursion)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1      = L"--Snapshot=C:\\Audit\\Build 42.snap";
+            const wchar_t * a2      = L"C:\\Build\\Out";
+            wchar_t       * argv[]  = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2) };
+            HRESULT         hr      = cl.Parse (2, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (wstring (L"C:\\Audit\\Build 42.snap"), cl.m_strSnapshotFile);
+            Assert::IsTrue (cl.m_strDiffBase.empty());
+            Assert::IsTrue (cl.m_fRecurse);
+
+            CCommandLine    clDiff;
+            const wchar_t * b1      = L"--diff=old.snap";
+            wchar_t       * argvDiff[] = { const_cast<wchar_t *>(b1) };
+
+            hr = clDiff.Parse (1, argvDiff);
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::AreEqual (wstring (L"old.snap"), clDiff.m_strDiffBase);
+            Assert::IsTrue (clDiff.m_fRecurse);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseEntryFilters)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1     = L"--Size>1K";
+            const wchar_t * a2     = L"--Size=-1M";
+            const wchar_t * a3     = L"--Newer=2026-10-01";
+            const wchar_t * a4     = L"--Regex=\\.cpp$";
+            const wchar_t * a5     = L"/T:C";
+            wchar_t       * argv[] = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2), const_cast<wchar_t *>(a3),
+                                       const_cast<wchar_t *>(a4), const_cast<wchar_t *>(a5) };
+            HRESULT         hr     = cl.Parse (5, argv);
+            ULONGLONG       ftDate = 0;
+            WIN32_FIND_DATA wfd    = {};
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsFalse (cl.m_entryFilter.IsEmpty());
+            Assert::IsTrue (cl.m_eSizeFormat == ESizeFormat::Bytes, L"Size bounds leave the size format alone");
+
+            Assert::AreEqual (S_OK, CEntryFilter::ParseDate (L"2026-10-01", ftDate));
+
+            wcscpy_s (wfd.cFileName, L"Main.cpp");
+            wfd.nFileSizeLow                  = 4096;
+            wfd.ftCreationTime.dwLowDateTime  = static_cast<DWORD> (ftDate);
+            wfd.ftCreationTime.dwHighDateTime = static_cast<DWORD> (ftDate >> 32);
+
+            // /T:C came after --Newer, and still selects the field it compares
+            Assert::IsTrue (cl.m_entryFilter.Matches (wfd));
+
+            wfd.nFileSizeLow = 1024;
+            Assert::IsFalse (cl.m_entryFilter.Matches (wfd));
+
+            wfd.nFileSizeLow = 4096;
+            wcscpy_s (wfd.cFileName, L"Main.h");
+            Assert::IsFalse (cl.m_entryFilter.Matches (wfd));
+        }
+
+
+
+
+
+        TEST_METHOD(ParseWatch)
+        {
+            CCommandLine    cl;
+            const wchar_t * a1     = L"--watch";
+            const wchar_t * a2     = L"/s";
+            wchar_t       * argv[] = { const_cast<wchar_t *>(a1), const_cast<wchar_t *>(a2) };
+            HRESULT         hr     = cl.Parse (2, argv);
+
+
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsTrue (cl.m_fWatch);
+            Assert::IsTrue (cl.m_fRecurse);
+
+            // Off by default
+            CCommandLine    clDefault;
+            const wchar_t * b1         = L"*.cpp";
+            wchar_t       * argvDefault[] = { const_cast<wchar_t *>(b1) };
+
+            hr = clDefault.Parse (1, argvDefault);
+
+            Assert::IsTrue (SUCCEEDED(hr));
+            Assert::IsFalse (clDefault.m_fWatch);
+        }
+
     };
 }
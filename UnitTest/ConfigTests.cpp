@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "EhmTestHelper.h"
+#include "../TCDirCore/CommandLine.h"
 #include "../TCDirCore/Config.h"
 #include "../TCDirCore/Color.h"
 #include "../TCDirCore/IconMapping.h"
@@ -844,11 +845,11 @@ namespace UnitTest
 
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN;
             wcscpy_s(wfd.cFileName, L"somedir");
-            Assert::AreEqual (expected, config.GetDisplayStyleForFile(wfd).m_wTextAttr);
+            Assert::AreEqual (expected, config.GetDisplayStyleForFile(FileInfo (wfd), wfd.cFileName).m_wTextAttr);
 
             wfd.dwFileAttributes = FILE_ATTRIBUTE_HIDDEN;
             wcscpy_s(wfd.cFileName, L"foo.cpp");
-            Assert::AreEqual (expected, config.GetDisplayStyleForFile(wfd).m_wTextAttr);
+            Assert::AreEqual (expected, config.GetDisplayStyleForFile(FileInfo (wfd), wfd.cFileName).m_wTextAttr);
         }
 
 
@@ -867,7 +868,7 @@ namespace UnitTest
             wcscpy_s(wfd.cFileName, L"foo.txt");
 
             // PSHERC0TA precedence: System (S) has higher priority than Hidden (H)
-            Assert::AreEqual (static_cast<WORD>(FC_Green | BC_Blue), config.GetDisplayStyleForFile(wfd).m_wTextAttr);
+            Assert::AreEqual (static_cast<WORD>(FC_Green | BC_Blue), config.GetDisplayStyleForFile(FileInfo (wfd), wfd.cFileName).m_wTextAttr);
         }
 
 
@@ -2232,6 +2233,63 @@ namespace UnitTest
 
 
 
+
+        TEST_METHOD(EnvVar_Threads_SetsThreads)
+        {
+            ConfigProbe config;
+            config.Initialize (FC_LightGrey);
+
+            config.SetEnvVar (TCDIR_ENV_VAR_NAME, L"Threads=6");
+            config.ApplyUserColorOverrides();
+
+
+
+            Assert::IsTrue (config.m_cThreads.has_value());
+            Assert::AreEqual (6, config.m_cThreads.value());
+            Assert::IsTrue (config.m_eThreadsSource == CConfig::EAttributeSource::Environment);
+        }
+
+
+
+
+
+        TEST_METHOD(EnvVar_ThreadsAuto_SetsAdaptive)
+        {
+            ConfigProbe config;
+            config.Initialize (FC_LightGrey);
+
+            config.SetEnvVar (TCDIR_ENV_VAR_NAME, L"threads=AUTO");
+            config.ApplyUserColorOverrides();
+
+
+
+            Assert::IsTrue (config.m_cThreads.has_value());
+            Assert::AreEqual (CCommandLine::s_kcThreadsAuto, config.m_cThreads.value());
+        }
+
+
+
+
+
+        TEST_METHOD(EnvVar_ThreadsInvalid_RecordsError)
+        {
+            ConfigProbe config;
+            config.Initialize (FC_LightGrey);
+
+            config.SetEnvVar (TCDIR_ENV_VAR_NAME, L"Threads=0");
+            config.ApplyUserColorOverrides();
+
+
+
+            Assert::IsFalse (config.m_cThreads.has_value());
+
+            auto result = config.ValidateEnvironmentVariable();
+            Assert::IsTrue (result.hasIssues());
+        }
+
+
+
+
         //
         //  Env var: Ellipsize / Ellipsize-
         //
@@ -2369,7 +2427,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_ARCHIVE;
             wcscpy_s (wfd.cFileName, L"main.cpp");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::MdLanguageCpp), style.m_iconCodePoint);
             Assert::IsFalse  (style.m_fIconSuppressed);
@@ -2387,7 +2445,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
             wcscpy_s (wfd.cFileName, L"somedir");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<WORD>(FC_LightBlue), style.m_wTextAttr);
             Assert::AreEqual (static_cast<char32_t>(NfIcon::CustomFolder), style.m_iconCodePoint);
@@ -2405,7 +2463,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
             wcscpy_s (wfd.cFileName, L".git");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::SetiGit), style.m_iconCodePoint);
         }
@@ -2424,7 +2482,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_ARCHIVE;
             wcscpy_s (wfd.cFileName, L"secret.cpp");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             // Color is locked by HIDDEN attribute override (DarkGrey)
             Assert::AreEqual (static_cast<WORD>(FC_DarkGrey), style.m_wTextAttr);
@@ -2444,7 +2502,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_ARCHIVE;
             wcscpy_s (wfd.cFileName, L"data.xyz");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::FaFile), style.m_iconCodePoint);
         }
@@ -2463,7 +2521,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN;
             wcscpy_s (wfd.cFileName, L".hidden");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<WORD>(FC_DarkGrey), style.m_wTextAttr);
             Assert::AreEqual (static_cast<char32_t>(NfIcon::CustomFolder), style.m_iconCodePoint);
@@ -2483,7 +2541,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM;
             wcscpy_s (wfd.cFileName, L".git");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             // System has higher precedence than Hidden in PSHERC0TA, but
             // no system color override exists by default, so hidden wins
@@ -2508,7 +2566,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_HIDDEN;
             wcscpy_s (wfd.cFileName, L"secret.cpp");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<WORD>(FC_DarkGrey), style.m_wTextAttr);
             Assert::AreEqual (static_cast<char32_t>(NfIcon::OctFileBinary), style.m_iconCodePoint);
@@ -2527,7 +2585,7 @@ namespace UnitTest
             wfd.dwReserved0      = IO_REPARSE_TAG_SYMLINK;
             wcscpy_s (wfd.cFileName, L"link");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::CodFileSymlinkDir), style.m_iconCodePoint);
         }
@@ -2545,7 +2603,7 @@ namespace UnitTest
             wfd.dwReserved0      = IO_REPARSE_TAG_MOUNT_POINT;
             wcscpy_s (wfd.cFileName, L"junction");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::FaExternalLink), style.m_iconCodePoint);
         }
@@ -3072,7 +3130,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_ARCHIVE;
             wcscpy_s (wfd.cFileName, L"test.cpp");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(0xAAAA), style.m_iconCodePoint);
         }
@@ -3090,7 +3148,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
             wcscpy_s (wfd.cFileName, L".git");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(0xBBBB), style.m_iconCodePoint);
         }
@@ -3108,7 +3166,7 @@ namespace UnitTest
             wfd.dwFileAttributes = FILE_ATTRIBUTE_ARCHIVE;
             wcscpy_s (wfd.cFileName, L"test.obj");
 
-            auto style = config.GetDisplayStyleForFile (wfd);
+            auto style = config.GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(0), style.m_iconCodePoint);
             Assert::IsTrue (style.m_fIconSuppressed);
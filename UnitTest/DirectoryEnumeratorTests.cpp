@@ -0,0 +1,253 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "Mocks/FileSystemMock.h"
+#include "Mocks/TestConsole.h"
+
+#include "../TCDirCore/CommandLine.h"
+#include "../TCDirCore/Config.h"
+#include "../TCDirCore/DriveInfo.h"
+#include "../TCDirCore/MultiThreadedLister.h"
+#include "../TCDirCore/Win32DirectoryEnumerator.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  NullResultsDisplayer
+    //
+    //  Discards everything; these tests only look at the listing totals.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class NullResultsDisplayer : public IResultsDisplayer
+    {
+    public:
+        void DisplayResults          (const CDriveInfo &, const CDirectoryInfo &, EDirectoryLevel) override {}
+        void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &) override {}
+    };
+
+
+
+
+
+    TEST_CLASS(DirectoryEnumeratorTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        TEST_METHOD(Win32_DeliversFullAndPartialBatches)
+        {
+            static constexpr size_t   s_kcFiles = 2 * CWin32DirectoryEnumerator::s_kcEntriesPerBatch + 22;
+
+            MockFileTree              tree;
+            CWin32DirectoryEnumerator enumerator;
+            vector<size_t>            vBatchSizes;
+            size_t                    cEntries = 0;
+
+
+
+            for (size_t i = 0; i < s_kcFiles; ++i)
+            {
+                tree.AddFile (format (L"C:\\MockRoot\\file{}.txt", i).c_str(), i);
+            }
+
+            ScopedFileSystemMock mock (tree);
+
+            HRESULT hr = enumerator.Enumerate (L"C:\\MockRoot", L"*", false, [&] (span<const WIN32_FIND_DATA> batch)
+            {
+                vBatchSizes.push_back (batch.size());
+                cEntries += batch.size();
+                return true;
+            });
+
+            Assert::AreEqual (S_OK, hr);
+            Assert::AreEqual (s_kcFiles, cEntries);
+            Assert::AreEqual (size_t (3), vBatchSizes.size());
+            Assert::AreEqual (size_t (22), vBatchSizes.back());
+        }
+
+
+
+
+
+        TEST_METHOD(Win32_StopsWhenCallbackReturnsFalse)
+        {
+            MockFileTree              tree;
+            CWin32DirectoryEnumerator enumerator;
+            size_t                    cBatches = 0;
+
+
+
+            for (size_t i = 0; i < 3 * CWin32DirectoryEnumerator::s_kcEntriesPerBatch; ++i)
+            {
+                tree.AddFile (format (L"C:\\MockRoot\\file{}.txt", i).c_str(), i);
+            }
+
+            ScopedFileSystemMock mock (tree);
+
+            HRESULT hr = enumerator.Enumerate (L"C:\\MockRoot", L"*", false, [&] (span<const WIN32_FIND_DATA>)
+            {
+                ++cBatches;
+                return false;
+            });
+
+            Assert::AreEqual (S_OK, hr);
+            Assert::AreEqual (size_t (1), cBatches);
+        }
+
+
+
+
+
+        TEST_METHOD(Win32_NoMatchReturnsFileNotFound)
+        {
+            MockFileTree              tree;
+            CWin32DirectoryEnumerator enumerator;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\readme.md", 10);
+
+            ScopedFileSystemMock mock (tree);
+
+            HRESULT hr = enumerator.Enumerate (L"C:\\MockRoot", L"*.txt", false, [] (span<const WIN32_FIND_DATA>) { return true; });
+
+            Assert::AreEqual (HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND), hr);
+        }
+
+
+
+
+
+        TEST_METHOD(Mock_MatchesSpecInSmallBatches)
+        {
+            MockFileTree            tree;
+            vector<wstring>         vNames;
+
+
+
+            tree.AddFile      (L"C:\\MockRoot\\a.txt",  1);
+            tree.AddFile      (L"C:\\MockRoot\\b.TXT",  2);
+            tree.AddFile      (L"C:\\MockRoot\\c.md",   3);
+            tree.AddFile      (L"C:\\MockRoot\\d.txt",  4);
+            tree.AddDirectory (L"C:\\MockRoot\\e.txt");
+
+            MockDirectoryEnumerator enumerator (tree);
+
+            HRESULT hr = enumerator.Enumerate (L"C:\\MockRoot", L"*.txt", false, [&] (span<const WIN32_FIND_DATA> batch)
+            {
+                Assert::IsTrue (batch.size() <= 2);
+
+                for (const WIN32_FIND_DATA & wfd : batch)
+                {
+                    vNames.push_back (wfd.cFileName);
+                }
+
+                return true;
+            });
+
+            Assert::AreEqual (S_OK, hr);
+            Assert::AreEqual (size_t (4), vNames.size());
+            Assert::AreEqual (size_t (2), enumerator.GetBatchCount());
+        }
+
+
+
+
+
+        TEST_METHOD(Mock_ErrorsMatchFindFirstFile)
+        {
+            MockFileTree tree;
+
+
+
+            tree.AddDirectory (L"C:\\MockRoot\\empty");
+            tree.AddFile      (L"C:\\MockRoot\\a.txt", 1);
+
+            MockDirectoryEnumerator enumerator (tree);
+            auto                    onBatch = [] (span<const WIN32_FIND_DATA>) { return true; };
+
+            Assert::AreEqual (HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND), enumerator.Enumerate (L"C:\\Missing",          L"*",     false, onBatch));
+            Assert::AreEqual (HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND), enumerator.Enumerate (L"C:\\MockRoot",         L"*.cpp", false, onBatch));
+            Assert::AreEqual (S_OK,                                      enumerator.Enumerate (L"C:\\MockRoot\\empty",  L"*",     false, onBatch));
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  MultiThreadedLister_ListsThroughInjectedEnumerator
+        //
+        //  Runs a recursive listing entirely against the in-memory backend,
+        //  without any IAT patching, and checks that every directory was read
+        //  exactly once and counted as enumerated, though none matched.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(MultiThreadedLister_ListsThroughInjectedEnumerator)
+        {
+            MockFileTree tree;
+
+
+
+            tree.AddFile      (L"C:\\MockRoot\\file1.txt",               1000);
+            tree.AddFile      (L"C:\\MockRoot\\file2.cpp",               2000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub1");
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file3.txt",         3000);
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file4.txt",         4000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2");
+            tree.AddDirectory (L"C:\\MockRoot\\sub2\\subsub");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\subsub\\file5.txt", 5000);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            auto console     = make_shared<CTestConsole> ();
+            auto config      = make_shared<CConfig> ();
+
+            cmdLine->m_fRecurse = true;
+            console->Initialize (config);
+
+            CMultiThreadedLister lister (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            NullResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (driveInfo,
+                                                               L"C:\\MockRoot",
+                                                               { L"*.txt" },
+                                                               displayer,
+                                                               IResultsDisplayer::EDirectoryLevel::Initial,
+                                                               totals);
+
+            Assert::IsTrue    (SUCCEEDED (hr));
+            Assert::AreEqual  (4u,       totals.m_cFiles);
+            Assert::AreEqual  (13000ull, totals.m_uliFileBytes.QuadPart);
+            Assert::AreEqual  (size_t (4), pEnumerator->GetEnumerateCount());
+            Assert::AreEqual  (0u,         totals.m_cDirectories);
+            Assert::AreEqual  (size_t (4), lister.GetEnumeratedDirs());
+            Assert::AreEqual  (size_t (8), lister.GetEnumeratedEntries());
+        }
+    };
+}
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/DirectoryInfo.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(DirectoryInfoTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        TEST_METHOD(OnlyOneWorkerBeginsEnumeration)
+        {
+            CDirectoryInfo di        (L"C:\\Test", L"*");
+            UINT           prevState = 0;
+
+
+
+            Assert::IsTrue  (di.TryBeginEnumeration (prevState));
+            Assert::IsFalse (di.TryBeginEnumeration (prevState));
+            Assert::IsTrue  (CDirectoryInfo::StatusOf (di.GetState()) == CDirectoryInfo::Status::InProgress);
+        }
+
+
+
+
+
+        TEST_METHOD(StatusChangeKeepsFlags)
+        {
+            CDirectoryInfo di        (L"C:\\Test", L"*");
+            UINT           prevState = 0;
+
+
+
+            di.SetFlags (CDirectoryInfo::s_kfDiscarded | CDirectoryInfo::s_kfDescendantMatch);
+            Assert::IsTrue (di.TryBeginEnumeration (prevState));
+            Assert::IsTrue ((prevState & CDirectoryInfo::s_kfDiscarded) != 0);
+
+            prevState = di.SetStatus (CDirectoryInfo::Status::Done);
+
+            Assert::IsTrue ((prevState & CDirectoryInfo::s_kfDiscarded) != 0);
+            Assert::IsTrue (CDirectoryInfo::IsSettled (di.GetState()));
+            Assert::IsTrue (di.HasFlags (CDirectoryInfo::s_kfDescendantMatch));
+        }
+
+
+
+
+
+        TEST_METHOD(SetFlagsReportsWhetherAlreadySet)
+        {
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+
+
+            Assert::IsTrue  ((di.SetFlags (CDirectoryInfo::s_kfDemanded) & CDirectoryInfo::s_kfDemanded) == 0);
+            Assert::IsFalse ((di.SetFlags (CDirectoryInfo::s_kfDemanded) & CDirectoryInfo::s_kfDemanded) == 0);
+        }
+
+
+
+
+
+        TEST_METHOD(WaiterWakesWhenAnotherThreadPublishes)
+        {
+            CDirectoryInfo di        (L"C:\\Test", L"*");
+            UINT           prevState = 0;
+            UINT           state     = 0;
+
+
+
+            Assert::IsTrue (di.TryBeginEnumeration (prevState));
+
+            {
+                jthread producer ([&]
+                {
+                    this_thread::sleep_for (chrono::milliseconds (20));
+                    di.SetStatus (CDirectoryInfo::Status::Done);
+                });
+
+                state = di.WaitForState (CDirectoryInfo::IsSettled);
+            }
+
+            Assert::IsTrue (CDirectoryInfo::StatusOf (state) == CDirectoryInfo::Status::Done);
+        }
+    };
+}
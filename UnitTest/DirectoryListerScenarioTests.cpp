@@ -3,6 +3,8 @@
 #include "Mocks/FileSystemMock.h"
 #include "Mocks/TestConsole.h"
 
+#include "../TCDirCore/CachingDirectoryEnumerator.h"
+#include "../TCDirCore/DirectoryLister.h"
 #include "../TCDirCore/MultiThreadedLister.h"
 #include "../TCDirCore/ResultsDisplayerNormal.h"
 #include "../TCDirCore/ResultsDisplayerTree.h"
@@ -65,6 +67,119 @@ namespace UnitTest
 
 
 
+
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  OrderRecordingDisplayer
+    //
+    //  Records "<dir>\<spec> <file count>" for each DisplayResults call, in
+    //  call order.  The log lives outside the displayer because
+    //  CDirectoryLister takes ownership of it.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class OrderRecordingDisplayer : public IResultsDisplayer
+    {
+    public:
+        explicit OrderRecordingDisplayer (vector<wstring> & vDisplayed) :
+            m_vDisplayed (vDisplayed)
+        {
+        }
+
+        void DisplayResults (const CDriveInfo &, const CDirectoryInfo & di, EDirectoryLevel) override
+        {
+            m_vDisplayed.push_back (format (L"{} {}", (di.DirPath() / di.FileSpecs().front()).wstring(), di.m_cFiles));
+        }
+
+        void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &) override {}
+
+    private:
+        vector<wstring> & m_vDisplayed;
+    };
+
+
+
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  PathFilteringDisplayer
+    //
+    //  Counts the files of only those directories whose path contains a
+    //  given segment, as a script filtering /S output by path would.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class PathFilteringDisplayer : public IResultsDisplayer
+    {
+    public:
+        explicit PathFilteringDisplayer (wstring_view segment) :
+            m_segment (format (L"\\{}\\", segment))
+        {
+        }
+
+        void DisplayResults (const CDriveInfo &, const CDirectoryInfo & di, EDirectoryLevel) override
+        {
+            if ((di.DirPath().wstring() + L'\\').find (m_segment) != wstring::npos)
+            {
+                m_cFilesKept += di.m_cFiles;
+            }
+        }
+
+        void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &) override {}
+
+        UINT m_cFilesKept = 0;
+
+    private:
+        wstring m_segment;
+    };
+
+
+
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  ReadAheadSamplingDisplayer
+    //
+    //  Samples, at each directory displayed, the lister's read-ahead count
+    //  and how many directories have been read but not yet displayed, and
+    //  keeps the highest of each.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class ReadAheadSamplingDisplayer : public IResultsDisplayer
+    {
+    public:
+        ReadAheadSamplingDisplayer (const CMultiThreadedLister & lister, const MockDirectoryEnumerator & enumerator) :
+            m_lister     (lister),
+            m_enumerator (enumerator)
+        {
+        }
+
+        void DisplayResults (const CDriveInfo &, const CDirectoryInfo &, EDirectoryLevel) override
+        {
+            ++m_cDisplayed;
+
+            m_cMaxBuffered  = (max) (m_cMaxBuffered,  m_lister.GetBufferedEntryCount());
+            m_cMaxReadAhead = (max) (m_cMaxReadAhead, m_enumerator.GetEnumerateCount() - m_cDisplayed);
+        }
+
+        void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &) override {}
+
+        size_t m_cDisplayed    = 0;
+        size_t m_cMaxBuffered  = 0;
+        size_t m_cMaxReadAhead = 0;
+
+    private:
+        const CMultiThreadedLister    & m_lister;
+        const MockDirectoryEnumerator & m_enumerator;
+    };
+
+
+
+
+
     ////////////////////////////////////////////////////////////////////////////
     //
     //  DirectoryListerScenarioTests
@@ -300,6 +415,261 @@ namespace UnitTest
 
 
 
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_Top_DisplaysOnlyTheWinners
+        //
+        //  --Top=2 with /O-S shows the two largest files of the whole tree
+        //  in a single DisplayResults call, while the summary still counts
+        //  every file.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_Top_DisplaysOnlyTheWinners)
+        {
+            MockFileTree tree;
+            tree.AddFile      (L"C:\\MockRoot\\file1.txt",              1000);
+            tree.AddFile      (L"C:\\MockRoot\\file2.txt",              2000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub1");
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file3.txt",        3000);
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file4.txt",        4000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\file5.txt",        5000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2\\subsub");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\subsub\\file6.txt", 6000);
+
+            ScopedFileSystemMock mock (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse            = true;
+            cmdLine->m_cTop                = 2;
+            cmdLine->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_SIZE;
+            cmdLine->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"--Top listing should succeed");
+
+            Assert::AreEqual (1u,       displayer.m_cDisplayResultsCalls,        L"Only the winners should be displayed");
+            Assert::AreEqual (2ull,     displayer.m_cTotalFilesDisplayed,        L"Should display 2 files");
+            Assert::AreEqual (11000ull, displayer.m_uliBytesDisplayed.QuadPart,  L"Should display file6 and file5");
+            Assert::AreEqual (6u,       totals.m_cFiles,                         L"Totals should count every file");
+            Assert::AreEqual (21000ull, totals.m_uliFileBytes.QuadPart);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_EntryFilters_CountOnlyMatches
+        //
+        //  A size bound and a name pattern are applied as the workers read
+        //  each directory: only the entries passing both are kept, and the
+        //  totals count only them.  Directories fail the size bound but are
+        //  still recursed into.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_EntryFilters_CountOnlyMatches)
+        {
+            MockFileTree tree;
+            tree.AddFile      (L"C:\\MockRoot\\file1.txt",              1000);
+            tree.AddFile      (L"C:\\MockRoot\\file2.txt",              2000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub1");
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file3.txt",        3000);
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file4.txt",        4000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\file5.TXT",        5000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2\\subsub");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\subsub\\file6.txt", 6000);
+
+            ScopedFileSystemMock mock (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse = true;
+
+            Assert::AreEqual (S_OK, cmdLine->m_entryFilter.AddSizeBound   (L"2500", true));
+            Assert::AreEqual (S_OK, cmdLine->m_entryFilter.AddNamePattern (L"[135]\\.txt$"));
+            cmdLine->m_entryFilter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Filtered listing should succeed");
+
+            Assert::AreEqual (2u,      totals.m_cFiles,                         L"Only file3 and file5 pass both filters");
+            Assert::AreEqual (0u,      totals.m_cDirectories,                   L"Directories fail the size bound");
+            Assert::AreEqual (8000ull, totals.m_uliFileBytes.QuadPart);
+            Assert::AreEqual (2ull,    displayer.m_cTotalFilesDisplayed);
+            Assert::AreEqual (8000ull, displayer.m_uliBytesDisplayed.QuadPart);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_RecursiveGlob_ReadsOnlyReachableDirectories
+        //
+        //  "*\src\**\*.cpp" lists the .cpp files anywhere under a src
+        //  directory one level down, without /S.  Directories the mask cannot
+        //  reach through (docs, build, and everything under build) are never
+        //  read.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_RecursiveGlob_ReadsOnlyReachableDirectories)
+        {
+            MockFileTree tree;
+            tree.AddFile (L"C:\\MockRoot\\top.cpp",                   10);
+            tree.AddFile (L"C:\\MockRoot\\app\\src\\main.cpp",        100);
+            tree.AddFile (L"C:\\MockRoot\\app\\src\\util\\util.cpp",  200);
+            tree.AddFile (L"C:\\MockRoot\\app\\src\\util\\notes.txt", 50);
+            tree.AddFile (L"C:\\MockRoot\\app\\docs\\guide.cpp",      300);
+            tree.AddFile (L"C:\\MockRoot\\lib\\src\\lib.cpp",         400);
+            tree.AddFile (L"C:\\MockRoot\\lib\\build\\obj\\gen.cpp",  500);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                { L"*\\src\\**\\*.cpp" },
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Recursive glob listing should succeed");
+
+            Assert::AreEqual (3u,     totals.m_cFiles,              L"main.cpp, util.cpp, and lib.cpp");
+            Assert::AreEqual (0u,     totals.m_cDirectories);
+            Assert::AreEqual (700ull, totals.m_uliFileBytes.QuadPart);
+
+            // The root, app, app\src, app\src\util, lib, and lib\src
+            Assert::AreEqual (size_t (6), pEnumerator->GetEnumerateCount(), L"Unreachable directories should not be read");
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  UsageMode_SizesRollUpLargestFirst
+        //
+        //  --Usage with --Depth=1 shows each top-level directory with the
+        //  recursive size of everything under it, largest first, and does
+        //  not show the deeper directory whose size it includes.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(UsageMode_SizesRollUpLargestFirst)
+        {
+            MockFileTree tree;
+            tree.AddFile      (L"C:\\MockRoot\\file1.txt",              1000);
+            tree.AddFile      (L"C:\\MockRoot\\file2.txt",              2000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub1");
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file3.txt",        3000);
+            tree.AddFile      (L"C:\\MockRoot\\sub1\\file4.txt",        4000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\file5.txt",        5000);
+            tree.AddDirectory (L"C:\\MockRoot\\sub2\\subsub");
+            tree.AddFile      (L"C:\\MockRoot\\sub2\\subsub\\file6.txt", 6000);
+
+            ScopedFileSystemMock mock (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fUsage      = true;
+            cmdLine->m_cMaxDepth   = 1;
+            cmdLine->m_eSizeFormat = ESizeFormat::Bytes;
+
+            auto console = make_shared<CCapturingConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister        (cmdLine, console, config);
+            CDriveInfo            driveInfo      (L"C:\\MockRoot");
+            SListingTotals        totals       = {};
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"--Usage listing should succeed");
+
+            Assert::AreEqual (6u,       totals.m_cFiles,       L"Totals should count every file");
+            Assert::AreEqual (3u,       totals.m_cDirectories, L"sub1, sub2, and subsub");
+            Assert::AreEqual (21000ull, totals.m_uliFileBytes.QuadPart);
+
+            wstring stripped = StripAnsiCodes (console->m_strCaptured);
+            size_t  ichSub2  = stripped.find (L"11,000  2 files");
+            size_t  ichSub1  = stripped.find (L" 7,000  2 files");
+
+            Assert::IsTrue (stripped.find (L"21,000  6 files") != wstring::npos, L"Root line shows the grand total");
+            Assert::IsTrue (ichSub2 != wstring::npos && ichSub1 != wstring::npos, L"Each top-level directory shows its subtree total");
+            Assert::IsTrue (ichSub2 < ichSub1,                                    L"Larger directory is listed first");
+            Assert::IsTrue (stripped.find (L"subsub") == wstring::npos,           L"Directories below --Depth are not shown");
+        }
+
+
+
+
         ////////////////////////////////////////////////////////////////////////
         //
         //  RecursiveListing_EmptySubdirectories
@@ -1260,11 +1630,993 @@ namespace UnitTest
 
         ////////////////////////////////////////////////////////////////////////
         //
-        //  TreeMode_WithIcons_CorrectTotals
+        //  TreeMode_DepthLimit_StopsEnumeratingAtLimit
         //
-        //  Verifies tree mode works correctly with icons enabled.
-        //  Icons may not render in test environment (no NerdFont detection)
-        //  but the code path must not crash.
+        //  Verifies that without a file mask, directories below --Depth are
+        //  never read: only the directories the display expands are
+        //  enumerated.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_DepthLimit_StopsEnumeratingAtLimit)
+        {
+            MockFileTree tree;
+            tree.AddFile      (L"C:\\MockRoot\\L0.txt",            10);
+            tree.AddDirectory (L"C:\\MockRoot\\A");
+            tree.AddFile      (L"C:\\MockRoot\\A\\L1.txt",         20);
+            tree.AddDirectory (L"C:\\MockRoot\\A\\B");
+            tree.AddFile      (L"C:\\MockRoot\\A\\B\\L2.txt",      30);
+            tree.AddDirectory (L"C:\\MockRoot\\A\\B\\C");
+            tree.AddFile      (L"C:\\MockRoot\\A\\B\\C\\L3.txt",   40);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fTree     = true;
+            cmdLine->m_cMaxDepth = 2;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister          (cmdLine, console, config);
+            CDriveInfo            driveInfo        (L"C:\\MockRoot");
+            SListingTotals        totals         = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                { L"*" },
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Depth-limited tree should succeed");
+
+            //
+            // Depth=2 expands the root and A.  B is listed in A but never
+            // read, and C is never reached.
+            //
+
+            Assert::AreEqual (2u, totals.m_cFiles, L"Should have 2 files (L0, L1)");
+            Assert::AreEqual (2u, totals.m_cDirectories, L"Should have 2 directories (A, B)");
+            Assert::AreEqual (size_t (2), pEnumerator->GetEnumerateCount(), L"Only the root and A should be enumerated");
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_DepthLimitWithMask_PrunesOnDeepMatches
+        //
+        //  Verifies that with a file mask, a directory at the depth limit is
+        //  still shown when the only match is further down, and pruned when
+        //  there is no match anywhere below it.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_DepthLimitWithMask_PrunesOnDeepMatches)
+        {
+            //
+            // Setup:
+            //   C:\MockRoot\
+            //     top.log
+            //     deep\a\b\c\found.log   -- match three levels below the limit
+            //     none\a\b\c\other.txt   -- no match anywhere
+            //
+
+            MockFileTree tree;
+            tree.AddFile (L"C:\\MockRoot\\top.log",                    10);
+            tree.AddFile (L"C:\\MockRoot\\deep\\a\\b\\c\\found.log",   20);
+            tree.AddFile (L"C:\\MockRoot\\none\\a\\b\\c\\other.txt",   30);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fTree     = true;
+            cmdLine->m_cMaxDepth = 1;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister          (cmdLine, console, config);
+            CDriveInfo            driveInfo        (L"C:\\MockRoot");
+            SListingTotals        totals         = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                { L"*.log" },
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Depth-limited tree with a mask should succeed");
+
+            Assert::AreEqual (1u, totals.m_cFiles,       L"Only top.log is within the depth limit");
+            Assert::AreEqual (1u, totals.m_cDirectories, L"deep is shown, none is pruned");
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_WideDirectoryWithMask_PrunesInLinearTime
+        //
+        //  A root with 50,000 subdirectories, each holding one empty
+        //  subdirectory, with a match in only every 1,000th.  Every empty
+        //  leaf completes a subtree under a parent with tens of thousands of
+        //  siblings, so completion must not scan them.  Checks the pruned
+        //  totals and logs the elapsed time.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_WideDirectoryWithMask_PrunesInLinearTime)
+        {
+            static constexpr UINT s_kcSubdirs    = 50000;
+            static constexpr UINT s_kcMatchEvery = 1000;
+
+            MockFileTree tree;
+
+
+
+            for (UINT i = 0; i < s_kcSubdirs; ++i)
+            {
+                wstring dir = format (L"C:\\WideRoot\\d{:05}", i);
+
+                tree.AddDirectory (format (L"{}\\empty", dir).c_str());
+
+                if (i % s_kcMatchEvery == s_kcMatchEvery - 1)
+                {
+                    tree.AddFile (format (L"{}\\hit.cpp", dir).c_str(), 10);
+                }
+            }
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree, 64);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fTree = true;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister          (cmdLine, console, config);
+            CDriveInfo            driveInfo        (L"C:\\WideRoot");
+            SListingTotals        totals         = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            auto start = chrono::steady_clock::now();
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\WideRoot",
+                { L"*.cpp" },
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            auto end = chrono::steady_clock::now();
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Wide masked tree should succeed");
+
+            Assert::AreEqual (s_kcSubdirs / s_kcMatchEvery, totals.m_cFiles,       L"One hit.cpp per matching subdirectory");
+            Assert::AreEqual (s_kcSubdirs / s_kcMatchEvery, totals.m_cDirectories, L"Only subdirectories with a match are shown");
+
+            Logger::WriteMessage (format (L"{} subdirectories: {:.1f} ms\n",
+                                          s_kcSubdirs,
+                                          chrono::duration<double, milli> (end - start).count()).c_str());
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_DepthLimitOnDeepTree
+        //
+        //  Lists a deep synthetic tree (fan-out 3, 9 levels, ~30K
+        //  directories) in tree mode with and without --Depth=2, with and
+        //  without a file mask, and logs wall time, directories read, and the
+        //  process peak working set after each run.  The limited runs go
+        //  first so their peak is not hidden by the unlimited ones.  Ignored
+        //  by default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_DepthLimitOnDeepTree)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_DepthLimitOnDeepTree)
+        {
+            static constexpr int s_kcLevels = 9;
+            static constexpr int s_kcFanOut = 3;
+
+            struct SRun
+            {
+                int     cMaxDepth;
+                LPCWSTR pszSpec;
+            };
+
+            static constexpr SRun s_krgRuns[] = { { 2, L"*" }, { 2, L"*.log" }, { 0, L"*" }, { 0, L"*.log" } };
+
+            MockFileTree    tree;
+            vector<wstring> vLevel = { L"C:\\DeepRoot" };
+
+
+
+            for (int iLevel = 0; iLevel < s_kcLevels; ++iLevel)
+            {
+                vector<wstring> vNext;
+
+                for (const wstring & dir : vLevel)
+                {
+                    tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+                    tree.AddFile (format (L"{}\\b.cpp", dir).c_str(), 200);
+
+                    for (int iChild = 0; iChild < s_kcFanOut; ++iChild)
+                    {
+                        vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        tree.AddDirectory (vNext.back().c_str());
+                    }
+                }
+
+                vLevel = std::move (vNext);
+            }
+
+            // A single deep match so the masked runs have to search for it
+            tree.AddFile (format (L"{}\\deep.log", vLevel.back()).c_str(), 300);
+
+            for (const SRun & run : s_krgRuns)
+            {
+                auto                    pEnumerator = make_shared<MockDirectoryEnumerator> (tree, 64);
+                auto                    cmdLine     = make_shared<CCommandLine> ();
+                auto                    console     = make_shared<CTestConsole> ();
+                auto                    config      = make_shared<CConfig> ();
+                PROCESS_MEMORY_COUNTERS pmc         = { sizeof (pmc) };
+                SListingTotals          totals      = {};
+
+                cmdLine->m_fTree     = true;
+                cmdLine->m_cMaxDepth = run.cMaxDepth;
+                console->Initialize (config);
+
+                CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+                CMultiThreadedLister  lister          (cmdLine, console, config);
+                CDriveInfo            driveInfo        (L"C:\\DeepRoot");
+
+                lister.SetDirectoryEnumerator (pEnumerator);
+
+                auto start = chrono::steady_clock::now();
+
+                HRESULT hr = lister.ProcessDirectoryMultiThreaded (driveInfo,
+                                                                   L"C:\\DeepRoot",
+                                                                   { run.pszSpec },
+                                                                   treeDisplayer,
+                                                                   IResultsDisplayer::EDirectoryLevel::Initial,
+                                                                   totals);
+
+                auto end = chrono::steady_clock::now();
+
+                Assert::IsTrue (SUCCEEDED (hr));
+
+                GetProcessMemoryInfo (GetCurrentProcess(), &pmc, sizeof (pmc));
+
+                Logger::WriteMessage (format (L"Depth={} {:<6}  {:8.1f} ms  {:6} dirs read  peak working set {} MB\n",
+                                              run.cMaxDepth,
+                                              run.pszSpec,
+                                              chrono::duration<double, milli> (end - start).count(),
+                                              pEnumerator->GetEnumerateCount(),
+                                              pmc.PeakWorkingSetSize / (1024 * 1024)).c_str());
+            }
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_MaskWithCache_SecondRunReadsNothing
+        //
+        //  /S *.cs through --Cache twice.  The workers read every directory
+        //  with "*" and match the mask (and its 8.3 form) themselves, so the
+        //  second run is served entirely from the cache with the same
+        //  totals.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_MaskWithCache_SecondRunReadsNothing)
+        {
+            MockFileTree     tree;
+            filesystem::path cacheFile = filesystem::temp_directory_path() / format (L"TCDirCache_MaskedRecursive_{}.bin", GetCurrentProcessId());
+            std::error_code  ec;
+            SListingTotals   rgTotals[2] = {};
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.cs",            100);
+            tree.AddFile (L"C:\\MockRoot\\b.txt",           200);
+            tree.AddFile (L"C:\\MockRoot\\src\\c.cs",       300);
+            tree.AddFile (L"C:\\MockRoot\\src\\deep\\d.cs", 400);
+            tree.AddFile (L"C:\\MockRoot\\docs\\e.md",      500);
+
+            auto pInner = make_shared<MockDirectoryEnumerator> (tree);
+
+            filesystem::remove (cacheFile, ec);
+
+            for (SListingTotals & totals : rgTotals)
+            {
+                auto pCache  = make_shared<CListingCache> (cacheFile);
+                auto cmdLine = make_shared<CCommandLine> ();
+                auto console = make_shared<CTestConsole> ();
+                auto config  = make_shared<CConfig> ();
+
+                cmdLine->m_fRecurse = true;
+                console->Initialize (config);
+
+                Assert::IsTrue (SUCCEEDED (pCache->Open()));
+
+                CMultiThreadedLister lister    (cmdLine, console, config);
+                CDriveInfo           driveInfo (L"C:\\MockRoot");
+                MockResultsDisplayer displayer;
+
+                lister.SetDirectoryEnumerator (make_shared<CCachingDirectoryEnumerator> (pInner, pCache, false));
+
+                vector<filesystem::path> fileSpecs = { L"*.cs" };
+
+                HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                    driveInfo,
+                    L"C:\\MockRoot",
+                    fileSpecs,
+                    displayer,
+                    IResultsDisplayer::EDirectoryLevel::Initial,
+                    totals);
+
+                Assert::IsTrue (SUCCEEDED (hr));
+                Assert::AreEqual (S_OK, pCache->Save());
+            }
+
+            filesystem::remove (cacheFile, ec);
+
+            // Root, src, src\deep, and docs, all on the first run
+            Assert::AreEqual (size_t (4), pInner->GetEnumerateCount(), L"The second run should read nothing from disk");
+            Assert::AreEqual (3u,         rgTotals[0].m_cFiles);
+            Assert::AreEqual (3u,         rgTotals[1].m_cFiles);
+            Assert::AreEqual (800ull,     rgTotals[1].m_uliFileBytes.QuadPart);
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_ReadAheadLimit_TotalsUnchanged
+        //
+        //  With a read-ahead budget of a single entry the workers block after
+        //  nearly every directory and only run while the display waits.  The
+        //  listing must still finish with every directory read and the same
+        //  totals as an unlimited run.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_ReadAheadLimit_TotalsUnchanged)
+        {
+            static constexpr int s_kcLevels = 4;
+            static constexpr int s_kcFanOut = 4;
+
+            MockFileTree    tree;
+            vector<wstring> vLevel = { L"C:\\MockRoot" };
+            size_t          cDirs  = 1;
+
+
+
+            for (int iLevel = 0; iLevel < s_kcLevels; ++iLevel)
+            {
+                vector<wstring> vNext;
+
+                for (const wstring & dir : vLevel)
+                {
+                    tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+                    tree.AddFile (format (L"{}\\b.cpp", dir).c_str(), 200);
+
+                    for (int iChild = 0; iChild < s_kcFanOut; ++iChild)
+                    {
+                        vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        tree.AddDirectory (vNext.back().c_str());
+                    }
+                }
+
+                cDirs += vNext.size();
+                vLevel = std::move (vNext);
+            }
+
+            for (const wstring & dir : vLevel)
+            {
+                tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+                tree.AddFile (format (L"{}\\b.cpp", dir).c_str(), 200);
+            }
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse   = true;
+            cmdLine->m_cReadAhead = 1;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            //
+            // 2 files in every directory, and every directory but the root
+            // counted as a match of '*'
+            //
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Listing with a read-ahead limit should succeed");
+            Assert::AreEqual (cDirs, pEnumerator->GetEnumerateCount(), L"Every directory should be read");
+            Assert::AreEqual (static_cast<UINT> (2 * cDirs), totals.m_cFiles);
+            Assert::AreEqual (static_cast<UINT> (cDirs - 1), totals.m_cDirectories);
+            Assert::AreEqual (300ull * cDirs, totals.m_uliFileBytes.QuadPart);
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_ReadAheadLimitWithMask_TotalsUnchanged
+        //
+        //  Tree mode with pruning under a one-entry read-ahead budget: the
+        //  display blocks on visibility as well as completion, and pruned
+        //  directories are released while workers may still hold them.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_ReadAheadLimitWithMask_TotalsUnchanged)
+        {
+            //
+            // Setup:
+            //   C:\MockRoot\
+            //     top.log (100 bytes)
+            //     empty1\
+            //       deeper\
+            //         notes.txt
+            //     logs\
+            //       mid\
+            //         a.log (200 bytes)
+            //         b.log (300 bytes)
+            //     empty2\
+            //       readme.txt
+            //
+
+            MockFileTree tree;
+            tree.AddFile      (L"C:\\MockRoot\\top.log",                   100);
+            tree.AddDirectory (L"C:\\MockRoot\\empty1");
+            tree.AddDirectory (L"C:\\MockRoot\\empty1\\deeper");
+            tree.AddFile      (L"C:\\MockRoot\\empty1\\deeper\\notes.txt", 50);
+            tree.AddDirectory (L"C:\\MockRoot\\logs");
+            tree.AddDirectory (L"C:\\MockRoot\\logs\\mid");
+            tree.AddFile      (L"C:\\MockRoot\\logs\\mid\\a.log",          200);
+            tree.AddFile      (L"C:\\MockRoot\\logs\\mid\\b.log",          300);
+            tree.AddDirectory (L"C:\\MockRoot\\empty2");
+            tree.AddFile      (L"C:\\MockRoot\\empty2\\readme.txt",        50);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fTree      = true;
+            cmdLine->m_cReadAhead = 1;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister          (cmdLine, console, config);
+            CDriveInfo            driveInfo        (L"C:\\MockRoot");
+            SListingTotals        totals         = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*.log" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Tree mode listing with a read-ahead limit should succeed");
+            Assert::AreEqual (3u, totals.m_cFiles, L"Should count the 3 .log files");
+            Assert::AreEqual (2u, totals.m_cDirectories, L"Only logs and logs\\mid should be shown");
+            Assert::AreEqual (600ull, totals.m_uliFileBytes.QuadPart);
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_ReadAheadLimitSparseMask_StaysBounded
+        //
+        //  A mask that matches nothing leaves every directory without
+        //  matches, so only the directory nodes themselves count against the
+        //  budget.  The workers must still stay within a few directories per
+        //  worker and level of the display instead of reading the whole tree
+        //  ahead of it.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_ReadAheadLimitSparseMask_StaysBounded)
+        {
+            static constexpr int    s_kcLevels    = 6;
+            static constexpr int    s_kcFanOut    = 4;
+            static constexpr int    s_kcThreads   = 4;
+            static constexpr int    s_kcReadAhead = 64;
+            static constexpr size_t s_kcBound     = s_kcReadAhead + s_kcThreads * s_kcFanOut * (s_kcLevels + 4);
+
+            MockFileTree    tree;
+            vector<wstring> vLevel = { L"C:\\MockRoot" };
+            size_t          cDirs  = 1;
+
+
+
+            for (int iLevel = 0; iLevel < s_kcLevels; ++iLevel)
+            {
+                vector<wstring> vNext;
+
+                for (const wstring & dir : vLevel)
+                {
+                    tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+
+                    for (int iChild = 0; iChild < s_kcFanOut; ++iChild)
+                    {
+                        vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        tree.AddDirectory (vNext.back().c_str());
+                    }
+                }
+
+                cDirs += vNext.size();
+                vLevel = std::move (vNext);
+            }
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse   = true;
+            cmdLine->m_cThreads   = s_kcThreads;
+            cmdLine->m_cReadAhead = s_kcReadAhead;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister       lister    (cmdLine, console, config);
+            CDriveInfo                 driveInfo (L"C:\\MockRoot");
+            ReadAheadSamplingDisplayer displayer (lister, *pEnumerator);
+            SListingTotals             totals = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*.nomatch" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Listing with a read-ahead limit should succeed");
+            Assert::AreEqual (cDirs, pEnumerator->GetEnumerateCount(), L"Every directory should be read");
+            Assert::AreEqual (cDirs, displayer.m_cDisplayed);
+            Assert::AreEqual (0u, totals.m_cFiles);
+
+            Assert::IsTrue (displayer.m_cMaxBuffered  <= s_kcBound, format (L"Buffered count reached {}", displayer.m_cMaxBuffered).c_str());
+            Assert::IsTrue (displayer.m_cMaxReadAhead <= s_kcBound, format (L"Directories read ahead reached {}", displayer.m_cMaxReadAhead).c_str());
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_DemandScheduling_EnumeratesEachDirectoryOnce
+        //
+        //  With per-directory latency the display keeps catching up with the
+        //  workers and demanding nodes that are also sitting in a worker
+        //  deque.  The second copy of each demanded node must be skipped, so
+        //  every directory is still read exactly once.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_DemandScheduling_EnumeratesEachDirectoryOnce)
+        {
+            static constexpr int s_kcLevels = 3;
+            static constexpr int s_kcFanOut = 3;
+
+            MockFileTree    tree;
+            vector<wstring> vLevel = { L"C:\\MockRoot" };
+            size_t          cDirs  = 1;
+
+
+
+            for (int iLevel = 0; iLevel < s_kcLevels; ++iLevel)
+            {
+                vector<wstring> vNext;
+
+                for (const wstring & dir : vLevel)
+                {
+                    tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+
+                    for (int iChild = 0; iChild < s_kcFanOut; ++iChild)
+                    {
+                        vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        tree.AddDirectory (vNext.back().c_str());
+                    }
+                }
+
+                cDirs += vNext.size();
+                vLevel = std::move (vNext);
+            }
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse = true;
+
+            pEnumerator->SetLatency (chrono::milliseconds (1));
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+            SListingTotals       totals = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Listing with demand scheduling should succeed");
+            Assert::AreEqual (cDirs, pEnumerator->GetEnumerateCount(), L"Every directory should be read exactly once");
+            Assert::AreEqual (static_cast<UINT> (cDirs - vLevel.size()), totals.m_cFiles);
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_ConsumerStall
+        //
+        //  Lists a deep synthetic tree (fan-out 4, 7 levels, ~5K directories)
+        //  with 200 us of simulated latency per directory, in /S and tree
+        //  mode, with demand scheduling off (speculative work only) and on,
+        //  and logs wall time and how long the display was blocked waiting
+        //  on workers.  Ignored by default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_ConsumerStall)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_ConsumerStall)
+        {
+            static constexpr int s_kcLevels = 7;
+            static constexpr int s_kcFanOut = 4;
+
+            MockFileTree    tree;
+            vector<wstring> vLevel = { L"C:\\DeepRoot" };
+
+
+
+            for (int iLevel = 0; iLevel < s_kcLevels; ++iLevel)
+            {
+                vector<wstring> vNext;
+
+                for (const wstring & dir : vLevel)
+                {
+                    tree.AddFile (format (L"{}\\a.txt", dir).c_str(), 100);
+                    tree.AddFile (format (L"{}\\b.cpp", dir).c_str(), 200);
+
+                    for (int iChild = 0; iChild < s_kcFanOut; ++iChild)
+                    {
+                        vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        tree.AddDirectory (vNext.back().c_str());
+                    }
+                }
+
+                vLevel = std::move (vNext);
+            }
+
+            for (bool fTree : { false, true })
+            {
+                for (bool fDemand : { false, true })
+                {
+                    auto           pEnumerator = make_shared<MockDirectoryEnumerator> (tree, 64);
+                    auto           cmdLine     = make_shared<CCommandLine> ();
+                    auto           console     = make_shared<CTestConsole> ();
+                    auto           config      = make_shared<CConfig> ();
+                    SListingTotals totals      = {};
+
+                    pEnumerator->SetLatency (chrono::microseconds (200));
+                    cmdLine->m_fRecurse = !fTree;
+                    cmdLine->m_fTree    = fTree;
+                    console->Initialize (config);
+
+                    CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+                    MockResultsDisplayer  displayer;
+                    CMultiThreadedLister  lister        (cmdLine, console, config);
+                    CDriveInfo            driveInfo      (L"C:\\DeepRoot");
+
+                    lister.SetDirectoryEnumerator (pEnumerator);
+                    lister.SetDemandScheduling (fDemand);
+
+                    auto start = chrono::steady_clock::now();
+
+                    HRESULT hr = lister.ProcessDirectoryMultiThreaded (driveInfo,
+                                                                       L"C:\\DeepRoot",
+                                                                       { L"*" },
+                                                                       fTree ? static_cast<IResultsDisplayer &> (treeDisplayer) : displayer,
+                                                                       IResultsDisplayer::EDirectoryLevel::Initial,
+                                                                       totals);
+
+                    auto end = chrono::steady_clock::now();
+
+                    Assert::IsTrue (SUCCEEDED (hr));
+
+                    Logger::WriteMessage (format (L"{:<5} demand {:<3}  {:8.1f} ms elapsed  {:8.1f} ms display stall\n",
+                                                  fTree ? L"Tree" : L"/S",
+                                                  fDemand ? L"on" : L"off",
+                                                  chrono::duration<double, milli> (end - start).count(),
+                                                  chrono::duration<double, milli> (lister.GetConsumerStallTime()).count()).c_str());
+                }
+            }
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_RecursiveGlobVsPostFilter
+        //
+        //  Lists a monorepo-shaped synthetic tree (200 packages, each with a
+        //  src tree, tests, a wide node_modules, and build output; ~48K
+        //  directories) with 50 us of simulated latency per directory.  Finds
+        //  the .cpp files under each package's src once with the recursive
+        //  mask "*\src\**\*.cpp", and once with /S *.cpp, keeping only the
+        //  directories whose path has a src segment.  Logs wall time and
+        //  directories read for each.  Ignored by default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_RecursiveGlobVsPostFilter)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_RecursiveGlobVsPostFilter)
+        {
+            static constexpr int s_kcPackages    = 200;
+            static constexpr int s_kcSrcLevels   = 3;
+            static constexpr int s_kcSrcFanOut   = 3;
+            static constexpr int s_kcModules     = 25;
+            static constexpr int s_kcModuleDirs  = 6;
+            static constexpr int s_kcBuildDirs   = 20;
+
+            MockFileTree tree;
+            UINT         cExpected = 0;
+
+
+
+            for (int iPackage = 0; iPackage < s_kcPackages; ++iPackage)
+            {
+                wstring         package = format (L"C:\\Mono\\pkg{}", iPackage);
+                vector<wstring> vLevel  = { package + L"\\src" };
+
+                for (int iLevel = 0; iLevel <= s_kcSrcLevels; ++iLevel)
+                {
+                    vector<wstring> vNext;
+
+                    for (const wstring & dir : vLevel)
+                    {
+                        tree.AddFile (format (L"{}\\a.cpp", dir).c_str(), 100);
+                        tree.AddFile (format (L"{}\\a.h",   dir).c_str(), 50);
+                        ++cExpected;
+
+                        for (int iChild = 0; iLevel < s_kcSrcLevels && iChild < s_kcSrcFanOut; ++iChild)
+                        {
+                            vNext.push_back (format (L"{}\\d{}", dir, iChild));
+                        }
+                    }
+
+                    vLevel = std::move (vNext);
+                }
+
+                tree.AddFile (format (L"{}\\test\\a_test.cpp", package).c_str(), 100);
+
+                for (int iModule = 0; iModule < s_kcModules; ++iModule)
+                {
+                    for (int iDir = 0; iDir < s_kcModuleDirs; ++iDir)
+                    {
+                        tree.AddFile (format (L"{}\\node_modules\\m{}\\lib{}\\index.js", package, iModule, iDir).c_str(), 10);
+                    }
+                }
+
+                for (int iDir = 0; iDir < s_kcBuildDirs; ++iDir)
+                {
+                    tree.AddFile (format (L"{}\\build\\obj{}\\gen.cpp", package, iDir).c_str(), 100);
+                }
+            }
+
+            for (bool fGlob : { true, false })
+            {
+                auto                   pEnumerator = make_shared<MockDirectoryEnumerator> (tree, 64);
+                auto                   cmdLine     = make_shared<CCommandLine> ();
+                auto                   console     = make_shared<CTestConsole> ();
+                auto                   config      = make_shared<CConfig> ();
+                SListingTotals         totals      = {};
+                MockResultsDisplayer   globDisplayer;
+                PathFilteringDisplayer filterDisplayer (L"src");
+
+                pEnumerator->SetLatency (chrono::microseconds (50));
+                cmdLine->m_fRecurse = !fGlob;
+                console->Initialize (config);
+
+                CMultiThreadedLister lister    (cmdLine, console, config);
+                CDriveInfo           driveInfo (L"C:\\Mono");
+
+                lister.SetDirectoryEnumerator (pEnumerator);
+
+                auto start = chrono::steady_clock::now();
+
+                HRESULT hr = lister.ProcessDirectoryMultiThreaded (driveInfo,
+                                                                   L"C:\\Mono",
+                                                                   { fGlob ? L"*\\src\\**\\*.cpp" : L"*.cpp" },
+                                                                   fGlob ? static_cast<IResultsDisplayer &> (globDisplayer) : filterDisplayer,
+                                                                   IResultsDisplayer::EDirectoryLevel::Initial,
+                                                                   totals);
+
+                auto end = chrono::steady_clock::now();
+
+                Assert::IsTrue (SUCCEEDED (hr));
+                Assert::AreEqual (static_cast<ULONGLONG> (cExpected),
+                                  fGlob ? globDisplayer.m_cTotalFilesDisplayed : filterDisplayer.m_cFilesKept,
+                                  L"Both runs should find the same files");
+
+                Logger::WriteMessage (format (L"{:<18}  {:8.1f} ms  {:6} dirs read\n",
+                                              fGlob ? L"*\\src\\**\\*.cpp" : L"/S *.cpp + filter",
+                                              chrono::duration<double, milli> (end - start).count(),
+                                              pEnumerator->GetEnumerateCount()).c_str());
+            }
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  NonRecursive_PrefetchedGroups_DisplayInCommandLineOrder
+        //
+        //  Three directories with two specs each, every read delayed so the
+        //  prefetch threads finish out of order.  The listings must still be
+        //  displayed group by group and spec by spec, with each directory +
+        //  spec read once.  List checks that the directories exist, so they
+        //  are created on disk (empty); their contents come from the mock
+        //  enumerator.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(NonRecursive_PrefetchedGroups_DisplayInCommandLineOrder)
+        {
+            filesystem::path         root     = filesystem::temp_directory_path() / format (L"TCDirPrefetch_{}", GetCurrentProcessId());
+            vector<filesystem::path> vDirs    = { root / L"c", root / L"a", root / L"b" };
+            vector<filesystem::path> vSpecs   = { L"*.cs", L"*.txt" };
+            MockFileTree             tree;
+            vector<MaskGroup>        groups;
+            vector<wstring>          vExpected;
+            vector<wstring>          vDisplayed;
+            std::error_code          ec;
+
+
+
+            for (size_t iDir = 0; iDir < vDirs.size(); ++iDir)
+            {
+                filesystem::create_directories (vDirs[iDir], ec);
+
+                // A different number of matches per directory and spec
+                for (size_t iFile = 0; iFile <= iDir; ++iFile)
+                {
+                    tree.AddFile ((vDirs[iDir] / format (L"f{}.cs", iFile)).c_str(), 100);
+                    tree.AddFile ((vDirs[iDir] / format (L"g{}.txt", iFile)).c_str(), 100);
+                    tree.AddFile ((vDirs[iDir] / format (L"h{}.txt", iFile)).c_str(), 100);
+                }
+
+                groups.push_back (MaskGroup (vDirs[iDir], vSpecs));
+                vExpected.push_back (format (L"{} {}", (vDirs[iDir] / vSpecs[0]).wstring(), iDir + 1));
+                vExpected.push_back (format (L"{} {}", (vDirs[iDir] / vSpecs[1]).wstring(), 2 * (iDir + 1)));
+            }
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            auto console     = make_shared<CTestConsole> ();
+            auto config      = make_shared<CConfig> ();
+
+            pEnumerator->SetLatency (chrono::milliseconds (20));
+            console->Initialize (config);
+
+            {
+                CDirectoryLister lister (cmdLine, console, config, make_unique<OrderRecordingDisplayer> (vDisplayed));
+
+                lister.SetDirectoryEnumerator (pEnumerator);
+                lister.PrefetchListings (groups);
+
+                for (const auto & group : groups)
+                {
+                    lister.List (group);
+                }
+            }
+
+            filesystem::remove_all (root, ec);
+
+            Assert::AreEqual (vExpected.size(), vDisplayed.size());
+
+            for (size_t i = 0; i < vExpected.size(); ++i)
+            {
+                Assert::AreEqual (vExpected[i], vDisplayed[i]);
+            }
+
+            Assert::AreEqual (vExpected.size(), pEnumerator->GetEnumerateCount(), L"Each directory + spec should be read once");
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_WithIcons_CorrectTotals
+        //
+        //  Verifies tree mode works correctly with icons enabled.
+        //  Icons may not render in test environment (no NerdFont detection)
+        //  but the code path must not crash.
         //
         ////////////////////////////////////////////////////////////////////////
 
@@ -1706,6 +3058,355 @@ namespace UnitTest
 
 
 
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  ListWithFollowPolicy
+        //
+        //  Runs a multi-threaded /S listing of C:\MockRoot with the given
+        //  --Follow value and returns the number of directories read.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        static size_t ListWithFollowPolicy (const MockFileTree & tree, CCommandLine::EFollowLinks eFollow, SListingTotals & totals)
+        {
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fRecurse     = true;
+            cmdLine->m_eFollowLinks = eFollow;
+
+            auto console = make_shared<CTestConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CMultiThreadedLister lister    (cmdLine, console, config);
+            CDriveInfo           driveInfo (L"C:\\MockRoot");
+            MockResultsDisplayer displayer;
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                displayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Listing should succeed");
+
+            return pEnumerator->GetEnumerateCount();
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_FollowAlways_PrunesJunctionCycle
+        //
+        //  A junction back to the listing root is listed but not entered,
+        //  and is reported as a pruned link.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_FollowAlways_PrunesJunctionCycle)
+        {
+            //
+            // Setup:
+            //   C:\MockRoot\
+            //     a.txt
+            //     sub\
+            //       b.txt
+            //       loop\  -> C:\MockRoot
+            //
+
+            MockFileTree   tree;
+            SListingTotals totals = {};
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt",       100);
+            tree.AddFile (L"C:\\MockRoot\\sub\\b.txt",  200);
+            tree.AddLink (L"C:\\MockRoot\\sub\\loop",   L"C:\\MockRoot");
+
+            size_t cEnumerated = ListWithFollowPolicy (tree, CCommandLine::EFollowLinks::Always, totals);
+
+            Assert::AreEqual (size_t (2), cEnumerated, L"Only the root and sub should be read");
+            Assert::AreEqual (2u, totals.m_cFiles);
+            Assert::AreEqual (2u, totals.m_cDirectories, L"sub and loop are both listed");
+            Assert::AreEqual (1u, totals.m_cPrunedLinks);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_FollowAlways_TwoLinksToOneTarget_ListedOnce
+        //
+        //  Two links to the same directory: the target is listed through
+        //  one of them and the other is pruned.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_FollowAlways_TwoLinksToOneTarget_ListedOnce)
+        {
+            MockFileTree   tree;
+            SListingTotals totals = {};
+
+            tree.AddFile (L"C:\\Other\\o.txt", 100);
+            tree.AddLink (L"C:\\MockRoot\\l1", L"C:\\Other");
+            tree.AddLink (L"C:\\MockRoot\\l2", L"C:\\Other", IO_REPARSE_TAG_SYMLINK);
+
+            size_t cEnumerated = ListWithFollowPolicy (tree, CCommandLine::EFollowLinks::Always, totals);
+
+            Assert::AreEqual (size_t (2), cEnumerated, L"The root and one copy of the target");
+            Assert::AreEqual (1u, totals.m_cFiles);
+            Assert::AreEqual (1u, totals.m_cPrunedLinks);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_FollowOnce_StopsAtSecondLink
+        //
+        //  --Follow=Once enters a link from the root but not a link found
+        //  inside it.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_FollowOnce_StopsAtSecondLink)
+        {
+            //
+            // Setup:
+            //   C:\MockRoot\
+            //     a.txt
+            //     link\  -> C:\Other
+            //   C:\Other\
+            //     o.txt
+            //     back\  -> C:\MockRoot
+            //
+
+            MockFileTree   tree;
+            SListingTotals totals = {};
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt",  100);
+            tree.AddFile (L"C:\\Other\\o.txt",     200);
+            tree.AddLink (L"C:\\MockRoot\\link",   L"C:\\Other");
+            tree.AddLink (L"C:\\Other\\back",      L"C:\\MockRoot");
+
+            size_t cEnumerated = ListWithFollowPolicy (tree, CCommandLine::EFollowLinks::Once, totals);
+
+            Assert::AreEqual (size_t (2), cEnumerated);
+            Assert::AreEqual (2u, totals.m_cFiles, L"a.txt and o.txt");
+            Assert::AreEqual (2u, totals.m_cDirectories, L"link and back are both listed");
+            Assert::AreEqual (1u, totals.m_cPrunedLinks);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_FollowNever_ListsLinkWithoutEntering
+        //
+        //  --Follow=Never lists links as entries, never reads them, and does
+        //  not report them as pruned.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_FollowNever_ListsLinkWithoutEntering)
+        {
+            MockFileTree   tree;
+            SListingTotals totals = {};
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt",  100);
+            tree.AddFile (L"C:\\Other\\o.txt",     200);
+            tree.AddLink (L"C:\\MockRoot\\link",   L"C:\\Other");
+
+            size_t cEnumerated = ListWithFollowPolicy (tree, CCommandLine::EFollowLinks::Never, totals);
+
+            Assert::AreEqual (size_t (1), cEnumerated);
+            Assert::AreEqual (1u, totals.m_cFiles);
+            Assert::AreEqual (1u, totals.m_cDirectories);
+            Assert::AreEqual (0u, totals.m_cPrunedLinks);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  RecursiveListing_SingleThreaded_PrunesJunctionCycle
+        //
+        //  The single-threaded /S walk applies the same cycle check, against
+        //  the directories on its recursion path.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(RecursiveListing_SingleThreaded_PrunesJunctionCycle)
+        {
+            filesystem::path root = filesystem::temp_directory_path() / format (L"TCDirFollow_{}", GetCurrentProcessId());
+            MockFileTree     tree;
+            std::error_code  ec;
+
+
+
+            filesystem::create_directories (root, ec);
+
+            tree.AddFile ((root / L"a.txt").c_str(),            100);
+            tree.AddFile ((root / L"sub" / L"b.txt").c_str(),   200);
+            tree.AddLink ((root / L"sub" / L"loop").c_str(),    root.c_str());
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            auto console     = make_shared<CTestConsole> ();
+            auto config      = make_shared<CConfig> ();
+            auto pDisplayer  = make_unique<MockResultsDisplayer> ();
+            auto & displayer = *pDisplayer;
+
+            cmdLine->m_fRecurse       = true;
+            cmdLine->m_fMultiThreaded = false;
+            console->Initialize (config);
+
+            {
+                CDirectoryLister lister (cmdLine, console, config, std::move (pDisplayer));
+
+                lister.SetDirectoryEnumerator (pEnumerator);
+                lister.List (MaskGroup (root, { L"*" }));
+
+                Assert::AreEqual (2u, displayer.m_cDisplayResultsCalls, L"Only the root and sub should be listed");
+                Assert::IsTrue   (displayer.m_fRecursiveSummaryCalled);
+                Assert::AreEqual (2u, displayer.m_capturedTotals.m_cFiles);
+                Assert::AreEqual (1u, displayer.m_capturedTotals.m_cPrunedLinks);
+            }
+
+            filesystem::remove_all (root, ec);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_FollowOnce_ExpandsLink
+        //
+        //  With --Follow=Once, tree mode expands a link like any other
+        //  directory.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_FollowOnce_ExpandsLink)
+        {
+            MockFileTree tree;
+            tree.AddFile (L"C:\\MockRoot\\file1.txt",  100);
+            tree.AddFile (L"C:\\Other\\child.txt",     500);
+            tree.AddLink (L"C:\\MockRoot\\link",       L"C:\\Other");
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            cmdLine->m_fTree        = true;
+            cmdLine->m_eFollowLinks = CCommandLine::EFollowLinks::Once;
+
+            auto console = make_shared<CCapturingConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister        (cmdLine, console, config);
+            CDriveInfo            driveInfo      (L"C:\\MockRoot");
+            SListingTotals        totals       = {};
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            vector<filesystem::path> fileSpecs = { L"*" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr));
+
+            wstring stripped = StripAnsiCodes (console->m_strCaptured);
+
+            Assert::IsTrue   (stripped.find (L"child.txt") != wstring::npos, L"The link should be expanded");
+            Assert::AreEqual (2u, totals.m_cFiles);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_PruningWithJunction_ShowsLinkOnlyWhenFollowed
+        //
+        //  With a file mask, a junction that is not followed has no contents
+        //  to match, so it is pruned like an empty directory.  Followed, it
+        //  is shown when its target holds a match.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_PruningWithJunction_ShowsLinkOnlyWhenFollowed)
+        {
+            MockFileTree tree;
+            tree.AddFile (L"C:\\MockRoot\\keep.log",   100);
+            tree.AddFile (L"C:\\Other\\linked.log",    500);
+            tree.AddLink (L"C:\\MockRoot\\junction",   L"C:\\Other");
+
+            for (CCommandLine::EFollowLinks eFollow : { CCommandLine::EFollowLinks::Never, CCommandLine::EFollowLinks::Always })
+            {
+                bool fFollowed   = eFollow == CCommandLine::EFollowLinks::Always;
+                auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+                auto cmdLine     = make_shared<CCommandLine> ();
+                cmdLine->m_fTree        = true;
+                cmdLine->m_eFollowLinks = eFollow;
+
+                auto console = make_shared<CCapturingConsole> ();
+                auto config  = make_shared<CConfig> ();
+                console->Initialize (config);
+
+                CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+                CMultiThreadedLister  lister        (cmdLine, console, config);
+                CDriveInfo            driveInfo      (L"C:\\MockRoot");
+                SListingTotals        totals       = {};
+
+                lister.SetDirectoryEnumerator (pEnumerator);
+
+                HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                    driveInfo,
+                    L"C:\\MockRoot",
+                    { L"*.log" },
+                    treeDisplayer,
+                    IResultsDisplayer::EDirectoryLevel::Initial,
+                    totals);
+
+                Assert::IsTrue (SUCCEEDED (hr));
+
+                wstring stripped = StripAnsiCodes (console->m_strCaptured);
+
+                Assert::AreEqual (fFollowed, stripped.find (L"junction")   != wstring::npos, L"The junction is shown only when followed");
+                Assert::AreEqual (fFollowed, stripped.find (L"linked.log") != wstring::npos);
+                Assert::AreEqual (fFollowed ? 2u : 1u, totals.m_cFiles);
+            }
+        }
+
+
+
+
+
         ////////////////////////////////////////////////////////////////////////
         //
         //  TreeMode_ConfigOverride_TreeActivatedViaConfig
@@ -1994,15 +3695,87 @@ namespace UnitTest
 
 
 
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  TreeMode_FileMask_LastVisibleEntryGetsCorner
+        //
+        //  Verifies that when the trailing directories of a level are pruned
+        //  by the file mask, the last entry that is actually shown is drawn
+        //  with the corner connector rather than a tee.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(TreeMode_FileMask_LastVisibleEntryGetsCorner)
+        {
+            //
+            // Setup:
+            //   C:\MockRoot\
+            //     alpha\
+            //       x.cpp      (100 bytes)  — matched
+            //     beta\
+            //       y.txt      (100 bytes)  — NOT matched
+            //     gamma\
+            //       z.txt      (100 bytes)  — NOT matched
+            //
+            // File mask: "*.cpp"
+            //
+            // Expected: alpha\ is the only visible entry at the root, so it
+            //           and x.cpp both get the corner; no tee is drawn.
+            //
+
+            MockFileTree tree;
+            tree.AddFile (L"C:\\MockRoot\\alpha\\x.cpp", 100);
+            tree.AddFile (L"C:\\MockRoot\\beta\\y.txt",  100);
+            tree.AddFile (L"C:\\MockRoot\\gamma\\z.txt", 100);
+
+            ScopedFileSystemMock mock (tree);
+
+            auto cmdLine = make_shared<CCommandLine> ();
+            cmdLine->m_fTree = true;
+
+            auto console = make_shared<CCapturingConsole> ();
+            auto config  = make_shared<CConfig> ();
+            console->Initialize (config);
+
+            CResultsDisplayerTree treeDisplayer (cmdLine, console, config, false);
+            CMultiThreadedLister  lister        (cmdLine, console, config);
+            CDriveInfo            driveInfo      (L"C:\\MockRoot");
+            SListingTotals        totals       = {};
+
+            vector<filesystem::path> fileSpecs = { L"*.cpp" };
+
+            HRESULT hr = lister.ProcessDirectoryMultiThreaded (
+                driveInfo,
+                L"C:\\MockRoot",
+                fileSpecs,
+                treeDisplayer,
+                IResultsDisplayer::EDirectoryLevel::Initial,
+                totals);
+
+            Assert::IsTrue (SUCCEEDED (hr), L"Tree mode with file mask should succeed");
+            Assert::AreEqual (1u, totals.m_cFiles, L"Should have 1 matching file");
+
+            wstring stripped = StripAnsiCodes (console->m_strCaptured);
+
+            Assert::IsTrue (stripped.find (L"alpha")                   != wstring::npos,  L"Should contain alpha");
+            Assert::IsTrue (stripped.find (L"beta")                    == wstring::npos,  L"Should NOT contain beta");
+            Assert::IsTrue (stripped.find (L"gamma")                   == wstring::npos,  L"Should NOT contain gamma");
+            Assert::IsTrue (stripped.find (UnicodeSymbols::TreeCorner) != wstring::npos,  L"Last visible entry should use the corner");
+            Assert::IsTrue (stripped.find (UnicodeSymbols::TreeTee)    == wstring::npos,  L"No entry should use a tee");
+        }
+
+
+
+
+
         ////////////////////////////////////////////////////////////////////////
         //
         //  TreeMode_MixedCaseDirs_RecursionSucceeds
         //
         //  Verifies that tree-mode directory recursion works when directory
-        //  names use mixed case.  The childMap lookup uses m_strLowerName
-        //  (pre-computed lowercase filename) to match entries from m_vMatches
-        //  against m_vChildren.  If the lowercasing were broken, the lookup
-        //  would fail and the tree would not recurse into subdirectories.
+        //  names use mixed case.  Each directory entry in m_vMatches carries
+        //  the index of its node in m_vChildren (m_iChild); if the link were
+        //  missing, the tree would not recurse into subdirectories.
         //
         ////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/DirectoryInfo.h"
+#include "../TCDirCore/DirectoryNodePool.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(DirectoryNodePoolTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        static shared_ptr<CDirectoryInfo> MakeChild (const shared_ptr<CDirectoryNodePool> & pPool, const shared_ptr<CDirectoryInfo> & pParent, LPCWSTR pszLeaf)
+        {
+            return allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (pPool), pParent, pszLeaf);
+        }
+
+
+
+
+
+        TEST_METHOD(ChildPathIsComposedFromParentAndLeaf)
+        {
+            auto pPool  = make_shared<CDirectoryNodePool>();
+            auto pRoot  = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (pPool), L"C:\\Root", L"*.cpp");
+            auto pChild = MakeChild (pPool, pRoot,  L"src");
+            auto pLeaf  = MakeChild (pPool, pChild, L"core");
+
+
+
+            Assert::AreEqual (wstring (L"C:\\Root"),           pRoot->DirPath().wstring());
+            Assert::AreEqual (wstring (L"C:\\Root\\src"),      pChild->DirPath().wstring());
+            Assert::AreEqual (wstring (L"C:\\Root\\src\\core"), pLeaf->DirPath().wstring());
+            Assert::AreEqual (wstring (L"core"),               pLeaf->m_strLeafName);
+            Assert::IsTrue   (pLeaf->m_dirPath.empty());
+        }
+
+
+
+
+
+        TEST_METHOD(ChildrenShareTheRootFileSpecs)
+        {
+            vector<filesystem::path> vSpecs = { L"*.cpp", L"*.h" };
+            auto pPool  = make_shared<CDirectoryNodePool>();
+            auto pRoot  = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (pPool), L"C:\\Root", vSpecs);
+            auto pChild = MakeChild (pPool, pRoot,  L"a");
+            auto pLeaf  = MakeChild (pPool, pChild, L"b");
+
+
+
+            Assert::IsTrue (&pRoot->FileSpecs() == &pLeaf->FileSpecs());
+            Assert::AreEqual (size_t (2), pLeaf->FileSpecs().size());
+        }
+
+
+
+
+
+        TEST_METHOD(FreedNodesAreRecycled)
+        {
+            auto   pPool = make_shared<CDirectoryNodePool>();
+            auto   pRoot = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (pPool), L"C:\\Root", L"*");
+            size_t cNodes = CDirectoryNodePool::s_kcBlocksPerChunk * 4;
+
+
+
+            //
+            // Create and drop a chunk's worth of nodes over and over; the
+            // pool should never need more than the first chunks it carved.
+            //
+
+            for (int iRound = 0; iRound < 8; ++iRound)
+            {
+                vector<shared_ptr<CDirectoryInfo>> vNodes;
+
+                for (size_t i = 0; i < cNodes; ++i)
+                {
+                    vNodes.push_back (MakeChild (pPool, pRoot, L"d"));
+                }
+            }
+
+            Assert::IsTrue (pPool->GetChunkCount() <= 5);
+        }
+
+
+
+
+
+        TEST_METHOD(PoolOutlivesItsOwnerWhileNodesRemain)
+        {
+            auto pPool = make_shared<CDirectoryNodePool>();
+            auto pRoot = allocate_shared<CDirectoryInfo> (CDirectoryNodeAllocator<CDirectoryInfo> (pPool), L"C:\\Root", L"*");
+            auto pLeaf = MakeChild (pPool, pRoot, L"leaf");
+
+
+
+            // The lister drops its pool reference when the listing ends
+            pPool.reset();
+            pRoot.reset();
+
+            Assert::AreEqual (wstring (L"C:\\Root\\leaf"), pLeaf->DirPath().wstring());
+        }
+    };
+}
@@ -0,0 +1,267 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/EntryFilter.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(EntryFilterTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        static WIN32_FIND_DATA MakeEntry (LPCWSTR pszName, ULONGLONG cbSize, ULONGLONG ftLastWrite = 0, DWORD dwAttributes = FILE_ATTRIBUTE_ARCHIVE)
+        {
+            WIN32_FIND_DATA wfd = {};
+            ULARGE_INTEGER  uli = {};
+
+
+
+            wcscpy_s (wfd.cFileName, pszName);
+
+            uli.QuadPart = cbSize;
+            wfd.nFileSizeLow  = uli.LowPart;
+            wfd.nFileSizeHigh = uli.HighPart;
+
+            uli.QuadPart = ftLastWrite;
+            wfd.ftLastWriteTime.dwLowDateTime  = uli.LowPart;
+            wfd.ftLastWriteTime.dwHighDateTime = uli.HighPart;
+
+            wfd.dwFileAttributes = dwAttributes;
+
+            return wfd;
+        }
+
+        static ULONGLONG ParseDateOrFail (LPCWSTR pszDate)
+        {
+            ULONGLONG ftDate = 0;
+
+
+
+            Assert::AreEqual (S_OK, CEntryFilter::ParseDate (pszDate, ftDate), pszDate);
+
+            return ftDate;
+        }
+
+
+
+
+
+        TEST_METHOD(ParseSize_UnitsAre1024Based)
+        {
+            struct STestCase
+            {
+                LPCWSTR   pszText;
+                ULONGLONG cbExpected;
+            };
+
+            static constexpr STestCase s_krgCases[] =
+            {
+                { L"0",     0                     },
+                { L"512",   512                   },
+                { L"1K",    1024                  },
+                { L"1kb",   1024                  },
+                { L"100M",  100ull << 20          },
+                { L"1.5K",  1536                  },
+                { L"2G",    2ull << 30            },
+                { L"3TB",   3ull << 40            },
+                { L"7B",    7                     },
+            };
+
+            for (const STestCase & testCase : s_krgCases)
+            {
+                ULONGLONG cbSize = 0;
+
+                Assert::AreEqual (S_OK, CEntryFilter::ParseSize (testCase.pszText, cbSize), testCase.pszText);
+                Assert::AreEqual (testCase.cbExpected, cbSize, testCase.pszText);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ParseSize_RejectsMalformedText)
+        {
+            for (LPCWSTR pszText : { L"", L"M", L"10X", L"10MM", L"-5", L"99999999999999999999", L"20000000000T" })
+            {
+                ULONGLONG cbSize = 0;
+
+                Assert::AreEqual (E_INVALIDARG, CEntryFilter::ParseSize (pszText, cbSize), pszText);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(ParseDate_TimeOfDayIsOptional)
+        {
+            ULONGLONG ftMidnight = ParseDateOrFail (L"2026-10-01");
+
+
+
+            Assert::AreEqual (ftMidnight,                  ParseDateOrFail (L"2026-10-01T00:00"));
+            Assert::AreEqual (ftMidnight + 10000000ull,    ParseDateOrFail (L"2026-10-01T00:00:01"));
+            Assert::AreEqual (ftMidnight + 36000000000ull, ParseDateOrFail (L"2026-10-01 01:00"));
+            Assert::IsTrue   (ParseDateOrFail (L"2026-10-02") > ftMidnight);
+        }
+
+
+
+
+
+        TEST_METHOD(ParseDate_RejectsMalformedDates)
+        {
+            for (LPCWSTR pszText : { L"", L"2026", L"2026-10", L"10/01/2026", L"2026-13-01", L"2026-02-30", L"2026-10-01T25:00", L"2026-10-01T10", L"2026-10-01x" })
+            {
+                ULONGLONG ftDate = 0;
+
+                Assert::AreEqual (E_INVALIDARG, CEntryFilter::ParseDate (pszText, ftDate), pszText);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(EmptyFilter_MatchesEverything)
+        {
+            CEntryFilter filter;
+
+
+
+            filter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            Assert::IsTrue (filter.IsEmpty());
+            Assert::IsTrue (filter.Matches (MakeEntry (L"a.txt", 0)));
+            Assert::IsTrue (filter.Matches (MakeEntry (L"dir",   0, 0, FILE_ATTRIBUTE_DIRECTORY)));
+        }
+
+
+
+
+
+        TEST_METHOD(SizeBounds_AreStrictAndMatchOnlyFiles)
+        {
+            CEntryFilter filter;
+
+
+
+            Assert::AreEqual (S_OK, filter.AddSizeBound (L"1K", true));
+            Assert::AreEqual (S_OK, filter.AddSizeBound (L"1M", false));
+            filter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            Assert::IsFalse (filter.Matches (MakeEntry (L"a", 1024)));
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"a", 1025)));
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"a", (1 << 20) - 1)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"a", 1 << 20)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"d", 4096, 0, FILE_ATTRIBUTE_DIRECTORY)));
+        }
+
+
+
+
+
+        TEST_METHOD(RepeatedBounds_FoldToTheTightest)
+        {
+            CEntryFilter filter;
+
+
+
+            Assert::AreEqual (S_OK, filter.AddSizeBound (L"10", true));
+            Assert::AreEqual (S_OK, filter.AddSizeBound (L"100", true));
+            Assert::AreEqual (S_OK, filter.AddSizeBound (L"50", true));
+            filter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            Assert::IsFalse (filter.Matches (MakeEntry (L"a", 100)));
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"a", 101)));
+        }
+
+
+
+
+
+        TEST_METHOD(TimeBounds_UseTheSelectedField)
+        {
+            ULONGLONG    ftFrom  = ParseDateOrFail (L"2026-10-01");
+            ULONGLONG    ftUntil = ParseDateOrFail (L"2026-10-08");
+            CEntryFilter filter;
+
+
+
+            Assert::AreEqual (S_OK, filter.AddTimeBound (L"2026-10-01", true));
+            Assert::AreEqual (S_OK, filter.AddTimeBound (L"2026-10-08", false));
+            filter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"a", 0, ftFrom)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"a", 0, ftFrom - 1)));
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"a", 0, ftUntil - 1)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"a", 0, ftUntil)));
+
+            // Directories are filtered by date too
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"d", 0, ftFrom, FILE_ATTRIBUTE_DIRECTORY)));
+
+            // Compared against the creation time, the write time is ignored
+            CEntryFilter byCreation;
+
+            Assert::AreEqual (S_OK, byCreation.AddTimeBound (L"2026-10-01", true));
+            byCreation.Compile (&WIN32_FIND_DATA::ftCreationTime);
+
+            Assert::IsFalse (byCreation.Matches (MakeEntry (L"a", 0, ftFrom)));
+        }
+
+
+
+
+
+        TEST_METHOD(NamePatterns_SearchCaseInsensitivelyAndAllMustMatch)
+        {
+            CEntryFilter filter;
+
+
+
+            Assert::AreEqual (S_OK, filter.AddNamePattern (L"\\.(cpp|h)$"));
+            Assert::AreEqual (S_OK, filter.AddNamePattern (L"^test"));
+            filter.Compile (&WIN32_FIND_DATA::ftLastWriteTime);
+
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"TestMain.CPP", 0)));
+            Assert::IsTrue  (filter.Matches (MakeEntry (L"test_util.h",  0)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"Main.cpp",     0)));
+            Assert::IsFalse (filter.Matches (MakeEntry (L"test.hpp",     0)));
+        }
+
+
+
+
+
+        TEST_METHOD(NamePatterns_RejectInvalidExpressions)
+        {
+            CEntryFilter filter;
+
+
+
+            Assert::AreEqual (E_INVALIDARG, filter.AddNamePattern (L"(unclosed"));
+            Assert::AreEqual (E_INVALIDARG, filter.AddNamePattern (L""));
+            Assert::IsTrue   (filter.IsEmpty());
+        }
+    };
+}
@@ -2,6 +2,7 @@
 #include "EhmTestHelper.h"
 #include "../TCDirCore/CommandLine.h"
 #include "../TCDirCore/FileComparator.h"
+#include "../TCDirCore/DirectoryInfo.h"
 
 
 
@@ -15,6 +16,23 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace UnitTest
 {
+    //
+    // Adds synthetic entries to a directory, in order, so the comparator can
+    // find their names in its arena.
+    //
+
+    static void AddEntries (CDirectoryInfo & di, initializer_list<WIN32_FIND_DATA> entries)
+    {
+        for (const WIN32_FIND_DATA & wfd : entries)
+        {
+            di.AddMatch (FileInfo (wfd), wfd.cFileName);
+        }
+    }
+
+
+
+
+
     TEST_CLASS(FileComparatorTests)
     {
     public:
@@ -37,7 +55,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_SIZE;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA fileSmall = {};
             WIN32_FIND_DATA fileLarge = {};
@@ -46,13 +65,43 @@ namespace UnitTest
             fileSmall.nFileSizeHigh = 0; fileSmall.nFileSizeLow = 100;
             fileLarge.nFileSizeHigh = 0; fileLarge.nFileSizeLow = 200;
 
-            Assert::IsTrue (comp(fileSmall, fileLarge));
-            Assert::IsFalse (comp(fileLarge, fileSmall));
+            AddEntries (di, { fileSmall, fileLarge });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
 
             cmd->m_sortdirection = CCommandLine::ESortDirection::SD_DESCENDING;
 
-            Assert::IsFalse (comp(fileSmall, fileLarge));
-            Assert::IsTrue (comp(fileLarge, fileSmall));
+            Assert::IsFalse (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsTrue (comp(di.m_vMatches[1], di.m_vMatches[0]));
+        }
+
+
+
+
+
+        TEST_METHOD(SizeOrderingUsesHighPart)
+        {
+            auto cmd = std::make_shared<CCommandLine>();
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_SIZE;
+            cmd->m_sortorder           = CCommandLine::ESortOrder::SO_SIZE;
+            cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
+
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
+
+            WIN32_FIND_DATA fileUnder4GB = {};
+            WIN32_FIND_DATA fileOver4GB  = {};
+            StringCchCopyW(fileUnder4GB.cFileName, ARRAYSIZE(fileUnder4GB.cFileName), L"a");
+            StringCchCopyW(fileOver4GB.cFileName,  ARRAYSIZE(fileOver4GB.cFileName),  L"b");
+            fileUnder4GB.nFileSizeHigh = 0; fileUnder4GB.nFileSizeLow = 0xFFFFFFFF;
+            fileOver4GB.nFileSizeHigh  = 1; fileOver4GB.nFileSizeLow  = 0;
+
+            AddEntries (di, { fileUnder4GB, fileOver4GB });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -67,7 +116,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NAME;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA entryDir  = {};
             WIN32_FIND_DATA entryFile = {};
@@ -76,8 +126,10 @@ namespace UnitTest
             entryDir.dwFileAttributes  = FILE_ATTRIBUTE_DIRECTORY;
             entryFile.dwFileAttributes = 0;
 
-            Assert::IsTrue (comp(entryDir, entryFile));
-            Assert::IsFalse (comp(entryFile, entryDir));
+            AddEntries (di, { entryDir, entryFile });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -92,7 +144,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NAME;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             // Same name => falls back; verify reverse applies only to primary attribute (not to fallback).
             WIN32_FIND_DATA a = {};
@@ -106,10 +159,12 @@ namespace UnitTest
             a.nFileSizeHigh = 0; a.nFileSizeLow = 100;
             b.nFileSizeHigh = 0; b.nFileSizeLow = 200;
 
+            AddEntries (di, { a, b });
+
             // Even though direction is DESC for primary (name), because names are equal,
             // comparison falls back, and reverse should NOT apply. Smaller comes first.
-            Assert::IsTrue (comp(a, b));
-            Assert::IsFalse (comp(b, a));
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -124,7 +179,8 @@ namespace UnitTest
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
             // m_timeField defaults to TF_WRITTEN
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA older = {};
             WIN32_FIND_DATA newer = {};
@@ -135,8 +191,10 @@ namespace UnitTest
             older.ftLastWriteTime.dwHighDateTime = 0; older.ftLastWriteTime.dwLowDateTime = 100;
             newer.ftLastWriteTime.dwHighDateTime = 0; newer.ftLastWriteTime.dwLowDateTime = 200;
 
-            Assert::IsTrue (comp(older, newer));
-            Assert::IsFalse (comp(newer, older));
+            AddEntries (di, { older, newer });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -151,7 +209,8 @@ namespace UnitTest
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
             cmd->m_timeField           = CCommandLine::ETimeField::TF_CREATION;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA older = {};
             WIN32_FIND_DATA newer = {};
@@ -164,8 +223,10 @@ namespace UnitTest
             older.ftLastWriteTime.dwHighDateTime  = 0; older.ftLastWriteTime.dwLowDateTime  = 200;  // Intentionally reversed
             newer.ftLastWriteTime.dwHighDateTime  = 0; newer.ftLastWriteTime.dwLowDateTime  = 100;
 
-            Assert::IsTrue (comp(older, newer));
-            Assert::IsFalse (comp(newer, older));
+            AddEntries (di, { older, newer });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -180,7 +241,8 @@ namespace UnitTest
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
             cmd->m_timeField           = CCommandLine::ETimeField::TF_ACCESS;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA older = {};
             WIN32_FIND_DATA newer = {};
@@ -193,8 +255,10 @@ namespace UnitTest
             older.ftLastWriteTime.dwHighDateTime  = 0; older.ftLastWriteTime.dwLowDateTime  = 200;  // Intentionally reversed
             newer.ftLastWriteTime.dwHighDateTime  = 0; newer.ftLastWriteTime.dwLowDateTime  = 100;
 
-            Assert::IsTrue (comp(older, newer));
-            Assert::IsFalse (comp(newer, older));
+            AddEntries (di, { older, newer });
+
+            Assert::IsTrue (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -209,7 +273,8 @@ namespace UnitTest
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
             cmd->m_timeField           = CCommandLine::ETimeField::TF_CREATION;
 
-            FileComparator comp(cmd);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
 
             WIN32_FIND_DATA older = {};
             WIN32_FIND_DATA newer = {};
@@ -219,9 +284,11 @@ namespace UnitTest
             older.ftCreationTime.dwHighDateTime = 0; older.ftCreationTime.dwLowDateTime = 100;
             newer.ftCreationTime.dwHighDateTime = 0; newer.ftCreationTime.dwLowDateTime = 200;
 
+            AddEntries (di, { older, newer });
+
             // Descending: newer should come before older
-            Assert::IsFalse (comp(older, newer));
-            Assert::IsTrue (comp(newer, older));
+            Assert::IsFalse (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsTrue (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -235,7 +302,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NAME;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
 
-            FileComparator comp(cmd, true /* fInterleavedSort */);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di, true /* fInterleavedSort */);
 
             WIN32_FIND_DATA entryDir  = {};
             WIN32_FIND_DATA entryFile = {};
@@ -244,9 +312,11 @@ namespace UnitTest
             entryDir.dwFileAttributes  = FILE_ATTRIBUTE_DIRECTORY;
             entryFile.dwFileAttributes = 0;
 
+            AddEntries (di, { entryDir, entryFile });
+
             // In interleaved mode, "aaa" (file) sorts before "zzz" (dir) by name
-            Assert::IsFalse (comp(entryDir, entryFile));
-            Assert::IsTrue (comp(entryFile, entryDir));
+            Assert::IsFalse (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsTrue (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -260,7 +330,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NAME;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
 
-            FileComparator comp(cmd, true /* fInterleavedSort */);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di, true /* fInterleavedSort */);
 
             WIN32_FIND_DATA dir1  = {};
             WIN32_FIND_DATA file1 = {};
@@ -276,13 +347,103 @@ namespace UnitTest
             file2.dwFileAttributes = 0;
 
             // Verify full sort produces: aaa(file), bbb(dir), ccc(file), ddd(dir)
-            std::vector<WIN32_FIND_DATA> entries = { dir2, file1, dir1, file2 };
-            std::sort(entries.begin(), entries.end(), comp);
+            AddEntries (di, { dir2, file1, dir1, file2 });
+            std::sort(di.m_vMatches.begin(), di.m_vMatches.end(), comp);
+
+            Assert::AreEqual(std::wstring(L"aaa"), std::wstring(di.Name (di.m_vMatches[0])));
+            Assert::AreEqual(std::wstring(L"bbb"), std::wstring(di.Name (di.m_vMatches[1])));
+            Assert::AreEqual(std::wstring(L"ccc"), std::wstring(di.Name (di.m_vMatches[2])));
+            Assert::AreEqual(std::wstring(L"ddd"), std::wstring(di.Name (di.m_vMatches[3])));
+        }
+
+
+
+
+        TEST_METHOD(NaturalSort_OrdersDigitRunsByValue)
+        {
+            auto cmd = std::make_shared<CCommandLine>();
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_NATURAL;
+            cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NATURAL;
+
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+            static constexpr LPCWSTR s_krgszNames[] = { L"shard10", L"log.10.txt", L"Shard2", L"shard1", L"log.2.txt", L"shard1000", L"shard", L"shard1a" };
+
+            for (LPCWSTR pszName : s_krgszNames)
+            {
+                WIN32_FIND_DATA wfd = {};
+                StringCchCopyW(wfd.cFileName, ARRAYSIZE(wfd.cFileName), pszName);
+                AddEntries (di, { wfd });
+            }
+
+            // The natural keys are built when the comparator is created
+            FileComparator comp(cmd, di);
+
+            std::sort(di.m_vMatches.begin(), di.m_vMatches.end(), comp);
+
+            static constexpr LPCWSTR s_krgszExpected[] = { L"log.2.txt", L"log.10.txt", L"shard", L"shard1", L"shard1a", L"Shard2", L"shard10", L"shard1000" };
 
-            Assert::AreEqual(std::wstring(L"aaa"), std::wstring(entries[0].cFileName));
-            Assert::AreEqual(std::wstring(L"bbb"), std::wstring(entries[1].cFileName));
-            Assert::AreEqual(std::wstring(L"ccc"), std::wstring(entries[2].cFileName));
-            Assert::AreEqual(std::wstring(L"ddd"), std::wstring(entries[3].cFileName));
+            for (size_t i = 0; i < ARRAYSIZE(s_krgszExpected); ++i)
+            {
+                Assert::AreEqual(std::wstring(s_krgszExpected[i]), std::wstring(di.Name (di.m_vMatches[i])));
+            }
+        }
+
+
+
+
+        TEST_METHOD(NaturalSort_LeadingZerosTieToNextPreference)
+        {
+            auto cmd = std::make_shared<CCommandLine>();
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_NATURAL;
+            cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NATURAL;
+            cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
+
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+            WIN32_FIND_DATA padded   = {};
+            WIN32_FIND_DATA unpadded = {};
+            StringCchCopyW(padded.cFileName,   ARRAYSIZE(padded.cFileName),   L"run007");
+            StringCchCopyW(unpadded.cFileName, ARRAYSIZE(unpadded.cFileName), L"run7");
+
+            AddEntries (di, { unpadded, padded });
+
+            FileComparator comp(cmd, di);
+
+            // Equal natural keys fall back to the name, which is not reversed
+            Assert::IsTrue  (comp(di.m_vMatches[1], di.m_vMatches[0]));
+            Assert::IsFalse (comp(di.m_vMatches[0], di.m_vMatches[1]));
+        }
+
+
+
+
+        TEST_METHOD(NameCompare_OrdinalByDefault_LocaleOnRequest)
+        {
+            auto cmd = std::make_shared<CCommandLine>();
+
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
+
+            WIN32_FIND_DATA underscore = {};
+            WIN32_FIND_DATA letter     = {};
+            StringCchCopyW(underscore.cFileName, ARRAYSIZE(underscore.cFileName), L"_build");
+            StringCchCopyW(letter.cFileName,     ARRAYSIZE(letter.cFileName),     L"Build");
+
+            AddEntries (di, { underscore, letter });
+
+            // Ordinal: '_' (U+005F) sorts after 'B' (U+0042)
+            Assert::IsTrue  (cmd->m_eNameCompare == CCommandLine::ENameCompare::Ordinal);
+            Assert::IsFalse (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsTrue  (comp(di.m_vMatches[1], di.m_vMatches[0]));
+
+            // Locale: punctuation sorts ahead of letters
+            cmd->m_eNameCompare = CCommandLine::ENameCompare::Locale;
+
+            Assert::IsTrue  (comp(di.m_vMatches[0], di.m_vMatches[1]));
+            Assert::IsFalse (comp(di.m_vMatches[1], di.m_vMatches[0]));
         }
 
 
@@ -296,7 +457,8 @@ namespace UnitTest
             cmd->m_sortorder           = CCommandLine::ESortOrder::SO_NAME;
             cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_ASCENDING;
 
-            FileComparator comp(cmd, false /* fInterleavedSort - default */);
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di, false /* fInterleavedSort - default */);
 
             WIN32_FIND_DATA dir1  = {};
             WIN32_FIND_DATA file1 = {};
@@ -312,13 +474,67 @@ namespace UnitTest
             file2.dwFileAttributes = 0;
 
             // Non-interleaved: dirs first, then files. bbb(dir), ddd(dir), aaa(file), ccc(file)
-            std::vector<WIN32_FIND_DATA> entries = { dir2, file1, dir1, file2 };
-            std::sort(entries.begin(), entries.end(), comp);
+            AddEntries (di, { dir2, file1, dir1, file2 });
+            std::sort(di.m_vMatches.begin(), di.m_vMatches.end(), comp);
+
+            Assert::AreEqual(std::wstring(L"bbb"), std::wstring(di.Name (di.m_vMatches[0])));
+            Assert::AreEqual(std::wstring(L"ddd"), std::wstring(di.Name (di.m_vMatches[1])));
+            Assert::AreEqual(std::wstring(L"aaa"), std::wstring(di.Name (di.m_vMatches[2])));
+            Assert::AreEqual(std::wstring(L"ccc"), std::wstring(di.Name (di.m_vMatches[3])));
+        }
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_SortCompactEntries
+        //
+        //  Sorts 100K synthetic entries by name and logs the sort time and
+        //  the bytes held by the records plus the name arena.  Ignored by
+        //  default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_SortCompactEntries)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_SortCompactEntries)
+        {
+            static constexpr size_t s_kcEntries = 100000;
+
+            auto cmd = std::make_shared<CCommandLine>();
+
+            CDirectoryInfo di (L"C:\\Test", L"*");
+            FileComparator comp(cmd, di);
+
+
+
+            //
+            // Multiplicative hashing scatters the names so the input is not
+            // already sorted.
+            //
+
+            for (size_t i = 0; i < s_kcEntries; ++i)
+            {
+                std::wstring name = std::format (L"File{:08x}.txt", static_cast<UINT> (i * 2654435761u));
+
+                di.AddMatch (FileInfo(), name.c_str());
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            std::sort(di.m_vMatches.begin(), di.m_vMatches.end(), comp);
+
+            auto end = std::chrono::steady_clock::now();
 
-            Assert::AreEqual(std::wstring(L"bbb"), std::wstring(entries[0].cFileName));
-            Assert::AreEqual(std::wstring(L"ddd"), std::wstring(entries[1].cFileName));
-            Assert::AreEqual(std::wstring(L"aaa"), std::wstring(entries[2].cFileName));
-            Assert::AreEqual(std::wstring(L"ccc"), std::wstring(entries[3].cFileName));
+            Logger::WriteMessage (std::format (L"{} entries  {:8.1f} ms  {} bytes/record  {} KB records + {} KB names\n",
+                                               s_kcEntries,
+                                               std::chrono::duration<double, std::milli> (end - start).count(),
+                                               sizeof (FileInfo),
+                                               di.m_vMatches.capacity() * sizeof (FileInfo) / 1024,
+                                               di.m_vNameArena.capacity() * sizeof (WCHAR) / 1024).c_str());
         }
 
     };
@@ -0,0 +1,452 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/CaseFolding.h"
+#include "../TCDirCore/FileSpecMatcher.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(FileSpecMatcherTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        TEST_METHOD(Translate_QuestionMarkBecomesDosQm)
+        {
+            Assert::AreEqual (wstring (L"a>c"), CFileSpecMatcher::TranslateDosWildcards (L"a?c"));
+        }
+
+
+
+
+
+        TEST_METHOD(Translate_StarDotStar)
+        {
+            Assert::AreEqual (wstring (L"<\"*"), CFileSpecMatcher::TranslateDosWildcards (L"*.*"));
+        }
+
+
+
+
+
+        TEST_METHOD(Translate_TrailingDotBecomesDosDot)
+        {
+            Assert::AreEqual (wstring (L"<\""), CFileSpecMatcher::TranslateDosWildcards (L"*."));
+        }
+
+
+
+
+
+        TEST_METHOD(Translate_LiteralDotUnchanged)
+        {
+            Assert::AreEqual (wstring (L"<.txt"), CFileSpecMatcher::TranslateDosWildcards (L"*.txt"));
+        }
+
+
+
+
+
+        TEST_METHOD(Star_MatchesEverything)
+        {
+            Assert::IsTrue (Matches (L"*",   L"readme"));
+            Assert::IsTrue (Matches (L"*",   L".gitignore"));
+            Assert::IsTrue (Matches (L"*.*", L"readme"));
+            Assert::IsTrue (Matches (L"*.*", L".gitignore"));
+        }
+
+
+
+
+
+        TEST_METHOD(Extension_CaseInsensitive)
+        {
+            Assert::IsTrue  (Matches (L"*.txt", L"notes.txt"));
+            Assert::IsTrue  (Matches (L"*.txt", L"NOTES.TXT"));
+            Assert::IsTrue  (Matches (L"*.txt", L"archive.2024.txt"));
+            Assert::IsFalse (Matches (L"*.txt", L"notes.txt.bak"));
+            Assert::IsFalse (Matches (L"*.txt", L"notes.text"));
+        }
+
+
+
+
+
+        TEST_METHOD(TrailingDot_MatchesNamesWithoutExtension)
+        {
+            Assert::IsTrue  (Matches (L"*.", L"Makefile"));
+            Assert::IsFalse (Matches (L"*.", L"main.cpp"));
+        }
+
+
+
+
+
+        TEST_METHOD(QuestionMark_MatchesZeroCharsAtDotOrEnd)
+        {
+            Assert::IsTrue  (Matches (L"a?c",          L"abc"));
+            Assert::IsFalse (Matches (L"a?c",          L"ac"));
+            Assert::IsFalse (Matches (L"a?c",          L"a.c"));
+            Assert::IsTrue  (Matches (L"file?",        L"file"));
+            Assert::IsTrue  (Matches (L"a?.txt",       L"a.txt"));
+            Assert::IsTrue  (Matches (L"????????.???", L"ab.txt"));
+            Assert::IsFalse (Matches (L"????????.???", L"abcdefghi.txt"));
+        }
+
+
+
+
+
+        TEST_METHOD(Star_SpansDotsWhenNotFollowedByDot)
+        {
+            Assert::IsTrue  (Matches (L"foo*",  L"foo.tar.gz"));
+            Assert::IsTrue  (Matches (L"a*b*c", L"a.x.b.y.c"));
+            Assert::IsFalse (Matches (L"a*b*c", L"a.x.b.y"));
+            Assert::IsTrue  (Matches (L"*.c*",  L"main.cpp"));
+            Assert::IsFalse (Matches (L"*.c*",  L"main.h"));
+        }
+
+
+
+
+
+        TEST_METHOD(LiteralName_MatchesCaseInsensitively)
+        {
+            Assert::IsTrue  (Matches (L"ReadMe.md", L"README.MD"));
+            Assert::IsFalse (Matches (L"ReadMe.md", L"README.MDX"));
+        }
+
+
+
+
+
+        TEST_METHOD(ShortName_MatchesLikeFindFirstFile)
+        {
+            Assert::IsFalse (Matches (L"*.htm", L"index.html"));
+            Assert::IsTrue  (Matches (L"*.htm", L"index.html", L"INDEX~1.HTM"));
+        }
+
+
+
+
+
+        TEST_METHOD(MultipleSpecs_AnyMatches)
+        {
+            CFileSpecMatcher matcher ({ L"*.cpp", L"*.h" });
+
+
+
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"main.cpp")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"main.h")));
+            Assert::IsFalse (matcher.Matches (MakeFindData (L"main.obj")));
+            Assert::IsFalse (matcher.MatchesAll());
+        }
+
+
+
+
+
+        TEST_METHOD(MatchesAll_SetForStarSpecs)
+        {
+            Assert::IsTrue  (CFileSpecMatcher ({ L"*" }).MatchesAll());
+            Assert::IsTrue  (CFileSpecMatcher ({ L"*.txt", L"*.*" }).MatchesAll());
+            Assert::IsFalse (CFileSpecMatcher ({ L"*.txt" }).MatchesAll());
+        }
+
+
+
+
+
+        TEST_METHOD(Compiled_ExtensionTableAndNfaTogether)
+        {
+            CFileSpecMatcher matcher ({ L"*.cpp", L"*.h", L"*.tar.gz", L"test_??.*", L"*~", L"Makefile" });
+
+
+
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"lister.CPP")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"pch.h")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"src.tar.gz")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"test_01.log")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"notes.txt~")));
+            Assert::IsTrue  (matcher.Matches (MakeFindData (L"makefile")));
+            Assert::IsFalse (matcher.Matches (MakeFindData (L"lister.cpp.orig")));
+            Assert::IsFalse (matcher.Matches (MakeFindData (L"test_123.log")));
+            Assert::IsFalse (matcher.Matches (MakeFindData (L"Makefile.am")));
+        }
+
+
+
+
+
+        TEST_METHOD(Compiled_NonAsciiLiteral)
+        {
+            Assert::IsTrue  (Matches (L"r\u00e9sum\u00e9?.doc", L"R\u00c9SUM\u00c91.DOC"));
+            Assert::IsFalse (Matches (L"r\u00e9sum\u00e9?.doc", L"resume1.doc"));
+        }
+
+
+
+
+
+        TEST_METHOD(Compiled_ManySpecsAgreeWithReference)
+        {
+            vector<filesystem::path> specs;
+            vector<wstring>          expressions;
+            LPCWSTR                  rgpszNames[] = { L"a1b22c", L"axbyc", L"a.b.c", L"abc", L"b1", L"c33.txt" };
+
+
+
+            //
+            // Enough specs to overflow the merged NFA and exercise the
+            // one-expression-at-a-time path as well
+            //
+
+            for (int i = 0; i < 100; ++i)
+            {
+                specs.push_back (format (L"a*b?c{}*", i));
+            }
+
+            specs.push_back (L"c??.*");
+
+            for (const auto & spec : specs)
+            {
+                expressions.push_back (CFileSpecMatcher::TranslateDosWildcards (spec.wstring()));
+            }
+
+            CFileSpecMatcher matcher (specs);
+
+            for (LPCWSTR pszName : rgpszNames)
+            {
+                wstring upcased (pszName);
+                bool    fExpected = false;
+
+                CCaseFolding::Upcase (pszName, upcased.data(), upcased.size());
+
+                for (const wstring & expression : expressions)
+                {
+                    wstring upcasedExpression (expression);
+
+                    CCaseFolding::Upcase (expression, upcasedExpression.data(), upcasedExpression.size());
+                    fExpected |= CFileSpecMatcher::IsNameInExpression (upcasedExpression, upcased);
+                }
+
+                Assert::AreEqual (fExpected, matcher.Matches (MakeFindData (pszName)), pszName);
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(CaseFolding_AsciiVectorAndTail)
+        {
+            wchar_t szUpcased[64] = { 0 };
+            size_t  cch           = CCaseFolding::Upcase (L"abcdefghijklmnopqrstuvwxyz-0123.Txt", szUpcased, ARRAYSIZE (szUpcased));
+
+
+
+            Assert::AreEqual (wstring (L"ABCDEFGHIJKLMNOPQRSTUVWXYZ-0123.TXT"), wstring (szUpcased, cch));
+        }
+
+
+
+
+
+        TEST_METHOD(CaseFolding_NonAsciiFallsBackToLocaleMapping)
+        {
+            wchar_t szUpcased[64] = { 0 };
+            size_t  cch           = CCaseFolding::Upcase (L"stra\u00dfe-\u00e9t\u00e9-caf\u00e9", szUpcased, ARRAYSIZE (szUpcased));
+
+
+
+            Assert::IsFalse (CCaseFolding::TryUpcaseAscii (L"caf\u00e9", szUpcased));
+            Assert::AreEqual (wstring (L"STRA\u00dfE-\u00c9T\u00c9-CAF\u00c9"), wstring (szUpcased, cch));
+        }
+
+
+
+
+
+        TEST_METHOD(CaseFolding_TooLongReturnsZero)
+        {
+            wchar_t szUpcased[4] = { 0 };
+
+
+
+            Assert::AreEqual (size_t (0), CCaseFolding::Upcase (L"abcdef", szUpcased, ARRAYSIZE (szUpcased)));
+        }
+
+
+
+
+
+        TEST_METHOD(CaseFolding_CompareOrdinalIgnoresCase)
+        {
+            //
+            // Long enough that the difference falls in the second vector
+            // block, and in the scalar tail
+            //
+
+            Assert::AreEqual (0, CCaseFolding::CompareOrdinalIgnoreCase (L"Source-File-Name.CPP", L"source-file-name.cpp"));
+            Assert::IsTrue   (CCaseFolding::CompareOrdinalIgnoreCase (L"source-file-nameA.cpp", L"SOURCE-FILE-NAMEb.cpp") < 0);
+            Assert::IsTrue   (CCaseFolding::CompareOrdinalIgnoreCase (L"source-file-name.cpq", L"SOURCE-FILE-NAME.CPP") > 0);
+
+            // A proper prefix sorts first
+            Assert::IsTrue   (CCaseFolding::CompareOrdinalIgnoreCase (L"abcdefgh", L"ABCDEFGHI") < 0);
+            Assert::IsTrue   (CCaseFolding::CompareOrdinalIgnoreCase (L"ABCDEFGHI", L"abcdefgh") > 0);
+        }
+
+
+
+
+
+        TEST_METHOD(CaseFolding_CompareOrdinalUsesCodeUnitOrder)
+        {
+            // '_' (U+005F) follows the upcased letters, unlike in the locale order
+            Assert::IsTrue (CCaseFolding::CompareOrdinalIgnoreCase (L"zeta", L"_alpha") < 0);
+
+            // Non-ASCII goes through the table, in both the vector and scalar parts
+            Assert::AreEqual (0, CCaseFolding::CompareOrdinalIgnoreCase (L"r\u00e9sum\u00e9-2024-final.txt", L"R\u00c9SUM\u00c9-2024-FINAL.TXT"));
+            Assert::IsTrue   (CCaseFolding::CompareOrdinalIgnoreCase (L"caf\u00e9", L"cafz") > 0);
+            Assert::AreEqual (L'\u00c9', CCaseFolding::UpcaseChar (L'\u00e9'));
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_CompiledVsPerSpec
+        //
+        //  Matches 10M synthetic names against a typical multi-spec command
+        //  line, once by running each spec separately (the pre-compilation
+        //  approach) and once through the compiled matcher.  Ignored by
+        //  default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_CompiledVsPerSpec)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_CompiledVsPerSpec)
+        {
+            static constexpr size_t  s_kcNames          = 10'000'000;
+            static constexpr size_t  s_kcDistinctNames  = 65536;
+            static constexpr LPCWSTR s_krgpszExtensions[] = { L"cpp", L"h", L"obj", L"pdb", L"txt", L"md", L"json", L"png" };
+
+            vector<filesystem::path> specs       = { L"*.cpp", L"*.h", L"*.hpp", L"*.inl", L"*.rc", L"test_*.txt", L"*Tests.cpp" };
+            vector<wstring>          expressions;
+            vector<WIN32_FIND_DATA>  vNames      (s_kcDistinctNames);
+            CFileSpecMatcher         matcher     (specs);
+            size_t                   cPerSpec    = 0;
+            size_t                   cCompiled   = 0;
+
+
+
+            for (const auto & spec : specs)
+            {
+                wstring expression = CFileSpecMatcher::TranslateDosWildcards (spec.wstring());
+
+                CCaseFolding::Upcase (expression, expression.data(), expression.size());
+                expressions.push_back (expression);
+            }
+
+            for (size_t i = 0; i < s_kcDistinctNames; ++i)
+            {
+                wstring name = format (L"{}Module{}.{}",
+                                       (i % 5 == 0) ? L"test_" : L"",
+                                       i,
+                                       s_krgpszExtensions[i % ARRAYSIZE (s_krgpszExtensions)]);
+
+                wcscpy_s (vNames[i].cFileName, name.c_str());
+            }
+
+            auto start = chrono::steady_clock::now();
+
+            for (size_t i = 0; i < s_kcNames; ++i)
+            {
+                const WIN32_FIND_DATA & wfd = vNames[i % s_kcDistinctNames];
+                wchar_t                 szUpcased[MAX_PATH];
+                int                     cch = LCMapStringEx (LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, wfd.cFileName, -1, szUpcased, MAX_PATH, nullptr, nullptr, 0);
+
+                for (const wstring & expression : expressions)
+                {
+                    if (CFileSpecMatcher::IsNameInExpression (expression, wstring_view (szUpcased, cch - 1)))
+                    {
+                        ++cPerSpec;
+                        break;
+                    }
+                }
+            }
+
+            auto middle = chrono::steady_clock::now();
+
+            for (size_t i = 0; i < s_kcNames; ++i)
+            {
+                cCompiled += matcher.Matches (vNames[i % s_kcDistinctNames]) ? 1 : 0;
+            }
+
+            auto end = chrono::steady_clock::now();
+
+            Assert::AreEqual (cPerSpec, cCompiled);
+
+            Logger::WriteMessage (format (L"{} names, {} specs:  per-spec {:.0f} ms   compiled {:.0f} ms   ({} matches)\n",
+                                          s_kcNames,
+                                          specs.size(),
+                                          chrono::duration<double, milli> (middle - start).count(),
+                                          chrono::duration<double, milli> (end - middle).count(),
+                                          cCompiled).c_str());
+        }
+
+
+
+
+
+    private:
+
+        static WIN32_FIND_DATA MakeFindData (LPCWSTR pszName, LPCWSTR pszShortName = L"")
+        {
+            WIN32_FIND_DATA wfd = { 0 };
+
+
+
+            wcscpy_s (wfd.cFileName,          pszName);
+            wcscpy_s (wfd.cAlternateFileName, pszShortName);
+
+            return wfd;
+        }
+
+
+
+
+
+        static bool Matches (LPCWSTR pszSpec, LPCWSTR pszName, LPCWSTR pszShortName = L"")
+        {
+            CFileSpecMatcher matcher ({ pszSpec });
+
+
+
+            return matcher.Matches (MakeFindData (pszName, pszShortName));
+        }
+    };
+}
@@ -0,0 +1,383 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "Mocks/FileSystemMock.h"
+
+#include "../TCDirCore/CachingDirectoryEnumerator.h"
+#include "../TCDirCore/ListingCache.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(ListingCacheTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        //
+        // Each test gets its own cache file under the temp folder, deleted
+        // before and after so a failed run cannot leak into the next.
+        //
+
+        struct ScopedCacheFile
+        {
+            filesystem::path m_path;
+
+            explicit ScopedCacheFile (LPCWSTR pszName) :
+                m_path (filesystem::temp_directory_path() / format (L"TCDirCache_{}_{}.bin", pszName, GetCurrentProcessId()))
+            {
+                std::error_code ec;
+
+                filesystem::remove (m_path, ec);
+            }
+
+            ~ScopedCacheFile()
+            {
+                std::error_code ec;
+
+                filesystem::remove (m_path, ec);
+                filesystem::remove (filesystem::path (m_path) += L".tmp", ec);
+            }
+        };
+
+
+
+
+
+        //
+        // One run of tcdir against the cache: opens it, reads dirPath
+        // through a caching enumerator over the mock tree, and saves.
+        // Returns the names read and how many times the tree was read.
+        //
+
+        static pair<vector<wstring>, size_t> ReadThroughCache (const filesystem::path & cacheFile, const MockFileTree & tree, LPCWSTR pszDir, bool fRefresh = false, bool fNeedShortNames = false)
+        {
+            auto            pCache = make_shared<CListingCache> (cacheFile);
+            auto            pInner = make_shared<MockDirectoryEnumerator> (tree);
+            vector<wstring> vNames;
+
+
+
+            Assert::IsTrue (SUCCEEDED (pCache->Open()));
+
+            CCachingDirectoryEnumerator enumerator (pInner, pCache, fRefresh);
+
+            HRESULT hr = enumerator.Enumerate (pszDir, L"*", fNeedShortNames, [&] (span<const WIN32_FIND_DATA> batch)
+            {
+                for (const WIN32_FIND_DATA & wfd : batch)
+                {
+                    vNames.push_back (format (L"{} {}", wfd.cFileName, wfd.nFileSizeLow));
+                }
+
+                return true;
+            });
+
+            Assert::AreEqual (S_OK, hr);
+            Assert::AreEqual (S_OK, pCache->Save());
+
+            return { vNames, pInner->GetEnumerateCount() };
+        }
+
+
+
+
+
+        static vector<WIN32_FIND_DATA> MakeEntries (size_t cEntries)
+        {
+            vector<WIN32_FIND_DATA> vEntries (cEntries);
+
+
+
+            for (size_t i = 0; i < cEntries; ++i)
+            {
+                vEntries[i] = {};
+                vEntries[i].nFileSizeLow = static_cast<DWORD> (i);
+                wcscpy_s (vEntries[i].cFileName, format (L"file{}.txt", i).c_str());
+            }
+
+            return vEntries;
+        }
+
+
+
+
+
+        TEST_METHOD(UnchangedDirectory_IsServedFromTheCache)
+        {
+            ScopedCacheFile cacheFile (L"Hit");
+            MockFileTree    tree;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt", 100);
+            tree.AddFile (L"C:\\MockRoot\\b.txt", 200);
+            tree.AddDirectory (L"C:\\MockRoot\\sub");
+
+            auto [vFirst,  cFirstReads]  = ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot");
+            auto [vSecond, cSecondReads] = ReadThroughCache (cacheFile.m_path, tree, L"c:\\mockroot");
+
+            Assert::AreEqual (size_t (1), cFirstReads);
+            Assert::AreEqual (size_t (0), cSecondReads);
+            Assert::IsTrue (vFirst == vSecond);
+            Assert::AreEqual (size_t (3), vSecond.size());
+        }
+
+
+
+
+
+        TEST_METHOD(ChangedStamp_ReadsTheDirectoryAgain)
+        {
+            ScopedCacheFile cacheFile (L"Stale");
+            MockFileTree    tree;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt", 100);
+
+            ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot");
+
+            tree.AddFile (L"C:\\MockRoot\\b.txt", 200);
+
+            auto [vNames, cReads] = ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot");
+
+            Assert::AreEqual (size_t (1), cReads);
+            Assert::AreEqual (size_t (2), vNames.size());
+
+            // The new listing replaced the old one
+            Assert::AreEqual (size_t (0), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot").second);
+        }
+
+
+
+
+
+        TEST_METHOD(Refresh_ReadsEveryDirectory)
+        {
+            ScopedCacheFile cacheFile (L"Refresh");
+            MockFileTree    tree;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt", 100);
+
+            ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot");
+
+            Assert::AreEqual (size_t (1), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot", true).second);
+            Assert::AreEqual (size_t (0), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot").second);
+        }
+
+
+
+
+
+        TEST_METHOD(NeedShortNames_IsServedFromTheCache)
+        {
+            ScopedCacheFile cacheFile (L"ShortNames");
+            MockFileTree    tree;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt", 100);
+            tree.AddFile (L"C:\\MockRoot\\b.cs",  200);
+
+            // Masked listings need the 8.3 names; a record read for either kind serves both
+            Assert::AreEqual (size_t (1), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot", false, true).second);
+            Assert::AreEqual (size_t (0), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot", false, true).second);
+            Assert::AreEqual (size_t (0), ReadThroughCache (cacheFile.m_path, tree, L"C:\\MockRoot").second);
+        }
+
+
+
+
+
+        TEST_METHOD(ShortNames_RoundTripThroughTheFile)
+        {
+            ScopedCacheFile         cacheFile (L"ShortNameFile");
+            vector<WIN32_FIND_DATA> vEntries  = MakeEntries (2);
+            vector<WIN32_FIND_DATA> vRead;
+
+
+
+            wcscpy_s (vEntries[0].cFileName,          L"Long File Name.text");
+            wcscpy_s (vEntries[0].cAlternateFileName, L"LONGFI~1.TEX");
+
+            {
+                CListingCache cache (cacheFile.m_path);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                cache.Store (L"C:\\MockRoot", 1, vEntries);
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            {
+                CListingCache cache (cacheFile.m_path);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                Assert::IsTrue (cache.Lookup (L"C:\\MockRoot", 1, vRead));
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            Assert::AreEqual (size_t (2), vRead.size());
+            Assert::AreEqual (wstring (L"Long File Name.text"), wstring (vRead[0].cFileName));
+            Assert::AreEqual (wstring (L"LONGFI~1.TEX"),        wstring (vRead[0].cAlternateFileName));
+            Assert::AreEqual (wstring (L"file1.txt"),           wstring (vRead[1].cFileName));
+            Assert::AreEqual (wstring (),                       wstring (vRead[1].cAlternateFileName));
+        }
+
+
+
+
+
+        TEST_METHOD(NarrowSpec_BypassesTheCache)
+        {
+            ScopedCacheFile cacheFile (L"Spec");
+            MockFileTree    tree;
+            auto            pCache = make_shared<CListingCache> (cacheFile.m_path);
+            auto            pInner = make_shared<MockDirectoryEnumerator> (tree);
+            size_t          cNames = 0;
+
+
+
+            tree.AddFile (L"C:\\MockRoot\\a.txt", 100);
+            tree.AddFile (L"C:\\MockRoot\\b.cs",  200);
+
+            Assert::IsTrue (SUCCEEDED (pCache->Open()));
+
+            CCachingDirectoryEnumerator enumerator (pInner, pCache, false);
+
+            for (int i = 0; i < 2; ++i)
+            {
+                Assert::AreEqual (S_OK, enumerator.Enumerate (L"C:\\MockRoot", L"*.txt", false, [&] (span<const WIN32_FIND_DATA> batch)
+                {
+                    cNames += batch.size();
+                    return true;
+                }));
+            }
+
+            Assert::AreEqual (size_t (2), pInner->GetEnumerateCount());
+            Assert::AreEqual (size_t (2), cNames);
+
+            vector<WIN32_FIND_DATA> vEntries;
+
+            Assert::IsFalse (pCache->Lookup (L"C:\\MockRoot", 2, vEntries));
+        }
+
+
+
+
+
+        //
+        // Fills a small cache past its capacity.  The directory looked up
+        // last survives the rewrite; the one stored first and never used
+        // again is evicted, and the file ends within three quarters of the
+        // capacity.
+        //
+
+        TEST_METHOD(OverCapacity_EvictsLeastRecentlyUsed)
+        {
+            static constexpr ULONGLONG s_kcbCapacity = 16 * 1024;
+            static constexpr ULONGLONG s_kullStamp   = 1;
+
+            ScopedCacheFile         cacheFile (L"Evict");
+            vector<WIN32_FIND_DATA> vEntries  = MakeEntries (1);
+            vector<WIN32_FIND_DATA> vRead;
+
+
+
+            {
+                CListingCache cache (cacheFile.m_path, s_kcbCapacity);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                cache.Store (L"C:\\Cold", s_kullStamp, vEntries);
+                cache.Store (L"C:\\Hot",  s_kullStamp, vEntries);
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            Sleep (50);
+
+            {
+                CListingCache cache (cacheFile.m_path, s_kcbCapacity);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+
+                for (int i = 0; i < 200; ++i)
+                {
+                    cache.Store (format (L"C:\\Filler\\Dir{}", i), s_kullStamp, vEntries);
+                }
+
+                Sleep (50);
+
+                Assert::IsTrue (cache.Lookup (L"C:\\Hot", s_kullStamp, vRead));
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            Assert::IsTrue (filesystem::file_size (cacheFile.m_path) <= s_kcbCapacity / 4 * 3);
+
+            {
+                CListingCache cache (cacheFile.m_path, s_kcbCapacity);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                Assert::IsTrue  (cache.Lookup (L"C:\\Hot",  s_kullStamp, vRead));
+                Assert::IsFalse (cache.Lookup (L"C:\\Cold", s_kullStamp, vRead));
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(CorruptFile_OpensEmptyAndIsReplaced)
+        {
+            ScopedCacheFile         cacheFile (L"Corrupt");
+            vector<WIN32_FIND_DATA> vEntries  = MakeEntries (3);
+            vector<WIN32_FIND_DATA> vRead;
+
+
+
+            {
+                ofstream garbage (cacheFile.m_path, ios::binary);
+
+                garbage << string (4096, '\x5A');
+            }
+
+            {
+                CListingCache cache (cacheFile.m_path);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                Assert::IsFalse (cache.Lookup (L"C:\\MockRoot", 1, vRead));
+                cache.Store (L"C:\\MockRoot", 1, vEntries);
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            {
+                CListingCache cache (cacheFile.m_path);
+
+                Assert::IsTrue (SUCCEEDED (cache.Open()));
+                Assert::IsTrue (cache.Lookup (L"C:\\MockRoot", 1, vRead));
+                Assert::AreEqual (S_OK, cache.Save());
+            }
+
+            Assert::AreEqual (size_t (3), vRead.size());
+            Assert::AreEqual (wstring (L"file2.txt"), wstring (vRead[2].cFileName));
+            Assert::AreEqual (2ul, vRead[2].nFileSizeLow);
+        }
+    };
+}
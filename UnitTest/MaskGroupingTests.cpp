@@ -88,6 +88,41 @@ namespace UnitTest
 
 
 
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  IsRecursiveGlob tests
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        TEST_METHOD(IsRecursiveGlob_WildcardDirectoryOrTrailingAnyDirs_ReturnsTrue)
+        {
+            Assert::IsTrue (CMaskGrouper::IsRecursiveGlob (L"**\\*.cpp"));
+            Assert::IsTrue (CMaskGrouper::IsRecursiveGlob (L"src/**/test_*"));
+            Assert::IsTrue (CMaskGrouper::IsRecursiveGlob (L"C:\\repo\\*\\src\\*.h"));
+            Assert::IsTrue (CMaskGrouper::IsRecursiveGlob (L"docs\\**"));
+            Assert::IsTrue (CMaskGrouper::IsRecursiveGlob (L"**"));
+        }
+
+        TEST_METHOD(IsRecursiveGlob_WildcardOnlyInLastSegment_ReturnsFalse)
+        {
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"*.cpp"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"foo\\*.cpp"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"C:\\foo\\bar\\"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"foo\\a**b"));
+        }
+
+        TEST_METHOD(IsRecursiveGlob_DevicePrefixQuestionMark_IsNotAWildcard)
+        {
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"\\\\?\\C:\\dir\\*.txt"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"\\\\?\\C:\\dir"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"\\\\.\\C:\\dir\\*.txt"));
+            Assert::IsFalse (CMaskGrouper::IsRecursiveGlob (L"\\\\?\\UNC\\server\\share\\*.txt"));
+            Assert::IsTrue  (CMaskGrouper::IsRecursiveGlob (L"\\\\?\\C:\\dir\\**\\*.cpp"));
+        }
+
+
+
+
         ////////////////////////////////////////////////////////////////////////
         //
         //  GroupMasksByDirectory tests
@@ -233,6 +268,43 @@ namespace UnitTest
             Assert::AreEqual (2ull, groups[0].second.size(), L"Both masks included");
         }
 
+        TEST_METHOD(GroupMasks_RecursiveGlob_SplitsAtFirstWildcardDirectory)
+        {
+            // tcdir src/**/test_* *.h **
+            list<wstring>    masks = { L"src/**/test_*", L"*.h", L"**" };
+            filesystem::path cwd   = filesystem::current_path();
+
+            auto groups = CMaskGrouper::GroupMasksByDirectory (masks);
+
+            Assert::AreEqual (2ull, groups.size(), L"Should have 2 groups");
+
+            // The literal prefix becomes the group's directory
+            Assert::IsTrue (groups[0].first.wstring().find (L"src") != wstring::npos);
+            Assert::AreEqual (wstring (L"**\\test_*"), groups[0].second[0].wstring());
+
+            // A pure "**" shares the current directory's group and lists everything
+            Assert::AreEqual (cwd.wstring(), groups[1].first.wstring());
+            Assert::AreEqual (2ull, groups[1].second.size());
+            Assert::AreEqual (wstring (L"*.h"),   groups[1].second[0].wstring());
+            Assert::AreEqual (wstring (L"**\\*"), groups[1].second[1].wstring());
+        }
+
+        TEST_METHOD(GroupMasks_LongPathPrefix_SplitsLikeAnyQualifiedMask)
+        {
+            // tcdir \\?\C:\NoSuchDir\*.txt \\?\C:\NoSuchDir\**\*.cpp
+            list<wstring> masks = { L"\\\\?\\C:\\NoSuchDir\\*.txt", L"\\\\?\\C:\\NoSuchDir\\**\\*.cpp" };
+
+            auto groups = CMaskGrouper::GroupMasksByDirectory (masks);
+
+            Assert::AreEqual (1ull, groups.size(), L"Both masks start in the same directory");
+            Assert::IsTrue (groups[0].first.wstring().find (L"NoSuchDir") != wstring::npos);
+
+            // Without a wildcard directory the mask is a plain file spec; with one, a glob below it
+            Assert::AreEqual (2ull, groups[0].second.size());
+            Assert::AreEqual (wstring (L"*.txt"),      groups[0].second[0].wstring());
+            Assert::AreEqual (wstring (L"**\\*.cpp"), groups[0].second[1].wstring());
+        }
+
         TEST_METHOD(GroupMasks_PureMaskIsExistingDirectory_ListsContents)
         {
             //
@@ -0,0 +1,344 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "../TCDirCore/CommandLine.h"
+#include "../TCDirCore/DirectoryInfo.h"
+#include "../TCDirCore/FileComparator.h"
+#include "../TCDirCore/MatchSorter.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(MatchSorterTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        //
+        // Fills a directory with cEntries scattered entries.  Sizes and
+        // extensions repeat so the primary attribute ties often, names mix
+        // case and punctuation that the locale comparison treats specially,
+        // and every entry has its own write time so no two entries tie on
+        // every attribute (which would leave their order unspecified).
+        //
+
+        static void AddScatteredEntries (CDirectoryInfo & di, size_t cEntries)
+        {
+            static constexpr LPCWSTR s_krgszStems[] = { L"file", L"File", L"co-op", L"coop", L"a_b", L"Zeta", L"\u00E9t\u00E9", L"10" };
+            static constexpr LPCWSTR s_krgszExts[]  = { L".txt", L".TXT", L".cpp", L"", L".h", L".tar.gz" };
+
+            for (size_t i = 0; i < cEntries; ++i)
+            {
+                UINT            uHash = static_cast<UINT> (i * 2654435761u);
+                WIN32_FIND_DATA wfd   = {};
+                wstring         name  = format (L"{}{:05x}{}",
+                                                s_krgszStems[uHash % ARRAYSIZE (s_krgszStems)],
+                                                i,
+                                                s_krgszExts[(uHash >> 8) % ARRAYSIZE (s_krgszExts)]);
+
+
+
+                wfd.dwFileAttributes                = (uHash % 7 == 0) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+                wfd.nFileSizeLow                    = (uHash >> 4) % 16;
+                wfd.nFileSizeHigh                   = (uHash >> 12) % 2;
+                wfd.ftLastWriteTime.dwHighDateTime  = 0x01DA0000;
+                wfd.ftLastWriteTime.dwLowDateTime   = uHash;
+                wfd.ftCreationTime.dwHighDateTime   = 0x01DA0000 + (uHash % 3);
+
+                di.AddMatch (FileInfo (wfd), name.c_str());
+            }
+        }
+
+
+
+
+
+        //
+        // Sorts the same entries with the comparator and with CMatchSorter
+        // and checks the resulting name sequences are identical.
+        //
+
+        static void VerifyMatchesComparator (CCommandLine::ESortOrder sortOrder, CCommandLine::ESortDirection direction, CCommandLine::ENameCompare nameCompare, bool fInterleaved)
+        {
+            auto           cmd = make_shared<CCommandLine>();
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+
+
+            cmd->m_rgSortPreference[0] = sortOrder;
+            cmd->m_sortorder           = sortOrder;
+            cmd->m_sortdirection       = direction;
+            cmd->m_eNameCompare        = nameCompare;
+
+            AddScatteredEntries (di, 2000);
+
+            FileComparator comp (cmd, di, fInterleaved);
+            FileInfoVector expected;
+
+            for (const FileInfo & fileInfo : di.m_vMatches)
+            {
+                FileInfo copy;
+
+                copy.m_cbSize       = fileInfo.m_cbSize;
+                copy.m_ftCreation   = fileInfo.m_ftCreation;
+                copy.m_ftLastAccess = fileInfo.m_ftLastAccess;
+                copy.m_ftLastWrite  = fileInfo.m_ftLastWrite;
+                copy.m_dwAttributes = fileInfo.m_dwAttributes;
+                copy.m_ibName       = fileInfo.m_ibName;
+                copy.m_cchName      = fileInfo.m_cchName;
+
+                expected.push_back (move (copy));
+            }
+
+            sort (expected.begin(), expected.end(), comp);
+            CMatchSorter (di.m_vMatches, comp).Sort();
+
+            Assert::AreEqual (expected.size(), di.m_vMatches.size());
+
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                Assert::AreEqual (wstring (di.Name (expected[i])), wstring (di.Name (di.m_vMatches[i])),
+                                  format (L"Mismatch at {} (order {}, direction {}, compare {}, interleaved {})",
+                                          i, static_cast<int> (sortOrder), static_cast<int> (direction), static_cast<int> (nameCompare), fInterleaved).c_str());
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(KeyedSortMatchesComparatorForEveryOrder)
+        {
+            static constexpr CCommandLine::ESortOrder s_krgOrders[] =
+            {
+                CCommandLine::ESortOrder::SO_DEFAULT,
+                CCommandLine::ESortOrder::SO_NAME,
+                CCommandLine::ESortOrder::SO_EXTENSION,
+                CCommandLine::ESortOrder::SO_SIZE,
+                CCommandLine::ESortOrder::SO_DATE,
+                CCommandLine::ESortOrder::SO_NATURAL,
+            };
+
+            for (CCommandLine::ESortOrder sortOrder : s_krgOrders)
+            {
+                for (CCommandLine::ESortDirection direction : { CCommandLine::ESortDirection::SD_ASCENDING, CCommandLine::ESortDirection::SD_DESCENDING })
+                {
+                    for (CCommandLine::ENameCompare nameCompare : { CCommandLine::ENameCompare::Ordinal, CCommandLine::ENameCompare::Locale })
+                    {
+                        VerifyMatchesComparator (sortOrder, direction, nameCompare, false);
+                        VerifyMatchesComparator (sortOrder, direction, nameCompare, true);
+                    }
+                }
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(DescendingReversesOnlyThePrimaryAttribute)
+        {
+            auto           cmd = make_shared<CCommandLine>();
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_SIZE;
+            cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
+
+            //
+            // Equal sizes fall back to the name, which stays ascending
+            //
+
+            for (size_t i = 0; i < CMatchSorter::s_kcMinKeyedEntries; ++i)
+            {
+                WIN32_FIND_DATA wfd  = {};
+                wstring         name = format (L"n{:03}", CMatchSorter::s_kcMinKeyedEntries - 1 - i);
+
+                wfd.nFileSizeLow = (i % 2 == 0) ? 100 : 200;
+                di.AddMatch (FileInfo (wfd), name.c_str());
+            }
+
+            FileComparator comp (cmd, di);
+
+            CMatchSorter (di.m_vMatches, comp).Sort();
+
+            Assert::AreEqual (200ull, di.m_vMatches.front().m_cbSize);
+            Assert::AreEqual (100ull, di.m_vMatches.back().m_cbSize);
+            Assert::AreEqual (wstring (L"n000"), wstring (di.Name (di.m_vMatches.front())));
+            Assert::AreEqual (wstring (L"n001"), wstring (di.Name (di.m_vMatches[CMatchSorter::s_kcMinKeyedEntries / 2])));
+        }
+
+
+
+
+
+        TEST_METHOD(LocaleExtensionSort_NamesWithoutExtensions_StayKeyed)
+        {
+            auto           cmd = make_shared<CCommandLine>();
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_EXTENSION;
+            cmd->m_sortorder           = CCommandLine::ESortOrder::SO_EXTENSION;
+            cmd->m_eNameCompare        = CCommandLine::ENameCompare::Locale;
+
+            //
+            // Every other name has no extension, and so an empty locale key
+            //
+
+            for (size_t i = 0; i < CMatchSorter::s_kcMinKeyedEntries; ++i)
+            {
+                WIN32_FIND_DATA wfd  = {};
+                wstring         name = format (L"n{:03}{}", CMatchSorter::s_kcMinKeyedEntries - 1 - i, (i % 2 == 0) ? L"" : L".txt");
+
+                di.AddMatch (FileInfo (wfd), name.c_str());
+            }
+
+            FileComparator comp (cmd, di);
+
+            Assert::IsTrue (CMatchSorter (di.m_vMatches, comp).Sort(), L"Extensionless names should not force the comparator fallback");
+
+            Assert::AreEqual (wstring (L"n001"),     wstring (di.Name (di.m_vMatches.front())));
+            Assert::AreEqual (wstring (L"n000.txt"), wstring (di.Name (di.m_vMatches[CMatchSorter::s_kcMinKeyedEntries / 2])));
+            Assert::IsTrue (is_sorted (di.m_vMatches.begin(), di.m_vMatches.end(), comp));
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_KeyedSortVsComparator
+        //
+        //  Sorts 200K synthetic entries by name, size, and date, once with
+        //  std::sort and the comparator and once with CMatchSorter, and logs
+        //  both times.  Ignored by default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_KeyedSortVsComparator)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_KeyedSortVsComparator)
+        {
+            static constexpr size_t s_kcEntries = 200000;
+
+            static constexpr pair<CCommandLine::ESortOrder, LPCWSTR> s_krgOrders[] =
+            {
+                { CCommandLine::ESortOrder::SO_NAME, L"name" },
+                { CCommandLine::ESortOrder::SO_SIZE, L"size" },
+                { CCommandLine::ESortOrder::SO_DATE, L"date" },
+            };
+
+            for (const auto & [sortOrder, pszLabel] : s_krgOrders)
+            {
+                auto           cmd = make_shared<CCommandLine>();
+                CDirectoryInfo diComparator (L"C:\\Test", L"*");
+                CDirectoryInfo diKeyed      (L"C:\\Test", L"*");
+
+
+
+                cmd->m_rgSortPreference[0] = sortOrder;
+
+                AddScatteredEntries (diComparator, s_kcEntries);
+                AddScatteredEntries (diKeyed,      s_kcEntries);
+
+                auto start = chrono::steady_clock::now();
+
+                sort (diComparator.m_vMatches.begin(), diComparator.m_vMatches.end(), FileComparator (cmd, diComparator));
+
+                auto middle = chrono::steady_clock::now();
+
+                CMatchSorter (diKeyed.m_vMatches, FileComparator (cmd, diKeyed)).Sort();
+
+                auto end = chrono::steady_clock::now();
+
+                Logger::WriteMessage (format (L"{:5}  {} entries  comparator {:8.1f} ms  keyed {:8.1f} ms\n",
+                                              pszLabel,
+                                              s_kcEntries,
+                                              chrono::duration<double, milli> (middle - start).count(),
+                                              chrono::duration<double, milli> (end - middle).count()).c_str());
+            }
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_OrdinalVsLocaleNameSort
+        //
+        //  Sorts a 1M-entry directory by name with the default ordinal
+        //  comparison and with --Sort=Locale, through both std::sort with
+        //  the comparator and CMatchSorter, and logs the four times.
+        //  Ignored by default.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_OrdinalVsLocaleNameSort)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_OrdinalVsLocaleNameSort)
+        {
+            static constexpr size_t s_kcEntries = 1000000;
+
+            static constexpr pair<CCommandLine::ENameCompare, LPCWSTR> s_krgModes[] =
+            {
+                { CCommandLine::ENameCompare::Ordinal, L"ordinal" },
+                { CCommandLine::ENameCompare::Locale,  L"locale"  },
+            };
+
+            for (const auto & [nameCompare, pszLabel] : s_krgModes)
+            {
+                auto           cmd = make_shared<CCommandLine>();
+                CDirectoryInfo diComparator (L"C:\\Test", L"*");
+                CDirectoryInfo diKeyed      (L"C:\\Test", L"*");
+
+
+
+                cmd->m_eNameCompare = nameCompare;
+
+                AddScatteredEntries (diComparator, s_kcEntries);
+                AddScatteredEntries (diKeyed,      s_kcEntries);
+
+                auto start = chrono::steady_clock::now();
+
+                sort (diComparator.m_vMatches.begin(), diComparator.m_vMatches.end(), FileComparator (cmd, diComparator));
+
+                auto middle = chrono::steady_clock::now();
+
+                CMatchSorter (diKeyed.m_vMatches, FileComparator (cmd, diKeyed)).Sort();
+
+                auto end = chrono::steady_clock::now();
+
+                Logger::WriteMessage (format (L"{:7}  {} names  comparator {:8.1f} ms  keyed {:8.1f} ms\n",
+                                              pszLabel,
+                                              s_kcEntries,
+                                              chrono::duration<double, milli> (middle - start).count(),
+                                              chrono::duration<double, milli> (end - middle).count()).c_str());
+            }
+        }
+    };
+}
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "FileSystemMock.h"
 
+#include "../../TCDirCore/FileSpecMatcher.h"
+
 
 
 
@@ -46,7 +48,7 @@ MockFileTree& MockFileTree::AddFile (LPCWSTR pszPath, ULONGLONG cbSize, DWORD dw
     entry.m_ftLastAccess     = entry.m_ftCreation;
     entry.m_ftLastWrite      = entry.m_ftCreation;
 
-    m_mapDirectories[strParent].m_vEntries.push_back (entry);
+    AddEntry (strParent, entry);
 
     return *this;
 }
@@ -81,12 +83,13 @@ MockFileTree& MockFileTree::AddDirectory (LPCWSTR pszPath, DWORD dwAttributes)
     MockFileEntry entry;
     entry.m_strName          = strName;
     entry.m_dwAttributes     = dwAttributes | FILE_ATTRIBUTE_DIRECTORY;
+    entry.m_dwReparseTag     = (dwAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ? IO_REPARSE_TAG_MOUNT_POINT : 0;
     entry.m_uliSize.QuadPart = 0;
     entry.m_ftCreation       = GetCurrentFileTime();
     entry.m_ftLastAccess     = entry.m_ftCreation;
     entry.m_ftLastWrite      = entry.m_ftCreation;
 
-    m_mapDirectories[strParent].m_vEntries.push_back (entry);
+    AddEntry (strParent, entry);
 
     //
     // Ensure the directory itself exists in the map (even if empty)
@@ -104,6 +107,108 @@ MockFileTree& MockFileTree::AddDirectory (LPCWSTR pszPath, DWORD dwAttributes)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockFileTree::AddLink
+//
+//  Adds a directory link entry to the link's parent.  The link gets no
+//  contents of its own; GetDirectoryContents resolves it to the target.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+MockFileTree& MockFileTree::AddLink (LPCWSTR pszLinkPath, LPCWSTR pszTargetPath, DWORD dwReparseTag)
+{
+    wstring strOriginalPath = pszLinkPath;
+    wstring strPath         = NormalizePath (pszLinkPath);
+    wstring strParent       = GetParentPath (strPath);
+
+    EnsureParentDirectories (strPath);
+
+    MockFileEntry entry;
+    entry.m_strName      = GetFileName (strOriginalPath);
+    entry.m_dwAttributes = FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT;
+    entry.m_dwReparseTag = dwReparseTag;
+    entry.m_ftCreation   = GetCurrentFileTime();
+    entry.m_ftLastAccess = entry.m_ftCreation;
+    entry.m_ftLastWrite  = entry.m_ftCreation;
+
+    AddEntry (strParent, entry);
+    m_mapLinks[strPath] = NormalizePath (pszTargetPath);
+
+    return *this;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockFileTree::Remove
+//
+//  Removes an entry from its parent.  A directory's contents, and those of
+//  every directory below it, go with it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+MockFileTree& MockFileTree::Remove (LPCWSTR pszPath)
+{
+    wstring strPath   = NormalizePath (pszPath);
+    wstring strPrefix = strPath + L"\\";
+    wstring strName   = GetFileName (strPath);
+    auto    itParent  = m_mapDirectories.find (GetParentPath (strPath));
+
+
+
+    if (itParent != m_mapDirectories.end())
+    {
+        vector<MockFileEntry> & vEntries = itParent->second.m_vEntries;
+
+        erase_if (vEntries, [&] (const MockFileEntry & entry)
+        {
+            return _wcsicmp (entry.m_strName.c_str(), strName.c_str()) == 0;
+        });
+
+        ++itParent->second.m_ullStamp;
+    }
+
+    erase_if (m_mapDirectories, [&] (const auto & item)
+    {
+        return item.first == strPath || item.first.starts_with (strPrefix);
+    });
+
+    m_mapLinks.erase (strPath);
+
+    return *this;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockFileTree::AddEntry
+//
+//  Adds an entry to a directory and moves the directory's stamp, as adding
+//  an entry on disk moves its last-write time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void MockFileTree::AddEntry (const wstring & strParent, const MockFileEntry & entry)
+{
+    MockDirectoryContents & contents = m_mapDirectories[strParent];
+
+
+
+    contents.m_vEntries.push_back (entry);
+    ++contents.m_ullStamp;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  MockFileTree::GetDirectoryContents
@@ -112,7 +217,7 @@ MockFileTree& MockFileTree::AddDirectory (LPCWSTR pszPath, DWORD dwAttributes)
 
 const MockDirectoryContents * MockFileTree::GetDirectoryContents (const wstring & strDirPath) const
 {
-    wstring strNormalized = NormalizePath (strDirPath);
+    wstring strNormalized = ResolvePath (strDirPath);
     auto    it = m_mapDirectories.find (strNormalized);
 
     return (it != m_mapDirectories.end()) ? &it->second : nullptr;
@@ -167,6 +272,49 @@ bool MockFileTree::PathExists (const wstring & strPath) const
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockFileTree::ResolvePath
+//
+//  Normalizes a path and replaces any link it passes through with the
+//  link's target, repeatedly, as the file system would when opening it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+wstring MockFileTree::ResolvePath (const wstring & strPath) const
+{
+    wstring strResolved = NormalizePath (strPath);
+
+
+
+    for (size_t cHops = 0; cHops < s_kcMaxLinkHops; ++cHops)
+    {
+        bool fResolved = false;
+
+        for (const auto & [strLink, strTarget] : m_mapLinks)
+        {
+            if (strResolved.compare (0, strLink.length(), strLink) == 0 &&
+                (strResolved.length() == strLink.length() || strResolved[strLink.length()] == L'\\'))
+            {
+                strResolved = strTarget + strResolved.substr (strLink.length());
+                fResolved   = true;
+                break;
+            }
+        }
+
+        if (!fResolved)
+        {
+            break;
+        }
+    }
+
+    return strResolved;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  MockFileTree::EnsureParentDirectories
@@ -216,7 +364,7 @@ void MockFileTree::EnsureParentDirectories (const wstring & strPath)
             entry.m_ftLastAccess = entry.m_ftCreation;
             entry.m_ftLastWrite  = entry.m_ftCreation;
 
-            m_mapDirectories[strGrandparent].m_vEntries.push_back (entry);
+            AddEntry (strGrandparent, entry);
         }
     }
 }
@@ -427,6 +575,9 @@ ScopedFileSystemMock::ScopedFileSystemMock (const MockFileTree & tree)
     m_pPatchFindFirst = make_unique<ScopedIatPatch<decltype(&FindFirstFileW)>> (
         hThisModule, "kernel32.dll", "FindFirstFileW", &Mock_FindFirstFileW);
 
+    m_pPatchFindFirstEx = make_unique<ScopedIatPatch<decltype(&FindFirstFileExW)>> (
+        hThisModule, "kernel32.dll", "FindFirstFileExW", &Mock_FindFirstFileExW);
+
     m_pPatchFindNext = make_unique<ScopedIatPatch<decltype(&FindNextFileW)>> (
         hThisModule, "kernel32.dll", "FindNextFileW", &Mock_FindNextFileW);
 
@@ -454,6 +605,15 @@ HANDLE WINAPI ScopedFileSystemMock::OriginalFindFirstFileW (LPCWSTR lpFileName,
     return FindFirstFileW (lpFileName, lpFindFileData);
 }
 
+HANDLE WINAPI ScopedFileSystemMock::OriginalFindFirstFileExW (LPCWSTR lpFileName, FINDEX_INFO_LEVELS fInfoLevelId, LPVOID lpFindFileData, FINDEX_SEARCH_OPS fSearchOp, LPVOID lpSearchFilter, DWORD dwAdditionalFlags)
+{
+    if (s_pInstance && s_pInstance->m_pPatchFindFirstEx)
+    {
+        return s_pInstance->m_pPatchFindFirstEx->Original() (lpFileName, fInfoLevelId, lpFindFileData, fSearchOp, lpSearchFilter, dwAdditionalFlags);
+    }
+    return FindFirstFileExW (lpFileName, fInfoLevelId, lpFindFileData, fSearchOp, lpSearchFilter, dwAdditionalFlags);
+}
+
 BOOL WINAPI ScopedFileSystemMock::OriginalFindNextFileW (HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData)
 {
     if (s_pInstance && s_pInstance->m_pPatchFindNext)
@@ -567,6 +727,7 @@ static void FillFindData (LPWIN32_FIND_DATAW lpFindData, const MockFileEntry & e
     lpFindData->ftLastWriteTime  = entry.m_ftLastWrite;
     lpFindData->nFileSizeHigh    = entry.m_uliSize.HighPart;
     lpFindData->nFileSizeLow     = entry.m_uliSize.LowPart;
+    lpFindData->dwReserved0      = entry.m_dwReparseTag;
 
     wcscpy_s (lpFindData->cFileName, entry.m_strName.c_str());
 }
@@ -672,6 +833,29 @@ HANDLE WINAPI Mock_FindFirstFileW (LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFind
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Mock_FindFirstFileExW
+//
+//  The info level and LARGE_FETCH flag make no difference to the mock, so
+//  this is FindFirstFileW.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HANDLE WINAPI Mock_FindFirstFileExW (LPCWSTR lpFileName, FINDEX_INFO_LEVELS fInfoLevelId, LPVOID lpFindFileData, FINDEX_SEARCH_OPS fSearchOp, LPVOID lpSearchFilter, DWORD dwAdditionalFlags)
+{
+    if (!FileSystemMockState::Instance().GetMockTree())
+    {
+        return ScopedFileSystemMock::OriginalFindFirstFileExW (lpFileName, fInfoLevelId, lpFindFileData, fSearchOp, lpSearchFilter, dwAdditionalFlags);
+    }
+
+    return Mock_FindFirstFileW (lpFileName, static_cast<LPWIN32_FIND_DATAW> (lpFindFileData));
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Mock_FindNextFileW
@@ -742,3 +926,167 @@ BOOL WINAPI Mock_FindClose (HANDLE hFindFile)
     return TRUE;
 }
 
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockDirectoryEnumerator::MockDirectoryEnumerator
+//
+////////////////////////////////////////////////////////////////////////////////
+
+MockDirectoryEnumerator::MockDirectoryEnumerator (const MockFileTree & tree, size_t cEntriesPerBatch) :
+    m_tree             (tree),
+    m_cEntriesPerBatch (cEntriesPerBatch)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockDirectoryEnumerator::Enumerate
+//
+//  Mirrors FindFirstFile's results: ERROR_PATH_NOT_FOUND for a directory
+//  that is not in the tree, and ERROR_FILE_NOT_FOUND when nothing matches
+//  unless the spec would have matched "." (an empty directory listed with
+//  "*" still succeeds on disk).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT MockDirectoryEnumerator::Enumerate (
+    const filesystem::path & dirPath,
+    const filesystem::path & fileSpec,
+    bool                     fNeedShortNames,
+    const BatchCallback    & onBatch) const
+{
+    const MockDirectoryContents * pContents = m_tree.GetDirectoryContents (dirPath.wstring());
+    CFileSpecMatcher              matcher     ({ fileSpec });
+    vector<WIN32_FIND_DATA>       vBatch;
+    size_t                        cMatched  = 0;
+    bool                          fContinue = true;
+
+    UNREFERENCED_PARAMETER (fNeedShortNames);
+
+
+
+    ++m_cEnumerateCalls;
+
+    if (m_latency.count() > 0)
+    {
+        this_thread::sleep_for (m_latency);
+    }
+
+    if (!pContents)
+    {
+        return HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND);
+    }
+
+    for (const MockFileEntry & entry : pContents->m_vEntries)
+    {
+        WIN32_FIND_DATA wfd;
+
+        FillFindData (&wfd, entry);
+
+        if (!matcher.Matches (wfd))
+        {
+            continue;
+        }
+
+        ++cMatched;
+        vBatch.push_back (wfd);
+
+        if (vBatch.size() == m_cEntriesPerBatch)
+        {
+            ++m_cBatches;
+            fContinue = onBatch (vBatch);
+            vBatch.clear();
+
+            if (!fContinue)
+            {
+                break;
+            }
+        }
+    }
+
+    if (fContinue && !vBatch.empty())
+    {
+        ++m_cBatches;
+        onBatch (vBatch);
+    }
+
+    if (cMatched == 0 && !matcher.MatchesAll())
+    {
+        return HRESULT_FROM_WIN32 (ERROR_FILE_NOT_FOUND);
+    }
+
+    return S_OK;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockDirectoryEnumerator::GetDirectoryId
+//
+//  Every path resolving to the same tree directory gets the same ID, made
+//  from a hash of the resolved path.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT MockDirectoryEnumerator::GetDirectoryId (
+    const filesystem::path & dirPath,
+    SDirectoryId           & id) const
+{
+    wstring strResolved = m_tree.ResolvePath (dirPath.wstring());
+    size_t  hash        = std::hash<wstring>{} (strResolved);
+
+
+
+    if (!m_tree.GetDirectoryContents (strResolved))
+    {
+        return HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND);
+    }
+
+    id                   = SDirectoryId();
+    id.m_ullVolumeSerial = 1;
+    memcpy (id.m_fileId.Identifier, &hash, sizeof (hash));
+
+    return S_OK;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockDirectoryEnumerator::GetDirectoryStamp
+//
+//  Each directory counts the entries added to and removed from it, so its
+//  stamp moves exactly when its last-write time would.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HRESULT MockDirectoryEnumerator::GetDirectoryStamp (
+    const filesystem::path & dirPath,
+    ULONGLONG              & ullStamp) const
+{
+    const MockDirectoryContents * pContents = m_tree.GetDirectoryContents (dirPath.wstring());
+
+
+
+    if (!pContents)
+    {
+        return HRESULT_FROM_WIN32 (ERROR_PATH_NOT_FOUND);
+    }
+
+    ullStamp = pContents->m_ullStamp;
+
+    return S_OK;
+}
@@ -13,10 +13,17 @@
 //      ScopedFileSystemMock mock (tree);
 //      // Now FindFirstFileW (L"C:\\Test\\*") returns mock data
 //
+//  Code that reads directories through IDirectoryEnumerator can instead be
+//  handed a MockDirectoryEnumerator over the same tree, with no patching:
+//
+//      lister.SetDirectoryEnumerator (make_shared<MockDirectoryEnumerator> (tree));
+//
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "../IatHook/ScopedIatPatch.h"
 
+#include "../../TCDirCore/IDirectoryEnumerator.h"
+
 
 
 
@@ -37,13 +44,15 @@ struct MockFileEntry
     FILETIME        m_ftCreation;       // Creation time
     FILETIME        m_ftLastAccess;     // Last access time
     FILETIME        m_ftLastWrite;      // Last write time
+    DWORD           m_dwReparseTag;     // IO_REPARSE_TAG_* (reparse points only)
 
     MockFileEntry() :
         m_dwAttributes (0),
         m_uliSize {},
         m_ftCreation {},
         m_ftLastAccess {},
-        m_ftLastWrite {}
+        m_ftLastWrite {},
+        m_dwReparseTag (0)
     {
     }
 };
@@ -63,6 +72,7 @@ struct MockFileEntry
 struct MockDirectoryContents
 {
     vector<MockFileEntry> m_vEntries;
+    ULONGLONG             m_ullStamp = 0;   // Bumped whenever an entry is added or removed
 };
 
 
@@ -89,14 +99,30 @@ public:
     MockFileTree& AddFile (LPCWSTR pszPath, ULONGLONG cbSize, DWORD dwAttributes = FILE_ATTRIBUTE_ARCHIVE);
     MockFileTree& AddDirectory (LPCWSTR pszPath, DWORD dwAttributes = FILE_ATTRIBUTE_DIRECTORY);
 
+    //
+    // A directory link (junction by default) to another directory in the
+    // tree.  Paths through the link resolve to the target, so links back
+    // up the tree form cycles just as they do on disk.
+    //
+
+    MockFileTree& AddLink (LPCWSTR pszLinkPath, LPCWSTR pszTargetPath, DWORD dwReparseTag = IO_REPARSE_TAG_MOUNT_POINT);
+
+    //
+    // Removes a file, or a directory and everything under it
+    //
+
+    MockFileTree& Remove (LPCWSTR pszPath);
+
     //
     // Query mock data
     //
 
     const MockDirectoryContents * GetDirectoryContents (const wstring & strDirPath) const;
     bool                          PathExists (const wstring & strPath) const;
+    wstring                       ResolvePath (const wstring & strPath) const;
 
 private:
+    void        AddEntry (const wstring & strParent, const MockFileEntry & entry);
     void        EnsureParentDirectories (const wstring & strPath);
     wstring     NormalizePath (const wstring & strPath) const;
     wstring     GetParentPath (const wstring & strPath) const;
@@ -104,6 +130,9 @@ private:
     FILETIME    GetCurrentFileTime() const;
 
     unordered_map<wstring, MockDirectoryContents> m_mapDirectories;  // path -> contents
+    unordered_map<wstring, wstring>               m_mapLinks;        // link path -> target path
+
+    static constexpr size_t s_kcMaxLinkHops = 32;
 };
 
 
@@ -185,13 +214,15 @@ public:
     //
 
     static HANDLE WINAPI OriginalFindFirstFileW (LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData);
+    static HANDLE WINAPI OriginalFindFirstFileExW (LPCWSTR lpFileName, FINDEX_INFO_LEVELS fInfoLevelId, LPVOID lpFindFileData, FINDEX_SEARCH_OPS fSearchOp, LPVOID lpSearchFilter, DWORD dwAdditionalFlags);
     static BOOL   WINAPI OriginalFindNextFileW (HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData);
     static BOOL   WINAPI OriginalFindClose (HANDLE hFindFile);
 
 private:
-    unique_ptr<ScopedIatPatch<decltype(&FindFirstFileW)>> m_pPatchFindFirst;
-    unique_ptr<ScopedIatPatch<decltype(&FindNextFileW)>>  m_pPatchFindNext;
-    unique_ptr<ScopedIatPatch<decltype(&FindClose)>>      m_pPatchFindClose;
+    unique_ptr<ScopedIatPatch<decltype(&FindFirstFileW)>>   m_pPatchFindFirst;
+    unique_ptr<ScopedIatPatch<decltype(&FindFirstFileExW)>> m_pPatchFindFirstEx;
+    unique_ptr<ScopedIatPatch<decltype(&FindNextFileW)>>    m_pPatchFindNext;
+    unique_ptr<ScopedIatPatch<decltype(&FindClose)>>        m_pPatchFindClose;
 
     static ScopedFileSystemMock * s_pInstance;
 };
@@ -200,6 +231,51 @@ private:
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MockDirectoryEnumerator
+//
+//  In-memory IDirectoryEnumerator backend over a MockFileTree.  Specs are
+//  matched with CFileSpecMatcher, so wildcards behave as they do on disk.
+//  The default batch size is deliberately tiny so that tests cross batch
+//  boundaries even on small trees.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class MockDirectoryEnumerator : public IDirectoryEnumerator
+{
+public:
+    explicit MockDirectoryEnumerator (const MockFileTree & tree, size_t cEntriesPerBatch = 2);
+
+    HRESULT Enumerate (const filesystem::path & dirPath,
+                       const filesystem::path & fileSpec,
+                       bool                     fNeedShortNames,
+                       const BatchCallback    & onBatch) const override;
+
+    HRESULT GetDirectoryId (const filesystem::path & dirPath,
+                            SDirectoryId           & id) const override;
+
+    HRESULT GetDirectoryStamp (const filesystem::path & dirPath,
+                               ULONGLONG              & ullStamp) const override;
+
+    size_t GetEnumerateCount (void) const { return m_cEnumerateCalls; }
+    size_t GetBatchCount     (void) const { return m_cBatches; }
+
+    // Simulated per-directory I/O time, so scheduling effects show up in benchmarks
+    void   SetLatency        (chrono::microseconds latency) { m_latency = latency; }
+
+private:
+    const MockFileTree &    m_tree;
+    size_t                  m_cEntriesPerBatch;
+    chrono::microseconds    m_latency         = {};
+    mutable atomic<size_t>  m_cEnumerateCalls = 0;
+    mutable atomic<size_t>  m_cBatches        = 0;
+};
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Mock implementations (declared here, defined in .cpp)
@@ -207,6 +283,7 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 
 HANDLE WINAPI Mock_FindFirstFileW (LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData);
+HANDLE WINAPI Mock_FindFirstFileExW (LPCWSTR lpFileName, FINDEX_INFO_LEVELS fInfoLevelId, LPVOID lpFindFileData, FINDEX_SEARCH_OPS fSearchOp, LPVOID lpSearchFilter, DWORD dwAdditionalFlags);
 BOOL   WINAPI Mock_FindNextFileW (HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData);
 BOOL   WINAPI Mock_FindClose (HANDLE hFindFile);
 
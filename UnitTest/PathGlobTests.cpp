@@ -0,0 +1,181 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/PathGlob.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(PathGlobTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        static WIN32_FIND_DATA MakeEntry (LPCWSTR pszName, bool fDirectory = false)
+        {
+            WIN32_FIND_DATA wfd = {};
+
+
+
+            wcscpy_s (wfd.cFileName, pszName);
+            wfd.dwFileAttributes = fDirectory ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE;
+
+            return wfd;
+        }
+
+        //
+        // Steps from the start state through each directory of a relative path
+        //
+
+        static uint64_t Walk (const CPathGlob & glob, initializer_list<LPCWSTR> dirs)
+        {
+            uint64_t state = glob.GetStartState();
+
+
+
+            for (LPCWSTR pszDir : dirs)
+            {
+                state = glob.Step (state, MakeEntry (pszDir, true));
+            }
+
+            return state;
+        }
+
+
+
+
+
+        TEST_METHOD(IsGlobSpec_OnlySpecsWithSeparators)
+        {
+            Assert::IsTrue  (CPathGlob::IsGlobSpec (L"**\\*.cpp"));
+            Assert::IsTrue  (CPathGlob::IsGlobSpec (L"src/*.h"));
+            Assert::IsFalse (CPathGlob::IsGlobSpec (L"*.cpp"));
+            Assert::IsFalse (CPathGlob::IsGlobSpec (L"*"));
+
+            Assert::IsTrue  (CPathGlob::AnyGlobSpec ({ L"*.h", L"**\\*.cpp" }));
+            Assert::IsFalse (CPathGlob::AnyGlobSpec ({ L"*.h", L"*.cpp" }));
+        }
+
+
+
+
+
+        TEST_METHOD(AnyDirs_MatchesAtEveryDepthIncludingNone)
+        {
+            CPathGlob glob;
+
+
+
+            Assert::AreEqual (S_OK, glob.Compile ({ L"**\\*.cpp" }, false));
+
+            Assert::IsTrue  (glob.Matches (Walk (glob, {}),                     MakeEntry (L"main.cpp")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"a" }),               MakeEntry (L"main.CPP")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"a", L"b", L"c" }),   MakeEntry (L"main.cpp")));
+            Assert::IsFalse (glob.Matches (Walk (glob, { L"a", L"b" }),         MakeEntry (L"main.h")));
+        }
+
+
+
+
+
+        TEST_METHOD(Step_PrunesDirectoriesThatCannotMatch)
+        {
+            CPathGlob glob;
+
+
+
+            Assert::AreEqual (S_OK, glob.Compile ({ L"*\\src\\**\\test_*" }, false));
+
+            // The first segment is any directory, the second must be src
+            Assert::AreNotEqual (0ull, Walk (glob, { L"app" }));
+            Assert::AreNotEqual (0ull, Walk (glob, { L"app", L"SRC", L"deep", L"deeper" }));
+            Assert::AreEqual    (0ull, Walk (glob, { L"app", L"docs" }));
+            Assert::AreEqual    (0ull, Walk (glob, { L"app", L"docs", L"src" }));
+
+            // Files match only once every directory segment has
+            Assert::IsFalse (glob.Matches (Walk (glob, {}),                      MakeEntry (L"test_a.cpp")));
+            Assert::IsFalse (glob.Matches (Walk (glob, { L"app" }),              MakeEntry (L"test_a.cpp")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"app", L"src" }),      MakeEntry (L"test_a.cpp")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"app", L"src", L"x" }), MakeEntry (L"test_b.cpp")));
+            Assert::IsFalse (glob.Matches (Walk (glob, { L"app", L"src" }),      MakeEntry (L"main.cpp")));
+        }
+
+
+
+
+
+        TEST_METHOD(PlainSpecs_ApplyBelowTheRootOnlyWithRecurse)
+        {
+            CPathGlob flat;
+            CPathGlob recursive;
+
+
+
+            Assert::AreEqual (S_OK, flat.Compile      ({ L"*.h", L"src\\*.cpp" }, false));
+            Assert::AreEqual (S_OK, recursive.Compile ({ L"*.h", L"src\\*.cpp" }, true));
+
+            Assert::IsTrue  (flat.Matches (Walk (flat, {}),           MakeEntry (L"a.h")));
+            Assert::IsFalse (flat.Matches (Walk (flat, { L"src" }),   MakeEntry (L"a.h")));
+            Assert::IsTrue  (flat.Matches (Walk (flat, { L"src" }),   MakeEntry (L"a.cpp")));
+            Assert::AreEqual (0ull, Walk (flat, { L"lib" }));
+
+            Assert::IsTrue  (recursive.Matches (Walk (recursive, { L"lib", L"x" }), MakeEntry (L"a.h")));
+            Assert::IsFalse (recursive.Matches (Walk (recursive, { L"lib", L"x" }), MakeEntry (L"a.cpp")));
+        }
+
+
+
+
+
+        TEST_METHOD(TrailingAnyDirs_MatchesEverythingBelow)
+        {
+            CPathGlob glob;
+
+
+
+            Assert::AreEqual (S_OK, glob.Compile ({ L"docs\\**" }, false));
+
+            Assert::IsFalse (glob.Matches (Walk (glob, {}),                   MakeEntry (L"readme.md")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"docs" }),          MakeEntry (L"readme.md")));
+            Assert::IsTrue  (glob.Matches (Walk (glob, { L"docs", L"img" }),  MakeEntry (L"logo", true)));
+        }
+
+
+
+
+
+        TEST_METHOD(Compile_RejectsMoreSegmentsThanFitInAState)
+        {
+            CPathGlob glob;
+            wstring   spec;
+
+
+
+            for (size_t i = 0; i < CPathGlob::s_kcMaxPositions; ++i)
+            {
+                spec += L"d\\";
+            }
+
+            spec += L"*.cpp";
+
+            Assert::AreEqual (E_INVALIDARG, glob.Compile ({ spec }, false));
+        }
+    };
+}
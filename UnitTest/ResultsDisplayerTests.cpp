@@ -56,7 +56,7 @@ namespace UnitTest
 
         // Expose protected members for testing
         wstring      WrapFormatNumber   (ULONGLONG n)                                            { return FormatNumberWithSeparators (n);    }
-        ECloudStatus WrapGetCloudStatus (const WIN32_FIND_DATA & wfd, bool fInSyncRoot = false)  { return GetCloudStatus (wfd, fInSyncRoot); }
+        ECloudStatus WrapGetCloudStatus (const WIN32_FIND_DATA & wfd, bool fInSyncRoot = false)  { return GetCloudStatus (FileInfo (wfd), fInSyncRoot); }
     };
 
 
@@ -105,7 +105,7 @@ namespace UnitTest
 
         wstring_view WrapGetWideFormattedName (const WIN32_FIND_DATA & wfd, LPWSTR pszBuffer, size_t cchBuffer)
         {
-            return GetWideFormattedName (wfd, pszBuffer, cchBuffer);
+            return GetWideFormattedName (FileInfo (wfd), wfd.cFileName, pszBuffer, cchBuffer);
         }
     };
 
@@ -622,11 +622,14 @@ namespace UnitTest
             // Verify that ComputeDisplayWidth adds +2 for icons
             //
 
-            WIN32_FIND_DATA wfd = {};
-            wcscpy_s (wfd.cFileName, L"testfile.txt");
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+            di.AddMatch (FileInfo(), L"testfile.txt");
+
+            const FileInfo & fi = di.m_vMatches[0];
 
-            size_t widthOff = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, false);
-            size_t widthOn  = CResultsDisplayerWide::ComputeDisplayWidth (wfd, true,  false, false);
+            size_t widthOff = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, false);
+            size_t widthOn  = CResultsDisplayerWide::ComputeDisplayWidth (fi, true,  false, false);
 
             Assert::AreEqual (widthOff + 2, widthOn, L"Icons should add +2 to display width");
         }
@@ -640,12 +643,15 @@ namespace UnitTest
             // Verify that ComputeDisplayWidth adds +2 for icons and +2 for sync root
             //
 
-            WIN32_FIND_DATA wfd = {};
-            wcscpy_s (wfd.cFileName, L"testfile.txt");
+            CDirectoryInfo di (L"C:\\Test", L"*");
+
+            di.AddMatch (FileInfo(), L"testfile.txt");
+
+            const FileInfo & fi = di.m_vMatches[0];
 
-            size_t widthPlain    = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, false);
-            size_t widthSync     = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, true);
-            size_t widthIconSync = CResultsDisplayerWide::ComputeDisplayWidth (wfd, true,  false, true);
+            size_t widthPlain    = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, false);
+            size_t widthSync     = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, true);
+            size_t widthIconSync = CResultsDisplayerWide::ComputeDisplayWidth (fi, true,  false, true);
 
             Assert::AreEqual (widthPlain + 2, widthSync, L"Sync root should add +2");
             Assert::AreEqual (widthPlain + 4, widthIconSync, L"Icons + sync should add +4");
@@ -667,7 +673,7 @@ namespace UnitTest
             con->Initialize(cfg);
 
             WIN32_FIND_DATA wfd = CreateMockFileData (L"main.cpp", FILE_ATTRIBUTE_ARCHIVE);
-            auto style = cfg->GetDisplayStyleForFile (wfd);
+            auto style = cfg->GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             // C++ files should have the CPP icon
             Assert::AreEqual (static_cast<char32_t>(NfIcon::MdLanguageCpp), style.m_iconCodePoint,
@@ -687,7 +693,7 @@ namespace UnitTest
             con->Initialize(cfg);
 
             WIN32_FIND_DATA wfd = CreateMockFileData (L"mydir", FILE_ATTRIBUTE_DIRECTORY);
-            auto style = cfg->GetDisplayStyleForFile (wfd);
+            auto style = cfg->GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::CustomFolder), style.m_iconCodePoint,
                              L"Non-well-known directory should get default folder icon");
@@ -705,7 +711,7 @@ namespace UnitTest
             con->Initialize(cfg);
 
             WIN32_FIND_DATA wfd = CreateMockFileData (L"data.xyz123", FILE_ATTRIBUTE_ARCHIVE);
-            auto style = cfg->GetDisplayStyleForFile (wfd);
+            auto style = cfg->GetDisplayStyleForFile (FileInfo (wfd), wfd.cFileName);
 
             Assert::AreEqual (static_cast<char32_t>(NfIcon::FaFile), style.m_iconCodePoint,
                              L"Unknown extension should get default file icon");
@@ -1007,9 +1013,9 @@ namespace UnitTest
             wfd.dwReserved0 = 0x8000001B;  // IO_REPARSE_TAG_APPEXECLINK
 
             FileInfo fi (wfd);
-            fi.m_strReparseTarget = L"C:\\Program Files\\WindowsApps\\Microsoft.DesktopAppInstaller_1.29.30.0_arm64__8wekyb3d8bbwe\\winget.exe";
+            fi.Extras().m_strReparseTarget = L"C:\\Program Files\\WindowsApps\\Microsoft.DesktopAppInstaller_1.29.30.0_arm64__8wekyb3d8bbwe\\winget.exe";
 
-            di.m_vMatches.push_back (move (fi));
+            di.AddMatch (move (fi), wfd.cFileName);
 
             // Render using real CResultsDisplayerNormal (console defaults to 80-wide)
             // At 80-wide, metadata+filename+arrow ~ 51 chars, available ~ 29.
@@ -1051,9 +1057,9 @@ namespace UnitTest
             wfd.dwReserved0 = 0x8000001B;
 
             FileInfo fi (wfd);
-            fi.m_strReparseTarget = L"C:\\Windows\\sysuwp.exe";  // Short enough to fit at 80-width
+            fi.Extras().m_strReparseTarget = L"C:\\Windows\\sysuwp.exe";  // Short enough to fit at 80-width
 
-            di.m_vMatches.push_back (move (fi));
+            di.AddMatch (move (fi), wfd.cFileName);
 
             CResultsDisplayerNormal displayer (cmd, con, cfg, false);
             displayer.DisplayFileResults (di);
@@ -1088,9 +1094,9 @@ namespace UnitTest
             wfd.dwReserved0 = 0x8000001B;
 
             FileInfo fi (wfd);
-            fi.m_strReparseTarget = L"C:\\Program Files\\WindowsApps\\Microsoft.DesktopAppInstaller_1.29.30.0_arm64__8wekyb3d8bbwe\\AppInstallerPythonRedirector.exe";
+            fi.Extras().m_strReparseTarget = L"C:\\Program Files\\WindowsApps\\Microsoft.DesktopAppInstaller_1.29.30.0_arm64__8wekyb3d8bbwe\\AppInstallerPythonRedirector.exe";
 
-            di.m_vMatches.push_back (move (fi));
+            di.AddMatch (move (fi), wfd.cFileName);
 
             CResultsDisplayerNormal displayer (cmd, con, cfg, false);
             displayer.DisplayFileResults (di);
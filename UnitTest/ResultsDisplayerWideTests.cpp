@@ -15,15 +15,15 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 namespace UnitTest
 {
     //
-    // Helper to build a synthetic WIN32_FIND_DATA with a given filename and attributes
+    // Helper to build a synthetic FileInfo with a given filename length and attributes
     //
 
-    static WIN32_FIND_DATA MakeWfd (LPCWSTR pszName, DWORD dwAttrs = 0)
+    static FileInfo MakeFileInfo (LPCWSTR pszName, DWORD dwAttrs = 0)
     {
-        WIN32_FIND_DATA wfd = {};
-        wfd.dwFileAttributes = dwAttrs;
-        wcscpy_s (wfd.cFileName, pszName);
-        return wfd;
+        FileInfo fi;
+        fi.m_dwAttributes = dwAttrs;
+        fi.m_cchName      = static_cast<USHORT> (wcslen (pszName));
+        return fi;
     }
 
 
@@ -42,63 +42,63 @@ namespace UnitTest
 
         TEST_METHOD (PlainFile_ReturnsFileNameLength)
         {
-            auto wfd = MakeWfd (L"readme.txt");
+            auto fi = MakeFileInfo (L"readme.txt");
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, false);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, false);
 
             Assert::AreEqual (static_cast<size_t>(10), w);
         }
 
         TEST_METHOD (Directory_IconsOff_AddsBrackets)
         {
-            auto wfd = MakeWfd (L"docs", FILE_ATTRIBUTE_DIRECTORY);
+            auto fi = MakeFileInfo (L"docs", FILE_ATTRIBUTE_DIRECTORY);
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, false);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, false);
 
             Assert::AreEqual (static_cast<size_t>(6), w);  // [docs] = 4 + 2
         }
 
         TEST_METHOD (Directory_IconsOn_NoBrackets)
         {
-            auto wfd = MakeWfd (L"docs", FILE_ATTRIBUTE_DIRECTORY);
+            auto fi = MakeFileInfo (L"docs", FILE_ATTRIBUTE_DIRECTORY);
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, true, false, false);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, true, false, false);
 
             Assert::AreEqual (static_cast<size_t>(6), w);  // docs(4) + icon(2) = 6
         }
 
         TEST_METHOD (File_WithCloudStatus_AddsTwo)
         {
-            auto wfd = MakeWfd (L"file.txt");
+            auto fi = MakeFileInfo (L"file.txt");
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, true);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, true);
 
             Assert::AreEqual (static_cast<size_t>(10), w);  // 8 + 2 cloud
         }
 
         TEST_METHOD (File_WithIconsAndCloud_AddsFour)
         {
-            auto wfd = MakeWfd (L"file.txt");
+            auto fi = MakeFileInfo (L"file.txt");
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, true, false, true);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, true, false, true);
 
             Assert::AreEqual (static_cast<size_t>(12), w);  // 8 + 2 icon + 2 cloud
         }
 
         TEST_METHOD (File_IconSuppressed_NoIconWidth)
         {
-            auto wfd = MakeWfd (L"file.txt");
+            auto fi = MakeFileInfo (L"file.txt");
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, true, true, false);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, true, true, false);
 
             Assert::AreEqual (static_cast<size_t>(8), w);  // 8 only, no +2
         }
 
         TEST_METHOD (Dir_IconsOff_CloudOn_BracketsAndCloud)
         {
-            auto wfd = MakeWfd (L"src", FILE_ATTRIBUTE_DIRECTORY);
+            auto fi = MakeFileInfo (L"src", FILE_ATTRIBUTE_DIRECTORY);
 
-            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (wfd, false, false, true);
+            size_t w = CResultsDisplayerWide::ComputeDisplayWidth (fi, false, false, true);
 
             Assert::AreEqual (static_cast<size_t>(7), w);  // [src] = 3+2 + 2 cloud = 7
         }
@@ -634,14 +634,10 @@ namespace UnitTest
 
         for (auto pszName : names)
         {
-            FileInfo fi;
-            wcscpy_s (fi.cFileName, pszName);
-            fi.dwFileAttributes = 0;
-
             size_t len = wcslen (pszName);
             if (len > maxLen) maxLen = len;
 
-            pDi->m_vMatches.push_back (fi);
+            pDi->AddMatch (FileInfo(), pszName, len);
             pDi->m_cFiles++;
         }
 
@@ -892,9 +888,8 @@ namespace UnitTest
             CDirectoryInfo di (L"C:\\Test", L"*");
 
             FileInfo fi;
-            wcscpy_s (fi.cFileName, L"MyFolder");
-            fi.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
-            di.m_vMatches.push_back (fi);
+            fi.m_dwAttributes = FILE_ATTRIBUTE_DIRECTORY;
+            di.AddMatch (move (fi), L"MyFolder");
             di.m_cchLargestFileName = 8;
             di.m_cSubDirectories    = 1;
 
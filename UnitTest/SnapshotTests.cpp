@@ -0,0 +1,319 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "Mocks/FileSystemMock.h"
+
+#include "../TCDirCore/Snapshot.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  VectorSnapshotSource
+    //
+    //  Hands out a fixed list of entries, already in snapshot order.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class VectorSnapshotSource : public ISnapshotSource
+    {
+    public:
+        explicit VectorSnapshotSource (vector<SSnapshotEntry> vEntries) :
+            m_vEntries (move (vEntries))
+        {
+        }
+
+        HRESULT Next (SSnapshotEntry & entry) override
+        {
+            if (m_iNext == m_vEntries.size())
+            {
+                return S_FALSE;
+            }
+
+            entry = m_vEntries[m_iNext++];
+            return S_OK;
+        }
+
+    private:
+        vector<SSnapshotEntry> m_vEntries;
+        size_t                 m_iNext = 0;
+    };
+
+
+
+
+
+    TEST_CLASS(SnapshotTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        static SSnapshotEntry MakeEntry (LPCWSTR pszPath, ULONGLONG cbSize, ULONGLONG ftLastWrite = 1000, DWORD dwAttributes = FILE_ATTRIBUTE_ARCHIVE)
+        {
+            SSnapshotEntry entry;
+
+
+
+            entry.m_strPath      = pszPath;
+            entry.m_cbSize       = cbSize;
+            entry.m_ftCreation   = 500;
+            entry.m_ftLastWrite  = ftLastWrite;
+            entry.m_dwAttributes = dwAttributes;
+
+            return entry;
+        }
+
+        static SSnapshotEntry MakeDirectory (LPCWSTR pszPath, ULONGLONG ftLastWrite = 1000)
+        {
+            return MakeEntry (pszPath, 0, ftLastWrite, FILE_ATTRIBUTE_DIRECTORY);
+        }
+
+        static filesystem::path TempSnapshotPath (LPCWSTR pszName)
+        {
+            return filesystem::temp_directory_path() / format (L"TCDirSnapshot_{}_{}.bin", pszName, GetCurrentProcessId());
+        }
+
+        static vector<SSnapshotEntry> ReadAll (ISnapshotSource & source)
+        {
+            vector<SSnapshotEntry> vEntries;
+            SSnapshotEntry         entry;
+
+
+
+            while (source.Next (entry) == S_OK)
+            {
+                vEntries.push_back (entry);
+            }
+
+            return vEntries;
+        }
+
+
+
+
+
+        TEST_METHOD(ComparePaths_PutsContentsRightAfterTheirDirectory)
+        {
+            Assert::IsTrue (CSnapshot::ComparePaths (L"a",       L"a\\b")    < 0);
+            Assert::IsTrue (CSnapshot::ComparePaths (L"a\\b",    L"a.txt")   < 0);
+            Assert::IsTrue (CSnapshot::ComparePaths (L"a\\z\\y", L"ab")      < 0);
+            Assert::IsTrue (CSnapshot::ComparePaths (L"B\\c",    L"a\\c")    > 0);
+            Assert::IsTrue (CSnapshot::ComparePaths (L"Dir\\F",  L"dir\\f")  < 0);
+            Assert::AreEqual (0, CSnapshot::ComparePaths (L"dir\\file", L"dir\\file"));
+        }
+
+
+
+
+
+        TEST_METHOD(LiveSource_WalksDepthFirstInSnapshotOrder)
+        {
+            MockFileTree tree;
+
+
+
+            tree.AddFile      (L"C:\\MockRoot\\b.txt",         10);
+            tree.AddFile      (L"C:\\MockRoot\\a.txt",         20);
+            tree.AddFile      (L"C:\\MockRoot\\a\\z.txt",      30);
+            tree.AddFile      (L"C:\\MockRoot\\a\\deep\\x.cs", 40);
+            tree.AddDirectory (L"C:\\MockRoot\\Empty");
+            tree.AddLink      (L"C:\\MockRoot\\link", L"C:\\MockRoot\\a");
+
+            CLiveSnapshotSource    source (make_shared<MockDirectoryEnumerator> (tree), L"C:\\MockRoot");
+            vector<SSnapshotEntry> vEntries = ReadAll (source);
+            vector<wstring>        vPaths;
+
+
+
+            for (const SSnapshotEntry & entry : vEntries)
+            {
+                vPaths.push_back (entry.m_strPath);
+            }
+
+            // The link is listed but not entered
+            vector<wstring> vExpected = { L"a", L"a\\deep", L"a\\deep\\x.cs", L"a\\z.txt", L"a.txt", L"b.txt", L"Empty", L"link" };
+
+            Assert::IsTrue (vPaths == vExpected);
+            Assert::AreEqual (40ull, vEntries[2].m_cbSize);
+
+            for (size_t i = 1; i < vPaths.size(); ++i)
+            {
+                Assert::IsTrue (CSnapshot::ComparePaths (vPaths[i - 1], vPaths[i]) < 0, vPaths[i].c_str());
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(WriteThenRead_RoundTripsEveryField)
+        {
+            filesystem::path       file      = TempSnapshotPath (L"RoundTrip");
+            vector<SSnapshotEntry> vWritten  =
+            {
+                MakeDirectory (L"bin"),
+                MakeEntry     (L"bin\\app.exe",       123456789012ull, 77, FILE_ATTRIBUTE_READONLY),
+                MakeEntry     (L"bin\\app.pdb",       42),
+                MakeDirectory (L"bin\\x64"),
+                MakeEntry     (L"bin\\x64\\app.exe",  7),
+                MakeEntry     (L"readme.md",          0),
+            };
+            CSnapshotWriter        writer;
+            std::error_code        ec;
+
+
+
+            Assert::AreEqual (S_OK, writer.Create (file, L"C:\\Build\\Out"));
+
+            for (const SSnapshotEntry & entry : vWritten)
+            {
+                Assert::AreEqual (S_OK, writer.Add (entry));
+            }
+
+            Assert::AreEqual (S_OK, writer.Commit());
+            Assert::IsTrue (CSnapshot::IsSnapshot (file));
+
+            {
+                CSnapshotReader reader;
+
+                Assert::AreEqual (S_OK, reader.Open (file));
+                Assert::AreEqual (wstring (L"C:\\Build\\Out"), reader.GetRoot().wstring());
+
+                vector<SSnapshotEntry> vRead = ReadAll (reader);
+
+                Assert::AreEqual (vWritten.size(), vRead.size());
+
+                for (size_t i = 0; i < vWritten.size(); ++i)
+                {
+                    Assert::AreEqual (vWritten[i].m_strPath,      vRead[i].m_strPath);
+                    Assert::AreEqual (vWritten[i].m_cbSize,       vRead[i].m_cbSize);
+                    Assert::AreEqual (vWritten[i].m_ftCreation,   vRead[i].m_ftCreation);
+                    Assert::AreEqual (vWritten[i].m_ftLastWrite,  vRead[i].m_ftLastWrite);
+                    Assert::AreEqual (vWritten[i].m_dwAttributes, vRead[i].m_dwAttributes);
+                }
+            }
+
+            filesystem::remove (file, ec);
+        }
+
+
+
+
+
+        TEST_METHOD(UncommittedOrTruncatedFile_IsRejected)
+        {
+            filesystem::path file = TempSnapshotPath (L"Truncated");
+            std::error_code  ec;
+
+
+
+            {
+                CSnapshotWriter writer;
+
+                Assert::AreEqual (S_OK, writer.Create (file, L"C:\\Root"));
+                Assert::AreEqual (S_OK, writer.Add (MakeEntry (L"file.txt", 1)));
+            }
+
+            // Never committed: no header
+            Assert::IsFalse (CSnapshot::IsSnapshot (file));
+            Assert::IsTrue (FAILED (CSnapshotReader().Open (file)));
+
+            {
+                CSnapshotWriter writer;
+
+                Assert::AreEqual (S_OK, writer.Create (file, L"C:\\Root"));
+                Assert::AreEqual (S_OK, writer.Add (MakeEntry (L"first.txt",  1)));
+                Assert::AreEqual (S_OK, writer.Add (MakeEntry (L"second.txt", 2)));
+                Assert::AreEqual (S_OK, writer.Commit());
+            }
+
+            filesystem::resize_file (file, filesystem::file_size (file) - 4, ec);
+
+            {
+                CSnapshotReader reader;
+                SSnapshotEntry  entry;
+
+                Assert::AreEqual (S_OK, reader.Open (file));
+                Assert::AreEqual (S_OK, reader.Next (entry));
+                Assert::AreEqual (HRESULT_FROM_WIN32 (ERROR_FILE_CORRUPT), reader.Next (entry));
+            }
+
+            filesystem::remove (file, ec);
+        }
+
+
+
+
+
+        //
+        // Removed, added, and changed entries come out in one pass, in
+        // snapshot order.  A directory whose write time moved is not itself
+        // a change; a file whose attributes, size, or write time moved is.
+        //
+
+        TEST_METHOD(Diff_ReportsAddedRemovedAndChanged)
+        {
+            VectorSnapshotSource oldSource ({
+                MakeDirectory (L"bin", 1000),
+                MakeEntry     (L"bin\\app.exe",  100),
+                MakeEntry     (L"bin\\gone.dll", 10),
+                MakeEntry     (L"bin\\same.dll", 20),
+                MakeDirectory (L"obj"),
+                MakeEntry     (L"obj\\a.obj",    5),
+                MakeEntry     (L"readme.md",     1),
+                MakeEntry     (L"touched.txt",   3, 1000),
+            });
+            VectorSnapshotSource newSource ({
+                MakeDirectory (L"bin", 2000),
+                MakeEntry     (L"bin\\app.exe",  200),
+                MakeEntry     (L"bin\\new.dll",  30),
+                MakeEntry     (L"bin\\same.dll", 20),
+                MakeEntry     (L"readme.md",     1, 1000, FILE_ATTRIBUTE_READONLY),
+                MakeEntry     (L"touched.txt",   3, 2000),
+                MakeEntry     (L"zzz.log",       4),
+            });
+            vector<wstring> vChanges;
+
+
+
+            HRESULT hr = CSnapshot::Diff (oldSource, newSource, [&] (CSnapshot::EChange change, const SSnapshotEntry & entry)
+            {
+                static constexpr LPCWSTR s_krgPrefixes[] = { L"+", L"-", L"*" };
+
+                vChanges.push_back (format (L"{} {} {}", s_krgPrefixes[static_cast<size_t> (change)], entry.m_strPath, entry.m_cbSize));
+            });
+
+            vector<wstring> vExpected =
+            {
+                L"* bin\\app.exe 200",
+                L"- bin\\gone.dll 10",
+                L"+ bin\\new.dll 30",
+                L"- obj 0",
+                L"- obj\\a.obj 5",
+                L"* readme.md 1",
+                L"* touched.txt 3",
+                L"+ zzz.log 4",
+            };
+
+            Assert::AreEqual (S_OK, hr);
+            Assert::IsTrue (vChanges == vExpected);
+        }
+    };
+}
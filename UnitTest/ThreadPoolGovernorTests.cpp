@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/ThreadPoolGovernor.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(ThreadPoolGovernorTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        //
+        // One 100 ms window in which cDirectories directories were read at
+        // msLatency each, leaving cQueued waiting.
+        //
+
+        static CThreadPoolGovernor::SSample MakeSample (size_t cDirectories, double msLatency, size_t cQueued)
+        {
+            CThreadPoolGovernor::SSample sample;
+
+
+
+            sample.m_cDirectories = cDirectories;
+            sample.m_elapsed      = chrono::milliseconds (100);
+            sample.m_latency      = chrono::duration_cast<chrono::steady_clock::duration> (chrono::duration<double, milli> (msLatency * cDirectories));
+            sample.m_cQueued      = cQueued;
+
+            return sample;
+        }
+
+
+
+
+
+        TEST_METHOD(StartsAtInitialClampedToRange)
+        {
+            Assert::AreEqual (size_t (4), CThreadPoolGovernor (1, 16, 4).GetActiveWorkers());
+            Assert::AreEqual (size_t (8), CThreadPoolGovernor (1, 8, 32).GetActiveWorkers());
+            Assert::AreEqual (size_t (1), CThreadPoolGovernor (0, 8, 0).GetActiveWorkers());
+        }
+
+
+
+
+
+        TEST_METHOD(GrowsWhileQueueDeeperThanWorkersAndThroughputHolds)
+        {
+            CThreadPoolGovernor governor (1, 16, 4);
+
+
+
+            Assert::AreEqual (size_t (5), governor.Update (MakeSample (100, 4.0, 50)));
+            Assert::AreEqual (size_t (6), governor.Update (MakeSample (125, 4.0, 50)));
+            Assert::AreEqual (size_t (7), governor.Update (MakeSample (150, 4.0, 50)));
+        }
+
+
+
+
+
+        TEST_METHOD(NeverGrowsPastMaximum)
+        {
+            CThreadPoolGovernor governor (1, 6, 4);
+            size_t              cDirectories = 100;
+
+
+
+            for (int i = 0; i < 10; ++i)
+            {
+                cDirectories += 20;
+                Assert::IsTrue (governor.Update (MakeSample (cDirectories, 4.0, 1000)) <= 6);
+            }
+
+            Assert::AreEqual (size_t (6), governor.GetActiveWorkers());
+        }
+
+
+
+
+
+        TEST_METHOD(RevertsGrowThatLowersThroughput)
+        {
+            CThreadPoolGovernor governor (1, 16, 8);
+
+
+
+            Assert::AreEqual (size_t (10), governor.Update (MakeSample (200, 4.0, 50)));
+            Assert::AreEqual (size_t (8),  governor.Update (MakeSample (150, 4.0, 50)));
+        }
+
+
+
+
+
+        TEST_METHOD(RevertsGrowThatOnlyRaisesLatency)
+        {
+            CThreadPoolGovernor governor (1, 16, 8);
+
+
+
+            // Same throughput, but each directory now takes three times as long
+            Assert::AreEqual (size_t (10), governor.Update (MakeSample (200, 4.0,  50)));
+            Assert::AreEqual (size_t (8),  governor.Update (MakeSample (200, 12.0, 50)));
+        }
+
+
+
+
+
+        TEST_METHOD(HoldsOffGrowingAfterRevert)
+        {
+            CThreadPoolGovernor governor (1, 16, 8);
+
+
+
+            governor.Update (MakeSample (200, 4.0, 50));
+            governor.Update (MakeSample (150, 4.0, 50));
+
+            for (UINT i = 0; i + 1 < CThreadPoolGovernor::s_kcBackoffWindows; ++i)
+            {
+                Assert::AreEqual (size_t (8), governor.Update (MakeSample (150, 4.0, 50)));
+            }
+
+            Assert::AreEqual (size_t (10), governor.Update (MakeSample (150, 4.0, 50)));
+        }
+
+
+
+
+
+        TEST_METHOD(ShrinksWhenIdleDownToMinimum)
+        {
+            CThreadPoolGovernor governor (2, 16, 4);
+
+
+
+            Assert::AreEqual (size_t (3), governor.Update (MakeSample (10, 4.0, 0)));
+            Assert::AreEqual (size_t (2), governor.Update (MakeSample (10, 4.0, 0)));
+            Assert::AreEqual (size_t (2), governor.Update (MakeSample (10, 4.0, 0)));
+        }
+
+
+
+
+
+        TEST_METHOD(HoldsSteadyWhenQueueMatchesWorkers)
+        {
+            CThreadPoolGovernor governor (1, 16, 4);
+
+
+
+            Assert::AreEqual (size_t (4), governor.Update (MakeSample (100, 4.0, 3)));
+            Assert::AreEqual (size_t (4), governor.Update (MakeSample (100, 4.0, 4)));
+        }
+    };
+}
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "../TCDirCore/CommandLine.h"
+#include "../TCDirCore/DirectoryInfo.h"
+#include "../TCDirCore/FileComparator.h"
+#include "../TCDirCore/TopMatches.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    TEST_CLASS(TopMatchesTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        //
+        // Entry i of a scattered listing: sizes, times, and names repeat
+        // often enough to tie on the primary attribute, and the directory
+        // part of the path has a dot so an extension sort must ignore it.
+        //
+
+        static pair<FileInfo, wstring> MakeEntry (size_t i)
+        {
+            UINT            uHash = static_cast<UINT> (i * 2654435761u);
+            WIN32_FIND_DATA wfd   = {};
+            wstring         path  = format (L"C:\\Root\\d{}.dir\\file{}{}", uHash % 5, (uHash >> 4) % 40, (uHash % 3 == 0) ? L"" : L".txt");
+
+
+
+            wfd.nFileSizeLow                   = (uHash >> 8) % 64;
+            wfd.ftLastWriteTime.dwHighDateTime = 0x01DA0000;
+            wfd.ftLastWriteTime.dwLowDateTime  = uHash;
+
+            return { FileInfo (wfd), path };
+        }
+
+
+
+
+
+        //
+        // Feeds the same entries to two collectors (as two workers would)
+        // and to one directory, and checks the merged winners are the
+        // directory's first cTop entries after a full sort.
+        //
+
+        static void VerifyTop (CCommandLine::ESortOrder sortOrder, CCommandLine::ESortDirection direction, size_t cTop)
+        {
+            static constexpr size_t s_kcEntries = 3000;
+
+            auto           cmd = make_shared<CCommandLine>();
+            CDirectoryInfo all (L"C:\\Root", L"*");
+
+
+
+            cmd->m_rgSortPreference[0] = sortOrder;
+            cmd->m_sortdirection       = direction;
+
+            CTopMatches first  (cmd, cTop);
+            CTopMatches second (cmd, cTop);
+
+            for (size_t i = 0; i < s_kcEntries; ++i)
+            {
+                auto [fileInfo, path] = MakeEntry (i);
+
+                all.AddMatch (MakeEntry (i).first, path.c_str());
+                (i % 2 == 0 ? first : second).Add (move (fileInfo), path);
+
+                Assert::IsTrue (first.GetCount() < 2 * cTop && second.GetCount() < 2 * cTop);
+            }
+
+            first.Merge (second);
+
+            CDirectoryInfo & winners = first.Finish (L"C:\\Root");
+
+            sort (all.m_vMatches.begin(), all.m_vMatches.end(), FileComparator (cmd, all));
+
+            Assert::AreEqual (cTop, winners.m_vMatches.size());
+            Assert::AreEqual (wstring (L"C:\\Root"), winners.DirPath().wstring());
+
+            for (size_t i = 0; i < cTop; ++i)
+            {
+                Assert::AreEqual (wstring (all.NameView (all.m_vMatches[i])), wstring (winners.NameView (winners.m_vMatches[i])),
+                                  format (L"Mismatch at {} (order {}, direction {})", i, static_cast<int> (sortOrder), static_cast<int> (direction)).c_str());
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(MergedWinnersMatchAFullSort)
+        {
+            static constexpr CCommandLine::ESortOrder s_krgOrders[] =
+            {
+                CCommandLine::ESortOrder::SO_NAME,
+                CCommandLine::ESortOrder::SO_EXTENSION,
+                CCommandLine::ESortOrder::SO_SIZE,
+                CCommandLine::ESortOrder::SO_DATE,
+                CCommandLine::ESortOrder::SO_NATURAL,
+            };
+
+            for (CCommandLine::ESortOrder sortOrder : s_krgOrders)
+            {
+                for (CCommandLine::ESortDirection direction : { CCommandLine::ESortDirection::SD_ASCENDING, CCommandLine::ESortDirection::SD_DESCENDING })
+                {
+                    VerifyTop (sortOrder, direction, 1);
+                    VerifyTop (sortOrder, direction, 50);
+                }
+            }
+        }
+
+
+
+
+
+        TEST_METHOD(FinishCountsOnlyTheWinners)
+        {
+            auto        cmd = make_shared<CCommandLine>();
+            CTopMatches top (cmd, 2);
+
+
+
+            cmd->m_rgSortPreference[0] = CCommandLine::ESortOrder::SO_SIZE;
+            cmd->m_sortdirection       = CCommandLine::ESortDirection::SD_DESCENDING;
+
+            for (DWORD cb : { 10u, 40u, 20u, 30u, 50u })
+            {
+                WIN32_FIND_DATA wfd  = {};
+                wstring         path = format (L"C:\\Root\\f{}.bin", cb);
+
+                wfd.nFileSizeLow = cb;
+                top.Add (FileInfo (wfd), path);
+            }
+
+            CDirectoryInfo & winners = top.Finish (L"C:\\Root");
+
+            Assert::AreEqual (2u,    winners.m_cFiles);
+            Assert::AreEqual (90ull, winners.m_uliBytesUsed.QuadPart);
+            Assert::AreEqual (50ull, winners.m_uliLargestFileSize.QuadPart);
+            Assert::AreEqual (wstring (L"C:\\Root\\f50.bin"), wstring (winners.Name (winners.m_vMatches[0])));
+            Assert::AreEqual (wstring (L"C:\\Root\\f40.bin"), wstring (winners.Name (winners.m_vMatches[1])));
+        }
+    };
+}
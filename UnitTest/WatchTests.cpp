@@ -0,0 +1,355 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+#include "Mocks/FileSystemMock.h"
+#include "Mocks/TestConsole.h"
+
+#include "../TCDirCore/ChangeCoalescer.h"
+#include "../TCDirCore/CommandLine.h"
+#include "../TCDirCore/Config.h"
+#include "../TCDirCore/PollingChangeNotifier.h"
+#include "../TCDirCore/WatchLister.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  ScriptedChangeNotifier
+    //
+    //  Reports one change per WaitForChanges call from a fixed list, then
+    //  times out.  With fEndless set it never runs out, as a tree that is
+    //  written to without pause.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class ScriptedChangeNotifier : public IChangeNotifier
+    {
+    public:
+        ScriptedChangeNotifier (vector<filesystem::path> vChanges, bool fEndless = false) :
+            m_vChanges (move (vChanges)),
+            m_fEndless (fEndless)
+        {
+        }
+
+        HRESULT Watch (const filesystem::path &, bool) override
+        {
+            return S_OK;
+        }
+
+        HRESULT WaitForChanges (DWORD, SChangeSet & changes) override
+        {
+            ++m_cWaits;
+
+            if (m_fEndless)
+            {
+                this_thread::sleep_for (chrono::milliseconds (1));
+                changes.m_changedDirs.insert (format (L"C:\\MockRoot\\d{}", m_cWaits));
+                return S_OK;
+            }
+
+            if (m_iNext == m_vChanges.size())
+            {
+                return S_FALSE;
+            }
+
+            changes.m_changedDirs.insert (m_vChanges[m_iNext++]);
+            return S_OK;
+        }
+
+        size_t GetWaitCount (void) const { return m_cWaits; }
+
+    private:
+        vector<filesystem::path> m_vChanges;
+        bool                     m_fEndless;
+        size_t                   m_iNext  = 0;
+        size_t                   m_cWaits = 0;
+    };
+
+
+
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  ListingRecordingDisplayer
+    //
+    //  Records "<dir> <file count>" for each DisplayResults call.  The log
+    //  lives outside the displayer because the lister takes ownership of it.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    class ListingRecordingDisplayer : public IResultsDisplayer
+    {
+    public:
+        explicit ListingRecordingDisplayer (vector<wstring> & vDisplayed) :
+            m_vDisplayed (vDisplayed)
+        {
+        }
+
+        void DisplayResults (const CDriveInfo &, const CDirectoryInfo & di, EDirectoryLevel) override
+        {
+            m_vDisplayed.push_back (format (L"{} {}", di.DirPath().wstring(), di.m_cFiles));
+        }
+
+        void DisplayRecursiveSummary (const CDirectoryInfo &, const SListingTotals &) override {}
+
+    private:
+        vector<wstring> & m_vDisplayed;
+    };
+
+
+
+
+
+    TEST_CLASS(WatchTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        static SChangeSet Changed (initializer_list<LPCWSTR> dirs)
+        {
+            SChangeSet changes;
+
+
+
+            for (LPCWSTR pszDir : dirs)
+            {
+                changes.m_changedDirs.insert (pszDir);
+            }
+
+            return changes;
+        }
+
+        static void BuildTree (MockFileTree & tree)
+        {
+            tree.AddFile (L"C:\\MockRoot\\a.txt",            10);
+            tree.AddFile (L"C:\\MockRoot\\sub\\b.txt",       20);
+            tree.AddFile (L"C:\\MockRoot\\sub\\deep\\c.txt", 30);
+            tree.AddFile (L"C:\\MockRoot\\other\\d.txt",     40);
+        }
+
+
+
+
+
+        TEST_METHOD(Polling_ReportsOnlyDirectoriesThatChanged)
+        {
+            MockFileTree           tree;
+            CPollingChangeNotifier notifier (make_shared<MockDirectoryEnumerator> (tree), chrono::milliseconds (0));
+            SChangeSet             changes;
+
+
+
+            BuildTree (tree);
+
+            Assert::AreEqual (S_OK, notifier.Watch (L"C:\\MockRoot", true));
+            Assert::AreEqual (S_FALSE, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.IsEmpty());
+
+            tree.AddFile (L"C:\\MockRoot\\sub\\deep\\e.txt", 50);
+
+            Assert::AreEqual (S_OK, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.m_changedDirs == Changed ({ L"C:\\MockRoot\\sub\\deep" }).m_changedDirs);
+            Assert::IsFalse (changes.m_fRescan);
+
+            // Nothing new since the last poll
+            changes = {};
+            Assert::AreEqual (S_FALSE, notifier.WaitForChanges (0, changes));
+        }
+
+
+
+
+
+        TEST_METHOD(Polling_WatchesNewDirectoriesAndDropsRemovedOnes)
+        {
+            MockFileTree           tree;
+            CPollingChangeNotifier notifier (make_shared<MockDirectoryEnumerator> (tree), chrono::milliseconds (0));
+            SChangeSet             changes;
+
+
+
+            BuildTree (tree);
+            Assert::AreEqual (S_OK, notifier.Watch (L"C:\\MockRoot", true));
+
+            tree.AddDirectory (L"C:\\MockRoot\\new");
+
+            Assert::AreEqual (S_OK, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.m_changedDirs == Changed ({ L"C:\\MockRoot" }).m_changedDirs);
+
+            // The new directory is watched from then on
+            changes = {};
+            tree.AddFile (L"C:\\MockRoot\\new\\f.txt", 60);
+
+            Assert::AreEqual (S_OK, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.m_changedDirs == Changed ({ L"C:\\MockRoot\\new" }).m_changedDirs);
+
+            // Removing a directory reports its parent and the directories
+            // that went with it, once
+            changes = {};
+            tree.Remove (L"C:\\MockRoot\\sub");
+
+            Assert::AreEqual (S_OK, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.m_changedDirs.contains (L"C:\\MockRoot"));
+            Assert::IsTrue (changes.m_changedDirs.contains (L"C:\\MockRoot\\sub"));
+
+            changes = {};
+            Assert::AreEqual (S_FALSE, notifier.WaitForChanges (0, changes));
+        }
+
+
+
+
+
+        TEST_METHOD(Polling_NonRecursiveWatchesOnlyTheRoot)
+        {
+            MockFileTree           tree;
+            CPollingChangeNotifier notifier (make_shared<MockDirectoryEnumerator> (tree), chrono::milliseconds (0));
+            SChangeSet             changes;
+
+
+
+            BuildTree (tree);
+            Assert::AreEqual (S_OK, notifier.Watch (L"C:\\MockRoot", false));
+
+            tree.AddFile (L"C:\\MockRoot\\sub\\g.txt", 70);
+            Assert::AreEqual (S_FALSE, notifier.WaitForChanges (0, changes));
+
+            tree.AddFile (L"C:\\MockRoot\\h.txt", 80);
+            Assert::AreEqual (S_OK, notifier.WaitForChanges (0, changes));
+            Assert::IsTrue (changes.m_changedDirs == Changed ({ L"C:\\MockRoot" }).m_changedDirs);
+        }
+
+
+
+
+
+        TEST_METHOD(Coalescer_MergesABurstIntoOneSet)
+        {
+            ScriptedChangeNotifier notifier ({ L"C:\\MockRoot\\a", L"C:\\MockRoot\\b", L"C:\\MockRoot\\a", L"C:\\MockRoot\\c" });
+            CChangeCoalescer       coalescer (notifier, chrono::milliseconds (10), chrono::seconds (60));
+            SChangeSet             changes;
+
+
+
+            Assert::AreEqual (S_OK, coalescer.Wait (changes));
+            Assert::AreEqual (size_t (3), changes.m_changedDirs.size());
+
+            // Four changes, then the timeout that ended the burst
+            Assert::AreEqual (size_t (5), notifier.GetWaitCount());
+        }
+
+
+
+
+
+        TEST_METHOD(Coalescer_MaxDelayBoundsAnEndlessBurst)
+        {
+            ScriptedChangeNotifier notifier ({}, true);
+            CChangeCoalescer       coalescer (notifier, chrono::milliseconds (10), chrono::milliseconds (50));
+            SChangeSet             changes;
+            auto                   start = chrono::steady_clock::now();
+
+
+
+            Assert::AreEqual (S_OK, coalescer.Wait (changes));
+            Assert::IsTrue (chrono::steady_clock::now() - start < chrono::seconds (5));
+            Assert::IsTrue (changes.m_changedDirs.size() > 1);
+        }
+
+
+
+
+
+        TEST_METHOD(Lister_RefreshReadsOnlyChangedDirectories)
+        {
+            MockFileTree    tree;
+            vector<wstring> vDisplayed;
+
+
+
+            BuildTree (tree);
+
+            auto pEnumerator = make_shared<MockDirectoryEnumerator> (tree);
+            auto cmdLine     = make_shared<CCommandLine> ();
+            auto console     = make_shared<CTestConsole> ();
+            auto config      = make_shared<CConfig> ();
+
+            cmdLine->m_fRecurse = true;
+            console->Initialize (config);
+
+            CWatchLister lister (cmdLine, console, config, make_unique<ListingRecordingDisplayer> (vDisplayed));
+
+            lister.SetDirectoryEnumerator (pEnumerator);
+
+            Assert::AreEqual (S_OK, lister.Load (MaskGroup (L"C:\\MockRoot\\", { L"*" })));
+            Assert::AreEqual (size_t (4), pEnumerator->GetEnumerateCount());
+
+            // A file added deep in the tree re-reads just that directory.
+            // Subdirectories show in the order they were enumerated.
+            tree.AddFile (L"C:\\MockRoot\\sub\\deep\\e.txt", 50);
+
+            Assert::AreEqual (size_t (1), lister.Refresh (Changed ({ L"C:\\MockRoot\\sub\\deep" })));
+            Assert::AreEqual (size_t (5), pEnumerator->GetEnumerateCount());
+
+            lister.Display();
+
+            vector<wstring> vExpected =
+            {
+                L"C:\\MockRoot 1",
+                L"C:\\MockRoot\\sub 1",
+                L"C:\\MockRoot\\sub\\deep 2",
+                L"C:\\MockRoot\\other 1",
+            };
+
+            Assert::IsTrue (vDisplayed == vExpected);
+
+            // A new directory is read along with its parent; a removed one
+            // drops out with nothing else re-read
+            tree.AddFile (L"C:\\MockRoot\\new\\f.txt", 60);
+            tree.Remove (L"C:\\MockRoot\\other");
+
+            Assert::AreEqual (size_t (2), lister.Refresh (Changed ({ L"C:\\MockRoot", L"C:\\MockRoot\\other" })));
+            Assert::AreEqual (size_t (7), pEnumerator->GetEnumerateCount());
+
+            vDisplayed.clear();
+            lister.Display();
+
+            vExpected =
+            {
+                L"C:\\MockRoot 1",
+                L"C:\\MockRoot\\sub 1",
+                L"C:\\MockRoot\\sub\\deep 2",
+                L"C:\\MockRoot\\new 1",
+            };
+
+            Assert::IsTrue (vDisplayed == vExpected);
+
+            // Changes outside the tree are ignored; a rescan reads it all
+            Assert::AreEqual (size_t (0), lister.Refresh (Changed ({ L"C:\\Elsewhere" })));
+
+            SChangeSet rescan;
+
+            rescan.m_fRescan = true;
+
+            Assert::AreEqual (size_t (4), lister.Refresh (rescan));
+        }
+    };
+}
@@ -0,0 +1,468 @@
+#include "pch.h"
+#include "EhmTestHelper.h"
+
+#include "../TCDirCore/WorkQueue.h"
+#include "../TCDirCore/WorkStealingQueue.h"
+
+
+
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+
+
+
+
+namespace UnitTest
+{
+    ////////////////////////////////////////////////////////////////////////////
+    //
+    //  SSyntheticNode
+    //
+    //  Work item for the synthetic directory tree.  Processing a node at a
+    //  given level burns a fixed amount of CPU (standing in for one
+    //  FindFirstFile/FindNextFile pass) and pushes s_krgFanOut[level]
+    //  children.
+    //
+    ////////////////////////////////////////////////////////////////////////////
+
+    struct SSyntheticNode
+    {
+        UINT m_level = 0;
+
+        bool operator< (const SSyntheticNode & other) const { return m_level < other.m_level; }
+    };
+
+
+
+
+
+    TEST_CLASS(WorkQueueTests)
+    {
+    public:
+
+        TEST_CLASS_INITIALIZE(ClassInitialize)
+        {
+            SetupEhmForUnitTests();
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_LocalPushPopsLifo)
+        {
+            CWorkStealingQueue<int> queue (1);
+            int                     item = 0;
+
+
+
+            queue.Push (0);
+            Assert::IsTrue (queue.Pop (0, item));
+
+            // Pushes from a worker thread go to that worker's own deque
+            queue.Push (1);
+            queue.Push (2);
+            queue.Push (3);
+
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (3, item);
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (2, item);
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (1, item);
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_StealTakesOldestItem)
+        {
+            CWorkStealingQueue<int> queue (2);
+            int                     item = 0;
+
+
+
+            // External push lands on worker 0's deque (round robin starts at 0)
+            queue.Push (0);
+            Assert::IsTrue (queue.Pop (0, item));
+
+            queue.Push (1);
+            queue.Push (2);
+            queue.Push (3);
+
+            // Worker 1 has nothing of its own, so it steals from the front
+            Assert::IsTrue (queue.Pop (1, item));
+            Assert::AreEqual (1, item);
+
+            // Worker 0 still pops its newest item
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (3, item);
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_SetDoneWakesIdleWorker)
+        {
+            CWorkStealingQueue<int> queue (2);
+            atomic<bool>            fPopResult = true;
+
+
+
+            thread worker ([&]() {
+                int item = 0;
+                fPopResult = queue.Pop (1, item);
+            });
+
+            this_thread::sleep_for (chrono::milliseconds (20));
+            queue.SetDone();
+            worker.join();
+
+            Assert::IsFalse (fPopResult.load());
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_PushAfterDoneIgnored)
+        {
+            CWorkStealingQueue<int> queue (1);
+            int                     item = 0;
+
+
+
+            queue.SetDone();
+            queue.Push (42);
+
+            Assert::IsFalse (queue.Pop (0, item));
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_UrgentItemsPopFirstLowestFirst)
+        {
+            CWorkStealingQueue<int> queue (2);
+            int                     item = 0;
+
+
+
+            queue.Push (0);
+            Assert::IsTrue (queue.Pop (0, item));
+
+            queue.Push (1);
+            queue.Push (2);
+            queue.PushUrgent (9);
+            queue.PushUrgent (5);
+            queue.PushUrgent (7);
+
+            // Any worker drains the urgent lane, lowest first, before its own deque
+            Assert::IsTrue (queue.Pop (1, item));
+            Assert::AreEqual (5, item);
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (7, item);
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (9, item);
+            Assert::IsTrue (queue.Pop (0, item));
+            Assert::AreEqual (2, item);
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_UrgentPushWakesIdleWorker)
+        {
+            CWorkStealingQueue<int> queue (2);
+            atomic<int>             popped = -1;
+
+
+
+            thread worker ([&]() {
+                int item = 0;
+
+                if (queue.Pop (1, item))
+                {
+                    popped = item;
+                }
+            });
+
+            this_thread::sleep_for (chrono::milliseconds (20));
+            queue.PushUrgent (42);
+            worker.join();
+
+            Assert::AreEqual (42, popped.load());
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_QueuedCountNeverExceedsItemsInFlight)
+        {
+            static constexpr size_t s_kcWorkers = 4;
+            static constexpr size_t s_kcItems   = 8;
+            static constexpr int    s_kcRounds  = 20000;
+
+            CWorkStealingQueue<int> queue (s_kcWorkers);
+            atomic<bool>            fStop      = false;
+            atomic<size_t>          cMaxQueued = 0;
+            vector<thread>          vWorkers;
+
+
+
+            for (size_t i = 0; i < s_kcItems; ++i)
+            {
+                queue.Push (static_cast<int> (i));
+            }
+
+            //
+            // Every worker pops an item and pushes it straight back, so the
+            // same items keep being stolen between deques while the count
+            // is sampled.  Counting an item only after it was pushed let a
+            // thief decrement first and wrap the count past SIZE_MAX.
+            //
+
+            for (size_t iWorker = 0; iWorker < s_kcWorkers; ++iWorker)
+            {
+                vWorkers.emplace_back ([&, iWorker]() {
+                    int item = 0;
+
+                    for (int i = 0; i < s_kcRounds && queue.Pop (iWorker, item); ++i)
+                    {
+                        if (i % 2 == 0)
+                        {
+                            queue.Push (item);
+                        }
+                        else
+                        {
+                            queue.PushUrgent (item);
+                        }
+                    }
+                });
+            }
+
+            thread sampler ([&]() {
+                while (!fStop.load())
+                {
+                    size_t cQueued = queue.GetQueuedCount();
+
+                    if (cQueued > cMaxQueued.load())
+                    {
+                        cMaxQueued = cQueued;
+                    }
+                }
+            });
+
+            for (thread & worker : vWorkers)
+            {
+                worker.join();
+            }
+
+            fStop = true;
+            sampler.join();
+            queue.SetDone();
+
+            Assert::IsTrue (cMaxQueued.load() <= s_kcItems);
+        }
+
+
+
+
+
+        TEST_METHOD(WorkStealing_ProcessesEverySyntheticNodeOnce)
+        {
+            CWorkStealingQueue<SSyntheticNode> queue (4);
+
+            ULONGLONG cProcessed = RunSyntheticTree (queue, 4, 0);
+
+
+
+            Assert::AreEqual (GetSyntheticTreeSize(), cProcessed);
+        }
+
+
+
+
+
+        TEST_METHOD(WorkQueue_ProcessesEverySyntheticNodeOnce)
+        {
+            CWorkQueue<SSyntheticNode> queue;
+
+            ULONGLONG cProcessed = RunSyntheticTree (queue, 4, 0);
+
+
+
+            Assert::AreEqual (GetSyntheticTreeSize(), cProcessed);
+        }
+
+
+
+
+
+        ////////////////////////////////////////////////////////////////////////
+        //
+        //  Benchmark_SchedulerThroughput
+        //
+        //  Compares the single-lock FIFO CWorkQueue against the work-stealing
+        //  scheduler on the synthetic wide-and-deep tree at several worker
+        //  counts.  Ignored by default; run explicitly from Test Explorer or
+        //  with vstest.console /Tests:Benchmark_SchedulerThroughput.
+        //
+        ////////////////////////////////////////////////////////////////////////
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_SchedulerThroughput)
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(Benchmark_SchedulerThroughput)
+        {
+            static constexpr UINT s_kcIterations = 5;
+            static constexpr UINT s_kcSpin       = 2000;
+
+            UINT cMaxWorkers = max (1u, thread::hardware_concurrency());
+
+
+
+            for (UINT cWorkers = 1; cWorkers <= cMaxWorkers * 2; cWorkers *= 2)
+            {
+                double msFifo     = 0;
+                double msStealing = 0;
+
+                for (UINT i = 0; i < s_kcIterations; ++i)
+                {
+                    CWorkQueue<SSyntheticNode>         fifo;
+                    CWorkStealingQueue<SSyntheticNode> stealing (cWorkers);
+
+                    msFifo     += TimeSyntheticTree (fifo,     cWorkers, s_kcSpin);
+                    msStealing += TimeSyntheticTree (stealing, cWorkers, s_kcSpin);
+                }
+
+                Logger::WriteMessage (format (L"{0,3} workers, {1} nodes:  CWorkQueue {2:8.2f} ms   CWorkStealingQueue {3:8.2f} ms   ({4:.2f}x)\n",
+                                              cWorkers,
+                                              GetSyntheticTreeSize(),
+                                              msFifo     / s_kcIterations,
+                                              msStealing / s_kcIterations,
+                                              msFifo / msStealing).c_str());
+            }
+        }
+
+
+
+
+
+    private:
+
+        //
+        // Wide-and-deep shape: a very wide top level (like a source tree's
+        // many sibling folders) with deep, narrow chains beneath it and a
+        // bushy tail at the bottom.
+        //
+
+        static constexpr UINT s_krgFanOut[] = { 2000, 2, 1, 1, 1, 1, 4, 4, 0 };
+
+
+
+
+
+        static ULONGLONG GetSyntheticTreeSize()
+        {
+            ULONGLONG cNodes   = 1;
+            ULONGLONG cAtLevel = 1;
+
+
+
+            for (UINT fanOut : s_krgFanOut)
+            {
+                cAtLevel *= fanOut;
+                cNodes   += cAtLevel;
+            }
+
+            return cNodes;
+        }
+
+
+
+
+
+        static ULONGLONG RunSyntheticTree (IWorkQueue<SSyntheticNode> & queue, UINT cWorkers, UINT cSpin)
+        {
+            atomic<ULONGLONG> cOutstanding = 1;
+            atomic<ULONGLONG> cProcessed   = 0;
+            vector<jthread>   workers;
+
+
+
+            queue.Push (SSyntheticNode { 0 });
+
+            for (UINT iWorker = 0; iWorker < cWorkers; ++iWorker)
+            {
+                workers.emplace_back ([&, iWorker]() {
+                    SSyntheticNode node;
+
+                    while (queue.Pop (iWorker, node))
+                    {
+                        UINT cChildren = s_krgFanOut[node.m_level];
+
+                        SpinWork (cSpin);
+
+                        cOutstanding.fetch_add (cChildren);
+
+                        for (UINT i = 0; i < cChildren; ++i)
+                        {
+                            queue.Push (SSyntheticNode { node.m_level + 1 });
+                        }
+
+                        cProcessed.fetch_add (1);
+
+                        if (cOutstanding.fetch_sub (1) == 1)
+                        {
+                            queue.SetDone();
+                        }
+                    }
+                });
+            }
+
+            workers.clear();
+
+            return cProcessed.load();
+        }
+
+
+
+
+
+        static double TimeSyntheticTree (IWorkQueue<SSyntheticNode> & queue, UINT cWorkers, UINT cSpin)
+        {
+            auto start = chrono::steady_clock::now();
+
+
+
+            RunSyntheticTree (queue, cWorkers, cSpin);
+
+            return chrono::duration<double, milli> (chrono::steady_clock::now() - start).count();
+        }
+
+
+
+
+
+        static void SpinWork (UINT cSpin)
+        {
+            volatile UINT hash = 2166136261u;
+
+
+
+            for (UINT i = 0; i < cSpin; ++i)
+            {
+                hash = (hash ^ i) * 16777619u;
+            }
+        }
+    };
+}